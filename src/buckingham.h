@@ -290,6 +290,28 @@ MDINLINE void add_buck_pair_force(Particle *p1, Particle *p2, IA_parameters *ia_
   }
 }
 
+/** Calculate the Buckingham force factor for a pair at distance dist,
+    i. e. the force on particle 1 is fac*d. Particle free version of
+    \ref add_buck_pair_force for the packed force loop. */
+MDINLINE double buck_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  if(dist < ia_params->BUCK_cut) {
+    if(ia_params->BUCK_capradius==0.0) {
+      /* true buckingham region or linear region */
+      if(dist > ia_params->BUCK_discont)
+	return buck_force_r(ia_params->BUCK_A, ia_params->BUCK_B, ia_params->BUCK_C, ia_params->BUCK_D, dist)/dist;
+      else
+	return -ia_params->BUCK_F2/dist;
+    }
+    /* capped potential */
+    else if(dist > ia_params->BUCK_capradius)
+      return buck_force_r(ia_params->BUCK_A, ia_params->BUCK_B, ia_params->BUCK_C, ia_params->BUCK_D, dist)/dist;
+    else
+      return buck_force_r(ia_params->BUCK_A, ia_params->BUCK_B, ia_params->BUCK_C, ia_params->BUCK_D, ia_params->BUCK_capradius)/dist;
+  }
+  return 0.0;
+}
+
 /** calculate Buckingham energy between particle p1 and p2. */
 MDINLINE double buck_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
 				double d[3], double dist)
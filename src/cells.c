@@ -40,6 +40,7 @@
 #include "domain_decomposition.h"
 #include "nsquare.h"
 #include "layered.h"
+#include "packed_cells.h"
 
 /* Variables */
 
@@ -147,11 +148,18 @@ static void topology_init(int cs, CellPList *local) {
     dd_topology_init(local);
     break;
   case CELL_STRUCTURE_NSQUARE:
-    nsq_topology_init(local);
-    break;
-  case CELL_STRUCTURE_LAYERED:
-    layered_topology_init(local);
+  case CELL_STRUCTURE_LAYERED: {
+    /* only the domain decomposition can use unequal domains */
+    int dir;
+    for (dir = 0; dir < 3; dir++)
+      if (node_bound[dir])
+	set_node_bound(dir, NULL);
+    if (cs == CELL_STRUCTURE_NSQUARE)
+      nsq_topology_init(local);
+    else
+      layered_topology_init(local);
     break;
+  }
   default:
     fprintf(stderr, "INTERNAL ERROR: attempting to sort the particles in an unknown way\n");
     errexit();
@@ -175,20 +183,69 @@ int tclcommand_cellsystem(ClientData data, Tcl_Interp *interp,
   }
 
   if (ARG1_IS_S("domain_decomposition")) {
-    if (argc > 2) {
-      if (ARG_IS_S(2,"-verlet_list"))
+    int i;
+    /** by default use verlet list and the packed force loop */
+    dd.use_vList  = 1;
+    dd.use_packed = 1;
+    dd.use_clusters = 0;
+    dd.use_eighth_shell = 0;
+    dd.use_overlap = 0;
+    dd.balance_interval = 0;
+    dd.sort_particles = 0;
+    dd.sort_cells = 0;
+    dd.use_incremental = 0;
+    for (i = 2; i < argc; i++) {
+      if (ARG_IS_S(i,"-verlet_list")) {
 	dd.use_vList = 1;
-      else if(ARG_IS_S(2,"-no_verlet_list")) 
+	dd.use_clusters = 0;
+      }
+      else if(ARG_IS_S(i,"-no_verlet_list")) {
 	dd.use_vList = 0;
+	dd.use_clusters = 0;
+      }
+      else if(ARG_IS_S(i,"-cluster_list")) {
+	/* the cluster lists use the verlet list rebuild criterion */
+	dd.use_vList = 1;
+	dd.use_clusters = 1;
+      }
+      else if(ARG_IS_S(i,"-packed"))
+	dd.use_packed = 1;
+      else if(ARG_IS_S(i,"-no_packed"))
+	dd.use_packed = 0;
+      else if(ARG_IS_S(i,"-eighth_shell"))
+	dd.use_eighth_shell = 1;
+      else if(ARG_IS_S(i,"-full_shell"))
+	dd.use_eighth_shell = 0;
+      else if(ARG_IS_S(i,"-overlap_comm"))
+	dd.use_overlap = 1;
+      else if(ARG_IS_S(i,"-no_overlap_comm"))
+	dd.use_overlap = 0;
+      else if(ARG_IS_S(i,"-load_balance")) {
+	if (i + 1 >= argc) {
+	  Tcl_AppendResult(interp, "-load_balance needs the number of time steps between two balancing steps", (char *)NULL);
+	  return TCL_ERROR;
+	}
+	if (!ARG_IS_I(i + 1, dd.balance_interval))
+	  return TCL_ERROR;
+	if (dd.balance_interval < 0) {
+	  Tcl_AppendResult(interp, "load balancing interval must not be negative", (char *)NULL);
+	  return TCL_ERROR;
+	}
+	i++;
+      }
+      else if(ARG_IS_S(i,"-sort_particles"))
+	dd.sort_particles = 1;
+      else if(ARG_IS_S(i,"-sort_cells"))
+	dd.sort_cells = 1;
+      else if(ARG_IS_S(i,"-incremental_verlet_list"))
+	dd.use_incremental = 1;
       else{
 	Tcl_AppendResult(interp, "wrong flag to",argv[0],
-			 " : should be \" -verlet_list or -no_verlet_list \"",
+			 " : should be \" -verlet_list, -no_verlet_list, -cluster_list, -packed, -no_packed, -eighth_shell, -full_shell, -overlap_comm, -no_overlap_comm, -load_balance <interval>, -sort_particles, -sort_cells or -incremental_verlet_list \"",
 			 (char *) NULL);
 	return (TCL_ERROR);
       }
     }
-    /** by default use verlet list */
-    else dd.use_vList = 1;
     mpi_bcast_cell_structure(CELL_STRUCTURE_DOMDEC);
   }
   else if (ARG1_IS_S("nsquare"))
@@ -374,6 +431,8 @@ void cells_resort_particles(int global_flag)
     break;
   case CELL_STRUCTURE_DOMDEC:
     dd_exchange_and_sort_particles(global_flag);
+    if (dd.sort_particles)
+      dd_sort_particles();
     break;
   }
 
@@ -385,6 +444,10 @@ void cells_resort_particles(int global_flag)
   ghost_communicator(&cell_structure.ghost_cells_comm);
   ghost_communicator(&cell_structure.exchange_ghosts_comm);
 
+  /* adapt the packed force loop data to the new particle distribution */
+  if (cell_structure.type == CELL_STRUCTURE_DOMDEC && dd.use_packed)
+    packed_cells_update_layout();
+
   on_resort_particles();
 
   rebuild_verletlist = 1;
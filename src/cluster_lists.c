@@ -0,0 +1,469 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file cluster_lists.c
+ *
+ *  Implementation of \ref cluster_lists.h "cluster_lists.h".
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "utils.h"
+#include "cluster_lists.h"
+#include "cells.h"
+#include "verlet.h"
+#include "integrate.h"
+#include "domain_decomposition.h"
+#include "forces.h"
+#include "energy.h"
+#include "pressure.h"
+#include "constraint.h"
+#include "packed_cells.h"
+#include "packed_kernels.h"
+
+/** Granularity of the cluster and cluster pair arrays */
+#define CLUSTER_INCREMENT 256
+
+/************************************************
+ * variables
+ ************************************************/
+
+ClusterLists cluster_lists = { NULL, 0, 0, NULL, NULL, 0, 0, NULL, NULL, 0, 0 };
+
+/************************************************
+ * privat functions
+ ************************************************/
+
+/** sort key of a particle for the cluster formation. */
+typedef struct {
+  /** 2x2 column in the x-y plane. */
+  int column;
+  /** z coordinate. */
+  double z;
+  /** index of the particle in the cell. */
+  int index;
+} ClusterSortKey;
+
+static int cluster_key_compare(const void *a, const void *b)
+{
+  const ClusterSortKey *ka = (const ClusterSortKey *)a, *kb = (const ClusterSortKey *)b;
+  if (ka->column != kb->column) return ka->column - kb->column;
+  if (ka->z < kb->z) return -1;
+  if (ka->z > kb->z) return  1;
+  return ka->index - kb->index;
+}
+
+/** pointer to particle a of a cluster. */
+MDINLINE Particle *cluster_particle(Cluster *cl, int a)
+{
+  return &cells[cl->cell].part[cl->part[a]];
+}
+
+/** form the clusters of cell c and append them to \ref cluster_lists. */
+static void form_cell_clusters(int c, ClusterSortKey **keys, int *max_keys)
+{
+  Particle *part = cells[c].part;
+  int np = cells[c].n, i, j, k;
+  Cluster *cl;
+  double *pos;
+
+  if (np > *max_keys) {
+    *max_keys = np;
+    *keys = (ClusterSortKey *)realloc(*keys, np*sizeof(ClusterSortKey));
+  }
+  /* the cell boundaries are multiples of the cell size, so the half
+     cell index parity gives the column within the cell */
+  for (i = 0; i < np; i++) {
+    (*keys)[i].column = ((int)floor(2.0*part[i].r.p[0]*dd.inv_cell_size[0]) & 1) +
+                    2*((int)floor(2.0*part[i].r.p[1]*dd.inv_cell_size[1]) & 1);
+    (*keys)[i].z      = part[i].r.p[2];
+    (*keys)[i].index  = i;
+  }
+  qsort(*keys, np, sizeof(ClusterSortKey), cluster_key_compare);
+
+  for (i = 0; i < np; i += CLUSTER_SIZE) {
+    if (cluster_lists.n_clusters >= cluster_lists.max_clusters) {
+      cluster_lists.max_clusters += CLUSTER_INCREMENT;
+      cluster_lists.cluster = (Cluster *)realloc(cluster_lists.cluster,
+						 cluster_lists.max_clusters*sizeof(Cluster));
+    }
+    cl = &cluster_lists.cluster[cluster_lists.n_clusters++];
+    cl->cell = c;
+    cl->n = (np - i < CLUSTER_SIZE) ? np - i : CLUSTER_SIZE;
+    for (k = 0; k < cl->n; k++) {
+      cl->part[k] = (*keys)[i + k].index;
+      pos = part[cl->part[k]].r.p;
+      for (j = 0; j < 3; j++) {
+	if (k == 0 || pos[j] < cl->lo[j]) cl->lo[j] = pos[j];
+	if (k == 0 || pos[j] > cl->hi[j]) cl->hi[j] = pos[j];
+      }
+    }
+  }
+}
+
+/** squared distance of the bounding boxes of two clusters. */
+MDINLINE double cluster_bb_distance2(Cluster *ci, Cluster *cj)
+{
+  int j;
+  double gap, dist2 = 0.0;
+  for (j = 0; j < 3; j++) {
+    gap = cj->lo[j] - ci->hi[j];
+    if (ci->lo[j] - cj->hi[j] > gap) gap = ci->lo[j] - cj->hi[j];
+    if (gap > 0.0) dist2 += SQR(gap);
+  }
+  return dist2;
+}
+
+/** interaction mask of a cluster pair. */
+static unsigned int cluster_pair_mask(Cluster *ci, Cluster *cj)
+{
+  unsigned int mask = 0;
+  int a, b;
+  Particle *p1, *p2;
+
+  for (a = 0; a < ci->n; a++) {
+    p1 = cluster_particle(ci, a);
+    /* avoid double counting within a cluster */
+    for (b = (ci == cj) ? a + 1 : 0; b < cj->n; b++) {
+      p2 = cluster_particle(cj, b);
+#ifdef EXCLUSIONS
+      if(!do_nonbonded(p1, p2))
+	continue;
+#endif
+      if (distance2(p1->r.p, p2->r.p) <= max_range_non_bonded2)
+	mask |= 1u << (a*CLUSTER_SIZE + b);
+    }
+  }
+  return mask;
+}
+
+/** add a cluster pair. */
+MDINLINE void add_cluster_pair(int cj, unsigned int imask)
+{
+  if (cluster_lists.n_pairs >= cluster_lists.max_pairs) {
+    cluster_lists.max_pairs += CLUSTER_INCREMENT;
+    cluster_lists.pair = (ClusterPair *)realloc(cluster_lists.pair,
+						cluster_lists.max_pairs*sizeof(ClusterPair));
+  }
+  cluster_lists.pair[cluster_lists.n_pairs].cj    = cj;
+  cluster_lists.pair[cluster_lists.n_pairs].imask = imask;
+  cluster_lists.n_pairs++;
+}
+
+/** add a cluster pair range for cluster ci, starting at the current
+    end of the cluster pair list. */
+MDINLINE ClusterIEntry *add_cluster_ientry(int ci)
+{
+  ClusterIEntry *ie;
+  if (cluster_lists.n_ientries >= cluster_lists.max_ientries) {
+    cluster_lists.max_ientries += CLUSTER_INCREMENT;
+    cluster_lists.ientry = (ClusterIEntry *)realloc(cluster_lists.ientry,
+						    cluster_lists.max_ientries*sizeof(ClusterIEntry));
+  }
+  ie = &cluster_lists.ientry[cluster_lists.n_ientries++];
+  ie->ci         = ci;
+  ie->first_pair = cluster_lists.n_pairs;
+  ie->n_pairs    = 0;
+  return ie;
+}
+
+/** Bonded forces and constraints of all local particles. */
+static void cluster_bonded_forces()
+{
+  int c, i, np;
+  Particle *p;
+  for (c = 0; c < local_cells.n; c++) {
+    p  = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)  {
+      add_bonded_force(&p[i]);
+#ifdef CONSTRAINTS
+      add_constraints_forces(&p[i]);
+#endif
+    }
+  }
+}
+
+/** Non bonded forces on the packed particle data, see \ref packed_kernels.h. */
+static void cluster_packed_forces()
+{
+  int c, e, k, a, b, i1, i2, thread;
+  ClusterIEntry *ie;
+  Cluster *cl_i, *cl_j;
+  ClusterPair *pair;
+  PackedCell *pc1, *pc2;
+  double *x1, *x2, *f1, *f2;
+  double dist2, vec21[3], p_vir[3] = { 0., 0., 0. }, t_vir[3];
+  PairBatch batch;
+
+  packed_cells_gather();
+
+#ifdef _OPENMP
+#pragma omp parallel private(c, e, k, a, b, i1, i2, thread, ie, cl_i, cl_j, pair, \
+			     pc1, pc2, x1, x2, f1, f2, dist2, vec21, t_vir, batch)
+#endif
+  {
+    thread = packed_thread_num();
+    batch.n = batch.mask = 0;
+    t_vir[0] = t_vir[1] = t_vir[2] = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (c = 0; c < local_cells.n; c++) {
+      for (e = cluster_lists.local_first[c]; e < cluster_lists.local_first[c + 1]; e++) {
+	ie   = &cluster_lists.ientry[e];
+	cl_i = &cluster_lists.cluster[ie->ci];
+	pc1  = &packed_cells[cl_i->cell];
+	f1   = packed_cells_force(pc1, thread);
+	for (k = ie->first_pair; k < ie->first_pair + ie->n_pairs; k++) {
+	  pair = &cluster_lists.pair[k];
+	  cl_j = &cluster_lists.cluster[pair->cj];
+	  pc2  = &packed_cells[cl_j->cell];
+	  f2   = packed_cells_force(pc2, thread);
+	  for (a = 0; a < cl_i->n; a++) {
+	    i1 = cl_i->part[a];
+	    x1 = &pc1->pos[3*i1];
+	    for (b = 0; b < cl_j->n; b++) {
+	      if (!(pair->imask & (1u << (a*CLUSTER_SIZE + b))))
+		continue;
+	      i2 = cl_j->part[b];
+	      x2 = &pc2->pos[3*i2];
+	      vec21[0] = x1[0] - x2[0];
+	      vec21[1] = x1[1] - x2[1];
+	      vec21[2] = x1[2] - x2[2];
+	      dist2 = SQR(vec21[0]) + SQR(vec21[1]) + SQR(vec21[2]);
+	      packed_batch_add(&batch, pc1->type[i1], pc2->type[i2],
+#ifdef ELECTROSTATICS
+			       pc1->q[i1]*pc2->q[i2],
+#else
+			       0.0,
+#endif
+			       vec21, dist2, &f1[3*i1], &f2[3*i2], t_vir);
+	    }
+	  }
+	}
+      }
+    }
+    packed_batch_flush(&batch, t_vir);
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    for (a = 0; a < 3; a++)
+      p_vir[a] += t_vir[a];
+  }
+
+  packed_cells_scatter_forces();
+
+#ifdef NPT
+  if(integ_switch == INTEG_METHOD_NPT_ISO)
+    for (a = 0; a < 3; a++)
+      nptiso.p_vir[a] += p_vir[a];
+#endif
+}
+
+/************************************************
+ * public functions
+ ************************************************/
+
+void build_cluster_lists()
+{
+  static ClusterSortKey *keys = NULL;
+  static int max_keys = 0;
+  int c, n, i, ci, cj, cell, ncell, j_start;
+  Particle *p;
+  ClusterIEntry *ie;
+  unsigned int imask;
+
+  VERLET_TRACE(fprintf(stderr,"%d: build_cluster_lists:\n",this_node));
+
+  /* form the clusters of all cells */
+  cluster_lists.cell_first = (int *)realloc(cluster_lists.cell_first, (n_cells + 1)*sizeof(int));
+  cluster_lists.n_clusters = 0;
+  for (c = 0; c < n_cells; c++) {
+    cluster_lists.cell_first[c] = cluster_lists.n_clusters;
+    form_cell_clusters(c, &keys, &max_keys);
+  }
+  cluster_lists.cell_first[n_cells] = cluster_lists.n_clusters;
+
+  /* store old positions */
+  for (c = 0; c < local_cells.n; c++) {
+    p = local_cells.cell[c]->part;
+    for (i = 0; i < local_cells.cell[c]->n; i++)
+      memcpy(p[i].l.p_old, p[i].r.p, 3*sizeof(double));
+  }
+
+  /* cluster pair lists of the cell pairs of the local cells */
+  cluster_lists.local_first = (int *)realloc(cluster_lists.local_first, (local_cells.n + 1)*sizeof(int));
+  cluster_lists.n_ientries = 0;
+  cluster_lists.n_pairs    = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    cluster_lists.local_first[c] = cluster_lists.n_ientries;
+    /* Loop cell neighbors, the first one is the cell itself */
+    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
+      cell  = dd.cell_inter[c].nList[n].pList1 - cells;
+      ncell = dd.cell_inter[c].nList[n].pList  - cells;
+      for (ci = cluster_lists.cell_first[cell]; ci < cluster_lists.cell_first[cell + 1]; ci++) {
+	ie = add_cluster_ientry(ci);
+	j_start = (n == 0) ? ci : cluster_lists.cell_first[ncell];
+	for (cj = j_start; cj < cluster_lists.cell_first[ncell + 1]; cj++) {
+	  if (cluster_bb_distance2(&cluster_lists.cluster[ci], &cluster_lists.cluster[cj]) > max_range_non_bonded2)
+	    continue;
+	  imask = cluster_pair_mask(&cluster_lists.cluster[ci], &cluster_lists.cluster[cj]);
+	  if (imask)
+	    add_cluster_pair(cj, imask);
+	}
+	ie->n_pairs = cluster_lists.n_pairs - ie->first_pair;
+	/* drop empty ranges */
+	if (ie->n_pairs == 0)
+	  cluster_lists.n_ientries--;
+      }
+    }
+  }
+  cluster_lists.local_first[local_cells.n] = cluster_lists.n_ientries;
+
+  VERLET_TRACE(fprintf(stderr,"%d: %d clusters, %d cluster pairs\n",this_node,
+		       cluster_lists.n_clusters, cluster_lists.n_pairs));
+
+  rebuild_verletlist = 0;
+}
+
+void calculate_cluster_ia()
+{
+  int c, e, k, a, b;
+  ClusterIEntry *ie;
+  Cluster *cl_i, *cl_j;
+  ClusterPair *pair;
+  Particle *p1, *p2;
+  double dist2, vec21[3];
+
+  cluster_bonded_forces();
+
+  if (packed_cells_applicable()) {
+    cluster_packed_forces();
+    return;
+  }
+
+  for (c = 0; c < local_cells.n; c++) {
+    for (e = cluster_lists.local_first[c]; e < cluster_lists.local_first[c + 1]; e++) {
+      ie   = &cluster_lists.ientry[e];
+      cl_i = &cluster_lists.cluster[ie->ci];
+      for (k = ie->first_pair; k < ie->first_pair + ie->n_pairs; k++) {
+	pair = &cluster_lists.pair[k];
+	cl_j = &cluster_lists.cluster[pair->cj];
+	for (a = 0; a < cl_i->n; a++) {
+	  p1 = cluster_particle(cl_i, a);
+	  for (b = 0; b < cl_j->n; b++) {
+	    if (!(pair->imask & (1u << (a*CLUSTER_SIZE + b))))
+	      continue;
+	    p2 = cluster_particle(cl_j, b);
+	    dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
+	    add_non_bonded_pair_force(p1, p2, vec21, sqrt(dist2), dist2);
+	  }
+	}
+      }
+    }
+  }
+}
+
+void calculate_cluster_energies()
+{
+  int c, e, k, a, b, i, np;
+  ClusterIEntry *ie;
+  Cluster *cl_i, *cl_j;
+  ClusterPair *pair;
+  Particle *p1, *p2;
+  double dist2, vec21[3];
+
+  for (c = 0; c < local_cells.n; c++) {
+    p1 = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)  {
+      add_kinetic_energy(&p1[i]);
+      add_bonded_energy(&p1[i]);
+#ifdef CONSTRAINTS
+      add_constraints_energy(&p1[i]);
+#endif
+    }
+  }
+
+  for (c = 0; c < local_cells.n; c++) {
+    for (e = cluster_lists.local_first[c]; e < cluster_lists.local_first[c + 1]; e++) {
+      ie   = &cluster_lists.ientry[e];
+      cl_i = &cluster_lists.cluster[ie->ci];
+      for (k = ie->first_pair; k < ie->first_pair + ie->n_pairs; k++) {
+	pair = &cluster_lists.pair[k];
+	cl_j = &cluster_lists.cluster[pair->cj];
+	for (a = 0; a < cl_i->n; a++) {
+	  p1 = cluster_particle(cl_i, a);
+	  for (b = 0; b < cl_j->n; b++) {
+	    if (!(pair->imask & (1u << (a*CLUSTER_SIZE + b))))
+	      continue;
+	    p2 = cluster_particle(cl_j, b);
+	    dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
+	    add_non_bonded_pair_energy(p1, p2, vec21, sqrt(dist2), dist2);
+	  }
+	}
+      }
+    }
+  }
+}
+
+void calculate_cluster_virials(int v_comp)
+{
+  int c, e, k, a, b, i, np;
+  ClusterIEntry *ie;
+  Cluster *cl_i, *cl_j;
+  ClusterPair *pair;
+  Particle *p1, *p2;
+  double dist2, vec21[3];
+
+  for (c = 0; c < local_cells.n; c++) {
+    p1 = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)  {
+      add_kinetic_virials(&p1[i],v_comp);
+      add_bonded_virials(&p1[i]);
+#ifdef BOND_ANGLE
+      add_three_body_bonded_stress(&p1[i]);
+#endif
+    }
+  }
+
+  for (c = 0; c < local_cells.n; c++) {
+    for (e = cluster_lists.local_first[c]; e < cluster_lists.local_first[c + 1]; e++) {
+      ie   = &cluster_lists.ientry[e];
+      cl_i = &cluster_lists.cluster[ie->ci];
+      for (k = ie->first_pair; k < ie->first_pair + ie->n_pairs; k++) {
+	pair = &cluster_lists.pair[k];
+	cl_j = &cluster_lists.cluster[pair->cj];
+	for (a = 0; a < cl_i->n; a++) {
+	  p1 = cluster_particle(cl_i, a);
+	  for (b = 0; b < cl_j->n; b++) {
+	    if (!(pair->imask & (1u << (a*CLUSTER_SIZE + b))))
+	      continue;
+	    p2 = cluster_particle(cl_j, b);
+	    dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
+	    add_non_bonded_pair_virials(p1, p2, vec21, sqrt(dist2), dist2);
+	  }
+	}
+      }
+    }
+  }
+}
@@ -0,0 +1,155 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CLUSTER_LISTS_H
+#define CLUSTER_LISTS_H
+/** \file cluster_lists.h
+    Cluster pair lists for the domain decomposition.
+
+    Instead of storing two \ref Particle pointers per interacting pair
+    as the verlet lists (see \ref verlet.h) do, the particles of each
+    cell are grouped into spatially compact clusters of up to \ref
+    CLUSTER_SIZE particles, and only cluster-cluster pairs are
+    stored. A cluster pair is listed if the bounding boxes of the two
+    clusters are closer than \ref max_range_non_bonded; for each cluster
+    pair, a bit mask stores which of the \ref CLUSTER_SIZE x \ref
+    CLUSTER_SIZE particle pairs actually interact, i. e. which are within
+    \ref max_range_non_bonded and not excluded. Therefore, exactly the
+    same particle pairs are treated as with the verlet lists, but the
+    list needs only 8 bytes per cluster pair instead of 16 bytes per
+    particle pair, and the particles of a cluster are accessed
+    together.
+
+    To form the clusters, the particles of each cell are sorted into 2x2
+    columns in the x-y plane, and by their z coordinate within a
+    column. The sorting is only done on an index list, the particles
+    themselves are not moved.
+
+    The cluster lists use the same rebuild criterion as the verlet
+    lists, i. e. \ref rebuild_verletlist. They are selected by
+    <tt>cellsystem domain_decomposition -cluster_list</tt>, which sets
+    \ref DomainDecomposition::use_clusters in addition to \ref
+    DomainDecomposition::use_vList.
+*/
+#include "utils.h"
+#include "cells.h"
+
+/** maximal number of particles per cluster. The interaction mask of
+    a cluster pair has CLUSTER_SIZE^2 bits. */
+#define CLUSTER_SIZE 4
+
+/************************************************
+ * data types
+ ************************************************/
+
+/** A cluster of particles of one cell. */
+typedef struct {
+  /** index of the cell in \ref cells::cells . */
+  int cell;
+  /** number of particles in the cluster. */
+  int n;
+  /** indices of the particles in the cell. */
+  int part[CLUSTER_SIZE];
+  /** bounding box of the particles. */
+  double lo[3], hi[3];
+} Cluster;
+
+/** The cluster pairs of one cluster with the clusters of one
+    neighbor cell. */
+typedef struct {
+  /** index of the first cluster. */
+  int ci;
+  /** first entry in \ref ClusterLists::pair . */
+  int first_pair;
+  /** number of cluster pairs. */
+  int n_pairs;
+} ClusterIEntry;
+
+/** An interacting cluster pair. */
+typedef struct {
+  /** index of the second cluster. */
+  int cj;
+  /** bit a*CLUSTER_SIZE+b is set if particle a of the first and
+      particle b of the second cluster interact. */
+  unsigned int imask;
+} ClusterPair;
+
+/** The clusters of all cells and the cluster pair lists of the
+    local clusters. */
+typedef struct {
+  /** clusters of all cells, ordered by cell. */
+  Cluster *cluster;
+  /** number of clusters. */
+  int n_clusters;
+  /** allocated size of \ref ClusterLists::cluster . */
+  int max_clusters;
+  /** clusters of cell c are cell_first[c] to cell_first[c+1]-1. */
+  int *cell_first;
+  /** the cluster pair ranges of the first clusters. */
+  ClusterIEntry *ientry;
+  /** number of cluster pair ranges. */
+  int n_ientries;
+  /** allocated size of \ref ClusterLists::ientry . */
+  int max_ientries;
+  /** the cluster pair ranges of the cell pairs of local cell c (see
+      \ref IA_Neighbor_List) are local_first[c] to local_first[c+1]-1. */
+  int *local_first;
+  /** the cluster pairs. */
+  ClusterPair *pair;
+  /** number of cluster pairs. */
+  int n_pairs;
+  /** allocated size of \ref ClusterLists::pair . */
+  int max_pairs;
+} ClusterLists;
+
+/************************************************************/
+/** \name Exported Variables */
+/************************************************************/
+/*@{*/
+
+/** The cluster lists of this node. */
+extern ClusterLists cluster_lists;
+
+/*@}*/
+
+/************************************************************/
+/** \name Exported Functions */
+/************************************************************/
+/*@{*/
+
+/** Form the clusters and fill the cluster pair lists. Also stores the
+    positions for the rebuild criterion and resets \ref
+    rebuild_verletlist. */
+void build_cluster_lists();
+
+/** Nonbonded and bonded force calculation using the cluster lists.
+    The pair loop runs on the packed particle data if possible (see
+    \ref packed_cells.h). */
+void calculate_cluster_ia();
+
+/** Nonbonded and bonded energy calculation using the cluster lists. */
+void calculate_cluster_energies();
+
+/** Nonbonded and bonded pressure calculation using the cluster lists.
+    @param v_comp flag which enables compensation of the velocities,
+    see \ref calculate_verlet_virials. */
+void calculate_cluster_virials(int v_comp);
+
+/*@}*/
+
+#endif
@@ -2495,9 +2495,7 @@ int mpi_iccp3m_iteration(int dummy)
 #ifdef ELECTROSTATICS
   mpi_call(mpi_iccp3m_iteration_slave, -1, 0);
 
-  printf("(%d) performing ICC iteration \n", this_node );
   iccp3m_iteration();
-  printf("(%d) performed ICC iteration \n", this_node );
 
   COMM_TRACE(fprintf(stderr, "%d: iccp3m iteration task %d done.\n", this_node, dummy));
 
@@ -2511,9 +2509,7 @@ int mpi_iccp3m_iteration(int dummy)
 void mpi_iccp3m_iteration_slave(int dummy, int dummy2)
 {
 #ifdef ELECTROSTATICS
-  printf("(%d) performing ICC iteration \n", this_node );
   iccp3m_iteration();
-  printf("(%d) performed ICC iteration \n", this_node );
   COMM_TRACE(fprintf(stderr, "%d: iccp3m iteration task %d done.\n", dummy, dummy2));
 
   check_runtime_errors();
@@ -2531,9 +2527,7 @@ int mpi_iccp3m_init(int n_induced_charges)
   
   mpi_call(mpi_iccp3m_init_slave, -1, n_induced_charges);
    
-  printf("(%d) broadcasting the ICC configuration\n", this_node);
   bcast_iccp3m_cfg();
-  printf("(%d) broadcasted ICC configuration\n", this_node);
 
   COMM_TRACE(fprintf(stderr, "%d: iccp3m init task %d done.\n", this_node, n_induced_charges));
 
@@ -2554,11 +2548,7 @@ void mpi_iccp3m_init_slave(int node, int dummy)
     iccp3m_initialized=1;
  }
 
-  printf("(%d) recieving the ICC configuration\n", this_node);
-  
   bcast_iccp3m_cfg();
-  
-  printf("(%d) recieved ICC configuration\n", this_node);
 
   check_runtime_errors();
 #endif
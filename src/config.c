@@ -83,6 +83,18 @@ int tclcallback_compilation(Tcl_Interp *interp)
 #ifdef CUDA
   Tcl_AppendResult(interp, "{ CUDA } ", (char *) NULL);
 #endif
+#ifdef P3M_SINGLE_PRECISION
+  Tcl_AppendResult(interp, "{ P3M_SINGLE_PRECISION } ", (char *) NULL);
+#endif
+#ifdef SIMD_AVX2
+  Tcl_AppendResult(interp, "{ SIMD_AVX2 } ", (char *) NULL);
+#endif
+#ifdef SIMD_AVX512
+  Tcl_AppendResult(interp, "{ SIMD_AVX512 } ", (char *) NULL);
+#endif
+#ifdef _OPENMP
+  Tcl_AppendResult(interp, "{ OPENMP } ", (char *) NULL);
+#endif
 #ifdef TK
   Tcl_AppendResult(interp, "{ TK } ", (char *) NULL);
 #endif
@@ -38,6 +38,10 @@
 /** half the number of cell neighbors in 3 Dimensions. */
 #define CELLS_MAX_NEIGHBORS 14
 
+/** relative load of the slowest slab of nodes above which the domains
+    are rebalanced, see \ref dd_balance_load. */
+#define DD_BALANCE_TOLERANCE 1.1
+
 /*@}*/
 
 /************************************************/
@@ -45,12 +49,17 @@
 /************************************************/
 /*@{*/
 
-DomainDecomposition dd = { 1, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, NULL };
+DomainDecomposition dd = { 1, 1, 0, 0, 0, 0, 0, 0, 0, {0,0,0}, {0,0,0}, {0,0,0}, {0,0,0}, NULL };
 
 int max_num_cells = CELLS_MAX_NUM_CELLS;
 int min_num_cells = 1;
 double max_skin   = 0.0;
 
+/** force calculation time of this node since the last load balancing. */
+static double dd_force_time = 0.0;
+/** time steps since the last load balancing. */
+static int dd_balance_steps = 0;
+
 /*@}*/
 
 /************************************************************/
@@ -82,6 +91,80 @@ double max_skin   = 0.0;
     n == 0 || n == dd.ghost_cell_grid[1] - 1 || \
     o == 0 || o == dd.ghost_cell_grid[2] - 1 ) 
 
+/** Calculate the cell grid for a box of size lbox, see \ref
+    dd_create_cell_grid.
+    @param lbox the size of the box to split into cells.
+    @param grid the cell grid.
+    @return the number of cells. */
+static int dd_calc_cell_grid(double lbox[3], int grid[3])
+{
+  int i,n_local_cells,min_ind;
+  double cell_range[3], min_size, scale, volume;
+
+  /* Calculate initial cell grid */
+  volume = lbox[0];
+  for(i=1;i<3;i++) volume *= lbox[i];
+  scale = pow(max_num_cells/volume, 1./3.);
+  for(i=0;i<3;i++) {
+    /* this is at least 1 */
+    grid[i] = (int)ceil(lbox[i]*scale);
+    cell_range[i] = lbox[i]/grid[i];
+
+    if ( cell_range[i] < max_range ) {
+      /* ok, too many cells for this direction, set to minimum */
+      grid[i] = (int)floor(lbox[i]/max_range);
+      if ( grid[i] < 1 ) {
+	char *error_msg = runtime_error(TCL_INTEGER_SPACE + 2*TCL_DOUBLE_SPACE + 128);
+	ERROR_SPRINTF(error_msg, "{002 interaction range %g in direction %d is larger than the local box size %g} ",
+		      max_range, i, lbox[i]);
+	grid[i] = 1;
+      }
+      cell_range[i] = lbox[i]/grid[i];
+    }
+  }
+
+  /* It may be necessary to asymmetrically assign the scaling to the coordinates, which the above approach will not do.
+     For a symmetric box, it gives a symmetric result. Here we correct that. */
+  for (;;) {
+    n_local_cells = grid[0];
+    for (i = 1; i < 3; i++)
+      n_local_cells *= grid[i];
+
+    /* done */
+    if (n_local_cells <= max_num_cells)
+      break;
+
+    /* find coordinate with the smallest cell range */
+    min_ind = 0;
+    min_size = cell_range[0];
+    for (i = 1; i < 3; i++)
+      if (grid[i] > 1 && cell_range[i] < min_size) {
+	min_ind = i;
+	min_size = cell_range[i];
+      }
+    CELL_TRACE(fprintf(stderr, "%d: minimal coordinate %d, size %f, grid %d\n", this_node,min_ind, min_size, grid[min_ind]));
+
+    grid[min_ind]--;
+    cell_range[min_ind] = lbox[min_ind]/grid[min_ind];
+  }
+  CELL_TRACE(fprintf(stderr, "%d: final %d %d %d\n", this_node, grid[0], grid[1], grid[2]));
+
+  /* sanity check */
+  if (n_local_cells < min_num_cells) {
+    char *error_msg = runtime_error(TCL_INTEGER_SPACE + 2*TCL_DOUBLE_SPACE + 128);
+    ERROR_SPRINTF(error_msg, "{001 number of cells %d is smaller than minimum %d (interaction range too large or max_num_cells too small)} ",
+		  n_local_cells, min_num_cells);
+  }
+
+  /* quit program if unsuccesful */
+  if(n_local_cells > max_num_cells) {
+    char *error_msg = runtime_error(128);
+    ERROR_SPRINTF(error_msg, "{003 no suitable cell grid found} ");
+  }
+
+  return n_local_cells;
+}
+
 /** Calculate cell grid dimensions, cell sizes and number of cells.
  *  Calculates the cell grid, based on \ref local_box_l and \ref
  *  max_range. If the number of cells is larger than \ref
@@ -91,84 +174,50 @@ double max_skin   = 0.0;
  *  DomainDecomposition::ghost_cell_grid, \ref
  *  DomainDecomposition::cell_size, \ref
  *  DomainDecomposition::inv_cell_size, and \ref n_cells.
+ *
+ *  If the domains have different sizes (see \ref node_bound), the
+ *  ghost layers of neighboring nodes only fit if the number of cells
+ *  in a direction only depends on the size of the domain in that
+ *  direction. Therefore, the cell size is determined for equally
+ *  sized domains, and each node uses the cell size closest to it that
+ *  fits its domain. The number of cells of a node may then exceed
+ *  \ref max_num_cells.
  */
 void dd_create_cell_grid()
 {
-  int i,n_local_cells,new_cells,min_ind;
-  double cell_range[3], min_box_l, min_size, scale, volume;
+  int i,n_local_cells,new_cells;
+  double cell_range[3];
   CELL_TRACE(fprintf(stderr, "%d: dd_create_cell_grid: max_range %f\n",this_node,max_range));
   CELL_TRACE(fprintf(stderr, "%d: dd_create_cell_grid: local_box %f-%f, %f-%f, %f-%f,\n",this_node,my_left[0],my_right[0],my_left[1],my_right[1],my_left[2],my_right[2]));
   
-  /* initialize */
-  min_box_l = dmin(dmin(local_box_l[0],local_box_l[1]),local_box_l[2]);
-  cell_range[0]=cell_range[1]=cell_range[2] = max_range;
-
   if(max_range2 < 0.0) {
     /* this is the initialization case */
     n_local_cells = dd.cell_grid[0] = dd.cell_grid[1] = dd.cell_grid[2]=1;
   }
-  else {
-    /* Calculate initial cell grid */
-    volume = local_box_l[0];
-    for(i=1;i<3;i++) volume *= local_box_l[i];
-    scale = pow(max_num_cells/volume, 1./3.);
-    for(i=0;i<3;i++) {
-      /* this is at least 1 */
-      dd.cell_grid[i] = (int)ceil(local_box_l[i]*scale);
-      cell_range[i] = local_box_l[i]/dd.cell_grid[i];
+  else if (node_bound_is_set()) {
+    double uniform_box_l[3];
+    int uniform_grid[3];
 
-      if ( cell_range[i] < max_range ) {
-	/* ok, too many cells for this direction, set to minimum */
+    for(i=0;i<3;i++)
+      uniform_box_l[i] = box_l[i]/(double)node_grid[i];
+    dd_calc_cell_grid(uniform_box_l, uniform_grid);
+
+    n_local_cells = 1;
+    for(i=0;i<3;i++) {
+      dd.cell_grid[i] = (int)floor(local_box_l[i]*uniform_grid[i]/uniform_box_l[i] + 0.5);
+      if (dd.cell_grid[i] > (int)floor(local_box_l[i]/max_range))
 	dd.cell_grid[i] = (int)floor(local_box_l[i]/max_range);
-	if ( dd.cell_grid[i] < 1 ) {
-	  char *error_msg = runtime_error(TCL_INTEGER_SPACE + 2*TCL_DOUBLE_SPACE + 128);
-	  ERROR_SPRINTF(error_msg, "{002 interaction range %g in direction %d is larger than the local box size %g} ",
-			max_range, i, local_box_l[i]);
-	  dd.cell_grid[i] = 1;
-	}
-	cell_range[i] = local_box_l[i]/dd.cell_grid[i];
+      if (dd.cell_grid[i] < 1) {
+	char *error_msg = runtime_error(TCL_INTEGER_SPACE + 2*TCL_DOUBLE_SPACE + 128);
+	ERROR_SPRINTF(error_msg, "{002 interaction range %g in direction %d is larger than the local box size %g} ",
+		      max_range, i, local_box_l[i]);
+	dd.cell_grid[i] = 1;
       }
+      n_local_cells *= dd.cell_grid[i];
     }
-
-    /* It may be necessary to asymmetrically assign the scaling to the coordinates, which the above approach will not do.
-       For a symmetric box, it gives a symmetric result. Here we correct that. */
-    for (;;) {
-      n_local_cells = dd.cell_grid[0];
-      for (i = 1; i < 3; i++)
-	n_local_cells *= dd.cell_grid[i];
-
-      /* done */
-      if (n_local_cells <= max_num_cells)
-	break;
-
-      /* find coordinate with the smallest cell range */
-      min_ind = 0;
-      min_size = cell_range[0];
-      for (i = 1; i < 3; i++)
-	if (dd.cell_grid[i] > 1 && cell_range[i] < min_size) {
-	  min_ind = i;
-	  min_size = cell_range[i];
-	}
-      CELL_TRACE(fprintf(stderr, "%d: minimal coordinate %d, size %f, grid %d\n", this_node,min_ind, min_size, dd.cell_grid[min_ind]));
-
-      dd.cell_grid[min_ind]--;
-      cell_range[min_ind] = local_box_l[min_ind]/dd.cell_grid[min_ind];
-    }
-    CELL_TRACE(fprintf(stderr, "%d: final %d %d %d\n", this_node, dd.cell_grid[0], dd.cell_grid[1], dd.cell_grid[2]));
-
-    /* sanity check */
-    if (n_local_cells < min_num_cells) {
-      char *error_msg = runtime_error(TCL_INTEGER_SPACE + 2*TCL_DOUBLE_SPACE + 128);
-      ERROR_SPRINTF(error_msg, "{001 number of cells %d is smaller than minimum %d (interaction range too large or max_num_cells too small)} ",
-		    n_local_cells, min_num_cells);
-    }
-  }
-
-  /* quit program if unsuccesful */
-  if(n_local_cells > max_num_cells) {
-    char *error_msg = runtime_error(128);
-    ERROR_SPRINTF(error_msg, "{003 no suitable cell grid found} ");
   }
+  else
+    n_local_cells = dd_calc_cell_grid(local_box_l, dd.cell_grid);
 
   /* now set all dependent variables */
   new_cells=1;
@@ -192,16 +241,65 @@ void dd_create_cell_grid()
   CELL_TRACE(fprintf(stderr, "%d: dd_create_cell_grid, n_cells=%d, local_cells.n=%d, ghost_cells.n=%d, dd.ghost_cell_grid=(%d,%d,%d)\n", this_node, n_cells,local_cells.n,ghost_cells.n,dd.ghost_cell_grid[0],dd.ghost_cell_grid[1],dd.ghost_cell_grid[2]));
 }
 
+/** sort key for the orders along the space filling curve. */
+typedef struct {
+  unsigned int key;
+  int index;
+} DDSortKey;
+
+static int dd_sort_key_compare(const void *a, const void *b)
+{
+  const DDSortKey *ka = (const DDSortKey *)a, *kb = (const DDSortKey *)b;
+  if (ka->key != kb->key) return (ka->key < kb->key) ? -1 : 1;
+  return ka->index - kb->index;
+}
+
+/** Get the order of the local cells in \ref local_cells and \ref
+    DomainDecomposition::cell_inter . This is the x-fastest order of
+    the cell grid, or the Morton order if \ref
+    DomainDecomposition::sort_cells is set.
+    \param order the linear indices of the local cells in the ghost
+    cell grid, in the order of the local cells. */
+static void dd_local_cell_order(int *order)
+{
+  int m,n,o,c=0;
+  DDSortKey *keys;
+
+  DD_LOCAL_CELLS_LOOP(m,n,o)
+    order[c++] = get_linear_index(m,n,o,dd.ghost_cell_grid);
+
+  if (!dd.sort_cells)
+    return;
+
+  keys = (DDSortKey *)malloc(c*sizeof(DDSortKey));
+  c = 0;
+  DD_LOCAL_CELLS_LOOP(m,n,o) {
+    keys[c].key   = get_morton_index(m-1,n-1,o-1);
+    keys[c].index = order[c];
+    c++;
+  }
+  qsort(keys, c, sizeof(DDSortKey), dd_sort_key_compare);
+  for (c = 0; c < local_cells.n; c++)
+    order[c] = keys[c].index;
+  free(keys);
+}
+
 /** Fill local_cells list and ghost_cells list for use with domain
     decomposition.  \ref cells::cells is assumed to be a 3d grid with size
     \ref DomainDecomposition::ghost_cell_grid . */
 void dd_mark_cells()
 {
-  int m,n,o,cnt_c=0,cnt_l=0,cnt_g=0;
+  int m,n,o,c,cnt_c=0,cnt_g=0;
+  int *order = (int *)malloc(local_cells.n*sizeof(int));
+
   DD_CELLS_LOOP(m,n,o) {
-    if(DD_IS_LOCAL_CELL(m,n,o)) local_cells.cell[cnt_l++] = &cells[cnt_c++]; 
-    else                        ghost_cells.cell[cnt_g++] = &cells[cnt_c++];
+    if(!DD_IS_LOCAL_CELL(m,n,o)) ghost_cells.cell[cnt_g++] = &cells[cnt_c];
+    cnt_c++;
   } 
+  dd_local_cell_order(order);
+  for (c = 0; c < local_cells.n; c++)
+    local_cells.cell[c] = &cells[order[c]];
+  free(order);
 }
 
 /** Fill a communication cell pointer list. Fill the cell pointers of
@@ -234,15 +332,40 @@ int dd_fill_comm_cell_lists(Cell **part_lists, int lc[3], int hc[3])
   return c;
 }
 
-/** Create communicators for cell structure domain decomposition. (see \ref GhostCommunicator) */
+/** Create communicators for cell structure domain decomposition. (see \ref GhostCommunicator)
+    With \ref DomainDecomposition::use_eighth_shell, the ghost layers
+    are only imported from the upper neighbors, i. e. only the left
+    sends of the lr loop are done, and the lower ghost layers are
+    left out of the cell ranges of the following directions. */
 void  dd_prepare_comm(GhostCommunicator *comm, int data_parts)
 {
-  int dir,lr,i,cnt, num, n_comm_cells[3];
-  int lc[3],hc[3],done[3]={0,0,0};
+  int dir,lr,i,cnt, num, n_lr, n_comm_cells[3], dir_first;
+  int lc[3],hc[3],done[3]={0,0,0},low[3]={0,0,0};
+
+  /* number of communication sides */
+  n_lr = dd.use_eighth_shell ? 1 : 2;
 
   /* calculate number of communications */
   num = 0;
   for(dir=0; dir<3; dir++) { 
+    if (dd.use_eighth_shell) {
+      if(node_grid[dir] == 1) {
+#ifdef PARTIAL_PERIODIC
+	if( PERIODIC(dir) || (boundary[2*dir] == 0) ) 
+#endif
+	  num++;
+      }
+      else {
+	/* send to the left, receive from the right */
+	for(lr=0; lr<2; lr++) {
+#ifdef PARTIAL_PERIODIC
+	  if( PERIODIC(dir) || (boundary[2*dir+lr] == 0) ) 
+#endif
+	    num++;
+	}
+      }
+      continue;
+    }
     for(lr=0; lr<2; lr++) {
 #ifdef PARTIAL_PERIODIC
       /* No communication for border of non periodic direction */
@@ -260,22 +383,29 @@ void  dd_prepare_comm(GhostCommunicator *comm, int data_parts)
   prepare_comm(comm, data_parts, num);
 
   /* number of cells to communicate in a direction */
-  n_comm_cells[0] = dd.cell_grid[1]       * dd.cell_grid[2];
-  n_comm_cells[1] = dd.cell_grid[2]       * dd.ghost_cell_grid[0];
-  n_comm_cells[2] = dd.ghost_cell_grid[0] * dd.ghost_cell_grid[1];
+  if (dd.use_eighth_shell) {
+    n_comm_cells[0] = dd.cell_grid[1]       * dd.cell_grid[2];
+    n_comm_cells[1] = dd.cell_grid[2]       * (dd.cell_grid[0] + 1);
+    n_comm_cells[2] = (dd.cell_grid[0] + 1) * (dd.cell_grid[1] + 1);
+  }
+  else {
+    n_comm_cells[0] = dd.cell_grid[1]       * dd.cell_grid[2];
+    n_comm_cells[1] = dd.cell_grid[2]       * dd.ghost_cell_grid[0];
+    n_comm_cells[2] = dd.ghost_cell_grid[0] * dd.ghost_cell_grid[1];
+  }
 
   cnt=0;
   /* direction loop: x, y, z */
   for(dir=0; dir<3; dir++) {
-    lc[(dir+1)%3] = 1-done[(dir+1)%3]; 
-    lc[(dir+2)%3] = 1-done[(dir+2)%3];
+    /* the communications of one direction are independent of each other */
+    dir_first = cnt;
+    lc[(dir+1)%3] = 1-low[(dir+1)%3]; 
+    lc[(dir+2)%3] = 1-low[(dir+2)%3];
     hc[(dir+1)%3] = dd.cell_grid[(dir+1)%3]+done[(dir+1)%3];
     hc[(dir+2)%3] = dd.cell_grid[(dir+2)%3]+done[(dir+2)%3];
-    /* lr loop: left right */
-    /* here we could in principle build in a one sided ghost
-       communication, simply by taking the lr loop only over one
-       value */
-    for(lr=0; lr<2; lr++) {
+    /* lr loop: left right. For the eighth shell, only the upper
+       ghost layer is filled */
+    for(lr=0; lr<n_lr; lr++) {
       if(node_grid[dir] == 1) {
 	/* just copy cells on a single node */
 #ifdef PARTIAL_PERIODIC
@@ -311,6 +441,7 @@ void  dd_prepare_comm(GhostCommunicator *comm, int data_parts)
 #endif
 	    if((node_pos[dir]+i)%2==0) {
 	      comm->comm[cnt].type          = GHOST_SEND;
+	      if (cnt > dir_first) comm->comm[cnt].type |= GHOST_OVERLAP;
 	      comm->comm[cnt].node          = node_neighbors[2*dir+lr];
 	      comm->comm[cnt].part_lists    = malloc(n_comm_cells[dir]*sizeof(ParticleList *));
 	      comm->comm[cnt].n_part_lists  = n_comm_cells[dir];
@@ -330,6 +461,7 @@ void  dd_prepare_comm(GhostCommunicator *comm, int data_parts)
 #endif
 	    if((node_pos[dir]+(1-i))%2==0) {
 	      comm->comm[cnt].type          = GHOST_RECV;
+	      if (cnt > dir_first) comm->comm[cnt].type |= GHOST_OVERLAP;
 	      comm->comm[cnt].node          = node_neighbors[2*dir+(1-lr)];
 	      comm->comm[cnt].part_lists    = malloc(n_comm_cells[dir]*sizeof(ParticleList *));
 	      comm->comm[cnt].n_part_lists  = n_comm_cells[dir];
@@ -344,6 +476,7 @@ void  dd_prepare_comm(GhostCommunicator *comm, int data_parts)
 	}
       }
       done[dir]=1;
+      low[dir]=(n_lr == 2);
     }
   }
 }
@@ -365,11 +498,17 @@ void dd_revert_comm_order(GhostCommunicator *comm)
     comm->comm[i] = comm->comm[comm->num-i-1];
     comm->comm[comm->num-i-1] = tmp;
   }
+  /* the overlap flag refers to the previous communication, which now is the next one */
+  for(i=comm->num-1; i>=0; i--) {
+    if(i > 0 && (comm->comm[i-1].type & GHOST_OVERLAP)) comm->comm[i].type |= GHOST_OVERLAP;
+    else comm->comm[i].type &= ~GHOST_OVERLAP;
+  }
   /* exchange SEND/RECV */
   for(i=0; i<comm->num; i++) {
-    if(comm->comm[i].type == GHOST_SEND) comm->comm[i].type = GHOST_RECV;
-    else if(comm->comm[i].type == GHOST_RECV) comm->comm[i].type = GHOST_SEND;
-    else if(comm->comm[i].type == GHOST_LOCL) {
+    int job = comm->comm[i].type & GHOST_JOBMASK, flags = comm->comm[i].type & ~GHOST_JOBMASK;
+    if(job == GHOST_SEND) comm->comm[i].type = GHOST_RECV | flags;
+    else if(job == GHOST_RECV) comm->comm[i].type = GHOST_SEND | flags;
+    else if(job == GHOST_LOCL) {
       nlist2=comm->comm[i].n_part_lists/2;
       for(j=0;j<nlist2;j++) {
 	tmplist = comm->comm[i].part_lists[j];
@@ -385,14 +524,49 @@ void dd_assign_prefetches(GhostCommunicator *comm)
 {
   int cnt;
 
+  /* The pairs must not span two directions, since the data sent in
+     a direction depends on the data received in the previous one. For
+     the eighth shell, a direction has only one or two communications,
+     so that only the case of one send and one receive per direction
+     is safe. */
+  if (dd.use_eighth_shell && comm->num != 6)
+    return;
+
   for(cnt=0; cnt<comm->num; cnt += 2) {
-    if (comm->comm[cnt].type == GHOST_RECV && comm->comm[cnt + 1].type == GHOST_SEND) {
+    if ((comm->comm[cnt].type & GHOST_JOBMASK) == GHOST_RECV &&
+	(comm->comm[cnt + 1].type & GHOST_JOBMASK) == GHOST_SEND) {
       comm->comm[cnt].type |= GHOST_PREFETCH | GHOST_PSTSTORE;
       comm->comm[cnt + 1].type |= GHOST_PREFETCH | GHOST_PSTSTORE;
     }
   }
 }
 
+/** Cell pairs of the eighth shell scheme, as offsets of the two cells
+    from the lower corner of a 2x2x2 block. The first pair is the
+    corner cell itself, then come the 7 pairs of the corner cell with
+    the other cells, and the 6 pairs of the other cells which are no
+    translation of a pair with the corner cell. */
+static int eighth_shell_pairs[CELLS_MAX_NEIGHBORS][2][3] = {
+  {{0,0,0},{0,0,0}},
+  {{0,0,0},{1,0,0}}, {{0,0,0},{0,1,0}}, {{0,0,0},{0,0,1}},
+  {{0,0,0},{1,1,0}}, {{0,0,0},{1,0,1}}, {{0,0,0},{0,1,1}},
+  {{0,0,0},{1,1,1}},
+  {{1,0,0},{0,1,0}}, {{1,0,0},{0,0,1}}, {{0,1,0},{0,0,1}},
+  {{1,0,0},{0,1,1}}, {{0,1,0},{1,0,1}}, {{0,0,1},{1,1,0}}
+};
+
+/** Check whether the cell with index ind in \ref cells::cells is a
+    local cell, i. e. not in the ghost frame. */
+static int dd_is_local_cell(int ind)
+{
+  int i, pos[3];
+  get_grid_pos(ind, &pos[0], &pos[1], &pos[2], dd.ghost_cell_grid);
+  for(i=0; i<3; i++)
+    if(pos[i] == 0 || pos[i] > dd.cell_grid[i])
+      return 0;
+  return 1;
+}
+
 /** Init cell interactions for cell system domain decomposition.
  * initializes the interacting neighbor cell list of a cell The
  * created list of interacting neighbor cells is used by the verlet
@@ -400,7 +574,9 @@ void dd_assign_prefetches(GhostCommunicator *comm)
  */
 void dd_init_cell_interactions()
 {
-  int m,n,o,p,q,r,ind1,ind2,c_cnt=0,n_cnt;
+  int m,n,o,p,q,r,ind1,ind2,c_cnt,n_cnt;
+  int (*pair)[3];
+  int *order = (int *)malloc(local_cells.n*sizeof(int));
  
   /* initialize cell neighbor structures */
   dd.cell_inter = (IA_Neighbor_List *) realloc(dd.cell_inter,local_cells.n*sizeof(IA_Neighbor_List));
@@ -409,13 +585,30 @@ void dd_init_cell_interactions()
     dd.cell_inter[m].n_neighbors=0; 
   }
 
-  /* loop all local cells */
-  DD_LOCAL_CELLS_LOOP(m,n,o) {
+  /* loop all local cells, in the order of local_cells */
+  dd_local_cell_order(order);
+  for(c_cnt=0; c_cnt<local_cells.n; c_cnt++) {
+    get_grid_pos(order[c_cnt],&m,&n,&o,dd.ghost_cell_grid);
     dd.cell_inter[c_cnt].nList = (IA_Neighbor *) realloc(dd.cell_inter[c_cnt].nList, CELLS_MAX_NEIGHBORS*sizeof(IA_Neighbor));
     dd.cell_inter[c_cnt].n_neighbors = CELLS_MAX_NEIGHBORS;
  
     n_cnt=0;
     ind1 = get_linear_index(m,n,o,dd.ghost_cell_grid);
+    if (dd.use_eighth_shell) {
+      /* loop the cell pairs of the 2x2x2 block */
+      for(n_cnt=0; n_cnt<CELLS_MAX_NEIGHBORS; n_cnt++) {
+	pair = eighth_shell_pairs[n_cnt];
+	ind1 = get_linear_index(m+pair[0][0],n+pair[0][1],o+pair[0][2],dd.ghost_cell_grid);
+	ind2 = get_linear_index(m+pair[1][0],n+pair[1][1],o+pair[1][2],dd.ghost_cell_grid);
+	dd.cell_inter[c_cnt].nList[n_cnt].cell_ind = ind2;
+	dd.cell_inter[c_cnt].nList[n_cnt].pList1   = &cells[ind1];
+	dd.cell_inter[c_cnt].nList[n_cnt].pList    = &cells[ind2];
+	init_pairList(&dd.cell_inter[c_cnt].nList[n_cnt].vList);
+	dd.cell_inter[c_cnt].nList[n_cnt].pInd     = NULL;
+	dd.cell_inter[c_cnt].nList[n_cnt].max_pInd = 0;
+      }
+      continue;
+    }
     /* loop all neighbor cells */
     for(p=o-1; p<=o+1; p++)	
       for(q=n-1; q<=n+1; q++)
@@ -423,12 +616,24 @@ void dd_init_cell_interactions()
 	  ind2 = get_linear_index(r,q,p,dd.ghost_cell_grid);
 	  if(ind2 >= ind1) {
 	    dd.cell_inter[c_cnt].nList[n_cnt].cell_ind = ind2;
+	    dd.cell_inter[c_cnt].nList[n_cnt].pList1   = &cells[ind1];
 	    dd.cell_inter[c_cnt].nList[n_cnt].pList    = &cells[ind2];
 	    init_pairList(&dd.cell_inter[c_cnt].nList[n_cnt].vList);
+	    dd.cell_inter[c_cnt].nList[n_cnt].pInd     = NULL;
+	    dd.cell_inter[c_cnt].nList[n_cnt].max_pInd = 0;
 	    n_cnt++;
 	  }
 	}
-    c_cnt++;
+  }
+  free(order);
+
+  /* mark the cells which do not interact with ghost cells */
+  for(m=0; m<local_cells.n; m++) {
+    dd.cell_inter[m].inner = 1;
+    for(n_cnt=0; n_cnt<dd.cell_inter[m].n_neighbors; n_cnt++)
+      if(!dd_is_local_cell(dd.cell_inter[m].nList[n_cnt].pList1 - cells) ||
+	 !dd_is_local_cell(dd.cell_inter[m].nList[n_cnt].pList - cells))
+	dd.cell_inter[m].inner = 0;
   }
 }
 
@@ -551,6 +756,93 @@ int dd_append_particles(ParticleList *pl, int fold_dir)
   }
   return flag;
 }
+
+/** check wether all domains given by \ref node_bound are at least
+    \ref max_range wide. */
+static int dd_node_bound_valid()
+{
+  int dir, k;
+  for (dir = 0; dir < 3; dir++)
+    if (node_bound[dir])
+      for (k = 0; k < node_grid[dir]; k++)
+	if ((node_bound[dir][k+1] - node_bound[dir][k])*box_l[dir] < max_range)
+	  return 0;
+  return 1;
+}
+
+/** Calculate new domain boundaries from the loads of the slabs of
+    the node grid, see \ref dd_balance_load.
+    @param load  the loads of the slabs, first the node_grid[0] slabs
+                 in x direction, then y and z.
+    @param bound the new boundaries, node_grid[dir]+1 values per direction.
+    @return wether the load was unbalanced in any direction.
+*/
+static int dd_balance_calc_bound(double *load, double *bound)
+{
+  int dir, j, k, n, unbalanced = 0;
+  double *w = load, *b = bound;
+
+  for (dir = 0; dir < 3; dir++) {
+    double total = 0, max = 0, cumulated, min_width, *cur;
+
+    /* current boundaries */
+    n = node_grid[dir];
+    cur = malloc((n + 1)*sizeof(double));
+    for (k = 0; k <= n; k++)
+      cur[k] = node_bound[dir] ? node_bound[dir][k] : (double)k/n;
+
+    for (k = 0; k < n; k++) {
+      total += w[k];
+      if (w[k] > max)
+	max = w[k];
+    }
+    /* a slab has to hold at least one cell */
+    min_width = 1.001*max_range*box_l_i[dir];
+
+    for (k = 0; k <= n; k++)
+      b[k] = cur[k];
+
+    if (n > 1 && total > 0 && n*min_width < 1) {
+      if (max*n > DD_BALANCE_TOLERANCE*total)
+	unbalanced = 1;
+
+      /* find the positions of equal cumulated load, assuming the load
+	 is evenly distributed within the old slabs */
+      cumulated = 0;
+      k = 0;
+      for (j = 1; j < n; j++) {
+	double target = j*total/n;
+	while (k < n - 1 && cumulated + w[k] < target) {
+	  cumulated += w[k];
+	  k++;
+	}
+	b[j] = cur[k];
+	if (w[k] > 0)
+	  b[j] += dmin(1.0, (target - cumulated)/w[k])*(cur[k+1] - cur[k]);
+      }
+
+      /* keep the minimal width, first from below, then from above */
+      for (j = 1; j < n; j++)
+	if (b[j] < b[j-1] + min_width)
+	  b[j] = b[j-1] + min_width;
+      for (j = n - 1; j > 0; j--)
+	if (b[j] > b[j+1] - min_width)
+	  b[j] = b[j+1] - min_width;
+
+      GRID_TRACE({
+	  fprintf(stderr, "%d: dd_balance_calc_bound: direction %d:", this_node, dir);
+	  for (k = 0; k < n; k++)
+	    fprintf(stderr, " %g (%g)", b[k+1], w[k]/total);
+	  fprintf(stderr, "\n");
+	});
+    }
+    free(cur);
+
+    w += n;
+    b += n + 1;
+  }
+  return unbalanced;
+}
  
 /*@}*/
 
@@ -558,9 +850,105 @@ int dd_append_particles(ParticleList *pl, int fold_dir)
 /* Public Functions */
 /************************************************************/
 
+void dd_sort_particles()
+{
+  int c,i,j,m,n,o,np,max_keys=0;
+  unsigned int q[3];
+  double lo[3];
+  DDSortKey *keys = NULL;
+  Particle *part, *sorted = NULL;
+
+  for (c = 0; c < local_cells.n; c++) {
+    np   = local_cells.cell[c]->n;
+    part = local_cells.cell[c]->part;
+    if (np < 2)
+      continue;
+    if (np > max_keys) {
+      max_keys = np;
+      keys   = (DDSortKey *)realloc(keys, max_keys*sizeof(DDSortKey));
+      sorted = (Particle *)realloc(sorted, max_keys*sizeof(Particle));
+    }
+
+    /* lower corner of the cell */
+    get_grid_pos(local_cells.cell[c] - cells,&m,&n,&o,dd.ghost_cell_grid);
+    lo[0] = my_left[0] + (m-1)*dd.cell_size[0];
+    lo[1] = my_left[1] + (n-1)*dd.cell_size[1];
+    lo[2] = my_left[2] + (o-1)*dd.cell_size[2];
+
+    /* position on a 1024^3 grid within the cell */
+    for (i = 0; i < np; i++) {
+      for (j = 0; j < 3; j++) {
+	int g = (int)((part[i].r.p[j] - lo[j])*dd.inv_cell_size[j]*1024);
+	q[j] = (g < 0) ? 0 : ((g > 1023) ? 1023 : g);
+      }
+      keys[i].key   = get_morton_index(q[0],q[1],q[2]);
+      keys[i].index = i;
+    }
+    qsort(keys, np, sizeof(DDSortKey), dd_sort_key_compare);
+
+    for (i = 0; i < np; i++)
+      memcpy(&sorted[i], &part[keys[i].index], sizeof(Particle));
+    memcpy(part, sorted, np*sizeof(Particle));
+    update_local_particles(local_cells.cell[c]);
+  }
+
+  free(keys);
+  free(sorted);
+}
+
+void dd_balance_add_time(double time)
+{
+  dd_force_time += time;
+}
+
+void dd_balance_load()
+{
+  int dir, n, offset, unbalanced = 0;
+  double *load, *sum = NULL, *bound;
+
+  if (++dd_balance_steps < dd.balance_interval)
+    return;
+  dd_balance_steps = 0;
+
+  /* the loads of the slabs of the node grid in all directions */
+  n = node_grid[0] + node_grid[1] + node_grid[2];
+  load  = calloc(n, sizeof(double));
+  bound = malloc((n + 3)*sizeof(double));
+  for (dir = 0, offset = 0; dir < 3; offset += node_grid[dir++])
+    load[offset + node_pos[dir]] = dd_force_time;
+  dd_force_time = 0;
+
+  if (this_node == 0)
+    sum = malloc(n*sizeof(double));
+  MPI_Reduce(load, sum, n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  if (this_node == 0)
+    unbalanced = dd_balance_calc_bound(sum, bound);
+  MPI_Bcast(&unbalanced, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  if (unbalanced) {
+    MPI_Bcast(bound, n + 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    for (dir = 0, offset = 0; dir < 3; offset += node_grid[dir++] + 1)
+      if (node_grid[dir] > 1)
+	set_node_bound(dir, bound + offset);
+
+    CELL_TRACE(fprintf(stderr, "%d: dd_balance_load: new domain %f-%f, %f-%f, %f-%f\n", this_node,
+		       my_left[0], my_right[0], my_left[1], my_right[1], my_left[2], my_right[2]));
+
+    cells_re_init(CELL_STRUCTURE_DOMDEC);
+    cells_resort_particles(CELL_GLOBAL_EXCHANGE);
+  }
+
+  free(load);
+  free(sum);
+  free(bound);
+}
+
+
 #ifdef NPT
 void dd_NpT_update_cell_grid(double scal1) {
   int i, dir,lr,cnt, lc[3],hc[3],done[3]={0,0,0};
+  /* number of communication sides, as in \ref dd_prepare_comm */
+  int n_lr = dd.use_eighth_shell ? 1 : 2;
   
   if(max_range > scal1*dmin(dmin(dd.cell_size[0],dd.cell_size[1]),dd.cell_size[2])) {
     /* if new box length leads to too small cells, redo cell structure */
@@ -586,7 +974,7 @@ void dd_NpT_update_cell_grid(double scal1) {
       hc[(dir+1)%3] = dd.cell_grid[(dir+1)%3]+done[(dir+1)%3];
       hc[(dir+2)%3] = dd.cell_grid[(dir+2)%3]+done[(dir+2)%3];
       /* lr loop: left right */
-      for(lr=0; lr<2; lr++) {
+      for(lr=0; lr<n_lr; lr++) {
 	if(node_grid[dir] == 1) {
 #ifdef PARTIAL_PERIODIC
 	  if( PERIODIC(dir ) || (boundary[2*dir+lr] == 0) ) 
@@ -646,6 +1034,22 @@ void dd_topology_init(CellPList *old)
 
   /** broadcast the flag for using verlet list */
   MPI_Bcast(&dd.use_vList, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.use_packed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.use_clusters, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.use_eighth_shell, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.use_overlap, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.balance_interval, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.sort_particles, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.sort_cells, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&dd.use_incremental, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  /* back to equally sized domains, if the load balancing was switched
+     off or the domains are too small for the interaction range */
+  if (node_bound_is_set() && (dd.balance_interval <= 0 || !dd_node_bound_valid())) {
+    int dir;
+    for (dir = 0; dir < 3; dir++)
+      set_node_bound(dir, NULL);
+  }
  
   cell_structure.type             = CELL_STRUCTURE_DOMDEC;
   cell_structure.position_to_node = map_position_node_array;
@@ -706,11 +1110,14 @@ void dd_topology_release()
   CELL_TRACE(fprintf(stderr,"%d: dd_topology_release:\n",this_node));
   /* release cell interactions */
   for(i=0; i<local_cells.n; i++) {
-    for(j=0; j<dd.cell_inter[i].n_neighbors; j++) 
+    for(j=0; j<dd.cell_inter[i].n_neighbors; j++) {
       free_pairList(&dd.cell_inter[i].nList[j].vList);
+      free(dd.cell_inter[i].nList[j].pInd);
+    }
     dd.cell_inter[i].nList = (IA_Neighbor *) realloc(dd.cell_inter[i].nList,0);
   }
   dd.cell_inter = (IA_Neighbor_List *) realloc(dd.cell_inter,0);
+  invalidate_verlet_cell_records();
   /* free ghost cell pointer list */
   realloc_cellplist(&ghost_cells, ghost_cells.n = 0);
   /* free ghost communicators */
@@ -944,7 +1351,6 @@ int tclcallback_min_num_cells(Tcl_Interp *interp, void *_data)
 void calc_link_cell()
 {
   int c, np1, n, np2, i ,j, j_start;
-  Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   double dist2, vec21[3];
@@ -954,12 +1360,11 @@ void calc_link_cell()
   /* Loop local cells */
   for (c = 0; c < local_cells.n; c++) {
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       /* Loop cell particles */
@@ -1021,6 +1426,8 @@ void calculate_link_cell_energies()
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       /* Loop cell particles */
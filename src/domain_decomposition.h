@@ -50,6 +50,11 @@
  * communication! For single sided ghost communication one would need
  * some ghost-ghost cell interaction as well, which we do not need!
  *
+ *  With \ref DomainDecomposition::balance_interval set, the domain
+ *  boundaries of the node grid are shifted periodically such that
+ *  the measured force calculation time is the same for all slabs of
+ *  nodes, see \ref dd_balance_load.
+ *
  *  For more information on cells,
  *  see \ref cells.h 
 */
@@ -66,10 +71,20 @@
 typedef struct {
   /** Just for transparency the index of the neighbor cell. */
   int cell_ind;
+  /** Pointer to particle list of the first cell of the pair. This is
+      the local cell itself, except for the ghost-ghost cell pairs of
+      the eighth shell scheme. */
+  ParticleList *pList1;
   /** Pointer to particle list of neighbor cell. */
   ParticleList *pList;
   /** Verlet list for non bonded interactions of a cell with a neighbor cell. */
   PairList vList;
+  /** Indices of the particles of the pairs of \ref vList in \ref pList1
+      rsp. \ref pList, two per pair, for the packed force loop. See \ref
+      packed_cells_pair_indices. */
+  int *pInd;
+  /** Number of pairs \ref pInd can hold. */
+  int max_pInd;
 } IA_Neighbor;
 
 
@@ -84,10 +99,13 @@ typedef struct {
       reactio). For each cell 13+1=14 neighbors. This has only to be
       done for the inner cells. 
 
-      Caution: This implementation needs double sided ghost
-      communication! For single sided ghost communication one would
-      need some ghost-ghost cell interaction as well, which we do not
-      need! 
+      Caution: This scheme needs double sided ghost communication!
+      With \ref DomainDecomposition::use_eighth_shell, the ghosts are
+      only imported from the upper neighbors. Then the 13 cell pairs
+      of a cell are taken from the 2x2x2 block of cells with the cell
+      in its lower corner, which includes 6 pairs of two other cells
+      of the block, possibly two ghost cells (see \ref
+      IA_Neighbor::pList1). The first entry is always the cell itself.
 
       It follows: inner cells: n_neighbors = 14
       ghost cells:             n_neighbors = 0
@@ -95,12 +113,33 @@ typedef struct {
   int n_neighbors;
   /** Interacting neighbor cell list  */
   IA_Neighbor *nList;
+  /** 1 if none of the neighbor cells is a ghost cell, so that the
+      pairs of the cell can be calculated before the ghosts are
+      updated. */
+  int inner;
 } IA_Neighbor_List;
 
 /** Structure containing the information about the cell grid used for domain decomposition. */
 typedef struct {
   /** flag for using Verlet List */
   int use_vList;
+  /** flag for using the packed force loop, see \ref packed_cells.h */
+  int use_packed;
+  /** flag for using cluster pair lists instead of verlet lists, see \ref cluster_lists.h */
+  int use_clusters;
+  /** flag for importing ghosts only from the upper neighbors */
+  int use_eighth_shell;
+  /** flag for overlapping the ghost communication with the force calculation */
+  int use_overlap;
+  /** number of time steps between two load balancing steps, or 0 for
+      equally sized domains, see \ref dd_balance_load */
+  int balance_interval;
+  /** flag for ordering the particles of each cell along a space filling curve at every resort */
+  int sort_particles;
+  /** flag for storing the local cells in the order of a space filling curve */
+  int sort_cells;
+  /** flag for rebuilding only the verlet lists of changed cells, see \ref build_verlet_lists_incremental */
+  int use_incremental;
   /** linked cell grid in nodes spatial domain. */
   int cell_grid[3];
   /** linked cell grid with ghost frame. */
@@ -190,6 +229,32 @@ void dd_exchange_and_sort_particles(int global_flag);
 /** implements \ref CellStructure::position_to_cell. */
 Cell *dd_position_to_cell(double pos[3]);
 
+/** Order the particles of each local cell along the Morton (Z-order)
+    space filling curve through the cell, so that particles close in
+    space are also close in memory. Called at every resort, i. e.
+    every Verlet list rebuild, if \ref
+    DomainDecomposition::sort_particles is set. Has to be called before
+    the ghosts are exchanged, since the order of the ghosts follows the
+    order of the particles. */
+void dd_sort_particles();
+
+/** Add time spent in the force calculation of this node to the load
+    measured for \ref dd_balance_load. */
+void dd_balance_add_time(double time);
+
+/** Dynamic load balancing. Called every time step, every \ref
+    DomainDecomposition::balance_interval time steps the force
+    calculation times of all slabs of the node grid are collected. If
+    in any direction a slab is more than \ref DD_BALANCE_TOLERANCE
+    times slower than the average, the domain boundaries (\ref
+    node_bound) are moved such that each slab gets the same share of
+    the work, assuming that the work is evenly distributed within each
+    old slab. The domains are kept at least \ref max_range wide. The
+    cell structure is then reinitialized and the particles are
+    redistributed.
+*/
+void dd_balance_load();
+
 /** Callback for setmd max_num_cells (maxnumcells >= 27). 
     see also \ref max_num_cells */
 int tclcallback_max_num_cells(Tcl_Interp *interp, void *_data);
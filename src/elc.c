@@ -46,6 +46,9 @@
 /** Largest reasonable cutoff for far formula */
 #define MAXIMAL_FAR_CUT 50
 
+/** maximal number of far formula modes whose sums are reduced together */
+#define MODE_BLOCK 32
+
 /****************************************
  * LOCAL VARIABLES
  ****************************************/
@@ -84,10 +87,30 @@ ELC_struct elc_params = { 1e100, 10, 1, 0, 1, 1, 1, 1, 0, 0, 0, 0 };
 /** number of local particles, equals the size of \ref elc::partblk. */
 static int n_localpart = 0;
 
-/** temporary buffers for product decomposition */
+/** temporary buffers for product decomposition, \ref MODE_BLOCK blocks
+    of 8 values per particle */
+static double *partblks = NULL;
+/** collected data from the other cells, for \ref MODE_BLOCK modes */
+static double gblcblks[8*MODE_BLOCK];
+
+/** the blocks of the mode currently worked on in \ref elc::partblks
+    and \ref elc::gblcblks */
 static double *partblk = NULL;
-/** collected data from the other cells */
-static double gblcblk[8];
+static double *gblcblk = gblcblks;
+
+/** a far formula mode waiting for the reduction of its sums */
+typedef struct {
+  int p, q;
+  double omega;
+  /** offset of its sums in \ref elc::gblcblks */
+  int offset;
+} FarMode;
+
+/** \name modes queued for the next reduction */
+/*@{*/
+static FarMode modes[MODE_BLOCK];
+static int n_modes = 0;
+/*@}*/
 
 /** structure for storing of sin and cos values */
 typedef struct {
@@ -244,7 +267,7 @@ MDINLINE double *block(double *p, int index, int size)
 
 void distribute(int size)
 {
-  double send_buf[8];
+  double send_buf[8*MODE_BLOCK];
   copy_vec(send_buf, gblcblk, size);
   MPI_Allreduce(send_buf, gblcblk, size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 }
@@ -1087,11 +1110,110 @@ static double PQ_energy(double omega)
 /* main loops */
 /*****************************************************************/
 
-void ELC_add_force()
+/** make mode m of the queue the current one */
+static void select_mode(int m)
+{
+  partblk = block(partblks, m, 8*n_localpart);
+  gblcblk = gblcblks + modes[m].offset;
+}
+
+/** calculate the sums of all queued modes, reduce them at once and
+    add the forces or return the energy of the modes */
+static double process_modes(int force)
+{
+  int m, p, q, size = 0;
+  double eng = 0;
+
+  for (m = 0; m < n_modes; m++) {
+    p = modes[m].p;
+    q = modes[m].q;
+    modes[m].offset = size;
+    select_mode(m);
+    if (q == 0) {
+      setup_P(p, modes[m].omega);
+      size += 4;
+    }
+    else if (p == 0) {
+      setup_Q(q, modes[m].omega);
+      size += 4;
+    }
+    else {
+      setup_PQ(p, q, modes[m].omega);
+      size += 8;
+    }
+  }
+
+  gblcblk = gblcblks;
+  distribute(size);
+
+  for (m = 0; m < n_modes; m++) {
+    p = modes[m].p;
+    q = modes[m].q;
+    select_mode(m);
+    if (q == 0) {
+      if (force)
+	add_P_force();
+      else
+	eng += P_energy(modes[m].omega);
+      checkpoint("************distri p", p, 0, 2);
+    }
+    else if (p == 0) {
+      if (force)
+	add_Q_force();
+      else
+	eng += Q_energy(modes[m].omega);
+      checkpoint("************distri q", 0, q, 2);
+    }
+    else {
+      if (force)
+	add_PQ_force(p, q, modes[m].omega);
+      else
+	eng += PQ_energy(modes[m].omega);
+      checkpoint("************distri pq", p, q, 4);
+    }
+  }
+
+  gblcblk = gblcblks;
+  n_modes = 0;
+  return eng;
+}
+
+/** queue a mode, q = 0 denotes a P and p = 0 a Q mode. If the queue is
+    full, it is processed. */
+static double add_mode(int p, int q, double omega, int force)
+{
+  modes[n_modes].p = p;
+  modes[n_modes].q = q;
+  modes[n_modes].omega = omega;
+  if (++n_modes == MODE_BLOCK)
+    return process_modes(force);
+  return 0;
+}
+
+/** queue all modes within the far cutoff */
+static double far_modes(int force)
 {
   int p, q;
-  double omega;
+  double eng = 0;
 
+  /* the second condition is just for the case of numerical accident */
+  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++)
+    eng += add_mode(p, 0, C_2PI*ux*p, force);
+
+  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++)
+    eng += add_mode(0, q, C_2PI*uy*q, force);
+
+  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++)
+    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++)
+      eng += add_mode(p, q, C_2PI*sqrt(SQR(ux*p) + SQR(uy*q)), force);
+
+  if (n_modes > 0)
+    eng += process_modes(force);
+  return eng;
+}
+
+void ELC_add_force()
+{
   prepare_scx_cache();
   prepare_scy_cache();
 
@@ -1105,32 +1227,7 @@ void ELC_add_force()
 
   clear_log_forces("z_force");
 
-  /* the second condition is just for the case of numerical accident */
-  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++) {
-    omega = C_2PI*ux*p;
-    setup_P(p, omega);
-    distribute(4);
-    add_P_force(); 
-    checkpoint("************distri p", p, 0, 2);
-  }
-
-  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++) {
-    omega = C_2PI*uy*q;
-    setup_Q(q, omega);
-    distribute(4); 
-    add_Q_force();
-    checkpoint("************distri q", 0, q, 2);
-  }
-
-  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++) {
-    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++) {
-      omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-      setup_PQ(p, q, omega);
-      distribute(8);
-      add_PQ_force(p, q, omega); 
-      checkpoint("************distri pq", p, q, 4);
-    }
-  }
+  far_modes(1);
 
   clear_log_forces("end");
 }
@@ -1138,38 +1235,14 @@ void ELC_add_force()
 double ELC_energy()
 {
   double eng;
-  int p, q;
-  double omega;
 
   eng = 2*dipole_energy(); 
   eng+=z_energy();
   prepare_scx_cache();
   prepare_scy_cache();
 
-  /* the second condition is just for the case of numerical accident */
-  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++) {
-    omega = C_2PI*ux*p;
-    setup_P(p, omega);
-    distribute(4);
-    eng += P_energy(omega);
-    checkpoint("E************distri p", p, 0, 2);
-  }
-  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++) {
-    omega = C_2PI*uy*q;
-    setup_Q(q, omega);
-    distribute(4);
-    eng += Q_energy(omega);
-    checkpoint("E************distri q", 0, q, 2);
-  }
-  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++) {
-    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++) {
-      omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-      setup_PQ(p, q, omega);
-      distribute(8);
-      eng += PQ_energy(omega);
-      checkpoint("E************distri pq", p, q, 4);
-    }
-  }
+  eng += far_modes(0);
+
   /* we count both i<->j and j<->i, so return just half of it */
   return 0.5*eng;
 }
@@ -1358,7 +1431,7 @@ void ELC_on_resort_particles()
   scxcache = realloc(scxcache, n_scxcache*n_localpart*sizeof(SCCache));
   scycache = realloc(scycache, n_scycache*n_localpart*sizeof(SCCache));
     
-  partblk   = realloc(partblk,  n_localpart*8*sizeof(double));
+  partblks  = realloc(partblks, MODE_BLOCK*n_localpart*8*sizeof(double));
 }
 
 /* TODO: This function is not used anywhere :) To be removed?  */
@@ -26,6 +26,7 @@
 #include "integrate.h"
 #include "initialize.h"
 #include "domain_decomposition.h"
+#include "cluster_lists.h"
 #include "nsquare.h"
 #include "layered.h"
 #include "elc.h"
@@ -64,7 +65,12 @@ void energy_calc(double *result)
     layered_calculate_energies();
     break;
   case CELL_STRUCTURE_DOMDEC: 
-    if(dd.use_vList) {
+    if(dd.use_clusters) {
+      if (rebuild_verletlist)
+	build_cluster_lists();
+      calculate_cluster_energies();
+    }
+    else if(dd.use_vList) {
       if (rebuild_verletlist)  
 	build_verlet_lists();
       calculate_verlet_energies();
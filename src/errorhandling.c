@@ -22,6 +22,7 @@
 */
 #include <mpi.h>
 #include <string.h>
+#include <stdarg.h>
 #include "utils.h"
 #include "errorhandling.h"
 
@@ -30,19 +31,58 @@
 char *error_msg;
 int n_error_msg = 0;
 
+#ifdef _OPENMP
+/** buffer for the error message of a thread within a parallel region. */
+static char *thread_error_msg = NULL;
+#pragma omp threadprivate(thread_error_msg)
+#endif
+
 /******************* exported functions **********************/
 
 char *runtime_error(int errlen)
 {
+  int curend;
+
+#ifdef _OPENMP
+  /* error_msg is shared by the threads, see error_sprintf */
+  if (omp_in_parallel()) {
+    thread_error_msg = realloc(thread_error_msg, errlen + 1);
+    return thread_error_msg;
+  }
+#endif
+
   /* the true length of the string will be in general shorter than n_error_msg,
      at least if numbers are involved */
-  int curend = error_msg ? strlen(error_msg) : 0;
+  curend = error_msg ? strlen(error_msg) : 0;
   n_error_msg = curend + errlen + 1;
  
   error_msg = realloc(error_msg, n_error_msg);
   return error_msg + curend;
 }
 
+#ifdef _OPENMP
+int error_sprintf(char *errtxt, const char *format, ...)
+{
+  va_list args;
+  int len;
+
+  va_start(args, format);
+  len = vsprintf(errtxt, format, args);
+  va_end(args);
+
+  if (omp_in_parallel() && errtxt == thread_error_msg) {
+#pragma omp critical(runtime_error)
+    {
+      int curend = error_msg ? strlen(error_msg) : 0;
+      n_error_msg = curend + len + 1;
+      error_msg = realloc(error_msg, n_error_msg);
+      strcpy(error_msg + curend, errtxt);
+    }
+  }
+  return len;
+}
+#endif
+
 int check_runtime_errors()
 {
   int n_all_error_msg;
@@ -39,7 +39,16 @@ extern int n_error_msg;
    @return where to put the (null-terminated) string */
 char *runtime_error(int errlen);
 
+#ifdef _OPENMP
+/* write an error message to the space obtained from \ref runtime_error.
+   Within an OpenMP parallel region, \ref runtime_error returns a buffer
+   of the calling thread, which is appended to \ref error_msg here. */
+int error_sprintf(char *errtxt, const char *format, ...);
+
+#define ERROR_SPRINTF error_sprintf
+#else
 #define ERROR_SPRINTF sprintf
+#endif
 
 /** check for runtime errors on all nodes. This has to be called on all nodes synchronously.
     @return the number of characters in the error messages of all nodes together. */
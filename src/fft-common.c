@@ -33,19 +33,44 @@
 
 #include "utils.h"
 #include "communication.h"
+#include "grid.h"
+
+/** the redistribution of the mesh for one plan and direction, see
+    \ref fft_common_forw_grid_comm. The blocks are packed from \a in
+    with \a pack at \a pack_block in a mesh of size \a pack_dim, and
+    unpacked to \a out at \a unpack_block in a mesh of size \a
+    unpack_dim. */
+static void fft_common_grid_comm(fft_data_struct *fft, fft_forw_plan *plan, void (*pack)(),
+				 int *pack_block, int *pack_dim, int *send_size,
+				 int *unpack_block, int *unpack_dim, int *recv_size,
+				 int tag, fft_float *in, fft_float *out);
 
 
 void fft_common_pre_init(fft_data_struct *fft)
 {
   for(int i=0;i<4;i++) {
     fft->plan[i].group = malloc(1*n_nodes*sizeof(int));
+    fft->plan[i].group_rank = malloc(1*n_nodes*sizeof(int));
+    fft->plan[i].group_comm = MPI_COMM_NULL;
     fft->plan[i].send_block = NULL;
     fft->plan[i].send_size  = NULL;
     fft->plan[i].recv_block = NULL;
     fft->plan[i].recv_size  = NULL;
+    fft->plan[i].fftw_plan  = NULL;
+    fft->back[i].fftw_plan  = NULL;
   }
 
   fft->init_tag = 0;
+  fft->n_fft_nodes = n_nodes;
+  fft->fft_node = 1;
+  fft->back_slot_buf = NULL;
+  fft->back_slot_size = 0;
+  fft->back_slot_requests = malloc(FFT_BACK_SLOTS*2*n_nodes*sizeof(MPI_Request));
+  fft->decomposition = FFT_PENCILS;
+  fft->comm_method = FFT_COMM_PAIRWISE;
+  fft->comm_counts = malloc(4*n_nodes*sizeof(int));
+  fft->requests = malloc(2*n_nodes*sizeof(MPI_Request));
+  fft->r2c = 0;
   fft->max_comm_size = 0;
   fft->max_mesh_size = 0;
   fft->send_buf = NULL;
@@ -53,7 +78,320 @@ void fft_common_pre_init(fft_data_struct *fft)
   fft->data_buf = NULL;
 }
 
-void fft_pack_block(double *in, double *out, int start[3], int size[3], int dim[3], int element)
+void fft_common_calc_node_grids(fft_data_struct *fft, int n_grid[4][3], int global_mesh_dim[3])
+{
+  int i, s, r_dir, mult[3];
+
+  /* slabs are cut perpendicular to the direction in which the real
+     space node grid is finest, that needs the least communication
+     for the first redistribution */
+  s = 0;
+  for(i=1;i<3;i++)
+    if(n_grid[0][i] > n_grid[0][s]) s = i;
+
+  if(fft->n_fft_nodes > 1 &&
+     global_mesh_dim[s]       >= FFT_SLAB_MIN_PLANES*fft->n_fft_nodes &&
+     global_mesh_dim[(s+1)%3] >= FFT_SLAB_MIN_PLANES*fft->n_fft_nodes) {
+    fft->decomposition = FFT_SLABS;
+    /* the first two FFTs run perpendicular to s, the third along s */
+    r_dir = (s+2)%3;
+    for(i=0;i<3;i++) n_grid[1][i] = 1;
+    n_grid[1][s] = fft->n_fft_nodes;
+  }
+  else {
+    fft->decomposition = FFT_PENCILS;
+    calc_2d_grid(fft->n_fft_nodes,n_grid[1]);
+    /* resort n_grid[1] dimensions if necessary. For a subset of the
+       nodes, the grids do not match anyways. */
+    if(fft->n_fft_nodes < n_nodes) r_dir = 2;
+    else r_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
+  }
+
+  fft->plan[1].row_dir = r_dir;
+  fft->plan[0].n_permute = 0;
+  for(i=1;i<4;i++) fft->plan[i].n_permute = (r_dir+i)%3;
+  for(i=0;i<3;i++) {
+    /* for slabs, the second FFT works on the same planes */
+    n_grid[2][i] = (fft->decomposition == FFT_SLABS) ? n_grid[1][i] : n_grid[1][(i+1)%3];
+    n_grid[3][i] = n_grid[1][(i+2)%3];
+  }
+  fft->plan[2].row_dir = (r_dir+2)%3;
+  fft->plan[3].row_dir = (r_dir+1)%3;
+
+  FFT_TRACE(fprintf(stderr,"%d: fft_common_calc_node_grids: %s, grids (%d,%d,%d) (%d,%d,%d) (%d,%d,%d)\n",
+		    this_node, (fft->decomposition == FFT_SLABS) ? "slabs" : "pencils",
+		    n_grid[1][0],n_grid[1][1],n_grid[1][2],n_grid[2][0],n_grid[2][1],n_grid[2][2],
+		    n_grid[3][0],n_grid[3][1],n_grid[3][2]));
+}
+
+int fft_common_fft_node(fft_data_struct *fft, int k)
+{
+  /* spread evenly over all nodes */
+  return (k*n_nodes)/fft->n_fft_nodes;
+}
+
+void fft_common_init_comm(fft_data_struct *fft)
+{
+  int i, j, k, color, send_total, recv_total;
+
+  for(i=1;i<4;i++) {
+    fft_forw_plan *plan = &fft->plan[i];
+
+    if(plan->group_comm != MPI_COMM_NULL) MPI_Comm_free(&plan->group_comm);
+    /* the first redistribution to a subset of the nodes does not form
+       closed groups, it is always done with nonblocking messages */
+    if(i > 1 || fft->n_fft_nodes == n_nodes) {
+      /* all members of a group have the same group, with the smallest
+	 node as representative */
+      if(plan->g_size == 0)
+	color = MPI_UNDEFINED;
+      else {
+	color = plan->group[0];
+	for(j=1;j<plan->g_size;j++)
+	  if(plan->group[j] < color) color = plan->group[j];
+      }
+      MPI_Comm_split(MPI_COMM_WORLD, color, this_node, &plan->group_comm);
+    }
+    /* the ranks follow the node identities */
+    for(j=0;j<plan->g_size;j++) {
+      plan->group_rank[j] = 0;
+      for(k=0;k<plan->g_size;k++)
+	if(plan->group[k] < plan->group[j]) plan->group_rank[j]++;
+    }
+
+    /* the collective methods send all blocks at once */
+    send_total = recv_total = 0;
+    for(j=0;j<plan->g_size;j++) {
+      send_total += plan->send_size[j];
+      recv_total += plan->recv_size[j];
+    }
+    if(send_total > fft->max_comm_size) fft->max_comm_size = send_total;
+    if(recv_total > fft->max_comm_size) fft->max_comm_size = recv_total;
+    /* for the back redistribution of the first plan in slots */
+    if(i == 1) fft->back_slot_size = send_total + recv_total;
+  }
+
+  if(fft->n_fft_nodes < n_nodes)
+    fft->back_slot_buf = (fft_float *)realloc(fft->back_slot_buf, FFT_BACK_SLOTS*fft->back_slot_size*sizeof(fft_float));
+  else {
+    free(fft->back_slot_buf);
+    fft->back_slot_buf = NULL;
+  }
+}
+
+void fft_common_tune_comm(fft_data_struct *fft, fft_float *data)
+{
+  int m, rep, i, best = FFT_COMM_PAIRWISE;
+  double time, max_time, best_time = 1e20;
+
+  /* without communication, all methods just copy the blocks */
+  if(n_nodes == 1) {
+    fft->comm_method = FFT_COMM_PAIRWISE;
+    return;
+  }
+
+  for(i=0;i<fft->max_mesh_size;i++) data[i] = fft->data_buf[i] = 0.0;
+
+  for(m=0;m<FFT_N_COMM_METHODS;m++) {
+    fft->comm_method = m;
+    MPI_Barrier(MPI_COMM_WORLD);
+    time = MPI_Wtime();
+    for(rep=0;rep<FFT_TUNE_REPS;rep++) {
+      /* the redistributions of a forward and a back transform */
+      fft_common_forw_grid_comm(fft, &fft->plan[1], data, fft->data_buf);
+      fft_common_forw_grid_comm(fft, &fft->plan[2], data, fft->data_buf);
+      fft_common_forw_grid_comm(fft, &fft->plan[3], fft->data_buf, data);
+      fft_common_back_grid_comm(fft, &fft->plan[3], &fft->back[3], data, fft->data_buf);
+      fft_common_back_grid_comm(fft, &fft->plan[2], &fft->back[2], fft->data_buf, data);
+      fft_common_back_grid_comm(fft, &fft->plan[1], &fft->back[1], fft->data_buf, data);
+    }
+    time = MPI_Wtime() - time;
+    /* the slowest node counts, and all nodes have to agree */
+    MPI_Allreduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    FFT_TRACE(fprintf(stderr,"%d: fft_common_tune_comm: method %d takes %f s\n",this_node,m,max_time));
+    if(max_time < best_time) {
+      best_time = max_time;
+      best = m;
+    }
+  }
+  fft->comm_method = best;
+}
+
+void fft_common_forw_grid_comm(fft_data_struct *fft, fft_forw_plan *plan, fft_float *in, fft_float *out)
+{
+  fft_common_grid_comm(fft, plan, plan->pack_function,
+		       plan->send_block, plan->old_mesh, plan->send_size,
+		       plan->recv_block, plan->new_mesh, plan->recv_size,
+		       REQ_FFT_FORW, in, out);
+}
+
+void fft_common_back_grid_comm(fft_data_struct *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+			       fft_float *in, fft_float *out)
+{
+  fft_common_grid_comm(fft, plan_f, plan_b->pack_function,
+		       plan_f->recv_block, plan_f->new_mesh, plan_f->recv_size,
+		       plan_f->send_block, plan_f->old_mesh, plan_f->send_size,
+		       REQ_FFT_BACK, in, out);
+}
+
+static void fft_common_grid_comm(fft_data_struct *fft, fft_forw_plan *plan, void (*pack)(),
+				 int *pack_block, int *pack_dim, int *send_size,
+				 int *unpack_block, int *unpack_dim, int *recv_size,
+				 int tag, fft_float *in, fft_float *out)
+{
+  int i, r, n_recv, offset;
+  int element = plan->element;
+  /* counts and displacements by rank in the group communicator */
+  int *s_count = fft->comm_counts,          *s_displ = fft->comm_counts + n_nodes;
+  int *r_count = fft->comm_counts + 2*n_nodes, *r_displ = fft->comm_counts + 3*n_nodes;
+  MPI_Request *r_req = fft->requests, *s_req = fft->requests + n_nodes;
+  MPI_Status status;
+  fft_float *tmp_ptr;
+  int method = fft->comm_method;
+
+  if(plan == &fft->plan[1] && fft->n_fft_nodes < n_nodes)
+    method = FFT_COMM_NONBLOCKING;
+
+  switch(method) {
+  case FFT_COMM_PAIRWISE:
+    for(i=0;i<plan->g_size;i++) {   
+      pack(in, fft->send_buf, &(pack_block[6*i]), &(pack_block[6*i+3]), pack_dim, element);
+
+      if(plan->group[i]<this_node) {       /* send first, receive second */
+	MPI_Send(fft->send_buf, send_size[i], MPI_FFT_FLOAT, 
+		 plan->group[i], tag, MPI_COMM_WORLD);
+	MPI_Recv(fft->recv_buf, recv_size[i], MPI_FFT_FLOAT, 
+		 plan->group[i], tag, MPI_COMM_WORLD, &status); 	
+      }
+      else if(plan->group[i]>this_node) {  /* receive first, send second */
+	MPI_Recv(fft->recv_buf, recv_size[i], MPI_FFT_FLOAT, 
+		 plan->group[i], tag, MPI_COMM_WORLD, &status); 	
+	MPI_Send(fft->send_buf, send_size[i], MPI_FFT_FLOAT, 
+		 plan->group[i], tag, MPI_COMM_WORLD);      
+      }
+      else {                              /* Self communication... */   
+	tmp_ptr  = fft->send_buf;
+	fft->send_buf = fft->recv_buf;
+	fft->recv_buf = tmp_ptr;
+      }
+      fft_unpack_block(fft->recv_buf, out, &(unpack_block[6*i]), &(unpack_block[6*i+3]), unpack_dim, element);
+    }
+    break;
+
+  case FFT_COMM_ALLTOALL:
+    offset = 0;
+    for(i=0;i<plan->g_size;i++) {
+      r = plan->group_rank[i];
+      pack(in, fft->send_buf + offset, &(pack_block[6*i]), &(pack_block[6*i+3]), pack_dim, element);
+      s_count[r] = send_size[i];
+      s_displ[r] = offset;
+      offset += send_size[i];
+    }
+    offset = 0;
+    for(i=0;i<plan->g_size;i++) {
+      r = plan->group_rank[i];
+      r_count[r] = recv_size[i];
+      r_displ[r] = offset;
+      offset += recv_size[i];
+    }
+    if(plan->g_size > 1)
+      MPI_Alltoallv(fft->send_buf, s_count, s_displ, MPI_FFT_FLOAT,
+		    fft->recv_buf, r_count, r_displ, MPI_FFT_FLOAT, plan->group_comm);
+    else if(plan->g_size == 1)
+      memcpy(fft->recv_buf, fft->send_buf, send_size[0]*sizeof(fft_float));
+    for(i=0;i<plan->g_size;i++)
+      fft_unpack_block(fft->recv_buf + r_displ[plan->group_rank[i]], out,
+		       &(unpack_block[6*i]), &(unpack_block[6*i+3]), unpack_dim, element);
+    break;
+
+  case FFT_COMM_NONBLOCKING:
+    /* post all receives first, r_count maps the requests to the blocks */
+    offset = 0;
+    n_recv = 0;
+    for(i=0;i<plan->g_size;i++) {
+      r_displ[i] = offset;
+      if(plan->group[i] != this_node && recv_size[i] > 0) {
+	r_count[n_recv] = i;
+	MPI_Irecv(fft->recv_buf + offset, recv_size[i], MPI_FFT_FLOAT,
+		  plan->group[i], tag, MPI_COMM_WORLD, &r_req[n_recv++]);
+      }
+      offset += recv_size[i];
+    }
+    /* send each block as soon as it is packed, the own one is unpacked right away */
+    offset = 0;
+    for(i=0;i<plan->g_size;i++) {
+      pack(in, fft->send_buf + offset, &(pack_block[6*i]), &(pack_block[6*i+3]), pack_dim, element);
+      if(plan->group[i] != this_node) {
+	if(send_size[i] > 0)
+	  MPI_Isend(fft->send_buf + offset, send_size[i], MPI_FFT_FLOAT,
+		    plan->group[i], tag, MPI_COMM_WORLD, &s_req[i]);
+	else
+	  s_req[i] = MPI_REQUEST_NULL;
+      }
+      else {
+	s_req[i] = MPI_REQUEST_NULL;
+	fft_unpack_block(fft->send_buf + offset, out, &(unpack_block[6*i]), &(unpack_block[6*i+3]), unpack_dim, element);
+      }
+      offset += send_size[i];
+    }
+    /* unpack the blocks in the order of arrival */
+    for(r=0;r<n_recv;r++) {
+      MPI_Waitany(n_recv, r_req, &i, &status);
+      i = r_count[i];
+      fft_unpack_block(fft->recv_buf + r_displ[i], out, &(unpack_block[6*i]), &(unpack_block[6*i+3]), unpack_dim, element);
+    }
+    MPI_Waitall(plan->g_size, s_req, MPI_STATUSES_IGNORE);
+    break;
+  }
+}
+
+void fft_common_back_comm_start(fft_data_struct *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+				fft_float *in, int slot)
+{
+  int j, offset;
+  /* the blocks to receive first, then the ones to send */
+  fft_float *r_buf = fft->back_slot_buf + slot*fft->back_slot_size;
+  MPI_Request *req = fft->back_slot_requests + 2*n_nodes*slot;
+  int n_req = 0;
+
+  offset = 0;
+  for(j=0;j<plan_f->g_size;j++) {
+    if(plan_f->send_size[j] > 0)
+      MPI_Irecv(r_buf + offset, plan_f->send_size[j], MPI_FFT_FLOAT,
+		plan_f->group[j], REQ_FFT_SLOT, MPI_COMM_WORLD, &req[n_req++]);
+    offset += plan_f->send_size[j];
+  }
+  if(fft->fft_node) {
+    for(j=0;j<plan_f->g_size;j++) {
+      if(plan_f->recv_size[j] > 0) {
+	plan_b->pack_function(in, r_buf + offset, &(plan_f->recv_block[6*j]),
+			      &(plan_f->recv_block[6*j+3]), plan_f->new_mesh, plan_f->element);
+	MPI_Isend(r_buf + offset, plan_f->recv_size[j], MPI_FFT_FLOAT,
+		  plan_f->group[j], REQ_FFT_SLOT, MPI_COMM_WORLD, &req[n_req++]);
+      }
+      offset += plan_f->recv_size[j];
+    }
+  }
+  fft->back_slot_n_requests[slot] = n_req;
+}
+
+void fft_common_back_comm_finish(fft_data_struct *fft, fft_forw_plan *plan_f, fft_float *out, int slot)
+{
+  int j, offset;
+  fft_float *r_buf = fft->back_slot_buf + slot*fft->back_slot_size;
+
+  MPI_Waitall(fft->back_slot_n_requests[slot], fft->back_slot_requests + 2*n_nodes*slot, MPI_STATUSES_IGNORE);
+
+  offset = 0;
+  for(j=0;j<plan_f->g_size;j++) {
+    if(plan_f->send_size[j] > 0)
+      fft_unpack_block(r_buf + offset, out, &(plan_f->send_block[6*j]),
+		       &(plan_f->send_block[6*j+3]), plan_f->old_mesh, plan_f->element);
+    offset += plan_f->send_size[j];
+  }
+}
+
+void fft_pack_block(fft_float *in, fft_float *out, int start[3], int size[3], int dim[3], int element)
 {
   /* mid and slow changing indices */
   int m,s;
@@ -66,7 +404,7 @@ void fft_pack_block(double *in, double *out, int start[3], int size[3], int dim[
   /* offsets for indizes in output grid */
   int m_out_offset;
 
-  copy_size    = element * size[2] * sizeof(double);
+  copy_size    = element * size[2] * sizeof(fft_float);
   m_in_offset  = element * dim[2];
   s_in_offset  = element * (dim[2] * (dim[1] - size[1]));
   m_out_offset = element * size[2];
@@ -82,7 +420,7 @@ void fft_pack_block(double *in, double *out, int start[3], int size[3], int dim[
   }
 }
 
-void fft_pack_block_permute1(double *in, double *out, int start[3], int size[3], 
+void fft_pack_block_permute1(fft_float *in, fft_float *out, int start[3], int size[3], 
 			 int dim[3], int element)
 {
   /* slow,mid and fast changing indices for input  grid */
@@ -113,7 +451,7 @@ void fft_pack_block_permute1(double *in, double *out, int start[3], int size[3],
 
 }
 
-void fft_pack_block_permute2(double *in, double *out, int start[3], int size[3], 
+void fft_pack_block_permute2(fft_float *in, fft_float *out, int start[3], int size[3], 
 			 int dim[3],int element)
 {
   /* slow,mid and fast changing indices for input  grid */
@@ -147,7 +485,7 @@ void fft_pack_block_permute2(double *in, double *out, int start[3], int size[3],
 
 }
 
-void fft_unpack_block(double *in, double *out, int start[3], int size[3], 
+void fft_unpack_block(fft_float *in, fft_float *out, int start[3], int size[3], 
 		  int dim[3], int element)
 {
   /* mid and slow changing indices */
@@ -161,7 +499,7 @@ void fft_unpack_block(double *in, double *out, int start[3], int size[3],
   /* offsets for indizes in output grid */
   int m_out_offset,s_out_offset;
 
-  copy_size    = element * (size[2] * sizeof(double));
+  copy_size    = element * (size[2] * sizeof(fft_float));
   m_out_offset = element * dim[2];
   s_out_offset = element * (dim[2] * (dim[1] - size[1]));
   m_in_offset  = element * size[2];
@@ -296,6 +634,8 @@ int fft_calc_send_block(int pos1[3], int grid1[3], int pos2[3], int grid2[3],
     last2[i] = first2[i] + mesh2[i] -1;
     block[i  ] = imax(first1[i],first2[i]) - first1[i];
     block[i+3] = (imin(last1[i], last2[i] ) - first1[i])-block[i]+1;
+    /* the meshes do not overlap */
+    if(block[i+3] < 0) block[i+3] = 0;
     size *= block[i+3];
   }
   return size;
@@ -330,7 +670,7 @@ void fft_print_fft_plan(fft_forw_plan pl)
  fflush(stderr);
 }
 
-void fft_print_global_fft_mesh(fft_forw_plan plan, double *data, int element, int num)
+void fft_print_global_fft_mesh(fft_forw_plan plan, fft_float *data, int element, int num)
 {
   int i0,i1,i2,b=1;
   int mesh,divide=0,block1=-1,start1;
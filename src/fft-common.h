@@ -22,6 +22,8 @@
 #define _FFT_COMMON_H
 
 #include <config.h>
+#include <mpi.h>
+#include "utils.h"
 
 #if defined(P3M) || defined(DP3M)
 
@@ -29,6 +31,24 @@
  * data types
  ************************************************/
 
+#ifdef P3M_SINGLE_PRECISION
+/** Floating point type of the P3M meshes and FFTs. Single precision if
+    configured with --with-p3m-precision=single, which halves the
+    memory and communication volume of the k-space part. */
+typedef float fft_float;
+/** MPI datatype of \ref fft_float. */
+#define MPI_FFT_FLOAT MPI_FLOAT
+/** FFTW function or type name for the precision of \ref fft_float. */
+#define FFTW_NAME(name) fftwf_ ## name
+/** prefix of the FFTW wisdom files, which differ between the precisions. */
+#define FFTW_WISDOM_PREFIX "fftw3f"
+#else
+typedef double fft_float;
+#define MPI_FFT_FLOAT MPI_DOUBLE
+#define FFTW_NAME(name) fftw_ ## name
+#define FFTW_WISDOM_PREFIX "fftw3"
+#endif
+
 /** Structure for performing a 1D FFT.  
  *
  *  This includes the information about the redistribution of the 3D
@@ -61,6 +81,10 @@ typedef struct {
   int g_size;
   /** group of nodes which have to communicate with each other. */ 
   int *group;
+  /** communicator of the group, for \ref FFT_COMM_ALLTOALL. */
+  MPI_Comm group_comm;
+  /** rank of the group members in \ref fft_forw_plan::group_comm. */
+  int *group_rank;
 
   /** packing function for send blocks. */
   void (*pack_function)();
@@ -89,6 +113,10 @@ typedef struct {
   void (*pack_function)(); 
 } fft_back_plan;
 
+/** number of back transforms whose final redistribution can be
+    pending at the same time, see \ref fft_common_back_comm_start. */
+#define FFT_BACK_SLOTS 3
+
 typedef struct {
   /** Information about the three one dimensional FFTs and how the nodes
    *  have to communicate in between.
@@ -103,6 +131,34 @@ typedef struct {
   /** Whether FFT is initialized or not. */
   int init_tag;
 
+  /** Number of nodes that do the FFTs. If these are only a part of
+      the nodes, the others just send their mesh to them and get back
+      the result, see \ref fft_common_fft_node. */
+  int n_fft_nodes;
+  /** Whether this node is one of the FFT nodes. */
+  int fft_node;
+
+  /** Decomposition of the FFT mesh, \ref FFT_PENCILS or \ref FFT_SLABS. */
+  int decomposition;
+  /** How the mesh is redistributed between the 1D FFTs, one of the
+      FFT_COMM_* methods. Chosen by \ref fft_common_tune_comm. */
+  int comm_method;
+  /** counts and displacements for MPI_Alltoallv, 4 per node. */
+  int *comm_counts;
+  /** requests for the nonblocking communication, 2 per node. */
+  MPI_Request *requests;
+
+  /** Whether the first FFT is a real to complex transform. Then only
+      the modes 0 to n/2 of its direction are stored and communicated,
+      the others are the complex conjugates of these, and the back
+      transform is complex to real. */
+  int r2c;
+  /** In the real to complex mode, the halved direction in the
+      k-space mesh (i. e. in the mesh of plan[3]). */
+  int r2c_dir;
+  /** In the real to complex mode, the full mesh size in that direction. */
+  int r2c_mesh;
+
   /** Maximal size of the communication buffers. */
   int max_comm_size;
 
@@ -110,11 +166,21 @@ typedef struct {
   int max_mesh_size;
 
   /** send buffer. */
-  double *send_buf;
+  fft_float *send_buf;
   /** receive buffer. */
-  double *recv_buf;
+  fft_float *recv_buf;
   /** Buffer for receive data. */
-  double *data_buf;
+  fft_float *data_buf;
+
+  /** buffers for the pending back redistributions of the first plan,
+      \ref FFT_BACK_SLOTS of \ref fft_data_struct::back_slot_size each. */
+  fft_float *back_slot_buf;
+  /** size of a slot in \ref fft_data_struct::back_slot_buf. */
+  int back_slot_size;
+  /** requests of the slots, 2 per node and slot. */
+  MPI_Request *back_slot_requests;
+  /** number of pending requests per slot. */
+  int back_slot_n_requests[FFT_BACK_SLOTS];
 } fft_data_struct;
 
 /************************************************
@@ -128,12 +194,141 @@ typedef struct {
 #define REQ_FFT_FORW   301
 /** Tag for communication in back_grid_comm() */
 #define REQ_FFT_BACK   302
+/** Tag for communication in fft_common_back_comm_start() */
+#define REQ_FFT_SLOT   303
 /* Tag for wisdom file I/O */
 #  define FFTW_FAILURE 0
 
+/** \name Decompositions of the FFT mesh */
+/*@{*/
+/** The mesh is distributed over a 2D node grid, leaving only the row
+    direction of the current 1D FFT local. Every 1D FFT needs a
+    redistribution, but each among a part of the nodes only. */
+#define FFT_PENCILS 0
+/** The mesh is distributed over a 1D node grid. The first two 1D FFTs
+    are done on the same planes of the mesh, only one redistribution
+    among all nodes is needed. */
+#define FFT_SLABS   1
+/*@}*/
+
+/** minimal number of mesh planes per node for \ref FFT_SLABS. */
+#define FFT_SLAB_MIN_PLANES 2
+
+/** \name Methods for the redistributions of the mesh */
+/*@{*/
+/** pairwise blocking send and receive with each group member in turn. */
+#define FFT_COMM_PAIRWISE    0
+/** one MPI_Alltoallv on the communicator of the group. */
+#define FFT_COMM_ALLTOALL    1
+/** nonblocking sends and receives for all group members; the blocks
+    are unpacked in the order in which they arrive. */
+#define FFT_COMM_NONBLOCKING 2
+/** number of methods. */
+#define FFT_N_COMM_METHODS   3
+/*@}*/
+
+/** number of test redistributions per method in \ref fft_common_tune_comm. */
+#define FFT_TUNE_REPS 3
+
 /** Initialize FFT data structure. */
 void fft_common_pre_init(fft_data_struct *fft);
 
+/** Choose the decomposition of the FFT mesh and set up the node grids
+ *  of the three 1D FFTs, as well as the row directions and
+ *  permutations of the plans. Slabs are used if every node gets at
+ *  least \ref FFT_SLAB_MIN_PLANES planes of the mesh in both
+ *  distributed directions, otherwise pencils.
+ *
+ * \param fft             the FFT data.
+ * \param n_grid          the node grids, n_grid[0] is the real space node grid (Input),
+ *                        n_grid[1..3] the FFT node grids (Output).
+ * \param global_mesh_dim global mesh dimensions.
+ */
+void fft_common_calc_node_grids(fft_data_struct *fft, int n_grid[4][3], int global_mesh_dim[3]);
+
+/** The node that does the FFTs with index \a k of the \ref
+ *  fft_data_struct::n_fft_nodes FFT nodes. */
+int fft_common_fft_node(fft_data_struct *fft, int k);
+
+/** Set up the communication of the plans, once the communication
+ *  groups and blocks are known: creates the communicators of the
+ *  groups and adapts \ref fft_data_struct::max_comm_size to the
+ *  collective methods, which send all blocks at once. Has to be called
+ *  on all nodes.
+ * \param fft the FFT data.
+ */
+void fft_common_init_comm(fft_data_struct *fft);
+
+/** Time the redistributions of the mesh with every method and choose
+ *  the fastest one, see \ref fft_data_struct::comm_method. Has to be
+ *  called on all nodes after the buffers are allocated. The content of
+ *  \a data and the data buffer is destroyed.
+ * \param fft  the FFT data.
+ * \param data the mesh.
+ */
+void fft_common_tune_comm(fft_data_struct *fft, fft_float *data);
+
+/** communicate the grid data according to the given fft_forw_plan. 
+ * \param fft  the FFT data.
+ * \param plan communication plan (see \ref fft_forw_plan).
+ * \param in   input mesh.
+ * \param out  output mesh.
+*/
+void fft_common_forw_grid_comm(fft_data_struct *fft, fft_forw_plan *plan, fft_float *in, fft_float *out);
+
+/** communicate the grid data according to the given fft_forw_plan/fft_back_plan. 
+ *  Back means: Use the send/recieve stuff from the forward plan but
+ *  replace the recieve blocks by the send blocks and vice
+ *  versa. Attention then also new_mesh and old_mesh are exchanged.
+ * \param fft    the FFT data.
+ * \param plan_f communication plan (see \ref fft_forw_plan).
+ * \param plan_b additional back plan (see \ref fft_back_plan).
+ * \param in     input mesh.
+ * \param out    output mesh.
+*/
+void fft_common_back_grid_comm(fft_data_struct *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+			       fft_float *in, fft_float *out);
+
+/** Start the back redistribution of the first plan without waiting
+ *  for it, so that the nodes which do not take part in the FFTs can
+ *  pick up the result later with \ref fft_common_back_comm_finish.
+ *  Up to \ref FFT_BACK_SLOTS redistributions can be pending, the
+ *  messages of one pair of nodes are matched in the order of the
+ *  slots. Has to be called on all nodes.
+ * \param fft    the FFT data.
+ * \param plan_f communication plan (the first one).
+ * \param plan_b additional back plan.
+ * \param in     input mesh, only used on the FFT nodes.
+ * \param slot   the slot, between 0 and \ref FFT_BACK_SLOTS-1.
+ */
+void fft_common_back_comm_start(fft_data_struct *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+				fft_float *in, int slot);
+
+/** Finish a back redistribution started with \ref fft_common_back_comm_start.
+ * \param fft    the FFT data.
+ * \param plan_f communication plan (the first one).
+ * \param out    output mesh.
+ * \param slot   the slot.
+ */
+void fft_common_back_comm_finish(fft_data_struct *fft, fft_forw_plan *plan_f, fft_float *out, int slot);
+
+/** Weight of a mode in a sum over the k-space mesh, e. g. for the
+ *  energy. In the real to complex mode, the modes with negative index
+ *  in the halved direction are not stored, and are accounted for by a
+ *  weight of 2 of their complex conjugates.
+ * \param fft the FFT data.
+ * \param j   local indices of the mode in the mesh of plan[3].
+ */
+MDINLINE double fft_mode_weight(fft_data_struct *fft, int j[3])
+{
+  int k;
+
+  if (!fft->r2c)
+    return 1.0;
+  k = j[fft->r2c_dir] + fft->plan[3].start[fft->r2c_dir];
+  return (k == 0 || 2*k == fft->r2c_mesh) ? 1.0 : 2.0;
+}
+
 /** This ugly function does the bookkepping which nodes have to
  *  communicate to each other, when you change the node grid.
  *  Changing the domain decomposition requieres communication. This
@@ -192,7 +387,7 @@ int fft_calc_local_mesh(int n_pos[3], int n_grid[3], int mesh[3], double mesh_of
  *  pos2  - position of the node you intend to receive the data from in the actual node grid. <br>
  *  grid2 - actual node grid.  <br>
  *
- *  \return          size of the send block.
+ *  \return          size of the send block, 0 if the meshes do not overlap.
  *  \param  pos1     Position of send node in grid1.
  *  \param  grid1    node grid 1.
  *  \param  pos2     Position of recv node in grid2.
@@ -221,7 +416,7 @@ int fft_calc_send_block(int pos1[3], int grid1[3], int pos2[3], int grid2[3],
  *  \param dim     size of the in-grid.
  *  \param element size of a grid element (e.g. 1 for Real, 2 for Complex).
  */
-void fft_pack_block(double *in, double *out, int start[3], int size[3], 
+void fft_pack_block(fft_float *in, fft_float *out, int start[3], int size[3], 
 		    int dim[3], int element);
 
 /** pack a block with dimensions (size[0] * size[1] * aize[2]) starting
@@ -247,7 +442,7 @@ void fft_pack_block(double *in, double *out, int start[3], int size[3],
  *  \param dim     size of the in-grid.
  *  \param element size of a grid element (e.g. 1 for Real, 2 for Complex).
  */
-void fft_pack_block_permute1(double *in, double *out, int start[3], int size[3], 
+void fft_pack_block_permute1(fft_float *in, fft_float *out, int start[3], int size[3], 
 			     int dim[3], int element);
 
 /** pack a block with dimensions (size[0] * size[1] * aize[2]) starting
@@ -273,7 +468,7 @@ void fft_pack_block_permute1(double *in, double *out, int start[3], int size[3],
  *  \param dim     size of the in-grid.
  *  \param element size of a grid element (e.g. 1 for Real, 2 for Complex).
  */
-void fft_pack_block_permute2(double *in, double *out, int start[3], int size[3], 
+void fft_pack_block_permute2(fft_float *in, fft_float *out, int start[3], int size[3], 
 			 int dim[3],int element);
 
 
@@ -289,7 +484,7 @@ void fft_pack_block_permute2(double *in, double *out, int start[3], int size[3],
  *  \param dim     size of the in-grid.
  *  \param element size of a grid element (e.g. 1 for Real, 2 for Complex).
  */
-void fft_unpack_block(double *in, double *out, int start[3], int size[3], 
+void fft_unpack_block(fft_float *in, fft_float *out, int start[3], int size[3], 
 		      int dim[3], int element);
 
 /** Debug function to print global fft mesh. 
@@ -299,7 +494,7 @@ void fft_unpack_block(double *in, double *out, int start[3], int size[3],
  * \param element  element size.
  * \param num      element index to print.
 */
-void fft_print_global_fft_mesh(fft_forw_plan plan, double *data, int element, int num);
+void fft_print_global_fft_mesh(fft_forw_plan plan, fft_float *data, int element, int num);
 
 /** Debug function to print fft_forw_plan structure. 
  * \param pl fft/communication plan (see \ref fft_forw_plan).
@@ -31,7 +31,7 @@
 
 #include <fftw3.h>
 /* our remapping of malloc interferes with fftw3's name mangling. */
-void *fftw_malloc(size_t n);
+void *FFTW_NAME(malloc)(size_t n);
 
 #include <mpi.h>
 #include "communication.h"
@@ -47,37 +47,21 @@ void *fftw_malloc(size_t n);
 
 fft_data_struct dfft;
 
-/** communicate the grid data according to the given fft_forw_plan. 
- * \param plan communication plan (see \ref fft_forw_plan).
- * \param in   input mesh.
- * \param out  output mesh.
-*/
-void dfft_forw_grid_comm(fft_forw_plan plan, double *in, double *out);
-
-/** communicate the grid data according to the given fft_forw_plan/fft_bakc_plan. 
- * \param plan_f communication plan (see \ref fft_forw_plan).
- * \param plan_b additional back plan (see \ref fft_back_plan).
- * \param in     input mesh.
- * \param out    output mesh.
-*/
-void dfft_back_grid_comm(fft_forw_plan plan_f, fft_back_plan plan_b, double *in, double *out);
-
-
 void dfft_pre_init()
 {
   fft_common_pre_init(&dfft);
 }
 
-int dfft_init(double **data, 
+int dfft_init(fft_float **data, 
 	      int *local_mesh_dim, int *local_mesh_margin, 
 	      int* global_mesh_dim, double *global_mesh_off,
 	      int *ks_pnum)
 {
   int i,j;
-  /* helpers */
-  int mult[3];
 
   int n_grid[4][3]; /* The four node grids. */
+  int c_mesh_dim[3]; /* The global mesh after the first FFT. */
+  int r_dir;         /* The direction of the first FFT. */
   int my_pos[4][3]; /* The position of this_node in the node grids. */
   int *n_id[4];     /* linear node identity lists for the node grids. */
   int *n_pos[4];    /* positions of nodes in the node grids. */
@@ -107,19 +91,19 @@ int dfft_init(double **data,
 		 n_grid[0]);
   }
     
-  /* FFT node grids (n_grid[1 - 3]) */
-  calc_2d_grid(n_nodes,n_grid[1]);
-  /* resort n_grid[1] dimensions if necessary */
-  dfft.plan[1].row_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
-  dfft.plan[0].n_permute = 0;
-  for(i=1;i<4;i++) dfft.plan[i].n_permute = (dfft.plan[1].row_dir+i)%3;
-  for(i=0;i<3;i++) {
-    n_grid[2][i] = n_grid[1][(i+1)%3];
-    n_grid[3][i] = n_grid[1][(i+2)%3];
-  }
-  dfft.plan[2].row_dir = (dfft.plan[1].row_dir-1)%3;
-  dfft.plan[3].row_dir = (dfft.plan[1].row_dir-2)%3;
+  /* FFT node grids (n_grid[1 - 3]), slabs or pencils */
+  fft_common_calc_node_grids(&dfft, n_grid, global_mesh_dim);
 
+  /* === real to complex mode === */
+  /* The first FFT only keeps the modes 0 to n/2 of its direction,
+     if the remaining mesh can still be split up among the nodes of
+     the other two node grids. For slabs, that direction is never split. */
+  r_dir = dfft.plan[1].row_dir;
+  for(i=0;i<3;i++) c_mesh_dim[i] = global_mesh_dim[i];
+  c_mesh_dim[r_dir] = global_mesh_dim[r_dir]/2 + 1;
+  dfft.r2c = 1;
+  if(n_grid[2][r_dir] > c_mesh_dim[r_dir] || n_grid[3][r_dir] > c_mesh_dim[r_dir]) dfft.r2c = 0;
+  if(!dfft.r2c) c_mesh_dim[r_dir] = global_mesh_dim[r_dir];
 
 
   /* === communication groups === */
@@ -146,7 +130,7 @@ int dfft_init(double **data,
     dfft.plan[i].recv_block = (int *)realloc(dfft.plan[i].recv_block, 6*dfft.plan[i].g_size*sizeof(int));
     dfft.plan[i].recv_size  = (int *)realloc(dfft.plan[i].recv_size, 1*dfft.plan[i].g_size*sizeof(int));
 
-    dfft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], global_mesh_dim,
+    dfft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], (i==1) ? global_mesh_dim : c_mesh_dim,
 					   global_mesh_off, dfft.plan[i].new_mesh, 
 					   dfft.plan[i].start);  
     permute_ifield(dfft.plan[i].new_mesh,3,-(dfft.plan[i].n_permute));
@@ -160,7 +144,7 @@ int dfft_init(double **data,
       node = dfft.plan[i].group[j];
       dfft.plan[i].send_size[j] 
 	= fft_calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			      global_mesh_dim, global_mesh_off, &(dfft.plan[i].send_block[6*j]));
+			      (i==1) ? global_mesh_dim : c_mesh_dim, global_mesh_off, &(dfft.plan[i].send_block[6*j]));
       permute_ifield(&(dfft.plan[i].send_block[6*j]),3,-(dfft.plan[i-1].n_permute));
       permute_ifield(&(dfft.plan[i].send_block[6*j+3]),3,-(dfft.plan[i-1].n_permute));
       if(dfft.plan[i].send_size[j] > dfft.max_comm_size) 
@@ -175,7 +159,7 @@ int dfft_init(double **data,
       /* recv block: this_node from comm-group-node i (identity: node) */
       dfft.plan[i].recv_size[j] 
 	= fft_calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			      global_mesh_dim, global_mesh_off,&(dfft.plan[i].recv_block[6*j]));
+			      (i==1) ? global_mesh_dim : c_mesh_dim, global_mesh_off,&(dfft.plan[i].recv_block[6*j]));
       permute_ifield(&(dfft.plan[i].recv_block[6*j]),3,-(dfft.plan[i].n_permute));
       permute_ifield(&(dfft.plan[i].recv_block[6*j+3]),3,-(dfft.plan[i].n_permute));
       if(dfft.plan[i].recv_size[j] > dfft.max_comm_size) 
@@ -183,6 +167,8 @@ int dfft_init(double **data,
     }
 
     for(j=0;j<3;j++) dfft.plan[i].old_mesh[j] = dfft.plan[i-1].new_mesh[j];
+    /* the rows of the first FFT are shorter afterwards */
+    if(i==2) dfft.plan[2].old_mesh[2] = c_mesh_dim[r_dir];
     if(i==1) 
       dfft.plan[i].element = 1; 
     else {
@@ -199,12 +185,23 @@ int dfft_init(double **data,
     }
   }
 
+  /* communicators for the collective transposes */
+  fft_common_init_comm(&dfft);
+
   /* Factor 2 for complex fields */
   dfft.max_comm_size *= 2;
   dfft.max_mesh_size = (local_mesh_dim[0]*local_mesh_dim[1]*local_mesh_dim[2]);
   for(i=1;i<4;i++) 
     if(2*dfft.plan[i].new_size > dfft.max_mesh_size) dfft.max_mesh_size = 2*dfft.plan[i].new_size;
 
+  if(dfft.r2c) {
+    /* position of the halved direction in the k-space mesh */
+    int dirs[3] = {0, 1, 2};
+    permute_ifield(dirs,3,-(dfft.plan[3].n_permute));
+    for(i=0;i<3;i++) if(dirs[i]==r_dir) dfft.r2c_dir = i;
+    dfft.r2c_mesh = global_mesh_dim[r_dir];
+  }
+
   FFT_TRACE(fprintf(stderr,"%d: dfft.max_comm_size = %d, dfft.max_mesh_size = %d\n",
 		    this_node,dfft.max_comm_size,dfft.max_mesh_size));
 
@@ -226,17 +223,17 @@ int dfft_init(double **data,
   }
   
   /* Factor 2 for complex numbers */
-  dfft.send_buf = (double *)realloc(dfft.send_buf, dfft.max_comm_size*sizeof(double));
-  dfft.recv_buf = (double *)realloc(dfft.recv_buf, dfft.max_comm_size*sizeof(double));
-  (*data)  = (double *)realloc((*data), dfft.max_mesh_size*sizeof(double));
-  dfft.data_buf = (double *)realloc(dfft.data_buf, dfft.max_mesh_size*sizeof(double));
+  dfft.send_buf = (fft_float *)realloc(dfft.send_buf, dfft.max_comm_size*sizeof(fft_float));
+  dfft.recv_buf = (fft_float *)realloc(dfft.recv_buf, dfft.max_comm_size*sizeof(fft_float));
+  (*data)  = (fft_float *)realloc((*data), dfft.max_mesh_size*sizeof(fft_float));
+  dfft.data_buf = (fft_float *)realloc(dfft.data_buf, dfft.max_mesh_size*sizeof(fft_float));
   if(!(*data) || !dfft.data_buf || !dfft.recv_buf || !dfft.send_buf) {
     fprintf(stderr,"%d: Could not allocate FFT data arays\n",this_node);
     errexit();
   }
 
-  fftw_complex *c_data     = (fftw_complex *) (*data);
-  fftw_complex *c_data_buf = (fftw_complex *) dfft.data_buf;
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) (*data);
+  FFTW_NAME(complex) *c_data_buf = (FFTW_NAME(complex) *) dfft.data_buf;
 
   /* === FFT Routines (Using FFTW / RFFTW package)=== */
   for(i=1;i<4;i++) {
@@ -244,25 +241,31 @@ int dfft_init(double **data,
     /* FFT plan creation. 
        Attention: destroys contents of c_data/data and c_data_buf/data_buf. */
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"dfftw3_1d_wisdom_forw_n%d.file",
+    sprintf(wisdom_file_name,"d" FFTW_WISDOM_PREFIX "_1d_wisdom_forw_n%d.file",
 	    dfft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
+      wisdom_status = FFTW_NAME(import_wisdom_from_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    if(dfft.init_tag==1) fftw_destroy_plan(dfft.plan[i].fftw_plan);
+    if(dfft.init_tag==1) FFTW_NAME(destroy_plan)(dfft.plan[i].fftw_plan);
 //printf("dfft.plan[%d].n_ffts=%d\n",i,dfft.plan[i].n_ffts);
-    dfft.plan[i].fftw_plan =
-      fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         dfft.plan[i].dir,FFTW_PATIENT);
+    if(i==1 && dfft.r2c)
+      dfft.plan[1].fftw_plan =
+	FFTW_NAME(plan_many_dft_r2c)(1,&dfft.plan[1].new_mesh[2],dfft.plan[1].n_ffts,
+			       dfft.data_buf,NULL,1,dfft.plan[1].new_mesh[2],
+			       c_data,NULL,1,c_mesh_dim[r_dir],FFTW_PATIENT);
+    else
+      dfft.plan[i].fftw_plan =
+        FFTW_NAME(plan_many_dft)(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           dfft.plan[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
+      FFTW_NAME(export_wisdom_to_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    dfft.plan[i].fft_function = fftw_execute;        
+    dfft.plan[i].fft_function = FFTW_NAME(execute);        
   }
 
   /* === The BACK Direction === */
@@ -270,24 +273,30 @@ int dfft_init(double **data,
   for(i=1;i<4;i++) {
     dfft.back[i].dir = FFTW_BACKWARD;
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"dfftw3_1d_wisdom_back_n%d.file",
+    sprintf(wisdom_file_name,"d" FFTW_WISDOM_PREFIX "_1d_wisdom_back_n%d.file",
 	    dfft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
+      wisdom_status = FFTW_NAME(import_wisdom_from_file)(wisdom_file);
       fclose(wisdom_file);
     }    
-    if(dfft.init_tag==1) fftw_destroy_plan(dfft.back[i].fftw_plan);
-    dfft.back[i].fftw_plan =
-      fftw_plan_many_dft(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         c_data,NULL,1,dfft.plan[i].new_mesh[2],
-                         dfft.back[i].dir,FFTW_PATIENT);
+    if(dfft.init_tag==1) FFTW_NAME(destroy_plan)(dfft.back[i].fftw_plan);
+    if(i==1 && dfft.r2c)
+      dfft.back[1].fftw_plan =
+	FFTW_NAME(plan_many_dft_c2r)(1,&dfft.plan[1].new_mesh[2],dfft.plan[1].n_ffts,
+			       c_data,NULL,1,c_mesh_dim[r_dir],
+			       dfft.data_buf,NULL,1,dfft.plan[1].new_mesh[2],FFTW_PATIENT);
+    else
+      dfft.back[i].fftw_plan =
+        FFTW_NAME(plan_many_dft)(1,&dfft.plan[i].new_mesh[2],dfft.plan[i].n_ffts,
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           c_data,NULL,1,dfft.plan[i].new_mesh[2],
+                           dfft.back[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
+      FFTW_NAME(export_wisdom_to_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    dfft.back[i].fft_function = fftw_execute;
+    dfft.back[i].fft_function = FFTW_NAME(execute);
     dfft.back[i].pack_function = fft_pack_block_permute1;
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 1 \n",this_node,i));
   }
@@ -300,24 +309,26 @@ int dfft_init(double **data,
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 2 \n",this_node,1));
   }
   dfft.init_tag=1;
+  /* pick the fastest redistribution method for these plans */
+  fft_common_tune_comm(&dfft, *data);
   /* free(data); */
   for(i=0;i<4;i++) { free(n_id[i]); free(n_pos[i]); }
   return dfft.max_mesh_size; 
 }
 
 
-void dfft_perform_forw(double *data)
+void dfft_perform_forw(fft_float *data)
 {
   int i;
   /* int m,n,o; */
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 1:\n",this_node));
 
-  fftw_complex *c_data     = (fftw_complex *) data;
-  fftw_complex *c_data_buf = (fftw_complex *) dfft.data_buf;
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) data;
+  FFTW_NAME(complex) *c_data_buf = (FFTW_NAME(complex) *) dfft.data_buf;
 
   /* communication to current dir row format (in is data) */
-  dfft_forw_grid_comm(dfft.plan[1], data, dfft.data_buf);
+  fft_common_forw_grid_comm(&dfft, &dfft.plan[1], data, dfft.data_buf);
 
 
   /*
@@ -334,142 +345,85 @@ void dfft_perform_forw(double *data)
     }
   */
 
-  /* complexify the real data array (in is data_buf) */
-  for(i=0;i<dfft.plan[1].new_size;i++) {
-    data[2*i]     = dfft.data_buf[i];     /* real value */
-    data[(2*i)+1] = 0;       /* complex value */
+  if(dfft.r2c) {
+    /* real to complex FFT (in is dfft.data_buf, out is data) */
+    FFTW_NAME(execute_dft_r2c)(dfft.plan[1].fftw_plan,dfft.data_buf,c_data);
+  }
+  else {
+    /* complexify the real data array (in is data_buf) */
+    for(i=0;i<dfft.plan[1].new_size;i++) {
+      data[2*i]     = dfft.data_buf[i];     /* real value */
+      data[(2*i)+1] = 0;       /* complex value */
+    }
+    /* perform FFT (in/out is data)*/
+    FFTW_NAME(execute_dft)(dfft.plan[1].fftw_plan,c_data,c_data);
   }
-  /* perform FFT (in/out is data)*/
-  fftw_execute_dft(dfft.plan[1].fftw_plan,c_data,c_data);
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 2:\n",this_node));
   /* communication to current dir row format (in is data) */
-  dfft_forw_grid_comm(dfft.plan[2], data, dfft.data_buf);
+  fft_common_forw_grid_comm(&dfft, &dfft.plan[2], data, dfft.data_buf);
   /* perform FFT (in/out is data_buf)*/
-  fftw_execute_dft(dfft.plan[2].fftw_plan,c_data_buf,c_data_buf);
+  FFTW_NAME(execute_dft)(dfft.plan[2].fftw_plan,c_data_buf,c_data_buf);
   /* ===== third direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 3:\n",this_node));
   /* communication to current dir row format (in is data_buf) */
-  dfft_forw_grid_comm(dfft.plan[3], dfft.data_buf, data);
+  fft_common_forw_grid_comm(&dfft, &dfft.plan[3], dfft.data_buf, data);
   /* perform FFT (in/out is data)*/
-  fftw_execute_dft(dfft.plan[3].fftw_plan,c_data,c_data);
+  FFTW_NAME(execute_dft)(dfft.plan[3].fftw_plan,c_data,c_data);
   //fft_print_global_fft_mesh(dfft.plan[3],data,1,0);
 
   /* REMARK: Result has to be in data. */
 }
 
 
-void dfft_perform_back(double *data)
+void dfft_perform_back(fft_float *data)
 {
   int i;
 
-  fftw_complex *c_data     = (fftw_complex *) data;
-  fftw_complex *c_data_buf = (fftw_complex *) dfft.data_buf;
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) data;
+  FFTW_NAME(complex) *c_data_buf = (FFTW_NAME(complex) *) dfft.data_buf;
   
   /* ===== third direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_back: dir 3:\n",this_node));
 
 
   /* perform FFT (in is data) */
-  fftw_execute_dft(dfft.back[3].fftw_plan,c_data,c_data);
+  FFTW_NAME(execute_dft)(dfft.back[3].fftw_plan,c_data,c_data);
   /* communicate (in is data)*/
-  dfft_back_grid_comm(dfft.plan[3],dfft.back[3],data,dfft.data_buf);
+  fft_common_back_grid_comm(&dfft, &dfft.plan[3], &dfft.back[3], data, dfft.data_buf);
  
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_back: dir 2:\n",this_node));
   /* perform FFT (in is data_buf) */
-  fftw_execute_dft(dfft.back[2].fftw_plan,c_data_buf,c_data_buf);
+  FFTW_NAME(execute_dft)(dfft.back[2].fftw_plan,c_data_buf,c_data_buf);
   /* communicate (in is data_buf) */
-  dfft_back_grid_comm(dfft.plan[2],dfft.back[2],dfft.data_buf,data);
+  fft_common_back_grid_comm(&dfft, &dfft.plan[2], &dfft.back[2], dfft.data_buf, data);
 
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-  fftw_execute_dft(dfft.back[1].fftw_plan,c_data,c_data);
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<dfft.plan[1].new_size;i++) {
-    dfft.data_buf[i] = data[2*i]; /* real value */
-    //Vincent:
-    if (data[2*i+1]>1e-5) {
-      printf("dipoar fft - Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
-      if (i>100) exit(-1);
+  if(dfft.r2c) {
+    /* complex to real FFT (in is data, out is dfft.data_buf) */
+    FFTW_NAME(execute_dft_c2r)(dfft.back[1].fftw_plan,c_data,dfft.data_buf);
+  }
+  else {
+    /* perform FFT (in is data) */
+    FFTW_NAME(execute_dft)(dfft.back[1].fftw_plan,c_data,c_data);
+    /* throw away the (hopefully) empty complex component (in is data)*/
+    for(i=0;i<dfft.plan[1].new_size;i++) {
+      dfft.data_buf[i] = data[2*i]; /* real value */
+      //Vincent:
+      if (data[2*i+1]>1e-5) {
+        printf("dipoar fft - Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
+        if (i>100) exit(-1);
+      }
     }
   }
   /* communicate (in is data_buf) */
-  dfft_back_grid_comm(dfft.plan[1],dfft.back[1],dfft.data_buf,data);
+  fft_common_back_grid_comm(&dfft, &dfft.plan[1], &dfft.back[1], dfft.data_buf, data);
 
 
   /* REMARK: Result has to be in data. */
 }
 
-void dfft_forw_grid_comm(fft_forw_plan plan, double *in, double *out)
-{
-  int i;
-  MPI_Status status;
-  double *tmp_ptr;
-
-  for(i=0;i<plan.g_size;i++) {   
-    plan.pack_function(in, dfft.send_buf, &(plan.send_block[6*i]), 
-		       &(plan.send_block[6*i+3]), plan.old_mesh, plan.element);
-
-    if(plan.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(dfft.send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
-      MPI_Recv(dfft.recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-    }
-    else if(plan.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(dfft.recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-      MPI_Send(dfft.send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);      
-    }
-    else {                              /* Self communication... */   
-      tmp_ptr  = dfft.send_buf;
-      dfft.send_buf = dfft.recv_buf;
-      dfft.recv_buf = tmp_ptr;
-    }
-    fft_unpack_block(dfft.recv_buf, out, &(plan.recv_block[6*i]), 
-		 &(plan.recv_block[6*i+3]), plan.new_mesh, plan.element);
-  }
-}
-
-void dfft_back_grid_comm(fft_forw_plan plan_f,  fft_back_plan plan_b, double *in, double *out)
-{
-  int i;
-  MPI_Status status;
-  double *tmp_ptr;
-
-  /* Back means: Use the send/recieve stuff from the forward plan but
-     replace the recieve blocks by the send blocks and vice
-     versa. Attention then also new_mesh and old_mesh are exchanged */
-
-  for(i=0;i<plan_f.g_size;i++) {
-    
-    plan_b.pack_function(in, dfft.send_buf, &(plan_f.recv_block[6*i]), 
-		       &(plan_f.recv_block[6*i+3]), plan_f.new_mesh, plan_f.element);
-
-    if(plan_f.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(dfft.send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
-      MPI_Recv(dfft.recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-    }
-    else if(plan_f.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(dfft.recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-      MPI_Send(dfft.send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);      
-    }
-    else {                                /* Self communication... */   
-      tmp_ptr  = dfft.send_buf;
-      dfft.send_buf = dfft.recv_buf;
-      dfft.recv_buf = tmp_ptr;
-    }
-    fft_unpack_block(dfft.recv_buf, out, &(plan_f.send_block[6*i]), 
-		 &(plan_f.send_block[6*i+3]), plan_f.old_mesh, plan_f.element);
-  }
-}
-
 
 #endif /* DP3M */
@@ -64,7 +64,7 @@ void  dfft_pre_init();
  * \param global_mesh_off    Pointer to global CA mesh offset.
  * \param ks_pnum            Pointer to number of permutations in k-space.
  */
-int dfft_init(double **data, 
+int dfft_init(fft_float **data, 
 	      int *ca_mesh_dim, int *ca_mesh_margin, 
 	      int* global_mesh_dim, double *global_mesh_off,
 	      int *ks_pnum);
@@ -74,13 +74,13 @@ int dfft_init(double **data,
     \warning The content of \a data is overwritten.
     \param data DMesh.
 */
-void dfft_perform_forw(double *data);
+void dfft_perform_forw(fft_float *data);
 
 /** perform the backward 3D FFT for meshes related to the magnetic dipole-dipole interaction.
     \warning The content of \a data is overwritten.
     \param data DMesh.
 */
-void dfft_perform_back(double *data);
+void dfft_perform_back(fft_float *data);
 
 
 #endif /* DP3M */
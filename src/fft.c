@@ -30,7 +30,7 @@
 
 #include <fftw3.h>
 /* our remapping of malloc interferes with fftw3's name mangling. */
-void *fftw_malloc(size_t n);
+void *FFTW_NAME(malloc)(size_t n);
 
 #include <mpi.h>
 #include "communication.h"
@@ -45,36 +45,60 @@ void *fftw_malloc(size_t n);
  ************************************************/
 fft_data_struct fft;
 
-/** communicate the grid data according to the given fft_forw_plan. 
- * \param plan communication plan (see \ref fft_forw_plan).
- * \param in   input mesh.
- * \param out  output mesh.
-*/
-static void 
-fft_forw_grid_comm(fft_forw_plan plan, double *in, double *out);
-
-/** communicate the grid data according to the given fft_forw_plan/fft_bakc_plan. 
- * \param plan_f communication plan (see \ref fft_forw_plan).
- * \param plan_b additional back plan (see \ref fft.back_plan).
- * \param in     input mesh.
- * \param out    output mesh.
-*/
-static void 
-fft_back_grid_comm(fft_forw_plan plan_f, fft_back_plan plan_b, double *in, double *out);
-
 void fft_pre_init() {
   fft_common_pre_init(&fft);
 }
 
-int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, 
+/** Find the communication group of the first plan if the FFT is done
+    on a subset of the nodes. Then every node sends its part of the
+    real space mesh to all FFT nodes whose part of the first FFT
+    node grid overlaps with it, and the FFT nodes receive from all
+    nodes overlapping with their part.
+    \param n_grid the node grids.
+    \param n_id   the node list of the first FFT node grid (Output).
+    \param n_pos  the positions of the nodes in the node grids, -1 for
+                  nodes outside of the first FFT node grid (Output for n_pos[1]).
+    \param my_pos the positions of this node in the node grids (Output for my_pos[1]).
+    \param global_mesh_dim global mesh dimensions.
+    \param global_mesh_off global mesh offset.
+    \return the size of the group.
+*/
+static int fft_find_subset_group(int n_grid[4][3], int *n_id, int *n_pos[4], int my_pos[4][3],
+				 int *global_mesh_dim, double *global_mesh_off)
+{
+  int k, node, g_size = 0, block[6];
+
+  for(node=0;node<n_nodes;node++) n_pos[1][3*node] = -1;
+  for(k=0;k<fft.n_fft_nodes;k++) {
+    node = fft_common_fft_node(&fft, k);
+    n_id[k] = node;
+    get_grid_pos(k,&(n_pos[1][3*node+0]),&(n_pos[1][3*node+1]),&(n_pos[1][3*node+2]),
+		 n_grid[1]);
+  }
+  if(fft.fft_node)
+    for(k=0;k<3;k++) my_pos[1][k] = n_pos[1][3*this_node+k];
+
+  for(node=0;node<n_nodes;node++) {
+    if((n_pos[1][3*node] >= 0 &&
+	fft_calc_send_block(my_pos[0], n_grid[0], &(n_pos[1][3*node]), n_grid[1],
+			    global_mesh_dim, global_mesh_off, block) > 0) ||
+       (fft.fft_node &&
+	fft_calc_send_block(my_pos[1], n_grid[1], &(n_pos[0][3*node]), n_grid[0],
+			    global_mesh_dim, global_mesh_off, block) > 0))
+      fft.plan[1].group[g_size++] = node;
+  }
+  return g_size;
+}
+
+int fft_init(fft_float **data, int *ca_mesh_dim, int *ca_mesh_margin, 
 	     int* global_mesh_dim, double *global_mesh_off,
-	     int *ks_pnum)
+	     int *ks_pnum, int n_fft_nodes)
 {
   int i,j;
-  /* helpers */
-  int mult[3];
 
   int n_grid[4][3]; /* The four node grids. */
+  int c_mesh_dim[3]; /* The global mesh after the first FFT. */
+  int r_dir;         /* The direction of the first FFT. */
   int my_pos[4][3]; /* The position of this_node in the node grids. */
   int *n_id[4];     /* linear node identity lists for the node grids. */
   int *n_pos[4];    /* positions of nodes in the node grids. */
@@ -87,6 +111,10 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
 
 
   fft.max_comm_size=0; fft.max_mesh_size=0;
+  fft.n_fft_nodes = (n_fft_nodes > 0 && n_fft_nodes < n_nodes) ? n_fft_nodes : n_nodes;
+  fft.fft_node = 0;
+  for(i=0;i<fft.n_fft_nodes;i++)
+    if(fft_common_fft_node(&fft, i) == this_node) fft.fft_node = 1;
   for(i=0;i<4;i++) {
     n_id[i]  = malloc(1*n_nodes*sizeof(int));
     n_pos[i] = malloc(3*n_nodes*sizeof(int));
@@ -104,27 +132,34 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
 		 n_grid[0]);
   }
     
-  /* FFT node grids (n_grid[1 - 3]) */
-  calc_2d_grid(n_nodes,n_grid[1]);
-  /* resort n_grid[1] dimensions if necessary */
-  fft.plan[1].row_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
-  fft.plan[0].n_permute = 0;
-  for(i=1;i<4;i++) fft.plan[i].n_permute = (fft.plan[1].row_dir+i)%3;
-  for(i=0;i<3;i++) {
-    n_grid[2][i] = n_grid[1][(i+1)%3];
-    n_grid[3][i] = n_grid[1][(i+2)%3];
-  }
-  fft.plan[2].row_dir = (fft.plan[1].row_dir-1)%3;
-  fft.plan[3].row_dir = (fft.plan[1].row_dir-2)%3;
+  /* FFT node grids (n_grid[1 - 3]), slabs or pencils */
+  fft_common_calc_node_grids(&fft, n_grid, global_mesh_dim);
 
+  /* === real to complex mode === */
+  /* The first FFT only keeps the modes 0 to n/2 of its direction,
+     if the remaining mesh can still be split up among the nodes of
+     the other two node grids. For slabs, that direction is never split. */
+  r_dir = fft.plan[1].row_dir;
+  for(i=0;i<3;i++) c_mesh_dim[i] = global_mesh_dim[i];
+  c_mesh_dim[r_dir] = global_mesh_dim[r_dir]/2 + 1;
+  fft.r2c = 1;
+  if(n_grid[2][r_dir] > c_mesh_dim[r_dir] || n_grid[3][r_dir] > c_mesh_dim[r_dir]) fft.r2c = 0;
+  if(!fft.r2c) c_mesh_dim[r_dir] = global_mesh_dim[r_dir];
 
 
   /* === communication groups === */
   /* copy local mesh off real space charge assignment grid */
   for(i=0;i<3;i++) fft.plan[0].new_mesh[i] = ca_mesh_dim[i];
   for(i=1; i<4;i++) {
-    fft.plan[i].g_size=fft_find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
-					fft.plan[i].group, n_pos[i], my_pos[i]);
+    if(i==1 && fft.n_fft_nodes < n_nodes)
+      fft.plan[1].g_size = fft_find_subset_group(n_grid, n_id[1], n_pos, my_pos,
+						 global_mesh_dim, global_mesh_off);
+    else if(!fft.fft_node)
+      /* the FFTs are done without this node */
+      fft.plan[i].g_size = 0;
+    else
+      fft.plan[i].g_size=fft_find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
+					      fft.plan[i].group, n_pos[i], my_pos[i]);
     if(fft.plan[i].g_size==-1) {
       /* try permutation */
       j = n_grid[i][(fft.plan[i].row_dir+1)%3];
@@ -143,11 +178,18 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     fft.plan[i].recv_block = (int *)realloc(fft.plan[i].recv_block, 6*fft.plan[i].g_size*sizeof(int));
     fft.plan[i].recv_size  = (int *)realloc(fft.plan[i].recv_size, 1*fft.plan[i].g_size*sizeof(int));
 
-    fft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], global_mesh_dim,
-					   global_mesh_off, fft.plan[i].new_mesh, 
-					   fft.plan[i].start);  
-    permute_ifield(fft.plan[i].new_mesh,3,-(fft.plan[i].n_permute));
-    permute_ifield(fft.plan[i].start,3,-(fft.plan[i].n_permute));
+    if(fft.fft_node) {
+      fft.plan[i].new_size = fft_calc_local_mesh(my_pos[i], n_grid[i], (i==1) ? global_mesh_dim : c_mesh_dim,
+						 global_mesh_off, fft.plan[i].new_mesh, 
+						 fft.plan[i].start);  
+      permute_ifield(fft.plan[i].new_mesh,3,-(fft.plan[i].n_permute));
+      permute_ifield(fft.plan[i].start,3,-(fft.plan[i].n_permute));
+    }
+    else {
+      /* no part of the FFT meshes on this node */
+      fft.plan[i].new_size = 0;
+      for(j=0;j<3;j++) fft.plan[i].new_mesh[j] = fft.plan[i].start[j] = 0;
+    }
     fft.plan[i].n_ffts = fft.plan[i].new_mesh[0]*fft.plan[i].new_mesh[1];
 
     /* === send/recv block specifications === */
@@ -157,7 +199,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
       node = fft.plan[i].group[j];
       fft.plan[i].send_size[j] 
 	= fft_calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			      global_mesh_dim, global_mesh_off, &(fft.plan[i].send_block[6*j]));
+			      (i==1) ? global_mesh_dim : c_mesh_dim, global_mesh_off, &(fft.plan[i].send_block[6*j]));
       permute_ifield(&(fft.plan[i].send_block[6*j]),3,-(fft.plan[i-1].n_permute));
       permute_ifield(&(fft.plan[i].send_block[6*j+3]),3,-(fft.plan[i-1].n_permute));
       if(fft.plan[i].send_size[j] > fft.max_comm_size) 
@@ -172,7 +214,7 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
       /* recv block: this_node from comm-group-node i (identity: node) */
       fft.plan[i].recv_size[j] 
 	= fft_calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			      global_mesh_dim, global_mesh_off, &(fft.plan[i].recv_block[6*j]));
+			      (i==1) ? global_mesh_dim : c_mesh_dim, global_mesh_off, &(fft.plan[i].recv_block[6*j]));
       permute_ifield(&(fft.plan[i].recv_block[6*j]),3,-(fft.plan[i].n_permute));
       permute_ifield(&(fft.plan[i].recv_block[6*j+3]),3,-(fft.plan[i].n_permute));
       if(fft.plan[i].recv_size[j] > fft.max_comm_size) 
@@ -180,6 +222,8 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     }
 
     for(j=0;j<3;j++) fft.plan[i].old_mesh[j] = fft.plan[i-1].new_mesh[j];
+    /* the rows of the first FFT are shorter afterwards */
+    if(i==2) fft.plan[2].old_mesh[2] = c_mesh_dim[r_dir];
     if(i==1) 
       fft.plan[i].element = 1; 
     else {
@@ -196,12 +240,23 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     }
   }
 
+  /* communicators for the collective transposes */
+  fft_common_init_comm(&fft);
+
   /* Factor 2 for complex fields */
   fft.max_comm_size *= 2;
   fft.max_mesh_size = (ca_mesh_dim[0]*ca_mesh_dim[1]*ca_mesh_dim[2]);
   for(i=1;i<4;i++) 
     if(2*fft.plan[i].new_size > fft.max_mesh_size) fft.max_mesh_size = 2*fft.plan[i].new_size;
 
+  if(fft.r2c) {
+    /* position of the halved direction in the k-space mesh */
+    int dirs[3] = {0, 1, 2};
+    permute_ifield(dirs,3,-(fft.plan[3].n_permute));
+    for(i=0;i<3;i++) if(dirs[i]==r_dir) fft.r2c_dir = i;
+    fft.r2c_mesh = global_mesh_dim[r_dir];
+  }
+
   FFT_TRACE(fprintf(stderr,"%d: fft.max_comm_size = %d, fft.max_mesh_size = %d\n",
 		    this_node,fft.max_comm_size,fft.max_mesh_size));
 
@@ -223,70 +278,87 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
   }
   
   /* Factor 2 for complex numbers */
-  fft.send_buf = (double *)realloc(fft.send_buf, fft.max_comm_size*sizeof(double));
-  fft.recv_buf = (double *)realloc(fft.recv_buf, fft.max_comm_size*sizeof(double));
-  if (*data) fftw_free(*data);
-  (*data)  = (double *)fftw_malloc(fft.max_mesh_size*sizeof(double));
-  if (fft.data_buf) fftw_free(fft.data_buf);
-  fft.data_buf = (double *)fftw_malloc(fft.max_mesh_size*sizeof(double));
+  fft.send_buf = (fft_float *)realloc(fft.send_buf, fft.max_comm_size*sizeof(fft_float));
+  fft.recv_buf = (fft_float *)realloc(fft.recv_buf, fft.max_comm_size*sizeof(fft_float));
+  if (*data) FFTW_NAME(free)(*data);
+  (*data)  = (fft_float *)FFTW_NAME(malloc)(fft.max_mesh_size*sizeof(fft_float));
+  if (fft.data_buf) FFTW_NAME(free)(fft.data_buf);
+  fft.data_buf = (fft_float *)FFTW_NAME(malloc)(fft.max_mesh_size*sizeof(fft_float));
   if(!(*data) || !fft.data_buf || !fft.recv_buf || !fft.send_buf) {
     fprintf(stderr,"%d: Could not allocate FFT data arays\n",this_node);
     errexit();
   }
 
-  fftw_complex *c_data     = (fftw_complex *) (*data);
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) (*data);
 
   /* === FFT Routines (Using FFTW / RFFTW package)=== */
   for(i=1;i<4;i++) {
     fft.plan[i].dir = FFTW_FORWARD;   
+    if(fft.plan[i].fftw_plan) FFTW_NAME(destroy_plan)(fft.plan[i].fftw_plan);
+    fft.plan[i].fftw_plan = NULL;
+    /* nodes outside of the FFT only redistribute the mesh */
+    if(!fft.fft_node) continue;
     /* FFT plan creation. 
        Attention: destroys contents of c_data/data and c_fft.data_buf/data_buf. */
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_forw_n%d.file",
+    sprintf(wisdom_file_name,FFTW_WISDOM_PREFIX "_1d_wisdom_forw_n%d.file",
 	    fft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
+      wisdom_status = FFTW_NAME(import_wisdom_from_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    if(fft.init_tag==1) fftw_destroy_plan(fft.plan[i].fftw_plan);
 //printf("fft.plan[%d].n_ffts=%d\n",i,fft.plan[i].n_ffts);
-    fft.plan[i].fftw_plan =
-      fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         fft.plan[i].dir,FFTW_PATIENT);
+    if(i==1 && fft.r2c)
+      fft.plan[1].fftw_plan =
+	FFTW_NAME(plan_many_dft_r2c)(1,&fft.plan[1].new_mesh[2],fft.plan[1].n_ffts,
+			       fft.data_buf,NULL,1,fft.plan[1].new_mesh[2],
+			       c_data,NULL,1,c_mesh_dim[r_dir],FFTW_PATIENT);
+    else
+      fft.plan[i].fftw_plan =
+        FFTW_NAME(plan_many_dft)(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           fft.plan[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
+      FFTW_NAME(export_wisdom_to_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    fft.plan[i].fft_function = fftw_execute;       
+    fft.plan[i].fft_function = FFTW_NAME(execute);       
   }
 
   /* === The BACK Direction === */
   /* this is needed because slightly different functions are used */
   for(i=1;i<4;i++) {
     fft.back[i].dir = FFTW_BACKWARD;
+    fft.back[i].pack_function = fft_pack_block_permute1;
+    if(fft.back[i].fftw_plan) FFTW_NAME(destroy_plan)(fft.back[i].fftw_plan);
+    fft.back[i].fftw_plan = NULL;
+    if(!fft.fft_node) continue;
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_back_n%d.file",
+    sprintf(wisdom_file_name,FFTW_WISDOM_PREFIX "_1d_wisdom_back_n%d.file",
 	    fft.plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
+      wisdom_status = FFTW_NAME(import_wisdom_from_file)(wisdom_file);
       fclose(wisdom_file);
     }    
-    if(fft.init_tag==1) fftw_destroy_plan(fft.back[i].fftw_plan);
-    fft.back[i].fftw_plan =
-      fftw_plan_many_dft(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         c_data,NULL,1,fft.plan[i].new_mesh[2],
-                         fft.back[i].dir,FFTW_PATIENT);
+    if(i==1 && fft.r2c)
+      fft.back[1].fftw_plan =
+	FFTW_NAME(plan_many_dft_c2r)(1,&fft.plan[1].new_mesh[2],fft.plan[1].n_ffts,
+			       c_data,NULL,1,c_mesh_dim[r_dir],
+			       fft.data_buf,NULL,1,fft.plan[1].new_mesh[2],FFTW_PATIENT);
+    else
+      fft.back[i].fftw_plan =
+        FFTW_NAME(plan_many_dft)(1,&fft.plan[i].new_mesh[2],fft.plan[i].n_ffts,
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           c_data,NULL,1,fft.plan[i].new_mesh[2],
+                           fft.back[i].dir,FFTW_PATIENT);
     if( wisdom_status == FFTW_FAILURE && 
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
+      FFTW_NAME(export_wisdom_to_file)(wisdom_file);
       fclose(wisdom_file);
     }
-    fft.back[i].fft_function = fftw_execute;
-    fft.back[i].pack_function = fft_pack_block_permute1;
+    fft.back[i].fft_function = FFTW_NAME(execute);
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 1 \n",this_node,i));
   }
   if(fft.plan[1].row_dir==2) {
@@ -298,12 +370,14 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 2 \n",this_node,1));
   }
   fft.init_tag=1;
+  /* pick the fastest redistribution method for these plans */
+  fft_common_tune_comm(&fft, *data);
   /* free(data); */
   for(i=0;i<4;i++) { free(n_id[i]); free(n_pos[i]); }
   return fft.max_mesh_size; 
 }
 
-void fft_perform_forw(double *data)
+void fft_perform_forw(fft_float *data)
 {
   int i;
 
@@ -311,11 +385,13 @@ void fft_perform_forw(double *data)
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 1:\n",this_node));
 
-  fftw_complex *c_data     = (fftw_complex *) data;
-  fftw_complex *c_data_buf = (fftw_complex *) fft.data_buf;
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) data;
+  FFTW_NAME(complex) *c_data_buf = (FFTW_NAME(complex) *) fft.data_buf;
 
   /* communication to current dir row format (in is data) */
-  fft_forw_grid_comm(fft.plan[1], data, fft.data_buf);
+  fft_common_forw_grid_comm(&fft, &fft.plan[1], data, fft.data_buf);
+  /* the other nodes do the FFTs */
+  if(!fft.fft_node) return;
 
 
   /*
@@ -332,140 +408,101 @@ void fft_perform_forw(double *data)
     }
   */
 
-  /* complexify the real data array (in is fft.data_buf) */
-  for(i=0;i<fft.plan[1].new_size;i++) {
-    data[2*i]     = fft.data_buf[i];     /* real value */
-    data[(2*i)+1] = 0;       /* complex value */
+  if(fft.r2c) {
+    /* real to complex FFT (in is fft.data_buf, out is data) */
+    FFTW_NAME(execute_dft_r2c)(fft.plan[1].fftw_plan,fft.data_buf,c_data);
+  }
+  else {
+    /* complexify the real data array (in is fft.data_buf) */
+    for(i=0;i<fft.plan[1].new_size;i++) {
+      data[2*i]     = fft.data_buf[i];     /* real value */
+      data[(2*i)+1] = 0;       /* complex value */
+    }
+    /* perform FFT (in/out is data)*/
+    FFTW_NAME(execute_dft)(fft.plan[1].fftw_plan,c_data,c_data);
   }
-  /* perform FFT (in/out is data)*/
-  fftw_execute_dft(fft.plan[1].fftw_plan,c_data,c_data);
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 2:\n",this_node));
   /* communication to current dir row format (in is data) */
-  fft_forw_grid_comm(fft.plan[2], data, fft.data_buf);
+  fft_common_forw_grid_comm(&fft, &fft.plan[2], data, fft.data_buf);
   /* perform FFT (in/out is fft.data_buf)*/
-  fftw_execute_dft(fft.plan[2].fftw_plan,c_data_buf,c_data_buf);
+  FFTW_NAME(execute_dft)(fft.plan[2].fftw_plan,c_data_buf,c_data_buf);
   /* ===== third direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 3:\n",this_node));
   /* communication to current dir row format (in is fft.data_buf) */
-  fft_forw_grid_comm(fft.plan[3], fft.data_buf, data);
+  fft_common_forw_grid_comm(&fft, &fft.plan[3], fft.data_buf, data);
   /* perform FFT (in/out is data)*/
-  fftw_execute_dft(fft.plan[3].fftw_plan,c_data,c_data);
+  FFTW_NAME(execute_dft)(fft.plan[3].fftw_plan,c_data,c_data);
   //fft_print_global_fft_mesh(fft.plan[3],data,1,0);
 
   /* REMARK: Result has to be in data. */
 }
 
-void fft_perform_back(double *data)
+/** the back transform up to the last redistribution, the result is in fft.data_buf. */
+static void fft_perform_back_local(fft_float *data)
 {
   int i;
   
-  fftw_complex *c_data     = (fftw_complex *) data;
-  fftw_complex *c_data_buf = (fftw_complex *) fft.data_buf;
+  FFTW_NAME(complex) *c_data     = (FFTW_NAME(complex) *) data;
+  FFTW_NAME(complex) *c_data_buf = (FFTW_NAME(complex) *) fft.data_buf;
+
+  if(!fft.fft_node) return;
   
   /* ===== third direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 3:\n",this_node));
 
 
   /* perform FFT (in is data) */
-  fftw_execute_dft(fft.back[3].fftw_plan,c_data,c_data);
+  FFTW_NAME(execute_dft)(fft.back[3].fftw_plan,c_data,c_data);
   /* communicate (in is data)*/
-  fft_back_grid_comm(fft.plan[3],fft.back[3],data,fft.data_buf);
+  fft_common_back_grid_comm(&fft, &fft.plan[3], &fft.back[3], data, fft.data_buf);
  
   /* ===== second direction ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 2:\n",this_node));
   /* perform FFT (in is fft.data_buf) */
-  fftw_execute_dft(fft.back[2].fftw_plan,c_data_buf,c_data_buf);
+  FFTW_NAME(execute_dft)(fft.back[2].fftw_plan,c_data_buf,c_data_buf);
   /* communicate (in is fft.data_buf) */
-  fft_back_grid_comm(fft.plan[2],fft.back[2],fft.data_buf,data);
+  fft_common_back_grid_comm(&fft, &fft.plan[2], &fft.back[2], fft.data_buf, data);
 
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-  fftw_execute_dft(fft.back[1].fftw_plan,c_data,c_data);
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<fft.plan[1].new_size;i++) {
-    fft.data_buf[i] = data[2*i]; /* real value */
-    //Vincent:
-    if (data[2*i+1]>1e-5) {
-      printf("Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
-      if (i>100) exit(-1);
-      } 
+  if(fft.r2c) {
+    /* complex to real FFT (in is data, out is fft.data_buf) */
+    FFTW_NAME(execute_dft_c2r)(fft.back[1].fftw_plan,c_data,fft.data_buf);
   }
-  /* communicate (in is fft.data_buf) */
-  fft_back_grid_comm(fft.plan[1],fft.back[1],fft.data_buf,data);
+  else {
+    /* perform FFT (in is data) */
+    FFTW_NAME(execute_dft)(fft.back[1].fftw_plan,c_data,c_data);
+    /* throw away the (hopefully) empty complex component (in is data)*/
+    for(i=0;i<fft.plan[1].new_size;i++) {
+      fft.data_buf[i] = data[2*i]; /* real value */
+      //Vincent:
+      if (data[2*i+1]>1e-5) {
+        printf("Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
+        if (i>100) exit(-1);
+        } 
+    }
+  }
+}
 
+void fft_perform_back(fft_float *data)
+{
+  fft_perform_back_local(data);
+  /* communicate (in is fft.data_buf) */
+  fft_common_back_grid_comm(&fft, &fft.plan[1], &fft.back[1], fft.data_buf, data);
 
   /* REMARK: Result has to be in data. */
 }
 
-void fft_forw_grid_comm(fft_forw_plan plan, double *in, double *out)
+void fft_perform_back_start(fft_float *data, int slot)
 {
-  int i;
-  MPI_Status status;
-  double *tmp_ptr;
-
-  for(i=0;i<plan.g_size;i++) {   
-    plan.pack_function(in, fft.send_buf, &(plan.send_block[6*i]), 
-		       &(plan.send_block[6*i+3]), plan.old_mesh, plan.element);
-
-    if(plan.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(fft.send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
-      MPI_Recv(fft.recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-    }
-    else if(plan.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(fft.recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-      MPI_Send(fft.send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);      
-    }
-    else {                              /* Self communication... */   
-      tmp_ptr  = fft.send_buf;
-      fft.send_buf = fft.recv_buf;
-      fft.recv_buf = tmp_ptr;
-    }
-    fft_unpack_block(fft.recv_buf, out, &(plan.recv_block[6*i]), 
-		 &(plan.recv_block[6*i+3]), plan.new_mesh, plan.element);
-  }
+  fft_perform_back_local(data);
+  fft_common_back_comm_start(&fft, &fft.plan[1], &fft.back[1], fft.data_buf, slot);
 }
 
-void fft_back_grid_comm(fft_forw_plan plan_f,  fft_back_plan plan_b, double *in, double *out)
+void fft_perform_back_finish(fft_float *data, int slot)
 {
-  int i;
-  MPI_Status status;
-  double *tmp_ptr;
-
-  /* Back means: Use the send/recieve stuff from the forward plan but
-     replace the recieve blocks by the send blocks and vice
-     versa. Attention then also new_mesh and old_mesh are exchanged */
-
-  for(i=0;i<plan_f.g_size;i++) {
-    
-    plan_b.pack_function(in, fft.send_buf, &(plan_f.recv_block[6*i]), 
-		       &(plan_f.recv_block[6*i+3]), plan_f.new_mesh, plan_f.element);
-
-    if(plan_f.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(fft.send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
-      MPI_Recv(fft.recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-    }
-    else if(plan_f.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(fft.recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-      MPI_Send(fft.send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);      
-    }
-    else {                                /* Self communication... */   
-      tmp_ptr  = fft.send_buf;
-      fft.send_buf = fft.recv_buf;
-      fft.recv_buf = tmp_ptr;
-    }
-    fft_unpack_block(fft.recv_buf, out, &(plan_f.send_block[6*i]), 
-		 &(plan_f.send_block[6*i+3]), plan_f.old_mesh, plan_f.element);
-  }
+  fft_common_back_comm_finish(&fft, &fft.plan[1], data, slot);
 }
 
 
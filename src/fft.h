@@ -30,9 +30,14 @@
  *  1D-FFT. After performing the FFT on theat direction the data is
  *  redistributed.
  *
- *  For simplicity at the moment I have implemented a full complex to
- *  complex FFT (even though a real to complex FFT would be
- *  sufficient)
+ *  The first 1D-FFT is a real to complex transform, which only keeps
+ *  the modes 0 to n/2 of its direction, since the others are the
+ *  complex conjugates of these. This halves the work and the
+ *  communication of the following FFTs, and the back transform ends
+ *  with a complex to real transform. Sums over the k-space mesh have
+ *  to weight the modes with \ref fft_mode_weight. If the halved mesh
+ *  is too small for the node grid, a full complex to complex FFT is
+ *  done (see \ref fft_data_struct::r2c).
  *
  *  \todo Combine the forward and backward structures.
  *  \todo The packing routines could be moved to utils.h when they are needed elsewhere.
@@ -61,23 +66,38 @@ void fft_pre_init();
  * \param ca_mesh_dim    Pointer to CA mesh dimensions.
  * \param ca_mesh_margin Pointer to CA mesh margins.
  * \param ks_pnum        Pointer to number of permutations in k-space.
+ * \param n_fft_nodes    Number of nodes that do the FFTs, 0 for all.
  */
-int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin,
+int fft_init(fft_float **data, int *ca_mesh_dim, int *ca_mesh_margin,
 	     int* global_mesh_dim, double *global_mesh_off,
-	     int *ks_pnum);
+	     int *ks_pnum, int n_fft_nodes);
 
 /** perform the forward 3D FFT.
     The assigned charges are in \a data. The result is also stored in \a data.
     \warning The content of \a data is overwritten.
     \param data Mesh.
 */
-void fft_perform_forw(double *data);
+void fft_perform_forw(fft_float *data);
 
 /** perform the backward 3D FFT.
     \warning The content of \a data is overwritten.
     \param data Mesh.
 */
-void fft_perform_back(double *data);
+void fft_perform_back(fft_float *data);
+/** start the backward 3D FFT, but do not wait for the final
+    redistribution of the mesh. Up to \ref FFT_BACK_SLOTS of these
+    can be pending, each has to be finished with \ref
+    fft_perform_back_finish.
+    \warning The content of \a data is overwritten.
+    \param data Mesh.
+    \param slot slot of this transform.
+*/
+void fft_perform_back_start(fft_float *data, int slot);
+/** finish a backward 3D FFT started by \ref fft_perform_back_start.
+    \param data Mesh, which receives the result.
+    \param slot slot of the transform.
+*/
+void fft_perform_back_finish(fft_float *data, int slot);
 
 
 /*@}*/
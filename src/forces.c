@@ -45,6 +45,8 @@
 #include "nsquare.h"
 #include "layered.h"
 #include "domain_decomposition.h"
+#include "packed_cells.h"
+#include "cluster_lists.h"
 #include "magnetic_non_p3m_methods.h"
 #include "mdlc_correction.h"
 #include "virtual_sites.h"
@@ -55,13 +57,26 @@
 /* local prototypes                                         */
 /************************************************************/
 
-/** Calculate long range forces (P3M, MMM2d...). */
-void calc_long_range_forces();
-
 /** initialize real particle forces with thermostat forces and
     ghost particle forces with zero. */
 void init_forces();
 
+#ifdef P3M
+/** whether the k-space part of P3M was started before the short
+    range forces, see \ref p3m_calc_kspace_forces_start. */
+static int p3m_kspace_started = 0;
+
+/** whether the P3M pressure is needed for the NpT integrator. */
+static int p3m_npt_virial()
+{
+#ifdef NPT
+  return integ_switch == INTEG_METHOD_NPT_ISO;
+#else
+  return 0;
+#endif
+}
+#endif
+
 /************************************************************/
 
 void force_calc()
@@ -72,17 +87,40 @@ void force_calc()
 #endif
 
    init_forces();
+
+#ifdef P3M
+  /* if only some nodes do the FFTs, they do so while the others
+     already calculate their short range forces */
+  if (integ_switch != INTEG_METHOD_RESPA && p3m_kspace_split_applicable()) {
+    p3m_charge_assign();
+    p3m_calc_kspace_forces_start(p3m_npt_virial());
+    p3m_kspace_started = 1;
+  }
+#endif
   
   switch (cell_structure.type) {
   case CELL_STRUCTURE_LAYERED:
     layered_calculate_ia();
     break;
   case CELL_STRUCTURE_DOMDEC:
-    if(dd.use_vList) {
+    if(dd.use_clusters) {
       if (rebuild_verletlist)
+	build_cluster_lists();
+      calculate_cluster_ia();
+    }
+    else if(dd.use_vList) {
+      if (packed_cells_applicable()) {
+	if (rebuild_verletlist)
+	  build_verlet_lists();
+	calculate_verlet_ia_packed();
+      }
+      else if (rebuild_verletlist && !dd.use_incremental)
 	build_verlet_lists_and_calc_verlet_ia();
-      else
+      else {
+	if (rebuild_verletlist)
+	  build_verlet_lists();
 	calculate_verlet_ia();
+      }
     }
     else
       calc_link_cell();
@@ -92,7 +130,9 @@ void force_calc()
     
   }
 
-  calc_long_range_forces();
+  /* the RESPA integrator applies the long range forces separately */
+  if (integ_switch != INTEG_METHOD_RESPA)
+    calc_long_range_forces();
 
 #ifdef LB
   if (lattice_switch & LATTICE_LB) calc_particle_lattice_ia() ;
@@ -121,6 +161,68 @@ void force_calc()
 
 /************************************************************/
 
+int force_calc_overlap_applicable()
+{
+#if defined(VIRTUAL_SITES) || defined(ADRESS)
+  /* need the ghosts before the force calculation */
+  return 0;
+#else
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC || !dd.use_overlap ||
+      !dd.use_vList || dd.use_clusters || rebuild_verletlist)
+    return 0;
+#ifdef COMFIXED
+  {
+    /* needs all forces before collecting the ghost forces */
+    int t;
+    for (t = 0; t < n_particle_types; t++)
+      if (get_ia_param(t,t)->COMFIXED_flag == 1) return 0;
+  }
+#endif
+#ifdef LB
+  if (lattice_switch & LATTICE_LB) return 0;
+#endif
+#ifdef LB_GPU
+  if (lattice_switch & LATTICE_LB_GPU) return 0;
+#endif
+  return 1;
+#endif
+}
+
+/** The long range forces as work for \ref ghost_communicator_overlap. */
+static int long_range_forces_work()
+{
+  calc_long_range_forces();
+  return 0;
+}
+
+void force_calc_overlapped()
+{
+  init_forces();
+
+  /* short range forces while updating the ghost positions */
+  calculate_verlet_ia_overlapped();
+
+  /* long range forces while collecting the ghost forces. They only
+     act on the local particles, and are simply added. */
+  if (integ_switch == INTEG_METHOD_RESPA)
+    ghost_communicator(&cell_structure.collect_ghost_force_comm);
+  else if (ghost_communicator_overlap(&cell_structure.collect_ghost_force_comm, long_range_forces_work))
+    long_range_forces_work();
+
+#ifdef COMFORCE
+  calc_comforce();
+#endif
+
+#ifdef METADYNAMICS
+    /* Metadynamics main function */
+    meta_perform();
+#endif
+
+  check_forces();
+}
+
+/************************************************************/
+
 void calc_long_range_forces()
 {
 #ifdef ELECTROSTATICS  
@@ -145,6 +247,16 @@ void calc_long_range_forces()
 
     break;
   case COULOMB_P3M:
+    if (p3m_kspace_started) {
+      p3m_kspace_started = 0;
+#ifdef NPT
+      if(integ_switch == INTEG_METHOD_NPT_ISO)
+	nptiso.p_vir[0] += p3m_calc_kspace_forces_finish(1);
+      else
+#endif
+	p3m_calc_kspace_forces_finish(0);
+      break;
+    }
     p3m_charge_assign();
 #ifdef NPT
     if(integ_switch == INTEG_METHOD_NPT_ISO)
@@ -398,7 +510,7 @@ MDINLINE void check_particle_force(Particle *part)
   int i;
   for (i=0; i< 3; i++) {
     if isnan(part->f.f[i]) {
-      char **errtext = runtime_error(128);
+      char *errtext = runtime_error(128);
       ERROR_SPRINTF(errtext,"{999 force on particle was NAN.} ");
     }
   }
@@ -406,7 +518,7 @@ MDINLINE void check_particle_force(Particle *part)
 #ifdef ROTATION
   for (i=0; i< 3; i++) {
     if isnan(part->f.torque[i]) {
-      char **errtext = runtime_error(128);
+      char *errtext = runtime_error(128);
       ERROR_SPRINTF(errtext,"{999 force on particle was NAN.} ");
     }
   }
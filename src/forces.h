@@ -37,6 +37,7 @@
 #include "adresso.h"
 #include "virtual_sites.h"
 #include "metadynamics.h"
+#include "packed_cells.h"
 
 /* include the force files */
 #include "p3m.h"
@@ -103,6 +104,29 @@
  */
 void force_calc();
 
+/** Check whether \ref force_calc_overlapped can be used, i. e. the
+    domain decomposition with verlet lists and
+    <tt>-overlap_comm</tt>, the verlet lists are valid, and nothing
+    needs the ghosts before or the total forces during the force
+    calculation.
+    \return 1 if applicable, 0 otherwise. */
+int force_calc_overlap_applicable();
+
+/** Update the ghost positions, calculate the forces and collect the
+    ghost forces, which otherwise is done by \ref
+    cells_update_ghosts, \ref force_calc and the collect_ghost_force
+    communication. Here, the communication is overlapped with the
+    calculation: while the ghost positions are transferred, the
+    forces of the inner cells are calculated, see \ref
+    calculate_verlet_ia_overlapped; while the ghost forces are
+    collected, the long range forces are calculated. Only valid if
+    \ref force_calc_overlap_applicable. */
+void force_calc_overlapped();
+
+/** Calculate long range forces (P3M, MMM2d...). They only act on the
+    local particles and are added to their forces. */
+void calc_long_range_forces();
+
 /** Set forces of all ghosts to zero
 */
 void init_forces_ghosts();
@@ -382,10 +406,17 @@ MDINLINE void add_non_bonded_pair_force(Particle *p1, Particle *p2,
   }
 }
 
+/** force accumulator of particle p in \ref add_bonded_force_to */
+#define BONDED_FORCE(p) (thread < 0 ? (p)->f.f : packed_particle_force(p, thread))
+
 /** Calculate bonded forces for one particle.
-    @param p1 particle for which to calculate forces
+    @param p1     particle for which to calculate forces
+    @param thread if negative, the forces are added to the particles,
+                  otherwise to the packed force buffers of this thread
+                  (see \ref packed_particle_force)
+    @param p_vir  where to add the virial in case of NpT
 */
-MDINLINE void add_bonded_force(Particle *p1)
+MDINLINE void add_bonded_force_to(Particle *p1, int thread, double *p_vir)
 {
   double dx[3]     = { 0., 0., 0. };
   double force[3]  = { 0., 0., 0. };
@@ -397,6 +428,7 @@ MDINLINE void add_bonded_force(Particle *p1)
 #endif
   char *errtxt;
   Particle *p2, *p3 = NULL, *p4 = NULL;
+  double *f1, *f2, *f3, *f4;
   Bonded_ia_parameters *iaparams;
   int i, j, type_num, type, n_partners, bond_broken;
 
@@ -551,33 +583,38 @@ MDINLINE void add_bonded_force(Particle *p1)
       force_weight = adress_bonded_force_weight(p1,p2);
 #endif
 
+      f1 = BONDED_FORCE(p1);
+      f2 = BONDED_FORCE(p2);
       for (j = 0; j < 3; j++) {
 #ifdef ADRESS
         tmp=force_weight*force[j];
-	p1->f.f[j] += tmp;
-	p2->f.f[j] -= tmp;
+	f1[j] += tmp;
+	f2[j] -= tmp;
 #else // ADRESS
 
 	switch (type) {
 #ifdef BOND_ENDANGLEDIST
 	case BONDED_IA_ENDANGLEDIST:
-          p1->f.f[j] += force[j];
-          p2->f.f[j] += force2[j];
+          f1[j] += force[j];
+          f2[j] += force2[j];
 	  break;
 #endif // BOND_ENDANGLEDIST
 	default:
-	  p1->f.f[j] += force[j];
-	  p2->f.f[j] -= force[j];
+	  f1[j] += force[j];
+	  f2[j] -= force[j];
 #ifdef ROTATION
-	  p1->f.torque[j] += torque1[j];
-	  p2->f.torque[j] += torque2[j];
+	  /* the packed buffers have no torques, but no bond has one */
+	  if (thread < 0) {
+	    p1->f.torque[j] += torque1[j];
+	    p2->f.torque[j] += torque2[j];
+	  }
 #endif
 	}
 #endif // NOT ADRESS
 
 #ifdef NPT
 	if(integ_switch == INTEG_METHOD_NPT_ISO)
-	  nptiso.p_vir[j] += force[j] * dx[j];
+	  p_vir[j] += force[j] * dx[j];
 #endif
       }
       break;
@@ -592,15 +629,18 @@ MDINLINE void add_bonded_force(Particle *p1)
 #ifdef ADRESS
       force_weight=adress_angle_force_weight(p1,p2,p3);
 #endif
+      f1 = BONDED_FORCE(p1);
+      f2 = BONDED_FORCE(p2);
+      f3 = BONDED_FORCE(p3);
       for (j = 0; j < 3; j++) {
 #ifdef ADRESS
-	p1->f.f[j] += force_weight*force[j];
-	p2->f.f[j] += force_weight*force2[j];
-	p3->f.f[j] -= force_weight*(force[j] + force2[j]);
+	f1[j] += force_weight*force[j];
+	f2[j] += force_weight*force2[j];
+	f3[j] -= force_weight*(force[j] + force2[j]);
 #else
-	p1->f.f[j] += force[j];
-	p2->f.f[j] += force2[j];
-	p3->f.f[j] -= (force[j] + force2[j]);
+	f1[j] += force[j];
+	f2[j] += force2[j];
+	f3[j] -= (force[j] + force2[j]);
 #endif
       }
       break;
@@ -614,17 +654,21 @@ MDINLINE void add_bonded_force(Particle *p1)
 #ifdef ADRESS
       force_weight=adress_dihedral_force_weight(p1,p2,p3,p4);
 #endif 
+      f1 = BONDED_FORCE(p1);
+      f2 = BONDED_FORCE(p2);
+      f3 = BONDED_FORCE(p3);
+      f4 = BONDED_FORCE(p4);
       for (j = 0; j < 3; j++) {
 #ifdef ADRESS
-	p1->f.f[j] += force_weight*force[j];
-	p2->f.f[j] += force_weight*force2[j];
-	p3->f.f[j] += force_weight*force3[j];
-	p4->f.f[j] -= force_weight*(force[j] + force2[j] + force3[j]);
+	f1[j] += force_weight*force[j];
+	f2[j] += force_weight*force2[j];
+	f3[j] += force_weight*force3[j];
+	f4[j] -= force_weight*(force[j] + force2[j] + force3[j]);
 #else
-	p1->f.f[j] += force[j];
-	p2->f.f[j] += force2[j];
-	p3->f.f[j] += force3[j];
-	p4->f.f[j] -= (force[j] + force2[j] + force3[j]);
+	f1[j] += force[j];
+	f2[j] += force2[j];
+	f3[j] += force3[j];
+	f4[j] -= (force[j] + force2[j] + force3[j]);
 #endif
       }
       break;
@@ -632,6 +676,20 @@ MDINLINE void add_bonded_force(Particle *p1)
   }
 }  
 
+#undef BONDED_FORCE
+
+/** Calculate bonded forces for one particle.
+    @param p1 particle for which to calculate forces
+*/
+MDINLINE void add_bonded_force(Particle *p1)
+{
+#ifdef NPT
+  add_bonded_force_to(p1, -1, nptiso.p_vir);
+#else
+  add_bonded_force_to(p1, -1, NULL);
+#endif
+}
+
 /** add force to another. This is used when collecting ghost forces. */
 MDINLINE void add_force(ParticleForce *F_to, ParticleForce *F_add)
 {
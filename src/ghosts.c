@@ -56,6 +56,8 @@ static MPI_Op MPI_FORCES_SUM;
 */
 int ghosts_have_v = 0;
 
+double ghost_wait_time = 0.0;
+
 /************************************************************
  * Exported Functions
  ************************************************************/
@@ -74,8 +76,13 @@ void prepare_comm(GhostCommunicator *comm, int data_parts, int num)
 
   comm->num = num;
   comm->comm = malloc(num*sizeof(GhostCommunication));
+  comm->request = malloc(num*sizeof(MPI_Request));
   for(i=0; i<num; i++) {
     comm->comm[i].shift[0]=comm->comm[i].shift[1]=comm->comm[i].shift[2]=0.0;
+    comm->comm[i].buffer = NULL;
+    comm->comm[i].max_buffer = 0;
+    comm->comm[i].n_buffer = -1;
+    comm->request[i] = MPI_REQUEST_NULL;
   }
 }
 
@@ -83,8 +90,14 @@ void free_comm(GhostCommunicator *comm)
 {
   int n;
   GHOST_TRACE(fprintf(stderr,"%d: free_comm: %p has %d ghost communications\n",this_node,comm,comm->num));
-  for (n = 0; n < comm->num; n++) free(comm->comm[n].part_lists);
+  for (n = 0; n < comm->num; n++) {
+    free(comm->comm[n].part_lists);
+    free(comm->comm[n].buffer);
+    if (comm->request[n] != MPI_REQUEST_NULL)
+      MPI_Request_free(&comm->request[n]);
+  }
   free(comm->comm);
+  free(comm->request);
 }
 
 int calc_transmit_size(GhostCommunication *gc, int data_parts)
@@ -116,25 +129,53 @@ int calc_transmit_size(GhostCommunication *gc, int data_parts)
   return n_buffer_new;
 }
 
-void prepare_send_buffer(GhostCommunication *gc, int data_parts)
+/** put the data of the cells of a communication into buffer, which
+    has to hold size bytes as given by \ref calc_transmit_size. */
+static void pack_send_buffer(GhostCommunication *gc, int data_parts, char *buffer, int size)
 {
   char *insert;
   int pl, p, np;
   Particle *part, *pt;
 
-  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
+  /* put in data */
+  insert = buffer;
 
-  /* reallocate send buffer */
-  n_s_buffer = calc_transmit_size(gc, data_parts);
-  if (n_s_buffer > max_s_buffer) {
-    max_s_buffer = n_s_buffer;
-    s_buffer = realloc(s_buffer, max_s_buffer);
+  /* the per time step transfers only carry one field, so skip the
+     tests of the flags for every particle */
+  if (data_parts == GHOSTTRANS_FORCE) {
+    ParticleForce *pf = (ParticleForce *)buffer;
+    for (pl = 0; pl < gc->n_part_lists; pl++) {
+      np   = gc->part_lists[pl]->n;
+      part = gc->part_lists[pl]->part;
+      for (p = 0; p < np; p++)
+	*(pf++) = part[p].f;
+    }
+    insert = (char *)pf;
+    pl = gc->n_part_lists;
   }
-  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
+  else if ((data_parts & ~GHOSTTRANS_POSSHFTD) == GHOSTTRANS_POSITION) {
+    ParticlePosition *pp = (ParticlePosition *)buffer;
+    int shifted = (data_parts & GHOSTTRANS_POSSHFTD);
+    for (pl = 0; pl < gc->n_part_lists; pl++) {
+      np   = gc->part_lists[pl]->n;
+      part = gc->part_lists[pl]->part;
+      for (p = 0; p < np; p++) {
+	*pp = part[p].r;
+	if (shifted) {
+	  pp->p[0] += gc->shift[0];
+	  pp->p[1] += gc->shift[1];
+	  pp->p[2] += gc->shift[2];
+	}
+	pp++;
+      }
+    }
+    insert = (char *)pp;
+    pl = gc->n_part_lists;
+  }
+  else
+    pl = 0;
 
-  /* put in data */
-  insert = s_buffer;
-  for (pl = 0; pl < gc->n_part_lists; pl++) {
+  for (; pl < gc->n_part_lists; pl++) {
     np   = gc->part_lists[pl]->n;
     if (data_parts == GHOSTTRANS_PARTNUM) {
       *(int *)insert = np;
@@ -182,13 +223,28 @@ void prepare_send_buffer(GhostCommunication *gc, int data_parts)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (insert - s_buffer != n_s_buffer) {
-    fprintf(stderr, "%d: INTERNAL ERROR: send buffer size %d differs from what I put in %d\n", this_node, n_s_buffer, insert - s_buffer);
+  if (insert - buffer != size) {
+    fprintf(stderr, "%d: INTERNAL ERROR: send buffer size %d differs from what I put in %d\n", this_node, size, insert - buffer);
     errexit();
   }
 #endif
 }
 
+void prepare_send_buffer(GhostCommunication *gc, int data_parts)
+{
+  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
+
+  /* reallocate send buffer */
+  n_s_buffer = calc_transmit_size(gc, data_parts);
+  if (n_s_buffer > max_s_buffer) {
+    max_s_buffer = n_s_buffer;
+    s_buffer = realloc(s_buffer, max_s_buffer);
+  }
+  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
+
+  pack_send_buffer(gc, data_parts, s_buffer, n_s_buffer);
+}
+
 void prepare_recv_buffer(GhostCommunication *gc, int data_parts)
 {
   GHOST_TRACE(fprintf(stderr, "%d: prepare receiving from %d\n", this_node, gc->node));
@@ -201,15 +257,31 @@ void prepare_recv_buffer(GhostCommunication *gc, int data_parts)
   GHOST_TRACE(fprintf(stderr, "%d: will get %d\n", this_node, n_r_buffer));
 }
 
-void put_recv_buffer(GhostCommunication *gc, int data_parts)
+void put_recv_buffer(GhostCommunication *gc, int data_parts, char *buffer, int size)
 {
   int pl, p, np;
   Particle *part, *pt;
   char *retrieve;
 
   /* put back data */
-  retrieve = r_buffer;
-  for (pl = 0; pl < gc->n_part_lists; pl++) {
+  retrieve = buffer;
+
+  /* fast path for the per time step position update, see \ref pack_send_buffer */
+  if ((data_parts & ~GHOSTTRANS_POSSHFTD) == GHOSTTRANS_POSITION) {
+    ParticlePosition *pp = (ParticlePosition *)buffer;
+    for (pl = 0; pl < gc->n_part_lists; pl++) {
+      np   = gc->part_lists[pl]->n;
+      part = gc->part_lists[pl]->part;
+      for (p = 0; p < np; p++)
+	part[p].r = *(pp++);
+    }
+    retrieve = (char *)pp;
+    pl = gc->n_part_lists;
+  }
+  else
+    pl = 0;
+
+  for (; pl < gc->n_part_lists; pl++) {
     if (data_parts == GHOSTTRANS_PARTNUM) {
       GHOST_TRACE(fprintf(stderr, "%d: reallocating cell %p to size %d, assigned to node %d\n",
 			  this_node, gc->part_lists[pl], *(int *)retrieve, gc->node));
@@ -222,6 +294,15 @@ void put_recv_buffer(GhostCommunication *gc, int data_parts)
 	  gc->part_lists[pl]->part[i].l.ghost=1;
 	}
       }
+#endif
+#ifdef EXCLUSIONS
+      {
+	/* ghosts carry no exclusions, but the eighth shell scheme
+	   checks pairs of two ghosts */
+	int i;
+	for (i=0;i<gc->part_lists[pl]->n;i++)
+	  init_intlist(&gc->part_lists[pl]->part[i].el);
+      }
 #endif
       retrieve += sizeof(int);
     }
@@ -266,21 +347,21 @@ void put_recv_buffer(GhostCommunication *gc, int data_parts)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (retrieve - r_buffer != n_r_buffer) {
-    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_r_buffer, retrieve - r_buffer);
+  if (retrieve - buffer != size) {
+    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, size, retrieve - buffer);
     errexit();
   }
 #endif
 }
 
-void add_forces_from_recv_buffer(GhostCommunication *gc)
+void add_forces_from_recv_buffer(GhostCommunication *gc, char *buffer, int size)
 {
   int pl, p, np;
   Particle *part, *pt;
   char *retrieve;
 
   /* put back data */
-  retrieve = r_buffer;
+  retrieve = buffer;
   for (pl = 0; pl < gc->n_part_lists; pl++) {
     np   = gc->part_lists[pl]->n;
     part = gc->part_lists[pl]->part;
@@ -291,8 +372,8 @@ void add_forces_from_recv_buffer(GhostCommunication *gc)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (retrieve - r_buffer != n_r_buffer) {
-    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_r_buffer, retrieve - r_buffer);
+  if (retrieve - buffer != size) {
+    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, size, retrieve - buffer);
     errexit();
   }
 #endif
@@ -320,6 +401,14 @@ void cell_cell_transfer(GhostCommunication *gc, int data_parts)
           gc->part_lists[pl + offset]->part[i].l.ghost=1;
         }
       }
+#endif
+#ifdef EXCLUSIONS
+      {
+        /* see put_recv_buffer */
+        int i;
+        for (i=0;i<gc->part_lists[pl + offset]->n;i++)
+          init_intlist(&gc->part_lists[pl + offset]->part[i].el);
+      }
 #endif
     }
     else {
@@ -381,6 +470,113 @@ static int is_recv_op(int comm_type, int node)
 	  (comm_type == GHOST_RDCE && node == this_node));
 }
 
+/** check whether a communicator only has point to point and local operations. */
+static int is_p2p_communicator(GhostCommunicator *gc)
+{
+  int n;
+  for (n = 0; n < gc->num; n++) {
+    int comm_type = gc->comm[n].type & GHOST_JOBMASK;
+    if (comm_type == GHOST_BCST || comm_type == GHOST_RDCE)
+      return 0;
+  }
+  return 1;
+}
+
+/** make sure that the buffer of point to point operation n can hold
+    size bytes, and that its persistent request is set up for it. */
+static void prepare_p2p_request(GhostCommunicator *gc, int n, int size)
+{
+  GhostCommunication *gcn = &gc->comm[n];
+
+  if (size > gcn->max_buffer) {
+    gcn->max_buffer = size;
+    gcn->buffer = realloc(gcn->buffer, size);
+    /* the request refers to the old buffer */
+    gcn->n_buffer = -1;
+  }
+  if (size != gcn->n_buffer) {
+    GHOST_TRACE(fprintf(stderr, "%d: ghost_comm new request for operation %d with node %d (%d bytes)\n", this_node, n, gcn->node, size));
+    if (gc->request[n] != MPI_REQUEST_NULL)
+      MPI_Request_free(&gc->request[n]);
+    if ((gcn->type & GHOST_JOBMASK) == GHOST_SEND)
+      MPI_Send_init(gcn->buffer, size, MPI_BYTE, gcn->node, REQ_GHOST_SEND, MPI_COMM_WORLD, &gc->request[n]);
+    else
+      MPI_Recv_init(gcn->buffer, size, MPI_BYTE, gcn->node, REQ_GHOST_SEND, MPI_COMM_WORLD, &gc->request[n]);
+    gcn->n_buffer = size;
+  }
+}
+
+/** \ref ghost_communicator for communicators with only point to point
+    and local operations, optionally working while waiting, see \ref
+    ghost_communicator_overlap. */
+static int p2p_communicator(GhostCommunicator *gc, int (*work)())
+{
+  int n, first, last, done;
+  int data_parts = gc->data_parts;
+  int work_left = (work != NULL);
+
+  for (first = 0; first < gc->num; first = last) {
+    if ((gc->comm[first].type & GHOST_JOBMASK) == GHOST_LOCL) {
+      cell_cell_transfer(&gc->comm[first], data_parts);
+      last = first + 1;
+      continue;
+    }
+
+    /* all following point to point operations that do not depend on the previous ones */
+    for (last = first + 1; last < gc->num; last++) {
+      int type = gc->comm[last].type;
+      if (!(type & GHOST_OVERLAP) || (type & GHOST_JOBMASK) == GHOST_LOCL)
+	break;
+    }
+
+    /* start the transfers */
+    for (n = first; n < last; n++) {
+      GhostCommunication *gcn = &gc->comm[n];
+      prepare_p2p_request(gc, n, calc_transmit_size(gcn, data_parts));
+      if ((gcn->type & GHOST_JOBMASK) == GHOST_SEND) {
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm send to %d (%d bytes)\n", this_node, gcn->node, gcn->n_buffer));
+	pack_send_buffer(gcn, data_parts, gcn->buffer, gcn->n_buffer);
+      }
+      else {
+	GHOST_TRACE(fprintf(stderr, "%d: ghost_comm receive from %d (%d bytes)\n", this_node, gcn->node, gcn->n_buffer));
+      }
+    }
+    MPI_Startall(last - first, &gc->request[first]);
+
+    /* work while waiting */
+    for (;;) {
+      if (!work_left) {
+	if (work) {
+	  /* time wasted in the force calculation, see \ref dd_balance_load */
+	  double start = MPI_Wtime();
+	  MPI_Waitall(last - first, &gc->request[first], MPI_STATUSES_IGNORE);
+	  ghost_wait_time += MPI_Wtime() - start;
+	}
+	else
+	  MPI_Waitall(last - first, &gc->request[first], MPI_STATUSES_IGNORE);
+	break;
+      }
+      MPI_Testall(last - first, &gc->request[first], &done, MPI_STATUSES_IGNORE);
+      if (done)
+	break;
+      work_left = work();
+    }
+
+    /* write back the received data in the original order */
+    for (n = first; n < last; n++) {
+      GhostCommunication *gcn = &gc->comm[n];
+      if ((gcn->type & GHOST_JOBMASK) != GHOST_RECV)
+	continue;
+      if (data_parts == GHOSTTRANS_FORCE)
+	add_forces_from_recv_buffer(gcn, gcn->buffer, gcn->n_buffer);
+      else
+	put_recv_buffer(gcn, data_parts, gcn->buffer, gcn->n_buffer);
+    }
+  }
+
+  return work_left;
+}
+
 void ghost_communicator(GhostCommunicator *gc)
 {
   MPI_Status status;
@@ -389,6 +585,11 @@ void ghost_communicator(GhostCommunicator *gc)
 
   GHOST_TRACE(fprintf(stderr, "%d: ghost_comm %p, data_parts %d\n", this_node, gc, data_parts));
 
+  if (is_p2p_communicator(gc)) {
+    p2p_communicator(gc, NULL);
+    return;
+  }
+
   for (n = 0; n < gc->num; n++) {
     GhostCommunication *gcn = &gc->comm[n];
     int comm_type = gcn->type & GHOST_JOBMASK;
@@ -473,9 +674,9 @@ void ghost_communicator(GhostCommunicator *gc)
 	  /* forces have to be added, the rest overwritten. Exception is RDCE, where the addition
 	     is integrated into the communication. */
 	  if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-	    add_forces_from_recv_buffer(gcn);
+	    add_forces_from_recv_buffer(gcn, r_buffer, n_r_buffer);
 	  else
-	    put_recv_buffer(gcn, data_parts);
+	    put_recv_buffer(gcn, data_parts, r_buffer, n_r_buffer);
 	}
 	else {
 	  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm delaying operation %d, recv from %d\n", this_node, n, node));
@@ -500,9 +701,9 @@ void ghost_communicator(GhostCommunicator *gc)
 #endif
 	      /* as above */
 	      if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-		add_forces_from_recv_buffer(gcn2);
+		add_forces_from_recv_buffer(gcn2, r_buffer, n_r_buffer);
 	      else
-		put_recv_buffer(gcn2, data_parts);
+		put_recv_buffer(gcn2, data_parts, r_buffer, n_r_buffer);
 	      break;
 	    }
 	  }
@@ -512,6 +713,18 @@ void ghost_communicator(GhostCommunicator *gc)
   }
 }
 
+int ghost_communicator_overlap(GhostCommunicator *gc, int (*work)())
+{
+  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm_overlap %p, data_parts %d\n", this_node, gc, gc->data_parts));
+
+  /* collective operations are not split up */
+  if (!is_p2p_communicator(gc)) {
+    ghost_communicator(gc);
+    return (work != NULL);
+  }
+  return p2p_communicator(gc, work);
+}
+
 void ghost_init()
 {
   MPI_Op_create(reduce_forces_sum, 1, &MPI_FORCES_SUM);
@@ -82,6 +82,13 @@ When sending, this precreated send buffer is used. In the scenario above, all no
 communication step, thereby reducing the latency a little bit. The pststore is similar and postpones the write back of received data until a
 send operation (with a precreated send buffer) is finished.
 
+Communicators consisting only of GHOST_SEND, GHOST_RECV and GHOST_LOCL operations do not use the prefetching. Instead,
+every point-to-point operation has its own buffer and a persistent MPI request, which are kept between the calls. Since the
+transfers of a ghost communicator normally depend on each other, e. g. the ghost layer received in x direction is forwarded
+in y direction, they are done one after the other. If an operation does not depend on the data of the previous one, the
+cell system can set GHOST_OVERLAP on it, and subsequent operations with this flag are started at the same time.
+\ref ghost_communicator_overlap in addition does other work while waiting for them to finish.
+
 The ghost communicators are created in the init routines of the cell systems, therefore have a look at \ref dd_topology_init or
 \ref nsq_topology_init for further details.
 */
@@ -109,6 +116,8 @@ The ghost communicators are created in the init routines of the cell systems, th
 #define GHOST_PREFETCH 16
 /// additional flag for poststoring
 #define GHOST_PSTSTORE 32
+/// additional flag: the operation does not depend on the data transferred by the previous one
+#define GHOST_OVERLAP  64
 /*@}*/
 
 
@@ -157,6 +166,13 @@ typedef struct {
   /** if \ref GhostCommunicator::data_parts has \ref GHOSTTRANS_POSSHFTD, then this is the shift vector.
       Normally this a integer multiple of the box length. The shift is done on the sender side */
   double shift[3];
+
+  /** Buffer of a GHOST_SEND or GHOST_RECV, kept between the calls. */
+  char *buffer;
+  /** Allocated size of the buffer. */
+  int max_buffer;
+  /** Number of bytes the persistent request in \ref GhostCommunicator::request was created for. */
+  int n_buffer;
 } GhostCommunication;
 
 /** Properties for a ghost communication. A ghost communication is defined */
@@ -171,10 +187,25 @@ typedef struct {
   /** List of ghost communications. */
   GhostCommunication *comm;
 
+  /** Persistent MPI requests of the GHOST_SEND and GHOST_RECV communications, one per communication.
+      They are recreated if the amount of data to transfer changes, i. e. normally after a resort. */
+  MPI_Request *request;
+
 } GhostCommunicator;
 
 /*@}*/
 
+/** \name Exported Variables */
+/************************************************************/
+/*@{*/
+
+/** Time this node spent waiting for the transfers in \ref
+    ghost_communicator_overlap after all work was done. This is not
+    part of the load of the node, see \ref dd_balance_load. */
+extern double ghost_wait_time;
+
+/*@}*/
+
 /** \name Exported Functions */
 /************************************************************/
 /*@{*/
@@ -191,6 +222,18 @@ void ghost_init();
 /** do a ghost communication */
 void ghost_communicator(GhostCommunicator *gc);
 
+/** do a ghost communication, but while waiting for the transfers, do
+    some work not depending on the transferred data. Consecutive
+    GHOST_SEND and GHOST_RECV operations with \ref GHOST_OVERLAP set
+    are done concurrently with nonblocking MPI calls, and as long as
+    they are running, work is called. Communicators with GHOST_BCST or
+    GHOST_RDCE operations are handed to \ref ghost_communicator.
+    @param gc   the ghost communicator
+    @param work does a small piece of work, and returns 0 if there is
+                no more work left. It is not called again then. May be NULL.
+    @return 1 if there is still work left, i. e. work never returned 0. */
+int ghost_communicator_overlap(GhostCommunicator *gc, int (*work)());
+
 /** Go through \ref ghost_cells and remove the ghost entries from \ref
     local_particles. Part of \ref dd_exchange_and_sort_particles.*/
 void invalidate_ghosts();
@@ -102,6 +102,7 @@ const Datafield fields[] = {
   {&dpd_twf,            TYPE_INT, 1, "dpd_twf",    tclcallback_ro,     6 },         /* 40 from thermostat.c */
   {&dpd_wf,             TYPE_INT, 1, "dpd_wf",    tclcallback_ro,     5 },         /* 41 from thermostat.c */
   {adress_vars,      TYPE_DOUBLE, 7, "adress_vars",tclcallback_ro,  1 },         /* 42  from adresso.c */
+  {&respa_n_steps,      TYPE_INT, 1, "respa_n_steps", tclcallback_ro,  5 },         /* 43 from integrate.c */
   { NULL, 0, 0, NULL, NULL, 0 }
 };
 
@@ -171,6 +171,8 @@ extern const Datafield fields[];
 #define FIELD_DPD_WF           41
 /** index of address variable in \ref #fields */
 #define FIELD_ADRESS           42
+/** index of \ref respa_n_steps in \ref #fields */
+#define FIELD_RESPA_STEPS      43
 /*@}*/
 
 /**********************************************
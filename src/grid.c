@@ -57,6 +57,7 @@ double local_box_l[3] = {1, 1, 1};
 double min_local_box_l;
 double my_left[3]     = {0, 0, 0};
 double my_right[3]    = {1, 1, 1};
+double *node_bound[3] = {NULL, NULL, NULL};
 
 /************************************************************/
 
@@ -86,7 +87,14 @@ int map_position_node_array(double pos[3])
   fold_position(f_pos, im);
 
   for (i = 0; i < 3; i++) {
-    im[i] = (int)floor(node_grid[i]*f_pos[i]*box_l_i[i]);
+    if (node_bound[i]) {
+      double rel = f_pos[i]*box_l_i[i];
+      for (im[i] = 0; im[i] < node_grid[i] - 1; im[i]++)
+	if (rel < node_bound[i][im[i] + 1])
+	  break;
+    }
+    else
+      im[i] = (int)floor(node_grid[i]*f_pos[i]*box_l_i[i]);
     if (im[i] < 0)
       im[i] = 0;
     else if (im[i] >= node_grid[i])
@@ -144,9 +152,16 @@ void grid_changed_box_l()
   GRID_TRACE(fprintf(stderr,"%d: grid_changed_box_l:\n",this_node));
 
   for(i = 0; i < 3; i++) {
-    local_box_l[i] = box_l[i]/(double)node_grid[i]; 
-    my_left[i]   = node_pos[i]    *local_box_l[i];
-    my_right[i]  = (node_pos[i]+1)*local_box_l[i];    
+    if (node_bound[i]) {
+      my_left[i]     = node_bound[i][node_pos[i]]*box_l[i];
+      my_right[i]    = node_bound[i][node_pos[i]+1]*box_l[i];
+      local_box_l[i] = my_right[i] - my_left[i];
+    }
+    else {
+      local_box_l[i] = box_l[i]/(double)node_grid[i]; 
+      my_left[i]   = node_pos[i]    *local_box_l[i];
+      my_right[i]  = (node_pos[i]+1)*local_box_l[i];    
+    }
     box_l_i[i] = 1/box_l[i];
   }
 
@@ -160,10 +175,42 @@ void grid_changed_box_l()
 #endif
 }
 
+void set_node_bound(int dir, double *bound)
+{
+  int k;
+
+  if (bound) {
+    node_bound[dir] = realloc(node_bound[dir], (node_grid[dir] + 1)*sizeof(double));
+    for (k = 0; k <= node_grid[dir]; k++)
+      node_bound[dir][k] = bound[k];
+    /* avoid gaps due to rounding */
+    node_bound[dir][0] = 0;
+    node_bound[dir][node_grid[dir]] = 1;
+  }
+  else {
+    free(node_bound[dir]);
+    node_bound[dir] = NULL;
+  }
+  grid_changed_box_l();
+}
+
+int node_bound_is_set()
+{
+  return (node_bound[0] || node_bound[1] || node_bound[2]);
+}
+
 void grid_changed_n_nodes()
 {
+  int i;
+
   GRID_TRACE(fprintf(stderr,"%d: grid_changed_n_nodes:\n",this_node));
 
+  /* the boundaries do not fit the new grid */
+  for (i = 0; i < 3; i++) {
+    free(node_bound[i]);
+    node_bound[i] = NULL;
+  }
+
   calc_node_neighbors(this_node);
 
 #ifdef GRID_DEBUG
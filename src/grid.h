@@ -88,6 +88,15 @@ extern double min_local_box_l;
 extern double my_left[3];
 /** Right (top, back) corner of this nodes local box. */ 
 extern double my_right[3];
+/** Domain boundaries of the node grid in units of \ref box_l, or NULL
+    if the box is split into equally sized domains. In direction i,
+    the nodes with node_pos[i] == k own the slab from
+    node_bound[i][k]*box_l[i] to node_bound[i][k+1]*box_l[i]. Since
+    the boundaries are the same for all nodes of a slab, the domains
+    still form a rectilinear grid and each node keeps its 6 neighbors.
+    Set by the load balancing of the domain decomposition, see \ref
+    dd_balance_load. */
+extern double *node_bound[3];
 
 /*@}*/
 
@@ -133,6 +142,16 @@ void grid_changed_n_nodes();
 /** called from \ref mpi_bcast_parameter . */
 void grid_changed_box_l();
 
+/** set the domain boundaries in direction dir, see \ref node_bound.
+    \param dir   the direction.
+    \param bound node_grid[dir]+1 increasing values from 0 to 1, or NULL to
+                 split the box into equally sized domains again.
+    Updates the local box, but not the cell structure. */
+void set_node_bound(int dir, double *bound);
+
+/** return wether any domain boundaries are set, see \ref node_bound. */
+int node_bound_is_set();
+
 /** Calculates the smallest box and local box dimensions for periodic
  * directions.  This is needed to check if the interaction ranges are
  * compatible with the box dimensions and the node grid.  
@@ -47,6 +47,7 @@
 #include "domain_decomposition.h"
 #include "verlet.h"
 #include "forces.h"
+#include "packed_cells.h"
 #include "config.h"
 #include "global.h"
 
@@ -78,6 +79,18 @@ void iccp3m_store_forces();
 /** Granularity of the verlet list */
 #define LIST_INCREMENT 20
 
+/** number of electrostatics parameters that the boundary response depends on */
+#define ICCP3M_RESPONSE_KEY_N 25
+
+/** LU decomposition of the linear system of the induced charges for
+    \ref ICCP3M_SOLVER_RESPONSE, the same on all nodes */
+static double **iccp3m_response = NULL, *iccp3m_response_data = NULL;
+static int *iccp3m_response_perms = NULL;
+/** dimension of \ref iccp3m_response, or 0 if it has to be calculated */
+static int iccp3m_response_n = 0;
+/** the electrostatics parameters \ref iccp3m_response was calculated for */
+static double iccp3m_response_key[ICCP3M_RESPONSE_KEY_N];
+
 void iccp3m_init(void){
    iccp3m_cfg.set_flag=0;
    iccp3m_cfg.areas = NULL;
@@ -91,25 +104,50 @@ void iccp3m_init(void){
    iccp3m_cfg.fx = NULL;
    iccp3m_cfg.fy = NULL;
    iccp3m_cfg.fz = NULL;
+   iccp3m_cfg.solver = ICCP3M_SOLVER_SOR;
+   iccp3m_cfg.gmres_restart = ICCP3M_GMRES_RESTART;
 }
 
 /** Parses the ICCP3M command.
  */
 int tclcommand_iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv) {
   int last_ind_id,num_iteration,normal_args,area_args;
+  int i, solver = ICCP3M_SOLVER_SOR, gmres_restart = ICCP3M_GMRES_RESTART;
   char buffer[TCL_DOUBLE_SPACE];
   double e1,convergence,relax;
 
-  Tcl_AppendResult(interp, "The ICCP3M algorithm is still experimental. Function can not be guaranteed, therefore it is still disabled.\n", (char *)NULL);
-  return (TCL_ERROR);
-
   if(iccp3m_initialized==0){
       iccp3m_init();
       iccp3m_initialized=1;
   }
 
+  /* the optional solver selection follows the positional arguments */
+  for (i = 9; i < argc; i++) {
+    if (ARG_IS_S(i, "solver")) {
+      if (i + 1 < argc && ARG_IS_S(i + 1, "sor") && i + 2 == argc)
+        solver = ICCP3M_SOLVER_SOR;
+      else if (i + 1 < argc && ARG_IS_S(i + 1, "gmres") && i + 2 == argc)
+        solver = ICCP3M_SOLVER_GMRES;
+      else if (i + 1 < argc && ARG_IS_S(i + 1, "response") && i + 2 == argc)
+        solver = ICCP3M_SOLVER_RESPONSE;
+      else if (i + 1 < argc && ARG_IS_S(i + 1, "gmres") && i + 3 == argc) {
+        solver = ICCP3M_SOLVER_GMRES;
+        if (!ARG_IS_I(i + 2, gmres_restart) || gmres_restart < 1) {
+          Tcl_ResetResult(interp);
+          Tcl_AppendResult(interp, "GMRES restart must be a positive integer (got: ", argv[i + 2],")!", (char *)NULL); return (TCL_ERROR);
+        }
+      }
+      else {
+        Tcl_AppendResult(interp, "Usage: iccp3m ... solver { sor | gmres [<restart>] | response }", (char *)NULL);
+        return (TCL_ERROR);
+      }
+      argc = i;
+      break;
+    }
+  }
+
   if(argc != 9 && argc != 2 && argc != 10) { 
-         Tcl_AppendResult(interp, "Wrong # of args! Usage: iccp3m { iterate | <last_ind_id> <e1> <num_iteration> <convergence> <relaxation> <area> <normal_components> <e_in/e_out>  [<ext_field>] }", (char *)NULL); 
+         Tcl_AppendResult(interp, "Wrong # of args! Usage: iccp3m { iterate | <last_ind_id> <e1> <num_iteration> <convergence> <relaxation> <area> <normal_components> <e_in/e_out>  [<ext_field>] [solver { sor | gmres [<restart>] | response }] }", (char *)NULL); 
          return (TCL_ERROR); 
    }
    if (argc == 2 ){
@@ -133,6 +171,11 @@ int tclcommand_iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv
           Tcl_ResetResult(interp);
           Tcl_AppendResult(interp, "Last induced id can not be smaller then 2 (got: ", argv[1],")!", (char *)NULL); return (TCL_ERROR);
        }
+       if(solver == ICCP3M_SOLVER_RESPONSE && last_ind_id >= ICCP3M_RESPONSE_MAX_N) {
+          Tcl_ResetResult(interp);
+          sprintf(buffer, "%d", ICCP3M_RESPONSE_MAX_N);
+          Tcl_AppendResult(interp, "solver response is limited to ", buffer, " surface elements, use solver gmres (got last induced id ", argv[1],")!", (char *)NULL); return (TCL_ERROR);
+       }
        if(!ARG_IS_D(2, e1)) {
           Tcl_ResetResult(interp);
           Tcl_AppendResult(interp, "Dielectric constant e1(inner) must be double(got: ", argv[2],")!", (char *)NULL); return (TCL_ERROR);
@@ -160,6 +203,8 @@ int tclcommand_iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv
        iccp3m_cfg.relax = relax;
        iccp3m_cfg.update = 0;
        iccp3m_cfg.set_flag = 1;
+       iccp3m_cfg.solver = solver;
+       iccp3m_cfg.gmres_restart = gmres_restart;
        
        normal_args = (iccp3m_cfg.last_ind_id+1)*3;
        /* Now get Normal Vectors components consecutively */
@@ -192,7 +237,6 @@ int tclcommand_iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv
          }      
        }
        else {
-         printf("allocating zeroes for external field \n");
          iccp3m_cfg.extx = (double*)calloc((last_ind_id +1), sizeof(double));
          iccp3m_cfg.exty = (double*)calloc((last_ind_id +1), sizeof(double));
          iccp3m_cfg.extz = (double*)calloc((last_ind_id +1), sizeof(double));
@@ -233,6 +277,10 @@ int bcast_iccp3m_cfg(void){
   MPI_Bcast((double*)&iccp3m_cfg.eout, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   MPI_Bcast((double*)&iccp3m_cfg.relax, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   MPI_Bcast((int*)&iccp3m_cfg.update, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.solver, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.gmres_restart, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  /* the boundary might have changed */
+  iccp3m_response_n = 0;
   
   /* broadcast the vectors element by element. This is slow
    * but safe and only performed at the beginning of each simulation*/
@@ -247,10 +295,9 @@ int bcast_iccp3m_cfg(void){
     MPI_Bcast((double*)&iccp3m_cfg.extz[i], 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   }
 
-  MPI_Bcast(&iccp3m_cfg.citeration, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Bcast(&iccp3m_cfg.set_flag, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.citeration, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.set_flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-  printf("node %d: no iterations: %d\n", this_node, iccp3m_cfg.num_iteration);
   return 0 ;
     
 }
@@ -270,6 +317,11 @@ int iccp3m_iteration() {
 	    ERROR_SPRINTF(errtxt, "ICCP3M: nonpositive dielectric constant is not allowed. Put a decent tcl error here\n");
    }
 
+   if (iccp3m_cfg.solver == ICCP3M_SOLVER_GMRES)
+     return iccp3m_iteration_gmres();
+   if (iccp3m_cfg.solver == ICCP3M_SOLVER_RESPONSE)
+     return iccp3m_iteration_response();
+
    
    iccp3m_cfg.citeration=0;
    for(j=0;j<iccp3m_cfg.num_iteration;j++) {
@@ -348,6 +400,391 @@ int iccp3m_iteration() {
   return iccp3m_cfg.citeration++;
 }
 
+/** the global scalar product of two vectors of the local induced charges */
+static double iccp3m_dot(double *a, double *b, int n)
+{
+  double sum = 0, globalsum;
+  int k;
+  for (k = 0; k < n; k++)
+    sum += a[k]*b[k];
+  MPI_Allreduce(&sum, &globalsum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  return globalsum;
+}
+
+/** calculates the unrelaxed update of the charge densities of the
+    local induced charges \a p for their current charges, see \ref
+    iccp3m_iteration. */
+static void iccp3m_density_update(Particle **p, int n, double *g)
+{
+  double del_eps, ex, ey, ez;
+  int k, id;
+  char *errtxt;
+
+  force_calc_iccp3m();
+  for (k = 0; k < n; k++) {
+    id = p[k]->p.identity;
+    del_eps = (iccp3m_cfg.ein[id]-iccp3m_cfg.eout)/(iccp3m_cfg.ein[id] + iccp3m_cfg.eout)/6.283185307;
+    ex = p[k]->f.f[0]/p[k]->p.q + iccp3m_cfg.extx[id];
+    ey = p[k]->f.f[1]/p[k]->p.q + iccp3m_cfg.exty[id];
+    ez = p[k]->f.f[2]/p[k]->p.q + iccp3m_cfg.extz[id];
+    if (ex == 0 && ey == 0 && ez == 0) {
+      errtxt = runtime_error(128);
+      ERROR_SPRINTF(errtxt, "ICCP3M found zero electric field on a charge. This must never happen");
+    }
+    g[k] = del_eps*(ex*iccp3m_cfg.nvectorx[id] + ey*iccp3m_cfg.nvectory[id] +
+                    ez*iccp3m_cfg.nvectorz[id])/coulomb.bjerrum;
+  }
+}
+
+/** collects the local induced charges, which do not move during the
+    iteration. The array has to be freed by the caller.
+    \return the number of local induced charges */
+static int iccp3m_local_induced(Particle ***p)
+{
+  Particle *part;
+  int n = 0, max_n = 0, c, np, i;
+
+  *p = NULL;
+  for (c = 0; c < local_cells.n; c++) {
+    part = local_cells.cell[c]->part;
+    np   = local_cells.cell[c]->n;
+    for (i = 0; i < np; i++)
+      if (part[i].p.identity <= iccp3m_cfg.last_ind_id) {
+        if (n == max_n) {
+          max_n += LIST_INCREMENT;
+          *p = realloc(*p, max_n*sizeof(Particle *));
+        }
+        (*p)[n++] = &part[i];
+      }
+  }
+  return n;
+}
+
+/** checks the local induced charges for divergence like the relaxed
+    iteration. \return 1 if any charge on any node diverged */
+static int iccp3m_check_divergence(Particle **p, int n)
+{
+  double qmax = 0, globalmax;
+  char *errtxt;
+  int k;
+
+  for (k = 0; k < n; k++)
+    if (fabs(p[k]->p.q) > qmax)
+      qmax = fabs(p[k]->p.q);
+  MPI_Allreduce(&qmax, &globalmax, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  if (qmax > 1e6) {
+    errtxt = runtime_error(128 + TCL_DOUBLE_SPACE);
+    ERROR_SPRINTF(errtxt, "{error occured 990 : too big charge assignment in iccp3m! q >1e6 , \
+                               assigned charge= %f } \n", qmax);
+  }
+  return globalmax > 1e6;
+}
+
+int iccp3m_iteration_gmres() {
+  Particle **p;
+  int n, m = iccp3m_cfg.gmres_restart, i, j, k, nj;
+  double *h, *g0, *v, *w, *hess, *cs, *sn, *gam, *y;
+  double diff, difftemp, globalmax, beta, hnorm, s, tmp;
+
+  n = iccp3m_local_induced(&p);
+
+  h    = malloc((n + 1)*sizeof(double));
+  g0   = malloc((n + 1)*sizeof(double));
+  w    = malloc((n + 1)*sizeof(double));
+  v    = malloc(((m + 1)*n + 1)*sizeof(double));
+  hess = malloc((m + 1)*m*sizeof(double));
+  cs   = malloc(m*sizeof(double));
+  sn   = malloc(m*sizeof(double));
+  gam  = malloc((m + 1)*sizeof(double));
+  y    = malloc(m*sizeof(double));
+
+  /* start from the current charges */
+  for (k = 0; k < n; k++)
+    h[k] = p[k]->p.q/iccp3m_cfg.areas[p[k]->p.identity];
+
+  iccp3m_cfg.citeration = 0;
+  while (iccp3m_cfg.citeration < iccp3m_cfg.num_iteration) {
+    /* residual of the current charges, with the convergence criterion
+       of the relaxed iteration */
+    iccp3m_density_update(p, n, g0);
+    iccp3m_cfg.citeration++;
+    diff = 0;
+    for (k = 0; k < n; k++) {
+      difftemp = fabs(2.*(g0[k] - h[k])/(h[k] + g0[k]));
+      if (difftemp > diff && p[k]->p.q > 1e-5)
+        diff = difftemp;
+    }
+    MPI_Allreduce(&diff, &globalmax, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if (globalmax < iccp3m_cfg.convergence) {
+      /* like the relaxed iteration, keep the last update */
+      for (k = 0; k < n; k++)
+        h[k] = g0[k];
+      break;
+    }
+
+    for (k = 0; k < n; k++)
+      v[k] = g0[k] - h[k];
+    beta  = sqrt(iccp3m_dot(v, v, n));
+    hnorm = sqrt(iccp3m_dot(h, h, n));
+    for (k = 0; k < n; k++)
+      v[k] /= beta;
+    gam[0] = beta;
+    /* size of the displacement of the charges along the Krylov vectors */
+    s = (hnorm > 0) ? hnorm : 1.0;
+
+    /* Arnoldi process with the Givens rotations of the Hessenberg matrix */
+    nj = 0;
+    for (j = 0; j < m && iccp3m_cfg.citeration < iccp3m_cfg.num_iteration; j++) {
+      for (k = 0; k < n; k++)
+        p[k]->p.q = (h[k] + s*v[j*n + k])*iccp3m_cfg.areas[p[k]->p.identity];
+      iccp3m_density_update(p, n, w);
+      iccp3m_cfg.citeration++;
+      for (k = 0; k < n; k++)
+        w[k] = v[j*n + k] - (w[k] - g0[k])/s;
+
+      for (i = 0; i <= j; i++) {
+        hess[i*m + j] = iccp3m_dot(w, v + i*n, n);
+        for (k = 0; k < n; k++)
+          w[k] -= hess[i*m + j]*v[i*n + k];
+      }
+      hess[(j + 1)*m + j] = sqrt(iccp3m_dot(w, w, n));
+      if (hess[(j + 1)*m + j] > 0)
+        for (k = 0; k < n; k++)
+          v[(j + 1)*n + k] = w[k]/hess[(j + 1)*m + j];
+
+      for (i = 0; i < j; i++) {
+        tmp = cs[i]*hess[i*m + j] + sn[i]*hess[(i + 1)*m + j];
+        hess[(i + 1)*m + j] = -sn[i]*hess[i*m + j] + cs[i]*hess[(i + 1)*m + j];
+        hess[i*m + j] = tmp;
+      }
+      tmp = sqrt(SQR(hess[j*m + j]) + SQR(hess[(j + 1)*m + j]));
+      if (tmp == 0)
+        break;
+      cs[j] = hess[j*m + j]/tmp;
+      sn[j] = hess[(j + 1)*m + j]/tmp;
+      hess[j*m + j] = tmp;
+      gam[j + 1] = -sn[j]*gam[j];
+      gam[j]     =  cs[j]*gam[j];
+      nj = j + 1;
+
+      /* the GMRES residual is known without a force calculation, so
+         restart and check the true residual once it is small */
+      if (hess[(j + 1)*m + j] == 0 || fabs(gam[j + 1]) < 0.1*iccp3m_cfg.convergence*hnorm)
+        break;
+    }
+
+    /* least squares solution in the Krylov subspace */
+    for (i = nj - 1; i >= 0; i--) {
+      y[i] = gam[i];
+      for (j = i + 1; j < nj; j++)
+        y[i] -= hess[i*m + j]*y[j];
+      y[i] /= hess[i*m + i];
+    }
+    for (i = 0; i < nj; i++)
+      for (k = 0; k < n; k++)
+        h[k] += y[i]*v[i*n + k];
+
+    for (k = 0; k < n; k++)
+      p[k]->p.q = h[k]*iccp3m_cfg.areas[p[k]->p.identity];
+    if (iccp3m_check_divergence(p, n))
+      break;
+  }
+
+  for (k = 0; k < n; k++)
+    p[k]->p.q = h[k]*iccp3m_cfg.areas[p[k]->p.identity];
+
+  free(p);
+  free(h);
+  free(g0);
+  free(w);
+  free(v);
+  free(hess);
+  free(cs);
+  free(sn);
+  free(gam);
+  free(y);
+
+  on_particle_change();
+  return iccp3m_cfg.citeration;
+}
+
+/** the parameters of the electrostatics method that change the
+    boundary response. Any change through the Tcl interface also
+    invalidates the response in \ref iccp3m_on_coulomb_change, but
+    the box can be rescaled without that, e. g. by the NpT integrator. */
+static void iccp3m_response_params(double key[ICCP3M_RESPONSE_KEY_N])
+{
+  int i, k = 0;
+  for (i = 0; i < ICCP3M_RESPONSE_KEY_N; i++)
+    key[i] = 0;
+  for (i = 0; i < 3; i++)
+    key[k++] = box_l[i];
+  key[k++] = coulomb.method;
+  key[k++] = coulomb.prefactor;
+  switch (coulomb.method) {
+#ifdef P3M
+  case COULOMB_ELC_P3M:
+    key[k++] = elc_params.gap_size;
+    key[k++] = elc_params.maxPWerror;
+    key[k++] = elc_params.far_cut;
+    key[k++] = elc_params.neutralize;
+    key[k++] = elc_params.dielectric_contrast_on;
+    key[k++] = elc_params.di_top;
+    key[k++] = elc_params.di_bot;
+    /* fall through */
+  case COULOMB_P3M:
+    key[k++] = p3m.params.alpha;
+    key[k++] = p3m.params.r_cut;
+    for (i = 0; i < 3; i++) {
+      key[k++] = p3m.params.mesh[i];
+      key[k++] = p3m.params.mesh_off[i];
+    }
+    key[k++] = p3m.params.cao;
+    key[k++] = p3m.params.inter;
+    key[k++] = p3m.params.ad;
+    key[k++] = p3m.params.interlace;
+    key[k++] = p3m.params.epsilon;
+    break;
+#endif
+  case COULOMB_MMM2D:
+    key[k++] = mmm2d_params.maxPWerror;
+    key[k++] = mmm2d_params.far_cut;
+    key[k++] = mmm2d_params.dielectric_contrast_on;
+    key[k++] = mmm2d_params.delta_mid_top;
+    key[k++] = mmm2d_params.delta_mid_bot;
+    break;
+  case COULOMB_MMM1D:
+    key[k++] = mmm1d_params.maxPWerror;
+    key[k++] = mmm1d_params.far_switch_radius_2;
+    key[k++] = mmm1d_params.bessel_cutoff;
+    break;
+  default: ;
+  }
+}
+
+void iccp3m_on_coulomb_change()
+{
+  iccp3m_response_n = 0;
+}
+
+/** calculates the LU decomposition of the linear system of the induced
+    charges. The derivatives of the unrelaxed update with respect to
+    the density of each surface element follow from the difference of
+    the update with that element's charge displaced, which takes one
+    force calculation per surface element. */
+static void iccp3m_build_response(Particle **p, int n)
+{
+  int N = iccp3m_cfg.last_ind_id + 1, i, j, k, *local;
+  double *m, *h, *g0, *g, s, hmax = 0;
+  char *errtxt;
+
+  local = malloc(N*sizeof(int));
+  m     = malloc(N*N*sizeof(double));
+  h     = malloc((n + 1)*sizeof(double));
+  g0    = malloc((n + 1)*sizeof(double));
+  g     = malloc((n + 1)*sizeof(double));
+  for (j = 0; j < N; j++)
+    local[j] = -1;
+  for (i = 0; i < N*N; i++)
+    m[i] = 0;
+  for (k = 0; k < n; k++) {
+    local[p[k]->p.identity] = k;
+    h[k] = p[k]->p.q/iccp3m_cfg.areas[p[k]->p.identity];
+    if (fabs(h[k]) > hmax)
+      hmax = fabs(h[k]);
+  }
+  /* displace by twice the size of the densities, so that no charge
+     becomes zero, which the field calculation divides by. The update
+     is affine, so the size does not matter otherwise. */
+  MPI_Allreduce(&hmax, &s, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  s *= 2;
+  if (s == 0)
+    s = 1;
+
+  iccp3m_density_update(p, n, g0);
+  iccp3m_cfg.citeration++;
+  for (j = 0; j < N; j++) {
+    if ((k = local[j]) >= 0)
+      p[k]->p.q = (h[k] + s)*iccp3m_cfg.areas[j];
+    iccp3m_density_update(p, n, g);
+    iccp3m_cfg.citeration++;
+    if (k >= 0)
+      p[k]->p.q = h[k]*iccp3m_cfg.areas[j];
+    for (k = 0; k < n; k++)
+      m[p[k]->p.identity*N + j] = -(g[k] - g0[k])/s;
+  }
+
+  iccp3m_response_data  = realloc(iccp3m_response_data, N*N*sizeof(double));
+  iccp3m_response       = realloc(iccp3m_response, N*sizeof(double *));
+  iccp3m_response_perms = realloc(iccp3m_response_perms, N*sizeof(int));
+  MPI_Allreduce(m, iccp3m_response_data, N*N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  for (j = 0; j < N; j++) {
+    iccp3m_response[j] = iccp3m_response_data + j*N;
+    iccp3m_response[j][j] += 1.0;
+  }
+  if (lu_decompose_matrix(iccp3m_response, N, iccp3m_response_perms) == -1) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt, "{318 ICCP3M boundary response is singular} ");
+    iccp3m_response_n = 0;
+  }
+  else {
+    iccp3m_response_n = N;
+    iccp3m_response_params(iccp3m_response_key);
+  }
+
+  free(local);
+  free(m);
+  free(h);
+  free(g0);
+  free(g);
+}
+
+int iccp3m_iteration_response() {
+  Particle **p;
+  int N = iccp3m_cfg.last_ind_id + 1, n, i, k;
+  double *g, *r, *x, key[ICCP3M_RESPONSE_KEY_N];
+
+  n = iccp3m_local_induced(&p);
+  iccp3m_cfg.citeration = 0;
+
+  iccp3m_response_params(key);
+  for (i = 0; i < ICCP3M_RESPONSE_KEY_N; i++)
+    if (key[i] != iccp3m_response_key[i])
+      iccp3m_response_n = 0;
+  if (iccp3m_response_n != N) {
+    iccp3m_build_response(p, n);
+    if (iccp3m_response_n != N) {
+      free(p);
+      return iccp3m_cfg.citeration;
+    }
+  }
+
+  /* the residual contains the field of the moved charges, the
+     boundary response gives the exact correction of the densities */
+  g = malloc((n + 1)*sizeof(double));
+  r = malloc(N*sizeof(double));
+  x = malloc(N*sizeof(double));
+  iccp3m_density_update(p, n, g);
+  iccp3m_cfg.citeration++;
+  for (i = 0; i < N; i++)
+    r[i] = 0;
+  for (k = 0; k < n; k++)
+    r[p[k]->p.identity] = g[k] - p[k]->p.q/iccp3m_cfg.areas[p[k]->p.identity];
+  MPI_Allreduce(r, x, N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  lu_solve_system(iccp3m_response, N, iccp3m_response_perms, x);
+  for (k = 0; k < n; k++)
+    p[k]->p.q += x[p[k]->p.identity]*iccp3m_cfg.areas[p[k]->p.identity];
+  iccp3m_check_divergence(p, n);
+
+  free(p);
+  free(g);
+  free(r);
+  free(x);
+
+  on_particle_change();
+  return iccp3m_cfg.citeration;
+}
+
 void force_calc_iccp3m() {
 /* The following ist mostly copied from forces.c */
 
@@ -364,7 +801,8 @@ void force_calc_iccp3m() {
     layered_calculate_ia_iccp3m();
     break;
   case CELL_STRUCTURE_DOMDEC:
-    if(dd.use_vList) {
+    /* the cluster lists have no iccp3m loop, use the link cells */
+    if(dd.use_vList && !dd.use_clusters) {
       if (rebuild_verletlist) {
         build_verlet_lists_and_calc_verlet_ia_iccp3m();
        } else  {
@@ -446,7 +884,6 @@ void layered_calculate_ia_iccp3m()
 void build_verlet_lists_and_calc_verlet_ia_iccp3m()
 {
   int c, np1, n, np2, i ,j, j_start=0;
-  Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   PairList *pl;
@@ -465,12 +902,11 @@ void build_verlet_lists_and_calc_verlet_ia_iccp3m()
   for (c = 0; c < local_cells.n; c++) {
     VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       VERLET_TRACE(fprintf(stderr,"%d: neighbor %d contains %d parts\n",this_node,n,np2));
@@ -512,6 +948,8 @@ void build_verlet_lists_and_calc_verlet_ia_iccp3m()
 	}
       }
       resize_verlet_list_iccp3m(pl);
+      if (dd.use_packed)
+	packed_cells_pair_indices(neighbor);
       VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d pairs\n",this_node,n,pl->n));
       VERLET_TRACE(sum += pl->n);
     }
@@ -553,7 +991,6 @@ void calculate_verlet_ia_iccp3m()
 void calc_link_cell_iccp3m()
 {
   int c, np1, n, np2, i ,j, j_start=0;
-  Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   double dist2, vec21[3];
@@ -561,12 +998,11 @@ void calc_link_cell_iccp3m()
   /* Loop local cells */
   for (c = 0; c < local_cells.n; c++) {
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       /* Loop cell particles */
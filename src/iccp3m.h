@@ -93,13 +93,33 @@ typedef struct {
   double *fx,*fy,*fz;                   /* forces iccp3m will use*/ 
   int citeration ;                      /* current number of iterations*/
   int set_flag;                         /* flag that indicates if ICCP3M has been initialized properly */    
+  int solver;                           /* solver for the induced charges, see ICCP3M_SOLVER_* */
+  int gmres_restart;                    /* dimension of the Krylov subspace before GMRES restarts */
 } iccp3m_struct;
 
+/** solvers for the induced charges */
+enum {
+  /** successive over-relaxation with the relaxation parameter */
+  ICCP3M_SOLVER_SOR,
+  /** restarted GMRES on the linear system of the induced charges */
+  ICCP3M_SOLVER_GMRES,
+  /** precalculated response of a static boundary */
+  ICCP3M_SOLVER_RESPONSE
+};
+
+/** default dimension of the Krylov subspace of the GMRES solver */
+#define ICCP3M_GMRES_RESTART 20
+
+/** maximal number of surface elements for \ref ICCP3M_SOLVER_RESPONSE.
+    Its dense matrix takes 8 N^2 bytes on every node, twice that while
+    it is calculated. */
+#define ICCP3M_RESPONSE_MAX_N 2000
+
 extern iccp3m_struct iccp3m_cfg;        /* global variable with ICCP3M configuration */
 extern int iccp3m_initialized;
 int bcast_iccp3m_cfg(void);
 /** Implementation of the tcl-command <br>
-    iccp3m  { \<last_ind_id\> \<e1\> \<num_iteration\> \<convergence\> \<relaxation\> \<area\> \<normal_components\> \<e_in/e_out\>  [\<ext_field\>] | iterate } 
+    iccp3m  { \<last_ind_id\> \<e1\> \<num_iteration\> \<convergence\> \<relaxation\> \<area\> \<normal_components\> \<e_in/e_out\>  [\<ext_field\>] [solver { sor | gmres [\<restart\>] | response }] | iterate } 
     ICC sets up and calculates induced charges on dielectric surfaces. At the beginning of every simulation run particles on the surface boundary 
     have to be set up (before any real particle) together with the list of areas, normal vectors and dielectric constant associated with them. 
     After that the iterate flag can be used during the simulation to update the value of the induced charges.
@@ -112,6 +132,14 @@ int bcast_iccp3m_cfg(void);
                  \<area\>       = List of the areas of each surface element.
                  \<normal_components\> = List of normal vectors of each surface element. 3n list entries. Do not have to be normalized.
                  \<e_in/e_out\> = Ratio of dielectric co
+                 solver        = sor (default) uses the relaxed fixed point iteration. gmres solves the
+                                 linear system of the induced charges with GMRES, restarted after \<restart\>
+                                 (default 20) iterations, starting from the current charges. In both cases,
+                                 every iteration is one electrostatic force calculation.
+                                 response is for static boundaries. It calculates the response of the
+                                 boundary once, which takes one force calculation per surface element, and
+                                 afterwards needs a single force calculation per update. Its dense matrix
+                                 limits it to \ref ICCP3M_RESPONSE_MAX_N surface elements.
 
 
                  iterate         = Indicates that a previous surface discretization shall be used. T
@@ -154,6 +182,33 @@ void nsq_calculate_ia_iccp3m();
  */
 int iccp3m_iteration();
 
+/** Determine the surface element charges by GMRES. The surface charge
+    densities h solve the linear system h = G(h), where G(h) is the
+    unrelaxed update of \ref iccp3m_iteration. Since G is affine, the
+    matrix-vector products follow from the difference of G for the
+    current charges and for the charges displaced along the Krylov
+    vectors, so that every GMRES iteration costs one force
+    calculation. Convergence is checked with the criterion of \ref
+    iccp3m_iteration at every restart.
+*/
+int iccp3m_iteration_gmres();
+
+/** Determine the surface element charges for a static boundary. The
+    linear system of \ref iccp3m_iteration_gmres only depends on the
+    boundary and the electrostatics parameters, so that its LU
+    decomposition is calculated once, with one force calculation per
+    surface element, and kept on all nodes. Afterwards, a single force
+    calculation gives the residual due to the moved charges, and the
+    solution of the linear system yields the exact charges. The
+    decomposition is recalculated when the box or the electrostatics
+    parameters change, and on every new iccp3m setup.
+*/
+int iccp3m_iteration_response();
+
+/** Invalidate the boundary response of \ref iccp3m_iteration_response,
+    called whenever the electrostatics parameters change. */
+void iccp3m_on_coulomb_change();
+
 /** The initialisation of ICCP3M with zero values for all variables 
  */
 void iccp3m_init(void);
@@ -205,6 +205,80 @@ void on_integration_start()
   
 #endif /*NPT*/
 
+  if (integ_switch == INTEG_METHOD_RESPA) {
+#ifdef ELECTROSTATICS
+    if (coulomb.method == COULOMB_MAGGS) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{317 respa does not work with maggs} ");
+    }
+#endif
+#ifdef DIPOLES
+    if (coulomb.Dmethod != DIPOLAR_NONE) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{317 respa does not work with magnetostatics} ");
+    }
+#endif
+  }
+
+  /* with the eighth shell, the ghosts of the lower neighbors are missing */
+  if (cell_structure.type == CELL_STRUCTURE_DOMDEC && dd.use_eighth_shell) {
+    if (n_bonded_ia > 0) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{311 eighth shell ghost communication does not support bonded interactions} ");
+    }
+#ifdef EXCLUSIONS
+    {
+      int c, p, have_excl = 0;
+      for (c = 0; c < local_cells.n; c++)
+	for (p = 0; p < local_cells.cell[c]->n; p++)
+	  have_excl |= (local_cells.cell[c]->part[p].el.n > 0);
+      if (have_excl) {
+	errtext = runtime_error(128);
+	ERROR_SPRINTF(errtext,"{311 eighth shell ghost communication does not support exclusions} ");
+      }
+    }
+#endif
+#ifdef VIRTUAL_SITES
+    errtext = runtime_error(128);
+    ERROR_SPRINTF(errtext,"{312 eighth shell ghost communication does not support virtual sites} ");
+#endif
+#ifdef LB
+    if (lattice_switch & LATTICE_LB) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{313 eighth shell ghost communication does not support lattice Boltzmann} ");
+    }
+#endif
+  }
+
+  /* the mesh based methods split their meshes into equally sized domains */
+  if (cell_structure.type == CELL_STRUCTURE_DOMDEC && dd.balance_interval > 0) {
+#ifdef ELECTROSTATICS
+    switch (coulomb.method) {
+#ifdef P3M
+    case COULOMB_P3M:
+    case COULOMB_ELC_P3M:
+#endif
+    case COULOMB_MAGGS:
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{314 load balancing is not possible with mesh based electrostatics} ");
+      break;
+    default: break;
+    }
+#endif
+#ifdef DP3M
+    if (coulomb.Dmethod == DIPOLAR_P3M || coulomb.Dmethod == DIPOLAR_MDLC_P3M) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{314 load balancing is not possible with mesh based magnetostatics} ");
+    }
+#endif
+#ifdef LB
+    if (lattice_switch & LATTICE_LB) {
+      errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{314 load balancing is not possible with lattice Boltzmann} ");
+    }
+#endif
+  }
+
   if (!check_obs_calc_initialized()) return;
 
 #ifdef LB
@@ -336,6 +410,7 @@ void on_particle_change()
   reinit_electrostatics = 1;
   reinit_magnetostatics = 1;
   rebuild_verletlist = 1;
+  invalidate_verlet_cell_records();
 
 #ifdef LB_GPU
   lb_reinit_particles_gpu = 1;
@@ -385,6 +460,7 @@ void on_coulomb_change()
   default: break;
   }
 
+  iccp3m_on_coulomb_change();
   recalc_forces = 1;
 #endif  /* ifdef ELECTROSTATICS */
 
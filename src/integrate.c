@@ -69,6 +69,8 @@
 
 int    integ_switch     = INTEG_METHOD_NVT;
 
+int    respa_n_steps    = 1;
+
 int n_verlet_updates    = 0;
 
 double time_step        = -1.0;
@@ -119,6 +121,12 @@ void force_and_velocity_display();
  
 void finalize_p_inst_npt();
 
+/** Kick the velocities of the local particles with the long range
+    forces for a time of n_half base time steps. The long range forces
+    are evaluated here, the (rescaled) short range forces are left
+    untouched. Used by the RESPA integrator. */
+static void respa_slow_kick(double n_half);
+
 /*@}*/
 
 /************************************************************/
@@ -141,6 +149,7 @@ int tclcommand_integrate_print_usage(Tcl_Interp *interp)
   Tcl_AppendResult(interp, "'integrate <INT n steps>' for integrating n steps \n", (char *)NULL);
   Tcl_AppendResult(interp, "'integrate set' for printing integrator status \n", (char *)NULL);
   Tcl_AppendResult(interp, "'integrate set nvt' for enabling NVT integration or \n" , (char *)NULL);
+  Tcl_AppendResult(interp, "'integrate set respa <INT n>' for evaluating the long range forces only every n steps or \n" , (char *)NULL);
 #ifdef NPT
   Tcl_AppendResult(interp, "'integrate set npt_isotropic <DOUBLE p_ext> [<DOUBLE piston>] [<INT, INT, INT system_geometry>] [-cubic_box]' for enabling isotropic NPT integration \n" , (char *)NULL);
 #endif
@@ -156,6 +165,10 @@ int tclcommand_integrate_print_status(Tcl_Interp *interp)
   case INTEG_METHOD_NVT:
     Tcl_AppendResult(interp, "{ set nvt }", (char *)NULL);
     return (TCL_OK);
+  case INTEG_METHOD_RESPA:
+    sprintf(buffer, "%d", respa_n_steps);
+    Tcl_AppendResult(interp, "{ set respa ", buffer, " }", (char *)NULL);
+    return (TCL_OK);
   case INTEG_METHOD_NPT_ISO:
     Tcl_PrintDouble(interp, nptiso.p_ext, buffer);
     Tcl_AppendResult(interp, "{ set npt_isotropic ", buffer, (char *)NULL);
@@ -188,6 +201,28 @@ int tclcommand_integrate_set_nvt(Tcl_Interp *interp, int argc, char **argv)
   return (TCL_OK);
 }
 
+/** Parse integrate respa command */
+int tclcommand_integrate_set_respa(Tcl_Interp *interp, int argc, char **argv)
+{
+  int n;
+
+  if (argc < 4) {
+    Tcl_AppendResult(interp, "wrong # args: \n", (char *)NULL);
+    return tclcommand_integrate_print_usage(interp);
+  }
+  if (!ARG_IS_I(3, n)) return tclcommand_integrate_print_usage(interp);
+  if (n < 1) {
+    Tcl_AppendResult(interp, "the number of steps between long range force evaluations must be positive", (char *)NULL);
+    return (TCL_ERROR);
+  }
+
+  respa_n_steps = n;
+  mpi_bcast_parameter(FIELD_RESPA_STEPS);
+  integ_switch = INTEG_METHOD_RESPA;
+  mpi_bcast_parameter(FIELD_INTEG_SWITCH);
+  return (TCL_OK);
+}
+
 /** Parse integrate npt_isotropic command */
 int tclcommand_integrate_set_npt_isotropic(Tcl_Interp *interp, int argc, char **argv)
 {
@@ -301,6 +336,7 @@ int tclcommand_integrate(ClientData data, Tcl_Interp *interp, int argc, char **a
   if (ARG1_IS_S("set")) {
     if      (argc < 3)                    return tclcommand_integrate_print_status(interp);
     if      (ARG_IS_S(2,"nvt"))           return tclcommand_integrate_set_nvt(interp, argc, argv);
+    else if (ARG_IS_S(2,"respa"))         return tclcommand_integrate_set_respa(interp, argc, argv);
 #ifdef NPT
     else if (ARG_IS_S(2,"npt_isotropic")) return tclcommand_integrate_set_npt_isotropic(interp, argc, argv);
 #endif
@@ -373,7 +409,8 @@ void integrate_ensemble_init()
 
 void integrate_vv(int n_steps)
 {
-  int i;
+  int i, overlap, balance;
+  double force_start = 0, wait_start = 0;
 
   /* Prepare the Integrator */
   on_integration_start();
@@ -445,6 +482,11 @@ ghost_communicator(&cell_structure.collect_ghost_force_comm);
   if (check_runtime_errors())
     return;
 
+  /* RESPA: the first half kick of the long range forces. f(t) only
+     contains the short range forces. */
+  if (integ_switch == INTEG_METHOD_RESPA && n_steps > 0)
+    respa_slow_kick(0.5*imin(respa_n_steps, n_steps));
+
   n_verlet_updates = 0;
 
   /* Integration loop */
@@ -490,7 +532,15 @@ ghost_communicator(&cell_structure.collect_ghost_force_comm);
       break;
 #endif
 
-    cells_update_ghosts();
+    /* move the domain boundaries according to the measured load */
+    balance = (cell_structure.type == CELL_STRUCTURE_DOMDEC && dd.balance_interval > 0);
+    if (balance)
+      dd_balance_load();
+
+    /* with overlapped communication, the ghost update is part of the force calculation */
+    overlap = force_calc_overlap_applicable();
+    if (!overlap)
+      cells_update_ghosts();
 
 //VIRTUAL_SITES update pos and vel (for DPD)
 #ifdef VIRTUAL_SITES
@@ -512,7 +562,18 @@ ghost_communicator(&cell_structure.collect_ghost_force_comm);
     transfer_momentum_gpu = 1;
 #endif
 
-    force_calc();
+    if (balance) {
+      force_start = MPI_Wtime();
+      wait_start  = ghost_wait_time;
+    }
+
+    if (overlap)
+      force_calc_overlapped();
+    else
+      force_calc();
+
+    if (balance)
+      dd_balance_add_time(MPI_Wtime() - force_start - (ghost_wait_time - wait_start));
 
 //VIRTUAL_SITES distribute forces
 #ifdef VIRTUAL_SITES
@@ -523,7 +584,8 @@ ghost_communicator(&cell_structure.collect_ghost_force_comm);
 #endif
 
     /* Communication step: ghost forces */
-    ghost_communicator(&cell_structure.collect_ghost_force_comm);
+    if (!overlap)
+      ghost_communicator(&cell_structure.collect_ghost_force_comm);
 
     /*apply trap forces to trapped molecules*/
 #ifdef MOLFORCES         
@@ -537,6 +599,15 @@ ghost_communicator(&cell_structure.collect_ghost_force_comm);
        v(t+dt) = v(t+0.5*dt) + 0.5*dt * f(t+dt) */
     rescale_forces_propagate_vel();
 
+    /* RESPA: at the end of a cycle of respa_n_steps, kick with the long
+       range forces, for the end of this cycle and the beginning of the
+       next one at once. The last cycle may be shorter. */
+    if (integ_switch == INTEG_METHOD_RESPA &&
+	((i + 1) % respa_n_steps == 0 || i + 1 == n_steps)) {
+      int n_next = imin(respa_n_steps, n_steps - (i + 1));
+      respa_slow_kick(0.5*(i % respa_n_steps + 1 + n_next));
+    }
+
 #ifdef LB
   if (lattice_switch & LATTICE_LB) lattice_boltzmann_update();
   if (check_runtime_errors()) break;
@@ -756,6 +827,59 @@ void rescale_forces_propagate_vel()
 #endif
 }
 
+static void respa_slow_kick(double n_half)
+{
+  static double *f_short = NULL;
+  static int max_f_short = 0;
+  Cell *cell;
+  Particle *p;
+  int c, i, j, k, np;
+  double scale;
+
+  INTEG_TRACE(fprintf(stderr,"%d: respa_slow_kick: %g steps\n",this_node,n_half));
+
+  if (3*cells_get_n_particles() > max_f_short) {
+    max_f_short = 3*cells_get_n_particles();
+    f_short = realloc(f_short, max_f_short*sizeof(double));
+  }
+
+  /* the long range forces only act on the local particles, and are
+     added to the forces. Park the short range forces meanwhile. */
+  k = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i = 0; i < np; i++)
+      for(j = 0; j < 3; j++) {
+	f_short[k++] = p[i].f.f[j];
+	p[i].f.f[j] = 0;
+      }
+  }
+
+  calc_long_range_forces();
+
+  /* v is stored in units of dt, f is the plain force here */
+  scale = n_half * time_step * time_step;
+  k = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i = 0; i < np; i++)
+      for(j = 0; j < 3; j++, k++) {
+#ifdef VIRTUAL_SITES
+	if (!ifParticleIsVirtual(&p[i]))
+#endif
+#ifdef EXTERNAL_FORCES
+	if (!(p[i].l.ext_flag & COORD_FIXED(j)))
+#endif
+	  p[i].m.v[j] += scale*p[i].f.f[j]/PMASS(p[i]);
+	p[i].f.f[j] = f_short[k];
+      }
+  }
+}
+
 void finalize_p_inst_npt()
 {
 #ifdef NPT
@@ -27,6 +27,7 @@
 
 #define INTEG_METHOD_NPT_ISO   0
 #define INTEG_METHOD_NVT       1
+#define INTEG_METHOD_RESPA     2
 
 /************************************************************/
 /** \name Exported Variables */
@@ -36,6 +37,10 @@
 /** Switch determining which Integrator to use. */
 extern int integ_switch;
 
+/** Number of base time steps between two evaluations of the long
+    range forces for the RESPA integrator. */
+extern int respa_n_steps;
+
 /** incremented if a Verlet update is done, aka particle resorting. */
 extern int n_verlet_updates;
 
@@ -314,6 +314,32 @@ MDINLINE void add_lj_pair_force(Particle *p1, Particle *p2, IA_parameters *ia_pa
   }
 }
 
+/** Calculate the Lennard Jones force factor for a pair at distance
+    dist > 0, i. e. the force on particle 1 is fac*d. Same as \ref
+    add_lj_pair_force, but without access to the particles, for the
+    packed force loop (see \ref packed_cells.h). */
+MDINLINE double lj_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  double r_off, frac2, frac6;
+  if ((dist < ia_params->LJ_cut+ia_params->LJ_offset) &&
+      (dist > ia_params->LJ_min+ia_params->LJ_offset)) {
+    r_off = dist - ia_params->LJ_offset;
+    /* normal case: resulting force/energy smaller than capping. */
+    if(r_off > ia_params->LJ_capradius) {
+      frac2 = SQR(ia_params->LJ_sig/r_off);
+      frac6 = frac2*frac2*frac2;
+      return 48.0 * ia_params->LJ_eps * frac6*(frac6 - 0.5) / (r_off * dist);
+    }
+    /* capped part of lj potential. */
+    else if(dist > 0.0) {
+      frac2 = SQR(ia_params->LJ_sig/ia_params->LJ_capradius);
+      frac6 = frac2*frac2*frac2;
+      return 48.0 * ia_params->LJ_eps * frac6*(frac6 - 0.5) / (ia_params->LJ_capradius * dist);
+    }
+  }
+  return 0.0;
+}
+
 /** calculate Lennard jones energy between particle p1 and p2. */
 MDINLINE double lj_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
 				double d[3], double dist)
@@ -184,6 +184,28 @@ MDINLINE void add_ljcos_pair_force(Particle *p1, Particle *p2, IA_parameters *ia
 }
 
 
+/** Calculate the lennard-jones+cos force factor for a pair at
+    distance dist > 0, i. e. the force on particle 1 is fac*d. Particle
+    free version of \ref add_ljcos_pair_force for the packed force loop. */
+MDINLINE double ljcos_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  double r_off, frac2, frac6;
+
+  if(dist < ia_params->LJCOS_cut+ia_params->LJCOS_offset) {
+    r_off = dist - ia_params->LJCOS_offset;
+    /* cos part of ljcos potential. */
+    if(dist > ia_params->LJCOS_rmin+ia_params->LJCOS_offset)
+      return (r_off/dist) * ia_params->LJCOS_alfa * ia_params->LJCOS_eps * (sin(ia_params->LJCOS_alfa * SQR(r_off) + ia_params->LJCOS_beta));
+    /* lennard-jones part of the potential. */
+    else if(dist > 0) {
+      frac2 = SQR(ia_params->LJCOS_sig/r_off);
+      frac6 = frac2*frac2*frac2;
+      return 48.0 * ia_params->LJCOS_eps * frac6*(frac6 - 0.5) / (r_off * dist);
+    }
+  }
+  return 0.0;
+}
+
 MDINLINE double ljcos_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
 				double d[3], double dist)
 {
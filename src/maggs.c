@@ -448,6 +448,11 @@ int maggs_sanity_checks()
     ERROR_SPRINTF(errtxt, "{306 MEMD requires no Verlet Lists.} ");
     ret = -1;
   }
+  else if (dd.use_eighth_shell) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt, "{310 MEMD requires full shell ghost communication.} ");
+    ret = -1;
+  }
   /** check if speed of light parameter makes sense */
   else if (maggs.f_mass < 2. * time_step * time_step * maggs.a * maggs.a) {
     errtxt = runtime_error(128);
@@ -48,6 +48,9 @@
 /** Granularity of the radius scan in multiples of box_l[2] */
 #define RAD_STEPPING 0.1
 
+/** maximal number of grid points of the interaction table */
+#define MAXIMAL_TABLE (1 << 20)
+
 /** if you define this, the Besselfunctions are calculated up
     to machine precision, otherwise 10^-14, which should be
     definitely enough for daily life. */
@@ -60,10 +63,25 @@
 
 /** inverse box dimensions and other constants */
 /*@{*/
-static double uz, L2, uz2, prefuz2, prefL3_i;
+static double uz, L2, uz2;
 /*@}*/
 
-MMM1D_struct mmm1d_params = { 0.05, 5, 1, 1e-5 };
+/** the tabulated interaction without the direct term and the
+    prefactor, see \ref MMM1D_struct::table. For each grid point in
+    the xy-distance rho and |z|, the radial and axial force and the
+    energy are stored. */
+static struct {
+  /** number of grid points in rho and z */
+  int n[2];
+  /** inverse grid spacings */
+  double hi[2];
+  /** box and error the table was calculated for */
+  double box_l[3], maxPWerror;
+  /** the table, or NULL if not tabulated */
+  double *data;
+} table = { {0, 0}, {0, 0}, {0, 0, 0}, 0, NULL };
+
+MMM1D_struct mmm1d_params = { 0.05, 5, 1, 1e-5, 0 };
 
 int tclprint_to_result_MMM1D(Tcl_Interp *interp)
 {
@@ -75,6 +93,8 @@ int tclprint_to_result_MMM1D(Tcl_Interp *interp)
   Tcl_AppendResult(interp, buffer, " ",(char *) NULL);
   Tcl_PrintDouble(interp, mmm1d_params.maxPWerror, buffer);
   Tcl_AppendResult(interp, buffer,(char *) NULL);
+  if (mmm1d_params.table)
+    Tcl_AppendResult(interp, " table", (char *) NULL);
 
   return TCL_OK;
 }
@@ -82,11 +102,16 @@ int tclprint_to_result_MMM1D(Tcl_Interp *interp)
 int tclcommand_inter_coulomb_parse_mmm1d(Tcl_Interp *interp, int argc, char **argv)
 {
   double switch_rad, maxPWerror;
-  int bessel_cutoff;
+  int bessel_cutoff, use_table = 0;
+
+  if (argc >= 1 && ARG_IS_S(argc - 1, "table")) {
+    use_table = 1;
+    argc--;
+  }
 
   if (argc < 2) {
     Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm1d <switch radius> "
-		     "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error>", (char *) NULL);
+		     "{<bessel cutoff>} <maximal error for near formula> {table} | tune  <maximal pairwise error> {table}", (char *) NULL);
     return TCL_ERROR;
   }
 
@@ -119,7 +144,7 @@ int tclcommand_inter_coulomb_parse_mmm1d(Tcl_Interp *interp, int argc, char **ar
     }
     else {
       Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm1d <switch radius> "
-		       "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error>", (char *) NULL);
+		       "{<bessel cutoff>} <maximal error for near formula> {table} | tune  <maximal pairwise error> {table}", (char *) NULL);
       return TCL_ERROR;
     }
     
@@ -129,6 +154,7 @@ int tclcommand_inter_coulomb_parse_mmm1d(Tcl_Interp *interp, int argc, char **ar
     }
   }
 
+  mmm1d_params.table = use_table;
   MMM1D_set_params(switch_rad, bessel_cutoff, maxPWerror);
   return tclcommand_inter_coulomb_print_mmm1d_parameteres(interp);
 }
@@ -138,8 +164,6 @@ static void MMM1D_setup_constants()
   uz  = 1/box_l[2];
   L2   = box_l[2]*box_l[2];
   uz2 = uz*uz;
-  prefuz2 = coulomb.prefactor*uz2;
-  prefL3_i = prefuz2*uz;
 }
 
 double determine_bessel_cutoff(double switch_rad, double maxPWerror, int maxP)
@@ -247,12 +271,14 @@ int tclcommand_inter_coulomb_print_mmm1d_parameteres(Tcl_Interp *interp)
   return TCL_OK;
 }
 
-void MMM1D_recalcTables()
+/** create the polygamma taylor series up to the order required
+    for the given error at xy-distances up to sqrt(rhomax2)*box_l[2]. */
+static void create_psi_series(double rhomax2, double error)
 {
   /* polygamma, determine order */
   int n;
   double err;
-  double rhomax2nm2, rhomax2 = uz2*mmm1d_params.far_switch_radius_2;
+  double rhomax2nm2;
   /* rhomax2 < 1, so rhomax2m2 falls monotonously */
 
   n = 1;
@@ -266,7 +292,12 @@ void MMM1D_recalcTables()
     n++;
     // fprintf(stderr, "%f\n", err);
   }
-  while (err > 0.1*mmm1d_params.maxPWerror);
+  while (err > 0.1*error);
+}
+
+void MMM1D_recalcTables()
+{
+  create_psi_series(uz2*mmm1d_params.far_switch_radius_2, mmm1d_params.maxPWerror);
 }
 
 int MMM1D_sanity_checks()
@@ -286,6 +317,303 @@ int MMM1D_sanity_checks()
   return 0;
 }
 
+/* pair interaction without the direct term and the prefactor. The radial
+   force is always divided by the xy-distance. */
+/************************************************************/
+
+/** near formula force, the polygamma series is summed up to the given error */
+static void calc_near_force(double rxy2, double z, double error, double *Fr, double *Fz)
+{
+  double rxy2_d = rxy2*uz2, z_d = z*uz;
+  double sr, sz, r2nm1, rt, rt2, shift_z;
+  int n;
+
+  /* polygamma summation */
+  sr = 0;
+  sz = mod_psi_odd(0, z_d);
+
+  r2nm1 = 1.0;
+  for (n = 1; n < n_modPsi; n++) {
+    double deriv = 2*n;
+    double mpe   = mod_psi_even(n, z_d);
+    double mpo   = mod_psi_odd(n, z_d);
+    double r2n   = r2nm1*rxy2_d;
+
+    sz +=         r2n*mpo;
+    sr += deriv*r2nm1*mpe;
+
+    if (fabs(deriv*r2nm1*mpe) < error)
+      break;
+
+    r2nm1 = r2n;
+  }
+
+  *Fr = uz2*uz*sr;
+  *Fz = uz2*sz;
+
+  /* real space parts */
+
+  shift_z = z + box_l[2];
+  rt2 = rxy2 + shift_z*shift_z;
+  rt  = sqrt(rt2);
+  *Fr += 1/(rt2*rt);
+  *Fz += shift_z/(rt2*rt);
+
+  shift_z = z - box_l[2];
+  rt2 = rxy2 + shift_z*shift_z;
+  rt  = sqrt(rt2);
+  *Fr += 1/(rt2*rt);
+  *Fz += shift_z/(rt2*rt);
+}
+
+/** far formula force with the given Bessel cutoff */
+static void calc_far_force(double rxy2, double z, int bessel_cutoff, double *Fr, double *Fz)
+{
+  double rxy   = sqrt(rxy2);
+  double rxy_d = rxy*uz, z_d = z*uz;
+  double r2 = rxy2 + z*z, r3 = r2*sqrt(r2);
+  double sr = 0, sz = 0;
+  int bp;
+
+  for (bp = 1; bp < bessel_cutoff; bp++) {
+    double fq = C_2PI*bp, k0, k1;
+#ifdef BESSEL_MACHINE_PREC
+    k0 = K0(fq*rxy_d);
+    k1 = K1(fq*rxy_d);
+#else
+    LPK01(fq*rxy_d, &k0, &k1);
+#endif
+    sr += bp*k1*cos(fq*z_d);
+    sz += bp*k0*sin(fq*z_d);
+  }
+  sr *= uz2*4*C_2PI;
+  sz *= uz2*4*C_2PI;
+
+  /* the far formula contains the direct interaction, which is added
+     separately */
+  *Fr = sr/rxy + 2*uz/rxy2 - 1/r3;
+  *Fz = sz - z/r3;
+}
+
+/** near formula energy, the polygamma series is summed up to the given error */
+static double calc_near_energy(double rxy2, double z, double error)
+{
+  double rxy2_d = rxy2*uz2, z_d = z*uz;
+  double E, r2n, rt, shift_z;
+  int n;
+
+  E = -2*C_GAMMA;
+
+  /* polygamma summation */
+  r2n = 1.0;
+  for (n = 0; n < n_modPsi; n++) {
+    double add = mod_psi_even(n, z_d)*r2n;
+    E -= add;
+      
+    if (fabs(add) < error)
+      break;
+ 
+    r2n *= rxy2_d;
+  }
+  E *= uz;
+
+  /* real space parts */
+
+  shift_z = z + box_l[2];
+  rt = sqrt(rxy2 + shift_z*shift_z);
+  E += 1/rt; 
+
+  shift_z = z - box_l[2];
+  rt = sqrt(rxy2 + shift_z*shift_z);
+  E += 1/rt; 
+
+  return E;
+}
+
+/** far formula energy with the given Bessel cutoff */
+static double calc_far_energy(double rxy2, double z, int bessel_cutoff)
+{
+  double rxy2_d = rxy2*uz2;
+  double rxy_d  = sqrt(rxy2_d), z_d = z*uz;
+  double E;
+  int bp;
+
+  /* The first Bessel term will compensate a little bit the
+     log term, so add them close together */
+  E = -0.25*log(rxy2_d) + 0.5*(M_LN2 - C_GAMMA);
+  for (bp = 1; bp < bessel_cutoff; bp++) {
+    double fq = C_2PI*bp;
+    E += K0(fq*rxy_d)*cos(fq*z_d);
+  }
+  E *= 4*uz;
+
+  /* the far formula contains the direct interaction, which is added
+     separately */
+  return E - 1/sqrt(rxy2 + z*z);
+}
+
+/** interpolates the tabulated interaction, where Fr is the radial
+    force. Returns 0 if the distance is not tabulated. */
+MDINLINE int table_lookup(double rxy, double z, double *Fr, double *Fz, double *E)
+{
+  double a[2] = { rxy*table.hi[0], fabs(z)*table.hi[1] };
+  double t, w[2][4], v[3] = {0, 0, 0}, *e;
+  int i, j, c, ind[2];
+
+  if (!table.data)
+    return 0;
+
+  for (i = 0; i < 2; i++) {
+    if (a[i] > table.n[i] - 1)
+      return 0;
+    /* four point Lagrange interpolation, the stencil is shifted inside
+       at the borders */
+    ind[i] = (int)a[i] - 1;
+    if (ind[i] < 0)
+      ind[i] = 0;
+    if (ind[i] > table.n[i] - 4)
+      ind[i] = table.n[i] - 4;
+    t = a[i] - ind[i];
+    w[i][0] = -(t - 1)*(t - 2)*(t - 3)/6;
+    w[i][1] =        t*(t - 2)*(t - 3)/2;
+    w[i][2] =       -t*(t - 1)*(t - 3)/2;
+    w[i][3] =        t*(t - 1)*(t - 2)/6;
+  }
+
+  for (i = 0; i < 4; i++) {
+    e = table.data + 3*((ind[0] + i)*table.n[1] + ind[1]);
+    for (j = 0; j < 4; j++)
+      for (c = 0; c < 3; c++)
+	v[c] += w[0][i]*w[1][j]*e[3*j + c];
+  }
+
+  /* the axial force is odd in z, the energy even */
+  *Fr = v[0];
+  *Fz = (z < 0) ? -v[1] : v[1];
+  *E  = v[2];
+  return 1;
+}
+
+/** the exact interaction at the given distance as it is tabulated,
+    that is the radial force times rxy, the axial force and the
+    energy. Below the switching radius, the near formula is used. */
+static void table_exact(double rxy, double z, double switch_rad, double error,
+			int bessel_cutoff, double F[3])
+{
+  double Fr, Fz;
+
+  if (rxy <= switch_rad) {
+    calc_near_force(SQR(rxy), z, error, &Fr, &Fz);
+    F[2] = calc_near_energy(SQR(rxy), z, error);
+  }
+  else {
+    calc_far_force(SQR(rxy), z, bessel_cutoff, &Fr, &Fz);
+    F[2] = calc_far_energy(SQR(rxy), z, bessel_cutoff);
+  }
+  F[0] = Fr*rxy;
+  F[1] = Fz;
+}
+
+/** tabulates the interaction for \ref MMM1D_struct::table. The
+    table values are calculated with a switching radius of box_l[2]/2
+    and a hundred times smaller error than required, and the grid is
+    refined until the interpolation error is below a tenth of the
+    maximal pairwise error in all grid cells. The error is checked at
+    the center of every cell, and additionally at the quarter points
+    of the cells at the borders, where the interpolation stencil is
+    shifted, and of the cells containing the switching radius. If
+    the table needs more than \ref MAXIMAL_TABLE points or the Bessel
+    cutoff for the far formula cannot be reached, the table is
+    switched off with an error. */
+static void MMM1D_setup_table()
+{
+  static const double offset[3] = { 0.5, 0.25, 0.75 };
+  double ext[2] = { sqrt(SQR(box_l[0]) + SQR(box_l[1])), 0.5*box_l[2] };
+  double error = 0.01*mmm1d_params.maxPWerror, target = 0.1*mmm1d_params.maxPWerror;
+  double h, hg[2], err, rxy, z, F[3], Ft[3], *e;
+  int i, j, a, b, na, nb, n_points, bessel_cutoff;
+  char *errtxt;
+
+  if (!mmm1d_params.table) {
+    free(table.data);
+    table.data = NULL;
+    table.maxPWerror = 0;
+    return;
+  }
+  if (table.box_l[0] == box_l[0] && table.box_l[1] == box_l[1] &&
+      table.box_l[2] == box_l[2] && table.maxPWerror == mmm1d_params.maxPWerror)
+    return;
+
+  for (i = 0; i < 3; i++)
+    table.box_l[i] = box_l[i];
+  table.maxPWerror = mmm1d_params.maxPWerror;
+  free(table.data);
+  table.data = NULL;
+
+  bessel_cutoff = determine_bessel_cutoff(ext[1], error, MAXIMAL_B_CUT);
+  if (bessel_cutoff == MAXIMAL_B_CUT) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt, "{320 MMM1D table: could not find reasonable Bessel cutoff, switched off} ");
+    table.maxPWerror = 0;
+    mmm1d_params.table = 0;
+    return;
+  }
+  create_psi_series(0.25, error);
+
+  h = ext[1]/4;
+  for (;;) {
+    n_points = 1;
+    for (i = 0; i < 2; i++) {
+      table.n[i] = imax(4, (int)ceil(ext[i]/h) + 1);
+      hg[i] = ext[i]/(table.n[i] - 1);
+      table.hi[i] = 1/hg[i];
+      n_points *= table.n[i];
+    }
+    if (n_points > MAXIMAL_TABLE) {
+      errtxt = runtime_error(128 + TCL_INTEGER_SPACE);
+      ERROR_SPRINTF(errtxt, "{320 MMM1D table would need more than %d points, switched off} ",
+		    MAXIMAL_TABLE);
+      free(table.data);
+      table.data = NULL;
+      table.maxPWerror = 0;
+      mmm1d_params.table = 0;
+      return;
+    }
+
+    table.data = realloc(table.data, 3*n_points*sizeof(double));
+    e = table.data;
+    for (i = 0; i < table.n[0]; i++)
+      for (j = 0; j < table.n[1]; j++) {
+	table_exact(i*hg[0], j*hg[1], ext[1], error, bessel_cutoff, e);
+	e += 3;
+      }
+
+    err = 0;
+    for (i = 0; i < table.n[0] - 1; i++) {
+      na = (i == 0 || i == table.n[0] - 2 ||
+	    (i*hg[0] <= ext[1] && (i + 1)*hg[0] > ext[1])) ? 3 : 1;
+      for (j = 0; j < table.n[1] - 1; j++) {
+	nb = (j == 0 || j == table.n[1] - 2) ? 3 : 1;
+	for (a = 0; a < na; a++)
+	  for (b = 0; b < nb; b++) {
+	    rxy = (i + offset[a])*hg[0];
+	    z   = (j + offset[b])*hg[1];
+	    if (!table_lookup(rxy, z, &F[0], &F[1], &F[2]))
+	      continue;
+	    table_exact(rxy, z, ext[1], error, bessel_cutoff, Ft);
+	    err = dmax(err, fabs(F[0] - Ft[0]));
+	    err = dmax(err, fabs(F[1] - Ft[1]));
+	    err = dmax(err, fabs(F[2] - Ft[2]));
+	  }
+      }
+    }
+    if (err <= target)
+      break;
+    /* the interpolation error decreases with the fourth power of the spacing */
+    h *= 0.9*pow(target/err, 0.25);
+  }
+}
+
 void MMM1D_init()
 {
   if (MMM1D_sanity_checks()) return;
@@ -299,174 +627,59 @@ void MMM1D_init()
     mmm1d_params.bessel_cutoff = determine_bessel_cutoff(sqrt(mmm1d_params.far_switch_radius_2), mmm1d_params.maxPWerror, MAXIMAL_B_CUT);
   }
   MMM1D_recalcTables();
+  MMM1D_setup_table();
 }
 
 void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], double r2, double r, double force[3])
 {
-  int dim;
-  double F[3];
   double chpref = p1->p.q*p2->p.q;
-  double rxy2, rxy2_d, z_d;
-  double pref;
-  double Fx, Fy, Fz;
+  double rxy2, rxy, Fr, Fz, E, pref;
   
   if (chpref == 0)
     return;
 
-  rxy2   = d[0]*d[0] + d[1]*d[1];
-  rxy2_d = rxy2*uz2;
-  z_d    = d[2]*uz;
-
-  if (rxy2 <= mmm1d_params.far_switch_radius_2) {
-    /* near range formula */
-    double sr, sz, r2nm1, rt, rt2, shift_z;
-    int n;
-
-    /* polygamma summation */
-    sr = 0;
-    sz = mod_psi_odd(0, z_d);
+  rxy2 = d[0]*d[0] + d[1]*d[1];
+  rxy  = sqrt(rxy2);
 
-    r2nm1 = 1.0;
-    for (n = 1; n < n_modPsi; n++) {
-      double deriv = 2*n;
-      double mpe   = mod_psi_even(n, z_d);
-      double mpo   = mod_psi_odd(n, z_d);
-      double r2n   = r2nm1*rxy2_d;
-
-      sz +=         r2n*mpo;
-      sr += deriv*r2nm1*mpe;
-
-      if (fabs(deriv*r2nm1*mpe) < mmm1d_params.maxPWerror)
-	break;
-
-      r2nm1 = r2n;
-    }
-    // fprintf(stderr, "max_n %d\n", n);
-
-    Fx = prefL3_i*sr*d[0];
-    Fy = prefL3_i*sr*d[1];
-    Fz = prefuz2*sz;
-
-    /* real space parts */
-
-    pref = coulomb.prefactor/(r2*r); 
-    Fx += pref*d[0];
-    Fy += pref*d[1];
-    Fz += pref*d[2];
-
-    shift_z = d[2] + box_l[2];
-    rt2 = rxy2 + shift_z*shift_z;
-    rt  = sqrt(rt2);
-    pref = coulomb.prefactor/(rt2*rt); 
-    Fx += pref*d[0];
-    Fy += pref*d[1];
-    Fz += pref*shift_z;
-
-    shift_z = d[2] - box_l[2];
-    rt2 = rxy2 + shift_z*shift_z;
-    rt  = sqrt(rt2);
-    pref = coulomb.prefactor/(rt2*rt); 
-    Fx += pref*d[0];
-    Fy += pref*d[1];
-    Fz += pref*shift_z;
-
-    F[0] = Fx;
-    F[1] = Fy;
-    F[2] = Fz;
-  }
-  else {
-    /* far range formula */
-    double rxy   = sqrt(rxy2);
-    double rxy_d = rxy*uz;
-    double sr = 0, sz = 0;
-    int bp;
-
-    for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
-      double fq = C_2PI*bp, k0, k1;
-#ifdef BESSEL_MACHINE_PREC
-      k0 = K0(fq*rxy_d);
-      k1 = K1(fq*rxy_d);
-#else
-      LPK01(fq*rxy_d, &k0, &k1);
-#endif
-      sr += bp*k1*cos(fq*z_d);
-      sz += bp*k0*sin(fq*z_d);
-    }
-    sr *= uz2*4*C_2PI;
-    sz *= uz2*4*C_2PI;
-    
-    pref = coulomb.prefactor*(sr/rxy + 2*uz/rxy2);
+  if (table_lookup(rxy, d[2], &Fr, &Fz, &E))
+    Fr = (rxy > 0) ? Fr/rxy : 0;
+  else if (rxy2 <= mmm1d_params.far_switch_radius_2)
+    calc_near_force(rxy2, d[2], mmm1d_params.maxPWerror, &Fr, &Fz);
+  else
+    calc_far_force(rxy2, d[2], mmm1d_params.bessel_cutoff, &Fr, &Fz);
 
-    F[0] = pref*d[0];
-    F[1] = pref*d[1];
-    F[2] = coulomb.prefactor*sz;
-  }
+  /* direct interaction */
+  pref = 1/(r2*r);
+  Fr += pref;
+  Fz += pref*d[2];
 
-  for (dim = 0; dim < 3; dim++)
-    force[dim] += chpref * F[dim];
+  chpref *= coulomb.prefactor;
+  force[0] += chpref*Fr*d[0];
+  force[1] += chpref*Fr*d[1];
+  force[2] += chpref*Fz;
 }
 
 double mmm1d_coulomb_pair_energy(Particle *p1, Particle *p2, double d[3], double r2, double r)
 {
   double chpref = p1->p.q*p2->p.q;
-  double rxy2, rxy2_d, z_d;
-  double E;
+  double rxy2, Fr, Fz, E;
 
   if (chpref == 0)
     return 0;
 
-  rxy2   = d[0]*d[0] + d[1]*d[1];
-  rxy2_d = rxy2*uz2;
-  z_d    = d[2]*uz;
+  rxy2 = d[0]*d[0] + d[1]*d[1];
 
-  if (rxy2 <= mmm1d_params.far_switch_radius_2) {
-    /* near range formula */
-    double r2n, rt, shift_z;
-    int n;
-
-    E = -2*C_GAMMA;
-
-    /* polygamma summation */
-    r2n = 1.0;
-    for (n = 0; n < n_modPsi; n++) {
-      double add = mod_psi_even(n, z_d)*r2n;
-      E -= add;
-      
-      if (fabs(add) < mmm1d_params.maxPWerror)
-	break;
- 
-      r2n *= rxy2_d;
-    }
-    E *= coulomb.prefactor*uz;
-
-    /* real space parts */
-
-    E += coulomb.prefactor/r; 
-
-    shift_z = d[2] + box_l[2];
-    rt = sqrt(rxy2 + shift_z*shift_z);
-    E += coulomb.prefactor/rt; 
-
-    shift_z = d[2] - box_l[2];
-    rt = sqrt(rxy2 + shift_z*shift_z);
-    E += coulomb.prefactor/rt; 
-  }
-  else {
-    /* far range formula */
-    double rxy   = sqrt(rxy2);
-    double rxy_d = rxy*uz;
-    int bp;
-    /* The first Bessel term will compensate a little bit the
-       log term, so add them close together */
-    E = -0.25*log(rxy2_d) + 0.5*(M_LN2 - C_GAMMA);
-    for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
-      double fq = C_2PI*bp;
-      E += K0(fq*rxy_d)*cos(fq*z_d);
-    }
-    E *= 4*coulomb.prefactor*uz;
+  if (!table_lookup(sqrt(rxy2), d[2], &Fr, &Fz, &E)) {
+    if (rxy2 <= mmm1d_params.far_switch_radius_2)
+      E = calc_near_energy(rxy2, d[2], mmm1d_params.maxPWerror);
+    else
+      E = calc_far_energy(rxy2, d[2], mmm1d_params.bessel_cutoff);
   }
 
-  return chpref*E;
+  /* direct interaction */
+  E += 1/r;
+
+  return chpref*coulomb.prefactor*E;
 }
 
 #endif
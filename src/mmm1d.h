@@ -49,6 +49,10 @@ typedef struct {
   int    bessel_calculated;
   /** required accuracy */
   double maxPWerror;
+  /** if nonzero, the interaction is interpolated from a table, which
+      is calculated to the required accuracy at initialization. Reset
+      if the table cannot be calculated. */
+  int table;
 } MMM1D_struct;
 extern MMM1D_struct mmm1d_params;
 
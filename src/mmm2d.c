@@ -63,6 +63,9 @@
     with this value. */
 #define MAXIMAL_FAR_CUT 100
 
+/** maximal number of far formula modes whose sums are communicated together */
+#define MODE_BLOCK 32
+
 /** Largest reasonable cutoff for Bessel function. The Bessel functions
     are quite slow, so do not make too large. */
 #define MAXIMAL_B_CUT 50
@@ -79,6 +82,9 @@
     that would not make things faster */
 #define FARRELPREC 1e-6
 
+/** maximal number of grid points of the tabulated near formula */
+#define MAXIMAL_NEAR_TABLE (1 << 20)
+
 /** number of steps in the complex cutoff table */
 #define COMPLEX_STEP 16
 /** map numbers from 0 to 1/2 onto the complex cutoff table
@@ -115,7 +121,21 @@ static double max_near, min_far;
 ///
 static double self_energy;
 
-MMM2D_struct mmm2d_params = { 1e100, 10, 1, 0, 0, 1, 1, 1 };
+/** the tabulated near formula without the direct interaction, see
+    \ref MMM2D_struct::near_table. By symmetry, only positive distances
+    are tabulated. */
+static struct {
+  /** number of grid points in each direction */
+  int n[3];
+  /** inverse grid spacings */
+  double hi[3];
+  /** box, z range and error the table was calculated for */
+  double box_l[2], max_near, maxPWerror;
+  /** force and energy per grid point, or NULL if not tabulated */
+  double *data;
+} near_table = { {0, 0, 0}, {0, 0, 0}, {0, 0}, 0, 0, NULL };
+
+MMM2D_struct mmm2d_params = { 1e100, 10, 1, 0, 0, 1, 1, 1, 0 };
 
 /** return codes for \ref MMM2D_tune_near and \ref MMM2D_tune_far */
 /*@{*/
@@ -194,7 +214,36 @@ static double *lclcblk = NULL;
 static double *gblcblk = NULL;
 
 /** contribution from the image charges */
-static double lclimge[8]; 
+static double *lclimge = NULL;
+
+/** \name storage of the above blocks for \ref MODE_BLOCK modes. The
+    pointers above point to the blocks of the mode currently worked on. */
+/*@{*/
+static double *partblks = NULL;
+static double *lclcblks = NULL;
+static double *gblcblks = NULL;
+static double lclimges[8*MODE_BLOCK];
+/*@}*/
+
+/** a far formula mode waiting for the communication of its sums */
+typedef struct {
+  int p, q;
+  /** calculate the energy rather than the force */
+  int energy;
+  /** whether the image charge contributions have to be gathered */
+  int images;
+  /** size of the top or bottom half of the sums */
+  int e_size;
+  double omega, fac;
+} FarMode;
+
+/** \name modes queued for the next communication */
+/*@{*/
+static FarMode modes[MODE_BLOCK];
+static int n_modes = 0;
+/** total number of values per layer of all queued modes */
+static int modes_size = 0;
+/*@}*/
 
 typedef struct {
   double s, c;
@@ -230,12 +279,13 @@ void MMM2D_self_energy();
 /** sin/cos storage */
 static void prepare_scx_cache();
 static void prepare_scy_cache();
-/** clear the image contributions if there is no dielectric contrast and no image charges */
-static void clear_image_contributions(int size);
-/** gather the informations for the far away image charges */
-static void gather_image_contributions(int size);
-/** spread the top/bottom sums */
-static void distribute(int size, double fac);
+/** make a queued mode the current one */
+static void select_mode(int m);
+/** gather the informations for the far away image charges of all
+    queued modes, or clear them if there is no dielectric contrast */
+static void gather_image_contributions();
+/** spread the top/bottom sums of all queued modes */
+static void distribute();
 /** 2 pi |z| code */
 static void setup_z_force();
 static void setup_z_energy();
@@ -400,43 +450,63 @@ MDINLINE double *abventry(double *p, int index, int e_size)
   return &p[(2*index + 1)*e_size];
 }
 
-/* dealing with the image contributions from far outside the simulation box */
-
-void clear_image_contributions(int e_size)
+void select_mode(int m)
 {
-  if (this_node == 0)
-    /* the gblcblk contains all contributions from layers deeper than one layer below our system,
-       which is precisely what the gblcblk should contain for the lowest layer. */
-    clear_vec(blwentry(gblcblk, 0, e_size), e_size);
-
-  if (this_node == n_nodes - 1)
-    /* same for the top node */
-    clear_vec(abventry(gblcblk, n_layers - 1, e_size), e_size);
+  partblk = block(partblks, m, 8*n_localpart);
+  lclcblk = block(lclcblks, m, 8*n_cells);
+  gblcblk = block(gblcblks, m, 8*n_layers);
+  lclimge = block(lclimges, m, 8);
 }
 
-void gather_image_contributions(int e_size)
+/* dealing with the image contributions from far outside the simulation box */
+
+void gather_image_contributions()
 {
-  double recvbuf[8];
+  double sendbuf[8*MODE_BLOCK];
+  double recvbuf[8*MODE_BLOCK];
+  int m, e_size, size = 0;
 
   /* collect the image charge contributions with at least a layer distance */
-  MPI_Allreduce(lclimge, recvbuf, 2*e_size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-
-  if (this_node == 0)
-    /* the gblcblk contains all contributions from layers deeper than one layer below our system,
-       which is precisely what the gblcblk should contain for the lowest layer. */
-    copy_vec(blwentry(gblcblk, 0, e_size),recvbuf, e_size);
+  for (m = 0; m < n_modes; m++)
+    if (modes[m].images) {
+      copy_vec(sendbuf + size, block(lclimges, m, 8), 2*modes[m].e_size);
+      size += 2*modes[m].e_size;
+    }
+  if (size > 0)
+    MPI_Allreduce(sendbuf, recvbuf, size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  size = 0;
+  for (m = 0; m < n_modes; m++) {
+    select_mode(m);
+    e_size = modes[m].e_size;
+    if (modes[m].images) {
+      if (this_node == 0)
+	/* the gblcblk contains all contributions from layers deeper than one layer below our system,
+	   which is precisely what the gblcblk should contain for the lowest layer. */
+	copy_vec(blwentry(gblcblk, 0, e_size), recvbuf + size, e_size);
+
+      if (this_node == n_nodes - 1)
+	/* same for the top node */
+	copy_vec(abventry(gblcblk, n_layers - 1, e_size), recvbuf + size + e_size, e_size);
+      size += 2*e_size;
+    }
+    else {
+      if (this_node == 0)
+	clear_vec(blwentry(gblcblk, 0, e_size), e_size);
 
-  if (this_node == n_nodes - 1)
-    /* same for the top node */
-    copy_vec(abventry(gblcblk, n_layers - 1, e_size), recvbuf + e_size, e_size);
+      if (this_node == n_nodes - 1)
+	clear_vec(abventry(gblcblk, n_layers - 1, e_size), e_size);
+    }
+  }
 }
 
-/* the data transfer routine for the lclcblks itself */
-void distribute(int e_size, double fac)
+/* the data transfer routine for the lclcblks itself. All queued modes are sent in one message. */
+void distribute()
 {
-  int c, node, inv_node;
-  double sendbuf[8];
-  double recvbuf[8];
+  int c, m, node, inv_node, e_size, o;
+  double fac;
+  double sendbuf[8*MODE_BLOCK];
+  double recvbuf[8*MODE_BLOCK];
   MPI_Status status;
 
   /* send/recv to/from other nodes. Also builds up the gblcblk. */
@@ -444,40 +514,60 @@ void distribute(int e_size, double fac)
     inv_node = n_nodes - node - 1;
     /* up */
     if (node == this_node) {
-      /* calculate sums of cells below */
-      for (c = 1; c < n_layers; c++)
-	addscale_vec(blwentry(gblcblk, c, e_size), fac, blwentry(gblcblk, c - 1, e_size), blwentry(lclcblk, c - 1, e_size), e_size);
-
-      /* calculate my ghost contribution only if a node above exists */
-      if (node + 1 < n_nodes) {
-	addscale_vec(sendbuf, fac, blwentry(gblcblk, n_layers - 1, e_size), blwentry(lclcblk, n_layers - 1, e_size), e_size);
-	copy_vec(sendbuf + e_size, blwentry(lclcblk, n_layers, e_size), e_size);
-	MPI_Send(sendbuf, 2*e_size, MPI_DOUBLE, node + 1, 0, MPI_COMM_WORLD);
+      for (m = 0, o = 0; m < n_modes; m++, o += 2*e_size) {
+	select_mode(m);
+	e_size = modes[m].e_size;
+	fac = modes[m].fac;
+	/* calculate sums of cells below */
+	for (c = 1; c < n_layers; c++)
+	  addscale_vec(blwentry(gblcblk, c, e_size), fac, blwentry(gblcblk, c - 1, e_size), blwentry(lclcblk, c - 1, e_size), e_size);
+
+	/* calculate my ghost contribution only if a node above exists */
+	if (node + 1 < n_nodes) {
+	  addscale_vec(sendbuf + o, fac, blwentry(gblcblk, n_layers - 1, e_size), blwentry(lclcblk, n_layers - 1, e_size), e_size);
+	  copy_vec(sendbuf + o + e_size, blwentry(lclcblk, n_layers, e_size), e_size);
+	}
       }
+      if (node + 1 < n_nodes)
+	MPI_Send(sendbuf, modes_size, MPI_DOUBLE, node + 1, 0, MPI_COMM_WORLD);
     }
     else if (node + 1 == this_node) {
-      MPI_Recv(recvbuf, 2*e_size, MPI_DOUBLE, node, 0, MPI_COMM_WORLD, &status);
-      copy_vec(blwentry(gblcblk, 0, e_size), recvbuf, e_size);
-      copy_vec(blwentry(lclcblk, 0, e_size), recvbuf + e_size, e_size);
+      MPI_Recv(recvbuf, modes_size, MPI_DOUBLE, node, 0, MPI_COMM_WORLD, &status);
+      for (m = 0, o = 0; m < n_modes; m++, o += 2*e_size) {
+	select_mode(m);
+	e_size = modes[m].e_size;
+	copy_vec(blwentry(gblcblk, 0, e_size), recvbuf + o, e_size);
+	copy_vec(blwentry(lclcblk, 0, e_size), recvbuf + o + e_size, e_size);
+      }
     }
 
     /* down */
     if (inv_node == this_node) {
-      /* calculate sums of all cells above */
-      for (c = n_layers + 1; c > 2; c--)
-	addscale_vec(abventry(gblcblk, c - 3, e_size), fac, abventry(gblcblk, c - 2, e_size), abventry(lclcblk, c, e_size), e_size);
+      for (m = 0, o = 0; m < n_modes; m++, o += 2*e_size) {
+	select_mode(m);
+	e_size = modes[m].e_size;
+	fac = modes[m].fac;
+	/* calculate sums of all cells above */
+	for (c = n_layers + 1; c > 2; c--)
+	  addscale_vec(abventry(gblcblk, c - 3, e_size), fac, abventry(gblcblk, c - 2, e_size), abventry(lclcblk, c, e_size), e_size);
       
-      /* calculate my ghost contribution only if a node below exists */
-      if (inv_node -  1 >= 0) {
-	addscale_vec(sendbuf, fac, abventry(gblcblk, 0, e_size), abventry(lclcblk, 2, e_size), e_size);
-	copy_vec(sendbuf + e_size, abventry(lclcblk, 1, e_size), e_size);
-	MPI_Send(sendbuf, 2*e_size, MPI_DOUBLE, inv_node - 1, 0, MPI_COMM_WORLD);
+	/* calculate my ghost contribution only if a node below exists */
+	if (inv_node -  1 >= 0) {
+	  addscale_vec(sendbuf + o, fac, abventry(gblcblk, 0, e_size), abventry(lclcblk, 2, e_size), e_size);
+	  copy_vec(sendbuf + o + e_size, abventry(lclcblk, 1, e_size), e_size);
+	}
       }
+      if (inv_node -  1 >= 0)
+	MPI_Send(sendbuf, modes_size, MPI_DOUBLE, inv_node - 1, 0, MPI_COMM_WORLD);
     }
     else if (inv_node - 1 == this_node) {
-      MPI_Recv(recvbuf, 2*e_size, MPI_DOUBLE, inv_node, 0, MPI_COMM_WORLD, &status);
-      copy_vec(abventry(gblcblk, n_layers - 1, e_size), recvbuf, e_size);
-      copy_vec(abventry(lclcblk, n_layers + 1, e_size), recvbuf + e_size, e_size);
+      MPI_Recv(recvbuf, modes_size, MPI_DOUBLE, inv_node, 0, MPI_COMM_WORLD, &status);
+      for (m = 0, o = 0; m < n_modes; m++, o += 2*e_size) {
+	select_mode(m);
+	e_size = modes[m].e_size;
+	copy_vec(abventry(gblcblk, n_layers - 1, e_size), recvbuf + o, e_size);
+	copy_vec(abventry(lclcblk, n_layers + 1, e_size), recvbuf + o + e_size, e_size);
+      }
     }
   }
 }
@@ -1199,115 +1289,126 @@ static double PQ_energy(double omega)
 /* main loops */
 /*****************************************************************/
 
-static void add_force_contribution(int p, int q)
+/** calculate the local sums of mode m */
+static void setup_mode(int m)
 {
-  double omega, fac;
-  
-  if (q == 0) {
-    if (p == 0) {
-      setup_z_force();
-
-      if (mmm2d_params.dielectric_contrast_on)
-	gather_image_contributions(1);
-      else
-	clear_image_contributions(1);
-
-      distribute(1, 1.);
-      add_z_force();
-      checkpoint("************2piz", 0, 0, 1);
+  FarMode *mode = &modes[m];
+  int p = mode->p, q = mode->q;
+
+  select_mode(m);
+  mode->images = mmm2d_params.dielectric_contrast_on;
+  if (q == 0 && p == 0) {
+    mode->fac = 1.;
+    if (mode->energy) {
+      setup_z_energy();
+      mode->e_size = 2;
+      mode->images = 0;
     }
     else {
-      omega = C_2PI*ux*p;
-      fac = exp(-omega*layer_h);
-      setup_P(p, omega, fac);
-      if (mmm2d_params.dielectric_contrast_on)
-	gather_image_contributions(2);
-      else
-	clear_image_contributions(2);
-      distribute(2, fac); 
-      add_P_force();
-      checkpoint("************distri p", p, 0, 2);
+      setup_z_force();
+      mode->e_size = 1;
     }
+    return;
+  }
+
+  if (q == 0)
+    mode->omega = C_2PI*ux*p;
+  else if (p == 0)
+    mode->omega = C_2PI*uy*q;
+  else
+    mode->omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
+  mode->fac = exp(-mode->omega*layer_h);
+
+  if (q == 0) {
+    setup_P(p, mode->omega, mode->fac);
+    mode->e_size = 2;
   }
   else if (p == 0) {
-    omega = C_2PI*uy*q;
-    fac = exp(-omega*layer_h);
-    setup_Q(q, omega, fac);
-    if (mmm2d_params.dielectric_contrast_on)
-      gather_image_contributions(2);
-    else
-      clear_image_contributions(2);
-    distribute(2, fac);
-    add_Q_force();
-    checkpoint("************distri q", 0, q, 2);
+    setup_Q(q, mode->omega, mode->fac);
+    mode->e_size = 2;
   }
   else {
-    omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-    fac = exp(-omega*layer_h);
-    setup_PQ(p, q, omega, fac);
-    if (mmm2d_params.dielectric_contrast_on)
-      gather_image_contributions(4);
-    else
-      clear_image_contributions(4);
-    distribute(4, fac);
-    add_PQ_force(p, q, omega);
-    checkpoint("************distri pq", p, q, 4);
+    setup_PQ(p, q, mode->omega, mode->fac);
+    mode->e_size = 4;
   }
 }
 
-static double energy_contribution(int p, int q)
+/** add the force of mode m or return its energy */
+static double apply_mode(int m)
 {
-  double eng;
-  double omega, fac;
-  
+  FarMode *mode = &modes[m];
+  int p = mode->p, q = mode->q;
+  double eng = 0;
+
+  select_mode(m);
   if (q == 0) {
     if (p == 0) {
-      setup_z_energy();
-      clear_image_contributions(2);
-      distribute(2, 1.);
-      eng = z_energy();
-      checkpoint("E************2piz", 0, 0, 2);
+      if (mode->energy)
+	eng = z_energy();
+      else
+	add_z_force();
+      checkpoint("************2piz", 0, 0, mode->e_size);
     }
     else {
-      omega = C_2PI*ux*p;
-      fac = exp(-omega*layer_h);
-      setup_P(p, omega, fac);
-      if (mmm2d_params.dielectric_contrast_on)
-	gather_image_contributions(2);
+      if (mode->energy)
+	eng = P_energy(mode->omega);
       else
-	clear_image_contributions(2);
-      distribute(2, fac);
-      eng = P_energy(omega);
+	add_P_force();
       checkpoint("************distri p", p, 0, 2);
     }
   }
   else if (p == 0) {
-    omega = C_2PI*uy*q;
-    fac = exp(-omega*layer_h);
-    setup_Q(q, omega, fac);
-    if (mmm2d_params.dielectric_contrast_on)
-      gather_image_contributions(2);
+    if (mode->energy)
+      eng = Q_energy(mode->omega);
     else
-      clear_image_contributions(2);
-    distribute(2, fac);
-    eng = Q_energy(omega);
+      add_Q_force();
     checkpoint("************distri q", 0, q, 2);
   }
   else {
-    omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-    fac = exp(-omega*layer_h);
-    setup_PQ(p, q, omega, fac);
-    if (mmm2d_params.dielectric_contrast_on)
-      gather_image_contributions(4);
+    if (mode->energy)
+      eng = PQ_energy(mode->omega);
     else
-      clear_image_contributions(4);
-    distribute(4, fac);
-    eng = PQ_energy(omega);
+      add_PQ_force(p, q, mode->omega);
     checkpoint("************distri pq", p, q, 4);
   }
   return eng;
 }
 
+/** calculate the sums of all queued modes, communicate them at once and
+    add the forces rsp. return the energy of the modes */
+static double process_modes()
+{
+  int m;
+  double eng = 0;
+
+  modes_size = 0;
+  for (m = 0; m < n_modes; m++) {
+    setup_mode(m);
+    modes_size += 2*modes[m].e_size;
+  }
+
+  gather_image_contributions();
+  distribute();
+
+  for (m = 0; m < n_modes; m++)
+    eng += apply_mode(m);
+
+  n_modes = 0;
+  return eng;
+}
+
+/** queue the force or energy contribution of a mode. If the queue
+    is full, it is processed. */
+static double add_mode(int p, int q, int energy)
+{
+  modes[n_modes].p = p;
+  modes[n_modes].q = q;
+  modes[n_modes].energy = energy;
+  if (++n_modes == MODE_BLOCK)
+    return process_modes();
+  return 0;
+}
+
 double MMM2D_add_far(int f, int e)
 {
   double eng;
@@ -1353,9 +1454,9 @@ double MMM2D_add_far(int f, int e)
 	if (ux2*SQR(p)  + uy2*SQR(q) < SQR(R))
 	  break;
 	if (f)
-	  add_force_contribution(p, q);
+	  eng += add_mode(p, q, 0);
 	if (e)
-	  eng += energy_contribution(p, q);
+	  eng += add_mode(p, q, 1);
       }
       undone[p] = q;
     }
@@ -1368,11 +1469,13 @@ double MMM2D_add_far(int f, int e)
     for (; q >= 0; q--) {
       // printf("xxxxx %d %d\n", p, q);
       if (f)
-	add_force_contribution(p, q);
+	eng += add_mode(p, q, 0);
       if (e)
-	eng += energy_contribution(p, q);
+	eng += add_mode(p, q, 1);
      }
   }
+  if (n_modes > 0)
+    eng += process_modes();
   
   free(undone);
   
@@ -1517,24 +1620,60 @@ static void prepareBernoulliNumbers(int bon_order)
   }
 }
 
-void add_mmm2d_coulomb_pair_force(double charge_factor,
-				  double d[3], double dl2, double dl, double force[3])
+/** interpolates the tabulated near formula without the direct
+    interaction. Returns 0 if the distance is not tabulated. */
+MDINLINE int near_table_lookup(double d[3], double F[3], double *E)
+{
+  double a, t, w[3][4], wxy, wxyz, v[4] = {0, 0, 0, 0}, *e;
+  int i, j, k, c, ind[3];
+
+  if (!near_table.data)
+    return 0;
+
+  for (i = 0; i < 3; i++) {
+    a = fabs(d[i])*near_table.hi[i];
+    if (a > near_table.n[i] - 1)
+      return 0;
+    /* four point Lagrange interpolation, the stencil is shifted inside
+       at the borders */
+    ind[i] = (int)a - 1;
+    if (ind[i] < 0)
+      ind[i] = 0;
+    if (ind[i] > near_table.n[i] - 4)
+      ind[i] = near_table.n[i] - 4;
+    t = a - ind[i];
+    w[i][0] = -(t - 1)*(t - 2)*(t - 3)/6;
+    w[i][1] =        t*(t - 2)*(t - 3)/2;
+    w[i][2] =       -t*(t - 1)*(t - 3)/2;
+    w[i][3] =        t*(t - 1)*(t - 2)/6;
+  }
+
+  for (i = 0; i < 4; i++)
+    for (j = 0; j < 4; j++) {
+      wxy = w[0][i]*w[1][j];
+      e = near_table.data + 4*(((ind[0] + i)*near_table.n[1] + ind[1] + j)*near_table.n[2] + ind[2]);
+      for (k = 0; k < 4; k++) {
+	wxyz = wxy*w[2][k];
+	for (c = 0; c < 4; c++)
+	  v[c] += wxyz*e[4*k + c];
+      }
+    }
+
+  /* the force components are odd in their own direction, the energy is even */
+  for (i = 0; i < 3; i++)
+    F[i] = (d[i] < 0) ? -v[i] : v[i];
+  *E = v[3];
+  return 1;
+}
+
+/** the near formula force without the direct interaction of the pair */
+static void calc_mmm2d_copy_pair_force(double d[3], double F[3])
 {
-  double F[3];
-  double pref = coulomb.prefactor*charge_factor;
   double z2   = d[2]*d[2];
   double rho2 = d[1]*d[1] + z2;
   int i;
 
-#ifdef ADDITIONAL_CHECKS
-  if (d[2] >box_l[1]/2) {
-    char *errtxt = runtime_error(128);
-    ERROR_SPRINTF(errtxt, "{024 near formula called for too distant particle pair} ");
-    return;
-  }
-#endif
-
-  if (pref != 0.0) {
+  {
     F[0] = F[1] = F[2] = 0;
 
     /* Bessel sum */
@@ -1678,13 +1817,35 @@ void add_mmm2d_coulomb_pair_force(double charge_factor,
       F[1] += d[1]*rinv3;
       F[2] += d[2]*rinv3;
 
-      rinv3 = 1/(dl2*dl);
-      F[0] += d[0]*rinv3;
-      F[1] += d[1]*rinv3;
-      F[2] += d[2]*rinv3;
-
       // fprintf(stderr, "explcit force %f %f %f\n", F[0], F[1], F[2]);
     }
+  }
+}
+
+void add_mmm2d_coulomb_pair_force(double charge_factor,
+				  double d[3], double dl2, double dl, double force[3])
+{
+  double F[3], E;
+  double pref = coulomb.prefactor*charge_factor;
+  double rinv3;
+  int i;
+
+#ifdef ADDITIONAL_CHECKS
+  if (d[2] >box_l[1]/2) {
+    char *errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt, "{024 near formula called for too distant particle pair} ");
+    return;
+  }
+#endif
+
+  if (pref != 0.0) {
+    if (!near_table_lookup(d, F, &E))
+      calc_mmm2d_copy_pair_force(d, F);
+
+    rinv3 = 1/(dl2*dl);
+    F[0] += d[0]*rinv3;
+    F[1] += d[1]*rinv3;
+    F[2] += d[2]*rinv3;
 
     for (i = 0; i < 3; i++)
       force[i] += pref*F[i];
@@ -1807,14 +1968,130 @@ MDINLINE double calc_mmm2d_copy_pair_energy(double d[3])
 double mmm2d_coulomb_pair_energy(double charge_factor,
 				 double dv[3], double d2, double d)
 {
-  double eng, pref = coulomb.prefactor*charge_factor;
+  double eng, F[3], pref = coulomb.prefactor*charge_factor;
   if (pref != 0.0) {
-    eng = calc_mmm2d_copy_pair_energy(dv);
+    if (!near_table_lookup(dv, F, &eng))
+      eng = calc_mmm2d_copy_pair_energy(dv);
     return pref*(eng + 1/d);
   }
   return 0.0;
 }
 
+/** tabulates the near formula for \ref MMM2D_struct::near_table. The
+    table values are calculated with a hundred times smaller error than
+    required, and the grid is refined until the interpolation error is
+    below a tenth of the error of the near formula sums in all grid
+    cells. The error is checked at the center of every cell, and
+    additionally at the quarter points of the cells at the borders,
+    where the interpolation stencil is shifted. If this needs more than
+    \ref MAXIMAL_NEAR_TABLE points, the near formula is not tabulated,
+    and the table is switched off with an error. */
+static void MMM2D_setup_near_table()
+{
+  static const double offset[3] = { 0.5, 0.25, 0.75 };
+  double ext[3] = { box_l[0]/2, box_l[1]/2, max_near };
+  double target = 0.1*part_error;
+  double h, hg[3], err, d[3], F[3], E, Ft[3], Et, *e;
+  int i, j, k, a, b, c, na, nb, nc, n_points, res;
+  char *errtxt;
+
+  if (!mmm2d_params.near_table) {
+    free(near_table.data);
+    near_table.data = NULL;
+    near_table.maxPWerror = 0;
+    return;
+  }
+  if (near_table.box_l[0] == box_l[0] && near_table.box_l[1] == box_l[1] &&
+      near_table.max_near == max_near && near_table.maxPWerror == mmm2d_params.maxPWerror)
+    return;
+
+  near_table.box_l[0] = box_l[0];
+  near_table.box_l[1] = box_l[1];
+  near_table.max_near = max_near;
+  near_table.maxPWerror = mmm2d_params.maxPWerror;
+
+  /* the table values are calculated with a hundred times smaller
+     error, since the sums are truncated depending on the distance,
+     which makes the near formula only continuous within its error */
+  if ((res = MMM2D_tune_near(0.01*mmm2d_params.maxPWerror))) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt, "{319 MMM2D near formula table: %s, switched off} ", mmm2d_errors[res]);
+    MMM2D_tune_near(mmm2d_params.maxPWerror);
+    free(near_table.data);
+    near_table.data = NULL;
+    near_table.maxPWerror = 0;
+    mmm2d_params.near_table = 0;
+    return;
+  }
+
+  h = dmin(ext[0], dmin(ext[1], ext[2]))/4;
+  for (;;) {
+    n_points = 1;
+    for (i = 0; i < 3; i++) {
+      near_table.n[i] = imax(4, (int)ceil(ext[i]/h) + 1);
+      hg[i] = ext[i]/(near_table.n[i] - 1);
+      near_table.hi[i] = 1/hg[i];
+      n_points *= near_table.n[i];
+    }
+    if (n_points > MAXIMAL_NEAR_TABLE) {
+      errtxt = runtime_error(128 + TCL_INTEGER_SPACE);
+      ERROR_SPRINTF(errtxt, "{319 MMM2D near formula table would need more than %d points, switched off} ",
+		    MAXIMAL_NEAR_TABLE);
+      free(near_table.data);
+      near_table.data = NULL;
+      near_table.maxPWerror = 0;
+      mmm2d_params.near_table = 0;
+      break;
+    }
+
+    near_table.data = realloc(near_table.data, 4*n_points*sizeof(double));
+    e = near_table.data;
+    for (i = 0; i < near_table.n[0]; i++)
+      for (j = 0; j < near_table.n[1]; j++)
+	for (k = 0; k < near_table.n[2]; k++) {
+	  d[0] = i*hg[0];
+	  d[1] = j*hg[1];
+	  d[2] = k*hg[2];
+	  calc_mmm2d_copy_pair_force(d, e);
+	  e[3] = calc_mmm2d_copy_pair_energy(d);
+	  e += 4;
+	}
+
+    err = 0;
+    for (i = 0; i < near_table.n[0] - 1; i++) {
+      na = (i == 0 || i == near_table.n[0] - 2) ? 3 : 1;
+      for (j = 0; j < near_table.n[1] - 1; j++) {
+	nb = (j == 0 || j == near_table.n[1] - 2) ? 3 : 1;
+	for (k = 0; k < near_table.n[2] - 1; k++) {
+	  nc = (k == 0 || k == near_table.n[2] - 2) ? 3 : 1;
+	  for (a = 0; a < na; a++)
+	    for (b = 0; b < nb; b++)
+	      for (c = 0; c < nc; c++) {
+		d[0] = (i + offset[a])*hg[0];
+		d[1] = (j + offset[b])*hg[1];
+		d[2] = (k + offset[c])*hg[2];
+		if (!near_table_lookup(d, F, &E))
+		  continue;
+		calc_mmm2d_copy_pair_force(d, Ft);
+		Et = calc_mmm2d_copy_pair_energy(d);
+		err = dmax(err, fabs(F[0] - Ft[0]));
+		err = dmax(err, fabs(F[1] - Ft[1]));
+		err = dmax(err, fabs(F[2] - Ft[2]));
+		err = dmax(err, fabs(E - Et));
+	      }
+	}
+      }
+    }
+    if (err <= target)
+      break;
+    /* the interpolation error decreases with the fourth power of the spacing */
+    h *= 0.9*pow(target/err, 0.25);
+  }
+
+  /* back to the cutoffs for the direct evaluation */
+  MMM2D_tune_near(mmm2d_params.maxPWerror);
+}
+
 void MMM2D_self_energy()
 {
   int c, np, i;
@@ -1851,6 +2128,8 @@ int tclprint_to_result_MMM2D(Tcl_Interp *interp)
   Tcl_AppendResult(interp, "mmm2d ", buffer,(char *) NULL);
   Tcl_PrintDouble(interp, mmm2d_params.far_cut, buffer);
   Tcl_AppendResult(interp, " ", buffer,(char *) NULL);
+  if (mmm2d_params.near_table)
+    Tcl_AppendResult(interp, " near_table", (char *) NULL);
 
   if (mmm2d_params.dielectric_contrast_on) {
     Tcl_PrintDouble(interp, mmm2d_params.delta_mid_top, buffer);
@@ -1869,10 +2148,11 @@ int tclcommand_inter_coulomb_parse_mmm2d(Tcl_Interp * interp, int argc, char **
   double far_cut = -1;
   double top = 1, mid = 1, bot = 1;
   double delta_top = 0, delta_bot = 0;
+  int near_table = 0;
 
   if (argc < 1) {
     Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm2d <maximal pairwise error> "
-		     "{<fixed far cutoff>} {dielectric <e1> <e2> <e3>} | {dielectric-contrasts <d1> <d2>}", (char *) NULL);
+		     "{<fixed far cutoff>} {near_table} {dielectric <e1> <e2> <e3>} | {dielectric-contrasts <d1> <d2>}", (char *) NULL);
     return TCL_ERROR;
   }
   
@@ -1887,6 +2167,11 @@ int tclcommand_inter_coulomb_parse_mmm2d(Tcl_Interp * interp, int argc, char **
       Tcl_ResetResult(interp);
     }
   }
+
+  if (argc >= 1 && ARG0_IS_S("near_table")) {
+    near_table = 1;
+    --argc; ++argv;
+  }
   
   if (argc != 0) {
     if (argc == 4 && ARG0_IS_S("dielectric")) {
@@ -1901,7 +2186,7 @@ int tclcommand_inter_coulomb_parse_mmm2d(Tcl_Interp * interp, int argc, char **
 	return TCL_ERROR;
     } else {
       Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm2d <maximal pairwise error> "
-		       "{<fixed far cutoff>} {dielectric <e1> <e2> <e3>} | {dielectric-contrasts <d1> <d2>}", (char *) NULL);
+		       "{<fixed far cutoff>} {near_table} {dielectric <e1> <e2> <e3>} | {dielectric-contrasts <d1> <d2>}", (char *) NULL);
       return TCL_ERROR;
     }
   }
@@ -1912,6 +2197,7 @@ int tclcommand_inter_coulomb_parse_mmm2d(Tcl_Interp * interp, int argc, char **
     return TCL_ERROR;
   }
 
+  mmm2d_params.near_table = near_table;
   if ((err = MMM2D_set_params(maxPWerror, far_cut, delta_top, delta_bot)) > 0) {
     Tcl_AppendResult(interp, mmm2d_errors[err], (char *)NULL);
     return TCL_ERROR;
@@ -2008,6 +2294,7 @@ void MMM2D_init()
     coulomb.method = COULOMB_NONE;
     return;
   }
+  MMM2D_setup_near_table();
   if (cell_structure.type == CELL_STRUCTURE_NSQUARE ||
       (cell_structure.type == CELL_STRUCTURE_LAYERED && n_nodes*n_layers < 3)) {
     mmm2d_params.far_cut = 0.0;
@@ -2038,9 +2325,9 @@ void MMM2D_on_resort_particles()
     scxcache = realloc(scxcache, n_scxcache*n_localpart*sizeof(SCCache));
     scycache = realloc(scycache, n_scycache*n_localpart*sizeof(SCCache));
     
-    partblk   = realloc(partblk,  n_localpart*8*sizeof(double));
-    lclcblk   = realloc(lclcblk,  n_cells*8*sizeof(double));
-    gblcblk   = realloc(gblcblk,  n_layers*8*sizeof(double));
+    partblks  = realloc(partblks, MODE_BLOCK*n_localpart*8*sizeof(double));
+    lclcblks  = realloc(lclcblks, MODE_BLOCK*n_cells*8*sizeof(double));
+    gblcblks  = realloc(gblcblks, MODE_BLOCK*n_layers*8*sizeof(double));
   }
   MMM2D_self_energy();
 }
@@ -48,6 +48,9 @@ typedef struct {
   int dielectric_contrast_on;
   /** dielectric contrasts at the bottom and top of the simulation cell */
   double delta_mid_top, delta_mid_bot, delta_mult;
+  /** if nonzero, the near formula is interpolated from a table, which is
+      calculated to the maximal pairwise error at initialization */
+  int near_table;
 } MMM2D_struct;
 extern MMM2D_struct mmm2d_params;
 
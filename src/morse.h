@@ -235,6 +235,22 @@ MDINLINE void add_morse_pair_force(Particle *p1, Particle *p2, IA_parameters *ia
   }
 }
 
+/** Calculate the Morse force factor for a pair at distance dist > 0,
+    i. e. the force on particle 1 is fac*d. Particle free version of
+    \ref add_morse_pair_force for the packed force loop. */
+MDINLINE double morse_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  double r, add1, add2;
+  if(dist < ia_params->MORSE_cut && dist > 0.0) {
+    /* the capped part uses the force at the cap radius */
+    r = (dist > ia_params->MORSE_capradius) ? dist : ia_params->MORSE_capradius;
+    add1 = exp(-2.0 * ia_params->MORSE_alpha * (r - ia_params->MORSE_rmin));
+    add2 = exp( -ia_params->MORSE_alpha * (r - ia_params->MORSE_rmin));
+    return -ia_params->MORSE_eps * 2.0 * ia_params->MORSE_alpha * (add2 - add1) / r;
+  }
+  return 0.0;
+}
+
 /** calculate Morse energy between particle p1 and p2. */
 MDINLINE double morse_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
 				double d[3], double dist)
@@ -30,7 +30,8 @@ struct mpifake_dtype
   mpifake_dtype_char   = { 0, 0, sizeof(char), sizeof(char), 1, 1, sizeof(char), NULL, NULL, NULL, NULL },
   mpifake_dtype_int    = { 0, 0, sizeof(int), sizeof(int), 1, 1, sizeof(int), NULL, NULL, NULL, NULL },
   mpifake_dtype_long   = { 0, 0, sizeof(long), sizeof(long), 1, 1, sizeof(long), NULL, NULL, NULL, NULL },
-  mpifake_dtype_double = { 0, 0, sizeof(double), sizeof(double), 1, 1, sizeof(double), NULL, NULL, NULL, NULL };
+  mpifake_dtype_double = { 0, 0, sizeof(double), sizeof(double), 1, 1, sizeof(double), NULL, NULL, NULL, NULL },
+  mpifake_dtype_float  = { 0, 0, sizeof(float), sizeof(float), 1, 1, sizeof(float), NULL, NULL, NULL, NULL };
 
 static void mpifake_dtblock(MPI_Datatype newtype, MPI_Datatype oldtype, int count, int disp);
 static void mpifake_pack(void *dest, void *src, int num, MPI_Datatype dtype);
@@ -27,6 +27,7 @@
 #ifndef MPI_H
 #define MPI_H
 #include <string.h>
+#include <sys/time.h>
 #include "utils.h"
 
 /********************************** REMARK **********************/
@@ -84,9 +85,12 @@ int mpifake_sendrecv(void *s, int scount, MPI_Datatype sdtype,
 #define MPI_COPY mpifake_copy
 
 #define MPI_STATUS_IGNORE NULL
+#define MPI_STATUSES_IGNORE NULL
 #define MPI_SUCCESS 1
 
 #define MPI_COMM_WORLD NULL
+#define MPI_COMM_NULL NULL
+#define MPI_UNDEFINED (-32766)
 
 #define MPI_REQUEST_NULL NULL
 
@@ -94,6 +98,7 @@ int mpifake_sendrecv(void *s, int scount, MPI_Datatype sdtype,
 
 extern struct mpifake_dtype mpifake_dtype_int;
 extern struct mpifake_dtype mpifake_dtype_double;
+extern struct mpifake_dtype mpifake_dtype_float;
 extern struct mpifake_dtype mpifake_dtype_byte;
 extern struct mpifake_dtype mpifake_dtype_long;
 extern struct mpifake_dtype mpifake_dtype_char;
@@ -102,6 +107,7 @@ extern struct mpifake_dtype mpifake_dtype_lb;
 
 #define MPI_INT    (&mpifake_dtype_int)
 #define MPI_DOUBLE (&mpifake_dtype_double)
+#define MPI_FLOAT  (&mpifake_dtype_float)
 #define MPI_BYTE   (&mpifake_dtype_byte)
 #define MPI_LONG   (&mpifake_dtype_long)
 #define MPI_CHAR   (&mpifake_dtype_char)
@@ -125,7 +131,13 @@ MDINLINE int MPI_Type_free(MPI_Datatype *dtype) { free(*dtype); *dtype = NULL; r
 MDINLINE int MPI_Type_extent(MPI_Datatype dtype, MPI_Aint *pextent) { *pextent = dtype->upper - dtype->lower; return MPI_SUCCESS; }
 MDINLINE int MPI_Barrier(MPI_Comm comm) { return MPI_SUCCESS; }
 MDINLINE int MPI_Waitall(int count, MPI_Request *reqs, MPI_Status *stats) { return MPI_SUCCESS; }
+MDINLINE int MPI_Waitany(int count, MPI_Request *reqs, int *index, MPI_Status *stat) { *index = 0; return MPI_SUCCESS; }
 MDINLINE int MPI_Wait(MPI_Request *reqs, MPI_Status *stats) { return MPI_SUCCESS; }
+MDINLINE int MPI_Testall(int count, MPI_Request *reqs, int *flag, MPI_Status *stats) { *flag = 1; return MPI_SUCCESS; }
+MDINLINE double MPI_Wtime() { struct timeval tv; gettimeofday(&tv, NULL); return tv.tv_sec + 1e-6*tv.tv_usec; }
+MDINLINE int MPI_Start(MPI_Request *req) { return MPI_SUCCESS; }
+MDINLINE int MPI_Startall(int count, MPI_Request *reqs) { return MPI_SUCCESS; }
+MDINLINE int MPI_Request_free(MPI_Request *req) { *req = MPI_REQUEST_NULL; return MPI_SUCCESS; }
 MDINLINE int MPI_Errhandler_create(MPI_Handler_function *errfunc, MPI_Errhandler *errhdl) { return MPI_SUCCESS; }
 MDINLINE int MPI_Errhandler_set(MPI_Comm comm, MPI_Errhandler errhdl) { return MPI_SUCCESS; }
 MDINLINE int MPI_Bcast(void *buff, int count, MPI_Datatype datatype, int root, MPI_Comm comm) { return MPI_SUCCESS; }
@@ -143,6 +155,10 @@ MDINLINE int MPI_Sendrecv(void *sbuf, int scount, MPI_Datatype stype, int dst, i
 }
 MDINLINE int MPI_Isend(void *buf, int count, MPI_Datatype dtype, int dst, int tag, MPI_Comm comm, MPI_Request *req) {
   fprintf(stderr, "MPI_Recv on a single node\n"); errexit(); return MPI_SUCCESS; }
+MDINLINE int MPI_Send_init(void *buf, int count, MPI_Datatype dtype, int dst, int tag, MPI_Comm comm, MPI_Request *req) {
+  fprintf(stderr, "MPI_Send_init on a single node\n"); errexit(); return MPI_SUCCESS; }
+MDINLINE int MPI_Recv_init(void *buf, int count, MPI_Datatype dtype, int src, int tag, MPI_Comm comm, MPI_Request *req) {
+  fprintf(stderr, "MPI_Recv_init on a single node\n"); errexit(); return MPI_SUCCESS; }
 
 #else
 
@@ -155,6 +171,8 @@ MDINLINE int __MPI_ERR(char *func, char *file, int line) {
 #define MPI_Irecv(buf, count, dtype, src, tag, comm, req) __MPI_ERR("MPI_IRecv", __FILE__, __LINE__)
 #define MPI_Send(buf, count, dtype, dst, tag, comm) __MPI_ERR("MPI_Send", __FILE__, __LINE__)
 #define MPI_Isend(buf, count, dtype, dst, tag, comm, req) __MPI_ERR("MPI_Isend", __FILE__, __LINE__)
+#define MPI_Send_init(buf, count, dtype, dst, tag, comm, req) __MPI_ERR("MPI_Send_init", __FILE__, __LINE__)
+#define MPI_Recv_init(buf, count, dtype, src, tag, comm, req) __MPI_ERR("MPI_Recv_init", __FILE__, __LINE__)
 #define MPI_Sendrecv(sbuf, scount, stype, dst, stag, rbuf, rcount, rtype, src, rtag, comm, stat) \
   __MPI_ERR("MPI_Sendrecv", __FILE__, __LINE__)
 
@@ -172,6 +190,11 @@ MDINLINE int MPI_Scatter(void *sbuf, int scount, MPI_Datatype sdtype,
 			 void *rbuf, int rcount, MPI_Datatype rdtype,
 			 int root, MPI_Comm comm)
 { return mpifake_sendrecv(sbuf, scount, sdtype, rbuf, rcount, rdtype); }
+MDINLINE int MPI_Alltoallv(void *sbuf, int *scounts, int *sdispls, MPI_Datatype sdtype,
+			   void *rbuf, int *rcounts, int *rdispls, MPI_Datatype rdtype,
+			   MPI_Comm comm)
+{ return mpifake_sendrecv((char *)sbuf + sdispls[0]*(sdtype->upper - sdtype->lower), scounts[0], sdtype,
+			  (char *)rbuf + rdispls[0]*(rdtype->upper - rdtype->lower), rcounts[0], rdtype); }
 MDINLINE int MPI_Op_create(MPI_User_function func, int commute, MPI_Op *pop) { *pop = func; return MPI_SUCCESS; }
 MDINLINE int MPI_Reduce(void *sbuf, void* rbuf, int count, MPI_Datatype dtype, MPI_Op op, int root, MPI_Comm comm)
 { op(sbuf, rbuf, &count, &dtype); return MPI_SUCCESS; }
@@ -38,6 +38,10 @@ void p3m_common_parameter_pre_init(p3m_parameter_struct *params) {
   params->mesh_off[1] = P3M_MESHOFF;
   params->mesh_off[2] = P3M_MESHOFF;
   params->inter = P3M_N_INTERPOL;
+  params->ad = 0;
+  params->interlace = 0;
+  params->kspace_nodes = 0;
+  params->influence_cache = 0;
   params->inter2 = 0;
   params->accuracy = 0.0;
   params->epsilon = P3M_EPSILON;
@@ -84,7 +88,7 @@ void p3m_p3m_print_send_mesh(p3m_send_mesh sm)
   }
 }
 
-void p3m_add_block(double *in, double *out, int start[3], int size[3], int dim[3])
+void p3m_add_block(fft_float *in, fft_float *out, int start[3], int size[3], int dim[3])
 {
   /* fast,mid and slow changing indices */
   int f,m,s;
@@ -146,6 +150,17 @@ double p3m_analytic_cotangent_sum(int n, double mesh_i, int cao)
 
 /** Computes the  assignment function of for the \a i'th degree
     at value \a x. */
+double p3m_alternating_cotangent_sum(int n, double mesh_i, int cao)
+{
+  int m;
+  double y = mesh_i*(double)n, res = pow(sinc(y), 2.0*cao);
+
+  for (m = 1; m <= P3M_ALTERNATING_SUM_CUT; m++)
+    res += ((m % 2) ? -1.0 : 1.0)*(pow(sinc(y + m), 2.0*cao) + pow(sinc(y - m), 2.0*cao));
+
+  return res;
+}
+
 double p3m_caf(int i, double x, int cao_value) {
   switch (cao_value) {
   case 1 : return 1.0;
@@ -222,4 +237,83 @@ double p3m_caf(int i, double x, int cao_value) {
     return 0.0;
   }}}
 }
+
+double p3m_caf_derivative(int i, double x, int cao_value) {
+  switch (cao_value) {
+  case 1 : return 0.0;
+  case 2 : {
+    switch (i) {
+    case 0: return -1.0;
+    case 1: return 1.0;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  case 3 : {
+    switch (i) {
+    case 0: return x-0.5;
+    case 1: return -2.0*x;
+    case 2: return x+0.5;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  case 4 : {
+    switch (i) {
+    case 0: return ( -6.0+x*( 24.0-x*24.0))/48.0;
+    case 1: return (-30.0+x*(-24.0+x*72.0))/48.0;
+    case 2: return ( 30.0+x*(-24.0-x*72.0))/48.0;
+    case 3: return (  6.0+x*( 24.0+x*24.0))/48.0;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  case 5 : {
+    switch (i) {
+    case 0: return ( -8.0+x*( 48.0+x*(-96.0+x*64.0)))/384.0;
+    case 1: return (-44.0+x*( 48.0+x*( 48.0-x*64.0)))/ 96.0;
+    case 2: return        x*(-240.0+x*   x*192.0)    /192.0;
+    case 3: return ( 44.0+x*( 48.0+x*(-48.0-x*64.0)))/ 96.0;
+    case 4: return (  8.0+x*( 48.0+x*( 96.0+x*64.0)))/384.0;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  case 6 : {
+    switch (i) {
+    case 0: return ( -10.0+x*(  80.0+x*( -240.0+x*( 320.0-x*160.0))))/3840.0;
+    case 1: return (-750.0+x*(1680.0+x*( -720.0+x*(-960.0+x*800.0))))/3840.0;
+    case 2: return (-770.0+x*(-880.0+x*( 1680.0+x*( 320.0-x*800.0))))/1920.0;
+    case 3: return ( 770.0+x*(-880.0+x*(-1680.0+x*( 320.0+x*800.0))))/1920.0;
+    case 4: return ( 750.0+x*(1680.0+x*(  720.0+x*(-960.0-x*800.0))))/3840.0;
+    case 5: return (  10.0+x*(  80.0+x*(  240.0+x*( 320.0+x*160.0))))/3840.0;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  case 7 : {
+    switch (i) {
+    case 0: return (   -12.0+x*(  120.0+x*(  -480.0+x*(   960.0+x*( -960.0+x* 384.0)))))/46080.0;
+    case 1: return ( -1416.0+x*( 4440.0+x*( -4800.0+x*(   960.0+x*( 1920.0-x*1152.0)))))/23040.0;
+    case 2: return (-17340.0+x*( 9480.0+x*( 20640.0+x*(-16320.0+x*(-4800.0+x*5760.0)))))/46080.0;
+    case 3: return           x*(-9240.0+x*          x*(  6720.0-x*          x*1920.0))  /11520.0;
+    case 4: return ( 17340.0+x*( 9480.0+x*(-20640.0+x*(-16320.0+x*( 4800.0+x*5760.0)))))/46080.0;
+    case 5: return (  1416.0+x*( 4440.0+x*(  4800.0+x*(   960.0+x*(-1920.0-x*1152.0)))))/23040.0;
+    case 6: return (    12.0+x*(  120.0+x*(   480.0+x*(   960.0+x*(  960.0+x* 384.0)))))/46080.0;
+    default:
+      fprintf(stderr,"%d: Tried to access charge assignment function of degree %d in scheme of order %d.\n",this_node,i,cao_value);
+      return 0.0;
+    }
+  }
+  default :{
+    fprintf(stderr,"%d: Charge assignment order %d unknown.\n",this_node,cao_value);
+    return 0.0;
+  }
+  }
+}
 #endif /* defined(P3M) || defined(DP3M) */
@@ -51,6 +51,7 @@
  */
 #include "config.h"
 #include "utils.h"
+#include "fft-common.h"
 
 #if defined(P3M) || defined(DP3M)
 
@@ -63,6 +64,8 @@
 #define P3M_RCUT_PREC 1e-3
 /** granularity of the time measurement */
 #define P3M_TIME_GRAN 2
+/** number of aliasing images on each side in \ref p3m_alternating_cotangent_sum */
+#define P3M_ALTERNATING_SUM_CUT 64
 
 /** whether the P3M charge assignment fraction is stored or not */
 #define P3M_STORE_CA_FRAC
@@ -136,6 +139,19 @@ typedef struct {
   int    cao;
   /** number of interpolation points for charge assignment function */
   int    inter;
+  /** whether the forces are obtained by analytical differentiation of
+      the charge assignment function (ad-P3M) instead of by
+      ik-differentiation of the mesh. */
+  int    ad;
+  /** whether the k-space part is averaged over two meshes shifted
+      by half a mesh constant (interlaced P3M). */
+  int    interlace;
+  /** number of nodes that do the FFTs, 0 for all. The other nodes
+      send their charge mesh to these. */
+  int    kspace_nodes;
+  /** whether the influence functions are also cached in files in the
+      working directory, so that later runs can reuse them. */
+  int    influence_cache;
   /** Accuracy of the actual parameter set. */
   double accuracy;
 
@@ -182,7 +198,7 @@ void p3m_p3m_print_send_mesh(p3m_send_mesh sm);
  *  \param size        Dimensions of the block
  *  \param dim         Dimensions of the output grid.
 */
-void p3m_add_block(double *in, double *out, int start[3], int size[3], int dim[3]);
+void p3m_add_block(fft_float *in, fft_float *out, int start[3], int size[3], int dim[3]);
 
 /** One of the aliasing sums used by \ref p3m_k_space_error. 
     (fortunately the one which is most important (because it converges
@@ -193,10 +209,20 @@ void p3m_add_block(double *in, double *out, int start[3], int size[3], int dim[3
     is Eqn. 7.66 in the book of Hockney and Eastwood). */
 double p3m_analytic_cotangent_sum(int n, double mesh_i, int cao);
 
+/** The same aliasing sum as \ref p3m_analytic_cotangent_sum, but with
+    alternating signs (-1)^m of the aliasing images, as needed for
+    interlaced P3M. It is summed numerically, which converges fast
+    since the series is alternating. */
+double p3m_alternating_cotangent_sum(int n, double mesh_i, int cao);
+
 /** Computes the  assignment function of for the \a i'th degree
     at value \a x. */
 double p3m_caf(int i, double x,int cao_value);
 
+/** Computes the derivative of the assignment function of for the \a
+    i'th degree at value \a x. */
+double p3m_caf_derivative(int i, double x, int cao_value);
+
 #endif /* P3M || DP3M */
 
 #endif /* _P3M_COMMON_H */
@@ -97,14 +97,14 @@ static void dp3m_calc_lm_ld_pos();
  *  After the charge assignment Each node needs to gather the
  *  information for the FFT grid in his spatial domain.
  */
-static void dp3m_gather_fft_grid(double* mesh);
+static void dp3m_gather_fft_grid(fft_float* mesh);
 
 /** Spread force grid.
  *  After the k-space calculations each node needs to get all force
  *  information to reassigne the forces from the grid to the
  *  particles.
  */
-static void dp3m_spread_force_grid(double* mesh);
+static void dp3m_spread_force_grid(fft_float* mesh);
 
 /** realloc charge assignment fields. */
 static void dp3m_realloc_ca_fields(int newsize);
@@ -360,8 +360,8 @@ void dp3m_init() {
          if(n==this_node) P3M_TRACE(p3m_p3m_print_send_mesh(dp3m.sm));
     }
     
-    dp3m.send_grid = (double *) realloc(dp3m.send_grid, sizeof(double)*dp3m.sm.max);
-    dp3m.recv_grid = (double *) realloc(dp3m.recv_grid, sizeof(double)*dp3m.sm.max);
+    dp3m.send_grid = (fft_float *) realloc(dp3m.send_grid, sizeof(fft_float)*dp3m.sm.max);
+    dp3m.recv_grid = (fft_float *) realloc(dp3m.recv_grid, sizeof(fft_float)*dp3m.sm.max);
     
     if (dp3m.params.inter > 0) dp3m_interpolate_dipole_assignment_function();
 
@@ -375,10 +375,10 @@ void dp3m_init() {
 				 dp3m.local_mesh.dim,dp3m.local_mesh.margin,
 				 dp3m.params.mesh, dp3m.params.mesh_off,
 				 &dp3m.ks_pnum);
-    dp3m.ks_mesh = (double *) realloc(dp3m.ks_mesh, ca_mesh_size*sizeof(double));
+    dp3m.ks_mesh = (fft_float *) realloc(dp3m.ks_mesh, ca_mesh_size*sizeof(fft_float));
     
     for (n=0;n<3;n++)   
-       dp3m.rs_mesh_dip[n] = (double *) realloc(dp3m.rs_mesh_dip[n], ca_mesh_size*sizeof(double));
+       dp3m.rs_mesh_dip[n] = (fft_float *) realloc(dp3m.rs_mesh_dip[n], ca_mesh_size*sizeof(fft_float));
 
      P3M_TRACE(fprintf(stderr,"%d: dp3m.rs_mesh_dip[0] ADR=%p\n",this_node,dp3m.rs_mesh_dip[0]));
      P3M_TRACE(fprintf(stderr,"%d: dp3m.rs_mesh_dip[1] ADR=%p\n",this_node,dp3m.rs_mesh_dip[1]));
@@ -437,8 +437,9 @@ double dp3m_average_dipolar_self_energy(double box_l, int mesh) {
 		 (n[2]%(dp3m.params.mesh[0]/2)==0) )
 	  node_phi += 0.0;
 	else {
+		  int j[3] = { n[0]-dfft.plan[3].start[0], n[1]-dfft.plan[3].start[1], n[2]-dfft.plan[3].start[2] };
 		  U2 = dp3m_perform_aliasing_sums_dipolar_self_energy(n);
-		  node_phi += dp3m.g_energy[ind] * U2*(SQR(dp3m.d_op[n[0]])+SQR(dp3m.d_op[n[1]])+SQR(dp3m.d_op[n[2]]));
+		  node_phi += fft_mode_weight(&dfft, j) * dp3m.g_energy[ind] * U2*(SQR(dp3m.d_op[n[0]])+SQR(dp3m.d_op[n[1]])+SQR(dp3m.d_op[n[2]]));
 	}
       }}}
   
@@ -1244,7 +1245,7 @@ double dp3m_calc_kspace_forces(int force_flag, int energy_flag)
     for(j[0]=0; j[0]<dfft.plan[3].new_mesh[0]; j[0]++) {
       for(j[1]=0; j[1]<dfft.plan[3].new_mesh[1]; j[1]++) {
 	for(j[2]=0; j[2]<dfft.plan[3].new_mesh[2]; j[2]++) {
-	  node_k_space_energy_dip += dp3m.g_energy[i] * (
+	  node_k_space_energy_dip += fft_mode_weight(&dfft, j) * dp3m.g_energy[i] * (
 	  SQR(dp3m.rs_mesh_dip[0][ind]*dp3m.d_op[j[2]+dfft.plan[3].start[2]]+
 	      dp3m.rs_mesh_dip[1][ind]*dp3m.d_op[j[0]+dfft.plan[3].start[0]]+
 	      dp3m.rs_mesh_dip[2][ind]*dp3m.d_op[j[1]+dfft.plan[3].start[1]]
@@ -1532,11 +1533,11 @@ double calc_surface_term(int force_flag, int energy_flag)
 
 
 /************************************************************/
-void dp3m_gather_fft_grid(double* themesh)
+void dp3m_gather_fft_grid(fft_float* themesh)
 {
   int s_dir,r_dir,evenodd;
   MPI_Status status;
-  double *tmp_ptr;
+  fft_float *tmp_ptr;
 
   P3M_TRACE(fprintf(stderr,"%d: dp3m_gather_fft_grid:\n",this_node));
 
@@ -1553,12 +1554,12 @@ void dp3m_gather_fft_grid(double* themesh)
       for(evenodd=0; evenodd<2;evenodd++) {
 	if((node_pos[s_dir/2]+evenodd)%2==0) {
 	  if(dp3m.sm.s_size[s_dir]>0) 
-	    MPI_Send(dp3m.send_grid, dp3m.sm.s_size[s_dir], MPI_DOUBLE, 
+	    MPI_Send(dp3m.send_grid, dp3m.sm.s_size[s_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[s_dir], REQ_P3M_GATHER_D, MPI_COMM_WORLD);
 	}
 	else {
 	  if(dp3m.sm.r_size[r_dir]>0) 
-	    MPI_Recv(dp3m.recv_grid, dp3m.sm.r_size[r_dir], MPI_DOUBLE, 
+	    MPI_Recv(dp3m.recv_grid, dp3m.sm.r_size[r_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[r_dir], REQ_P3M_GATHER_D, MPI_COMM_WORLD, &status); 	    
 	}
       }
@@ -1580,11 +1581,11 @@ void dp3m_gather_fft_grid(double* themesh)
 /************************************************************/
 
 
-void dp3m_spread_force_grid(double* themesh)
+void dp3m_spread_force_grid(fft_float* themesh)
 {
   int s_dir,r_dir,evenodd;
   MPI_Status status;
-  double *tmp_ptr;
+  fft_float *tmp_ptr;
   P3M_TRACE(fprintf(stderr,"%d: dipolar p3m_spread_force_grid:\n",this_node));
 
   /* direction loop */
@@ -1599,12 +1600,12 @@ void dp3m_spread_force_grid(double* themesh)
       for(evenodd=0; evenodd<2;evenodd++) {
 	if((node_pos[r_dir/2]+evenodd)%2==0) {
 	  if(dp3m.sm.r_size[r_dir]>0) 
-	    MPI_Send(dp3m.send_grid, dp3m.sm.r_size[r_dir], MPI_DOUBLE, 
+	    MPI_Send(dp3m.send_grid, dp3m.sm.r_size[r_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[r_dir], REQ_P3M_SPREAD_D, MPI_COMM_WORLD);
    	}
 	else {
 	  if(dp3m.sm.s_size[s_dir]>0) 
-	    MPI_Recv(dp3m.recv_grid, dp3m.sm.s_size[s_dir], MPI_DOUBLE, 
+	    MPI_Recv(dp3m.recv_grid, dp3m.sm.s_size[s_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[s_dir], REQ_P3M_SPREAD_D, MPI_COMM_WORLD, &status); 	    
 	}
       }
@@ -1686,7 +1687,7 @@ void dp3m_calc_influence_function_force()
     size *= dfft.plan[3].new_mesh[i];
     end[i] = dfft.plan[3].start[i] + dfft.plan[3].new_mesh[i];
   }
-  dp3m.g_force = (double *) realloc(dp3m.g_force, size*sizeof(double));
+  dp3m.g_force = (fft_float *) realloc(dp3m.g_force, size*sizeof(fft_float));
   fak1  = dp3m.params.mesh[0]*dp3m.params.mesh[0]*dp3m.params.mesh[0]*2.0/(box_l[0]*box_l[0]);
 
   for(n[0]=dfft.plan[3].start[0]; n[0]<end[0]; n[0]++)
@@ -1768,7 +1769,7 @@ void dp3m_calc_influence_function_energy()
     size *= dfft.plan[3].new_mesh[i];
     end[i] = dfft.plan[3].start[i] + dfft.plan[3].new_mesh[i];
   }
-  dp3m.g_energy = (double *) realloc(dp3m.g_energy, size*sizeof(double));
+  dp3m.g_energy = (fft_float *) realloc(dp3m.g_energy, size*sizeof(fft_float));
   fak1  = dp3m.params.mesh[0]*dp3m.params.mesh[0]*dp3m.params.mesh[0]*2.0/(box_l[0]*box_l[0]);
 
   for(n[0]=dfft.plan[3].start[0]; n[0]<end[0]; n[0]++)
@@ -44,11 +44,11 @@ typedef struct {
   /** local mesh. */
   p3m_local_mesh local_mesh;
   /** real space mesh (local) for CA/FFT.*/
-  double *rs_mesh;
+  fft_float *rs_mesh;
   /** real space mesh (local) for CA/FFT of the dipolar field.*/
-  double *rs_mesh_dip[3];
+  fft_float *rs_mesh_dip[3];
   /** k space mesh (local) for k space calculation and FFT.*/
-  double *ks_mesh;
+  fft_float *ks_mesh;
 
   /** number of dipolar particles (only on master node). */
   int sum_dip_part; 
@@ -66,9 +66,9 @@ typedef struct {
   /** Spatial differential operator in k-space. We use an i*k differentiation. */
   double *d_op;
   /** Force optimised influence function (k-space) */
-  double *g_force;
+  fft_float *g_force;
   /** Energy optimised influence function (k-space) */
-  double *g_energy;
+  fft_float *g_energy;
 
   /** number of charged particles on the node. */
   int ca_num;
@@ -84,9 +84,9 @@ typedef struct {
   p3m_send_mesh  sm;
 
   /** Field to store grid points to send. */
-  double *send_grid; 
+  fft_float *send_grid; 
   /** Field to store grid points to recv */
-  double *recv_grid;
+  fft_float *recv_grid;
 
   /* Stores the value of the energy correction due to MS effects */
   double  energy_correction;
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 
 #include "utils.h"
 #include "integrate.h"
@@ -44,6 +45,15 @@
  ************************************************/
 p3m_data_struct p3m;
 
+#ifdef P3M_STORE_CA_FRAC
+/** first charge of each local cell in the charge assignment fields. */
+static int *ca_cell_off = NULL;
+static int ca_cell_off_size = 0;
+/** charges sorted by mesh plane, and the first charge of each plane. */
+static int *ca_order = NULL, *ca_plane_start = NULL;
+static int ca_order_size = 0, ca_plane_start_size = 0;
+#endif
+
 /* MPI tags for the charge-charge p3m communications: */
 /** Tag for communication in P3M_init() -> send_calc_mesh(). */
 #define REQ_P3M_INIT   200
@@ -113,20 +123,38 @@ static double p3m_calc_dipole_term(int force_flag, int energy_flag);
  *  After the charge assignment Each node needs to gather the
  *  information for the FFT grid in his spatial domain.
  */
-static void p3m_gather_fft_grid(double* mesh);
+static void p3m_gather_fft_grid(fft_float* mesh);
 
 /** Spread force grid.
  *  After the k-space calculations each node needs to get all force
  *  information to reassigne the forces from the grid to the
  *  particles.
  */
-static void p3m_spread_force_grid(double* mesh);
+static void p3m_spread_force_grid(fft_float* mesh);
 
 #ifdef P3M_STORE_CA_FRAC
 /** realloc charge assignment fields. */
 static void p3m_realloc_ca_fields(int newsize);
+
+/** Counts the charges of each local cell and sets up their first
+    indices in the charge assignment fields. */
+static int p3m_count_ca_charges(void);
+
+/** Adds the stored charge fractions of all charges to the mesh. With
+    OpenMP, the charges are sorted by the x-plane of their first mesh
+    point, and the threads assign the charges of slabs of mesh
+    planes. */
+static void p3m_scatter_charges(int n_charges);
 #endif
 
+/** Calculates the charge assignment weights of a charge separately
+    for each direction, see \ref p3m_data_struct::ca_frac.
+    \param q        the charge.
+    \param real_pos its position.
+    \param w        where to store the weights.
+    \return the index of the first mesh point in \ref p3m_data_struct::rs_mesh. */
+static int p3m_calc_ca_weights(double q, double real_pos[3], double *w);
+
 /** checks for correctness for charges in P3M of the cao_cut, necessary when the box length changes */
 static int p3m_sanity_checks_boxl(void);
 
@@ -148,6 +176,16 @@ static void p3m_interpolate_charge_assignment_function(void);
 /** shifts the mesh points by mesh/2 */
 static void p3m_calc_meshift(void);
 
+/** Calculates the full aliasing sums of U^2 and U^2 k^2, with and
+    without the alternating signs of the second, shifted mesh, per
+    direction. They replace the denominators of the influence
+    functions for interlaced P3M. */
+static void p3m_calc_interlace_sums(void);
+
+/** Shift the local mesh by half a mesh constant for the second mesh
+    of interlaced P3M (\a shifted = 1), or back (\a shifted = 0). */
+static void p3m_shift_mesh(int shifted);
+
 /** Calculates the Fourier transformed differential operator.  
  *  Remark: This is done on the level of n-vectors and not k-vectors,
  *           i.e. the prefactor i*2*PI/L is missing! */
@@ -161,13 +199,39 @@ static void p3m_calc_differential_operator(void);
  *
  *  See also: Hockney/Eastwood 8-22 (p275). Note the somewhat
  *  different convention for the prefactors, which is described in
- *  Deserno/Holm. */
+ *  Deserno/Holm. For analytical differentiation, the differential
+ *  operator is replaced by k itself, which gives the ad variant of
+ *  the influence function. */
 static void p3m_calc_influence_function_force(void);
 
 /** Calculates the influence function optimized for the energy and the
     self energy correction.  */
 static void p3m_calc_influence_function_energy(void);
 
+/** Sets up both influence functions for the current parameters. They
+    are taken from the influence function cache if possible, otherwise
+    calculated by \ref p3m_calc_influence_function_force and \ref
+    p3m_calc_influence_function_energy and stored in the cache. */
+static void p3m_calc_influence_functions(void);
+
+/** Marks the influence functions as outdated. They are set up by \ref
+    p3m_check_influence_functions when they are needed the next time,
+    so that setting several parameters in a row does not calculate
+    them in between. */
+static void p3m_invalidate_influence_functions(void);
+
+/** Sets up the influence functions if they are outdated. */
+static void p3m_check_influence_functions(void);
+
+/** Adapts the influence functions to a changed box. For fixed alpha_L,
+    mesh and cao, the influence functions simply scale with the square
+    of the box length if the box aspect ratio does not change, which
+    is the case for the NpT integrator. Otherwise, they are set up
+    again. Does nothing if the influence functions are outdated or do
+    not belong to the current parameters, since then \ref p3m_init
+    follows anyways. */
+static void p3m_scale_influence_functions(void);
+
 
 /** Calculates the aliasing sums for the optimal influence function.
  *
@@ -180,6 +244,7 @@ static void p3m_calc_influence_function_energy(void);
  * \return denominator aliasing sum in the denominator
  */
 double p3m_perform_aliasing_sums_force(int n[3], double nominator[3]);
+double p3m_perform_aliasing_sums_force_ad(int n[3]);
 double p3m_perform_aliasing_sums_energy(int n[3]);
 
 int tclcommand_inter_coulomb_p3m_print_adaptive_tune_parameters(Tcl_Interp *interp);
@@ -205,6 +270,8 @@ static double p3m_real_space_error(double prefac, double r_cut_iL, int n_c_part,
     P3M method in the book of Hockney and Eastwood (Eqn. 8.23) in
     order to obtain the rms error in the force for a system of N
     randomly distributed particles in a cubic box (k space part).
+    Depending on \ref p3m_parameter_struct::ad, the estimate is for
+    ik- or for analytical differentiation.
     \param prefac   Prefactor of coulomb interaction.
     \param mesh     number of mesh points in one direction.
     \param cao      charge assignment order.
@@ -215,6 +282,22 @@ static double p3m_real_space_error(double prefac, double r_cut_iL, int n_c_part,
 */
 static double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L);
 
+#ifdef P3M_SINGLE_PRECISION
+/** Estimate of the rms force error due to the single precision
+    meshes and FFTs. The rounding error of the FFT grows like
+    sqrt(log2(number of mesh points)) relative to the rms field on the
+    mesh, which for randomly distributed charges smeared out by the
+    Ewald splitting is sqrt(8 sqrt(pi) alpha sum_q2 / V).
+    \param prefac   Prefactor of coulomb interaction.
+    \param mesh     number of mesh points in one direction.
+    \param n_c_part number of charged particles in the system.
+    \param sum_q2   sum of square of charges in the system
+    \param alpha_L  rescaled ewald splitting parameter.
+    \return rounding error of the k space force
+*/
+static double p3m_k_space_rounding_error(double prefac, int mesh[3], int n_c_part, double sum_q2, double alpha_L);
+#endif
+
 
 
 /** aliasing sum used by \ref p3m_k_space_error. */
@@ -222,6 +305,24 @@ static void p3m_tune_aliasing_sums(int nx, int ny, int nz,
 			    int mesh[3], double mesh_i[3], int cao, double alpha_L_i, 
 			    double *alias1, double *alias2);
 
+/** aliasing sums used by \ref p3m_k_space_error for analytical
+    differentiation. */
+static void p3m_tune_aliasing_sums_ad(int nx, int ny, int nz, 
+			       int mesh[3], double mesh_i[3], int cao, double alpha_L_i, 
+			       double *alias1, double *alias2);
+
+/** differentiation scheme the tuning is restricted to (0 for ik-, 1
+    for analytical differentiation), or -1 if both are tried. */
+static int p3m_tune_differentiation = -1;
+/** interlacing to use in the tuning, -1 means try both. */
+static int p3m_tune_interlace = -1;
+/** number of parameter sets with the lowest predicted time that are
+    timed by the model based tuning, or 0 for the exhaustive tuning. */
+static int p3m_tune_model = 0;
+/** file in which tuning results and cost model calibrations are
+    kept, or NULL. */
+static char *p3m_tune_cache_file = NULL;
+
 /*@}*/
 
 
@@ -236,12 +337,15 @@ void p3m_pre_init(void) {
   p3m.sum_q2 = 0.0;
   p3m.square_sum_q = 0.0;
 
-  for (int i = 0; i < 7; i++)
+  for (int i = 0; i < 7; i++) {
     p3m.int_caf[i] = NULL;
+    p3m.int_dcaf[i] = NULL;
+  }
   p3m.pos_shift = 0.0;
   p3m.meshift_x = NULL;
   p3m.meshift_y = NULL;
   p3m.meshift_z = NULL;
+  p3m.il_sums[0] = p3m.il_sums[1] = p3m.il_sums[2] = NULL;
 
   p3m.d_op[0] = NULL;
   p3m.d_op[1] = NULL;
@@ -251,6 +355,7 @@ void p3m_pre_init(void) {
 
 #ifdef P3M_STORE_CA_FRAC
   p3m.ca_num = 0;
+  p3m.ca_block = 0;
   p3m.ca_frac = NULL;
   p3m.ca_fmp = NULL;
 #endif
@@ -269,12 +374,20 @@ void p3m_free()
 #ifdef P3M_STORE_CA_FRAC
   free(p3m.ca_frac);
   free(p3m.ca_fmp);
+  free(ca_cell_off);
+  free(ca_order);
+  free(ca_plane_start);
+  ca_cell_off = ca_order = ca_plane_start = NULL;
+  ca_cell_off_size = ca_order_size = ca_plane_start_size = 0;
 #endif
   free(p3m.send_grid);
   free(p3m.recv_grid);
   free(p3m.rs_mesh);
   free(p3m.ks_mesh); 
-  for(i=0; i<p3m.params.cao; i++) free(p3m.int_caf[i]);
+  for(i=0; i<p3m.params.cao; i++) {
+    free(p3m.int_caf[i]);
+    free(p3m.int_dcaf[i]);
+  }
 }
 
 void p3m_set_bjerrum() {
@@ -315,6 +428,7 @@ void   p3m_init() {
 
 #ifdef P3M_STORE_CA_FRAC
     /* initialize ca fields to size CA_INCREMENT: p3m.ca_frac and p3m.ca_fmp */
+    p3m.ca_block = (p3m.params.ad ? 6 : 3)*p3m.params.cao;
     p3m.ca_num = 0;
     p3m_realloc_ca_fields(CA_INCREMENT);
 #endif
@@ -324,8 +438,8 @@ void   p3m_init() {
     p3m_calc_send_mesh();
     P3M_TRACE(p3m_p3m_print_local_mesh(p3m.local_mesh));
     P3M_TRACE(p3m_p3m_print_send_mesh(p3m.sm));
-    p3m.send_grid = (double *) realloc(p3m.send_grid, sizeof(double)*p3m.sm.max);
-    p3m.recv_grid = (double *) realloc(p3m.recv_grid, sizeof(double)*p3m.sm.max);
+    p3m.send_grid = (fft_float *) realloc(p3m.send_grid, sizeof(fft_float)*p3m.sm.max);
+    p3m.recv_grid = (fft_float *) realloc(p3m.recv_grid, sizeof(fft_float)*p3m.sm.max);
 
     if (p3m.params.inter > 0)
       p3m_interpolate_charge_assignment_function();
@@ -340,16 +454,15 @@ void   p3m_init() {
     int ca_mesh_size = fft_init(&p3m.rs_mesh,
 				p3m.local_mesh.dim,p3m.local_mesh.margin,
 				p3m.params.mesh, p3m.params.mesh_off,
-				&p3m.ks_pnum);
-    p3m.ks_mesh = (double *) realloc(p3m.ks_mesh, ca_mesh_size*sizeof(double));
+				&p3m.ks_pnum, p3m.params.kspace_nodes);
+    p3m.ks_mesh = (fft_float *) realloc(p3m.ks_mesh, ca_mesh_size*sizeof(fft_float));
     
 
     P3M_TRACE(fprintf(stderr,"%d: p3m.rs_mesh ADR=%p\n",this_node,p3m.rs_mesh));
   
     /* k-space part: */
     p3m_calc_differential_operator();
-    p3m_calc_influence_function_force();
-    p3m_calc_influence_function_energy();
+    p3m_invalidate_influence_functions();
 
     p3m_count_charged_particles();
 
@@ -467,12 +580,73 @@ static int p3m_set_ninterpol(int n)
 
 
 
+static int p3m_set_differentiation(int ad)
+{
+  p3m.params.ad = ad;
+
+  mpi_bcast_coulomb_params();
+
+  return TCL_OK;
+}
+
+
+
+static int p3m_set_interlace(int interlace)
+{
+  if (interlace != 0 && interlace != 1)
+    return TCL_ERROR;
+
+  p3m.params.interlace = interlace;
+
+  mpi_bcast_coulomb_params();
+
+  return TCL_OK;
+}
+
+
+
+static int p3m_set_kspace_nodes(int n)
+{
+  if (n < 0 || n > n_nodes)
+    return TCL_ERROR;
+
+  p3m.params.kspace_nodes = n;
+
+  mpi_bcast_coulomb_params();
+
+  return TCL_OK;
+}
+
+
+
+static int p3m_set_influence_cache(int on)
+{
+  if (on != 0 && on != 1)
+    return TCL_ERROR;
+
+  p3m.params.influence_cache = on;
+
+  mpi_bcast_coulomb_params();
+
+  return TCL_OK;
+}
+
+
+
 
 int tclcommand_inter_coulomb_parse_p3m_tune(Tcl_Interp * interp, int argc, char ** argv, int adaptive)
 {
   int mesh = -1, cao = -1, n_interpol = -1;
   double r_cut = -1, accuracy = -1;
 
+  p3m_tune_differentiation = -1;
+  p3m_tune_interlace = -1;
+  p3m_tune_model = 0;
+  if (p3m_tune_cache_file) {
+    free(p3m_tune_cache_file);
+    p3m_tune_cache_file = NULL;
+  }
+
   while(argc > 0) {
     if(ARG0_IS_S("r_cut")) {
       if (! (argc > 1 && ARG1_IS_D(r_cut) && r_cut >= -1)) {
@@ -507,6 +681,36 @@ int tclcommand_inter_coulomb_parse_p3m_tune(Tcl_Interp * interp, int argc, char
 	Tcl_AppendResult(interp, "n_interpol expects an nonnegative integer", (char *) NULL);
 	return TCL_ERROR;
       }
+
+    } else if (ARG0_IS_S("differentiation")) {
+      if (argc > 1 && ARG1_IS_S("ik"))
+	p3m_tune_differentiation = 0;
+      else if (argc > 1 && ARG1_IS_S("ad"))
+	p3m_tune_differentiation = 1;
+      else {
+	Tcl_AppendResult(interp, "differentiation expects \"ik\" or \"ad\"", (char *) NULL);
+	return TCL_ERROR;
+      }
+
+    } else if (ARG0_IS_S("interlace")) {
+      if (! (argc > 1 && ARG1_IS_I(p3m_tune_interlace) &&
+	     (p3m_tune_interlace == 0 || p3m_tune_interlace == 1))) {
+	Tcl_AppendResult(interp, "interlace expects 0 or 1", (char *) NULL);
+	return TCL_ERROR;
+      }
+
+    } else if (ARG0_IS_S("model")) {
+      if (! (argc > 1 && ARG1_IS_I(p3m_tune_model) && p3m_tune_model >= 0)) {
+	Tcl_AppendResult(interp, "model expects a nonnegative integer", (char *) NULL);
+	return TCL_ERROR;
+      }
+
+    } else if (ARG0_IS_S("cache")) {
+      if (argc < 2) {
+	Tcl_AppendResult(interp, "cache expects a file name", (char *) NULL);
+	return TCL_ERROR;
+      }
+      p3m_tune_cache_file = strdup(argv[1]);
     }
     /* unknown parameter. Probably one of the optionals */
     else break;
@@ -686,6 +890,106 @@ int tclcommand_inter_coulomb_parse_p3m_opt_params(Tcl_Interp * interp, int argc,
       argv += 4;
     }
     
+    /* p3m parameter: differentiation */
+    else if (ARG0_IS_S("differentiation")) {
+
+      if(argc < 2) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (ARG1_IS_S("ik"))
+	i = 0;
+      else if (ARG1_IS_S("ad"))
+	i = 1;
+      else {
+	Tcl_AppendResult(interp, argv[0], " needs \"ik\" or \"ad\"",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      p3m_set_differentiation(i);
+
+      argc -= 2;
+      argv += 2;
+    }
+
+    /* p3m parameter: interlace */
+    else if (ARG0_IS_S("interlace")) {
+
+      if(argc < 2) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (! ARG1_IS_I(i)) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 INTEGER parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (p3m_set_interlace(i) == TCL_ERROR) {
+	Tcl_AppendResult(interp, argv[0], " argument must be 0 or 1",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      argc -= 2;
+      argv += 2;
+    }
+
+    /* p3m parameter: kspace_nodes */
+    else if (ARG0_IS_S("kspace_nodes")) {
+
+      if(argc < 2) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (! ARG1_IS_I(i)) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 INTEGER parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (p3m_set_kspace_nodes(i) == TCL_ERROR) {
+	Tcl_AppendResult(interp, argv[0], " argument must be between 0 and the number of nodes",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      argc -= 2;
+      argv += 2;
+    }
+
+    /* p3m parameter: influence_cache */
+    else if (ARG0_IS_S("influence_cache")) {
+
+      if(argc < 2) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (! ARG1_IS_I(i)) {
+	Tcl_AppendResult(interp, argv[0], " needs 1 INTEGER parameter",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      if (p3m_set_influence_cache(i) == TCL_ERROR) {
+	Tcl_AppendResult(interp, argv[0], " argument must be 0 or 1",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+      argc -= 2;
+      argv += 2;
+    }
+
     /* p3m parameter: epsilon */
     else if(ARG0_IS_S( "epsilon")) {
 
@@ -746,10 +1050,43 @@ void p3m_interpolate_charge_assignment_function()
     /* loop over all interpolation points */
     for (j=-p3m.params.inter; j<=p3m.params.inter; j++)
       p3m.int_caf[i][j+p3m.params.inter] = p3m_caf(i, j*dInterpol,p3m.params.cao);
+
+    /* the derivative is only needed for analytical differentiation */
+    if (p3m.params.ad) {
+      p3m.int_dcaf[i] = (double *) realloc(p3m.int_dcaf[i], sizeof(double)*(2*p3m.params.inter+1));
+      for (j=-p3m.params.inter; j<=p3m.params.inter; j++)
+	p3m.int_dcaf[i][j+p3m.params.inter] = p3m_caf_derivative(i, j*dInterpol,p3m.params.cao);
+    }
   }
   
 }
 
+#ifdef P3M_STORE_CA_FRAC
+int p3m_count_ca_charges()
+{
+  Particle *p;
+  int i,c,np;
+  int cp_cnt = 0;
+
+  if (local_cells.n + 1 > ca_cell_off_size) {
+    ca_cell_off_size = local_cells.n + 1;
+    ca_cell_off = (int *) realloc(ca_cell_off, ca_cell_off_size*sizeof(int));
+  }
+
+  for (c = 0; c < local_cells.n; c++) {
+    ca_cell_off[c] = cp_cnt;
+    p  = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)
+      if (p[i].p.q != 0.0)
+	cp_cnt++;
+  }
+  ca_cell_off[local_cells.n] = cp_cnt;
+
+  return cp_cnt;
+}
+#endif
+
 /* assign the charges */
 void p3m_charge_assign()
 {
@@ -761,48 +1098,59 @@ void p3m_charge_assign()
   /* prepare local FFT mesh */
   for(i=0; i<p3m.local_mesh.size; i++) p3m.rs_mesh[i] = 0.0;
 
+#ifdef P3M_STORE_CA_FRAC
+  cp_cnt = p3m_count_ca_charges();
+  if (cp_cnt > p3m.ca_num) p3m_realloc_ca_fields(cp_cnt);
+
+  /* the weights of different charges are independent */
+#ifdef _OPENMP
+#pragma omp parallel for private(cell, p, np, i) schedule(static)
+#endif
+  for (c = 0; c < local_cells.n; c++) {
+    int cp = ca_cell_off[c];
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i = 0; i < np; i++) {
+      if( p[i].p.q != 0.0 ) {
+	p3m.ca_fmp[cp] = p3m_calc_ca_weights(p[i].p.q, p[i].r.p, p3m.ca_frac + p3m.ca_block*cp);
+	cp++;
+      }
+    }
+  }
+
+  p3m_scatter_charges(cp_cnt);
+  p3m_shrink_wrap_charge_grid(cp_cnt);
+#else
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
     np = cell->n;
     for(i = 0; i < np; i++) {
-      if( p[i].p.q != 0.0
-	  ) {
+      if( p[i].p.q != 0.0 ) {
 	p3m_assign_charge(p[i].p.q, p[i].r.p, cp_cnt);
 	cp_cnt++;
       }
     }
   }
-#ifdef P3M_STORE_CA_FRAC
-  p3m_shrink_wrap_charge_grid(cp_cnt);
 #endif
 }
 
-void p3m_assign_charge(double q,
-		       double real_pos[3],
-		       int cp_cnt)
+int p3m_calc_ca_weights(double q, double real_pos[3], double *w)
 {
-  int d, i0, i1, i2;
-  double tmp0, tmp1;
+  int d, i, cao = p3m.params.cao;
   /* position of a particle in local mesh units */
   double pos;
   /* 1d-index of nearest mesh point */
   int nmp;
   /* distance to nearest mesh point */
-  double dist[3];
+  double dist;
   /* index for caf interpolation grid */
-  int arg[3];
-  /* index, index jumps for rs_mesh array */
+  int arg;
+  /* index of the first mesh point in the rs_mesh array */
   int q_ind = 0;
-  double cur_ca_frac_val;
-#ifdef P3M_STORE_CA_FRAC
-  double *cur_ca_frac;
-
-  // make sure we have enough space
-  if (cp_cnt >= p3m.ca_num) p3m_realloc_ca_fields(cp_cnt + 1);
-  // do it here, since p3m_realloc_ca_fields may change the address of p3m.ca_frac
-  cur_ca_frac = p3m.ca_frac + p3m.params.cao3*cp_cnt;
-#endif
+  /* the derivatives, only for analytical differentiation */
+  double *dw = w + 3*cao;
 
   for(d=0;d<3;d++) {
     /* particle position in mesh coordinates */
@@ -811,13 +1159,25 @@ void p3m_assign_charge(double q,
     nmp  = (int)pos;
     /* 3d-array index of nearest mesh point */
     q_ind = (d == 0) ? nmp : nmp + p3m.local_mesh.dim[d]*q_ind;
-    
-    if (p3m.params.inter == 0)
+
+    if (p3m.params.inter == 0) {
       /* distance to nearest mesh point */
-      dist[d] = (pos-nmp)-0.5;
-    else
+      dist = (pos-nmp)-0.5;
+      for(i=0; i<cao; i++)
+	w[d*cao + i] = p3m_caf(i, dist, cao);
+      if (p3m.params.ad)
+	for(i=0; i<cao; i++)
+	  dw[d*cao + i] = p3m_caf_derivative(i, dist, cao)*p3m.params.ai[d];
+    }
+    else {
       /* distance to nearest mesh point for interpolation */
-      arg[d] = (int) ((pos - nmp)*p3m.params.inter2);
+      arg = (int) ((pos - nmp)*p3m.params.inter2);
+      for(i=0; i<cao; i++)
+	w[d*cao + i] = p3m.int_caf[i][arg];
+      if (p3m.params.ad)
+	for(i=0; i<cao; i++)
+	  dw[d*cao + i] = p3m.int_dcaf[i][arg]*p3m.params.ai[d];
+    }
 
 #ifdef ADDITIONAL_CHECKS
     if( pos < -skin*p3m.params.ai[d] ) {
@@ -833,47 +1193,149 @@ void p3m_assign_charge(double q,
 #endif
   }
 
+  /* fold the charge into the x-weights, so that the products of the
+     weights are the charge fractions */
+  for(i=0; i<cao; i++)
+    w[i] *= q;
+  if (p3m.params.ad)
+    for(i=0; i<cao; i++)
+      dw[i] *= q;
+
+  return q_ind;
+}
+
+/* add the charge fractions of one charge to the mesh, row by row in z */
+MDINLINE void p3m_scatter_charge(int q_ind, double *w)
+{
+  int i0, i1, i2, cao = p3m.params.cao;
+  double *wy = w + cao, *wz = w + 2*cao, tmp;
+  fft_float *row;
+
+  for(i0=0; i0<cao; i0++) {
+    for(i1=0; i1<cao; i1++) {
+      tmp = w[i0]*wy[i1];
+      row = p3m.rs_mesh + q_ind;
+      for(i2=0; i2<cao; i2++)
+	row[i2] += tmp*wz[i2];
+      q_ind += p3m.local_mesh.dim[2];
+    }
+    q_ind += p3m.local_mesh.q_21_off;
+  }
+}
+
+/* interpolate the mesh at the mesh points of one charge */
+MDINLINE double p3m_gather_charge(int q_ind, double *w)
+{
+  int i0, i1, i2, cao = p3m.params.cao;
+  double *wy = w + cao, *wz = w + 2*cao, sum, res = 0.0;
+  fft_float *row;
+
+  for(i0=0; i0<cao; i0++) {
+    for(i1=0; i1<cao; i1++) {
+      row = p3m.rs_mesh + q_ind;
+      sum = 0.0;
+      for(i2=0; i2<cao; i2++)
+	sum += wz[i2]*row[i2];
+      res += w[i0]*wy[i1]*sum;
+      q_ind += p3m.local_mesh.dim[2];
+    }
+    q_ind += p3m.local_mesh.q_21_off;
+  }
+  return res;
+}
+
 #ifdef P3M_STORE_CA_FRAC
-  if (cp_cnt >= 0) p3m.ca_fmp[cp_cnt] = q_ind;
+void p3m_scatter_charges(int n_charges)
+{
+  int k;
+#ifdef _OPENMP
+  int cao = p3m.params.cao, n_planes = p3m.local_mesh.dim[0];
+  int plane = p3m.local_mesh.dim[1]*p3m.local_mesh.dim[2];
+  /* slabs of at least 2*cao planes; the last cao-1 planes of a slab
+     are also written by charges of the next lower slab, but never by
+     those of any other slab */
+  int n_slabs = imin(omp_get_max_threads(), n_planes/(2*cao));
+  int width, s, pl;
+
+  if (n_slabs > 1) {
+    width = n_planes/n_slabs;
+
+    /* sort the charges by the x-plane of their first mesh point */
+    if (n_planes + 1 > ca_plane_start_size) {
+      ca_plane_start_size = n_planes + 1;
+      ca_plane_start = (int *) realloc(ca_plane_start, ca_plane_start_size*sizeof(int));
+    }
+    if (n_charges > ca_order_size) {
+      ca_order_size = n_charges;
+      ca_order = (int *) realloc(ca_order, ca_order_size*sizeof(int));
+    }
+    for (pl = 0; pl <= n_planes; pl++)
+      ca_plane_start[pl] = 0;
+    for (k = 0; k < n_charges; k++)
+      ca_plane_start[p3m.ca_fmp[k]/plane + 1]++;
+    for (pl = 0; pl < n_planes; pl++)
+      ca_plane_start[pl + 1] += ca_plane_start[pl];
+    for (k = 0; k < n_charges; k++)
+      ca_order[ca_plane_start[p3m.ca_fmp[k]/plane]++] = k;
+    /* the increments moved the starts to the next plane */
+    for (pl = n_planes; pl > 0; pl--)
+      ca_plane_start[pl] = ca_plane_start[pl - 1];
+    ca_plane_start[0] = 0;
+
+    /* first the inner planes of all slabs, then the boundary planes */
+#pragma omp parallel private(s, k)
+    {
+      int n_threads = omp_get_num_threads(), thread = omp_get_thread_num();
+      int lo, hi, mid;
+      for (s = thread; s < n_slabs; s += n_threads) {
+	lo  = s*width;
+	hi  = (s == n_slabs - 1) ? n_planes : lo + width;
+	mid = hi - (cao - 1);
+	for (k = ca_plane_start[lo]; k < ca_plane_start[mid]; k++)
+	  p3m_scatter_charge(p3m.ca_fmp[ca_order[k]], p3m.ca_frac + p3m.ca_block*ca_order[k]);
+      }
+#pragma omp barrier
+      for (s = thread; s < n_slabs; s += n_threads) {
+	lo  = s*width;
+	hi  = (s == n_slabs - 1) ? n_planes : lo + width;
+	mid = hi - (cao - 1);
+	for (k = ca_plane_start[mid]; k < ca_plane_start[hi]; k++)
+	  p3m_scatter_charge(p3m.ca_fmp[ca_order[k]], p3m.ca_frac + p3m.ca_block*ca_order[k]);
+      }
+    }
+    return;
+  }
 #endif
-  
-  if (p3m.params.inter == 0) {
-    for(i0=0; i0<p3m.params.cao; i0++) {
-      tmp0 = p3m_caf(i0, dist[0],p3m.params.cao);
-      for(i1=0; i1<p3m.params.cao; i1++) {
-	tmp1 = tmp0 * p3m_caf(i1, dist[1],p3m.params.cao);
-	for(i2=0; i2<p3m.params.cao; i2++) {
-	  cur_ca_frac_val = q * tmp1 * p3m_caf(i2, dist[2], p3m.params.cao);
-	  p3m.rs_mesh[q_ind] += cur_ca_frac_val;
+
+  for (k = 0; k < n_charges; k++)
+    p3m_scatter_charge(p3m.ca_fmp[k], p3m.ca_frac + p3m.ca_block*k);
+}
+#endif
+
+void p3m_assign_charge(double q,
+		       double real_pos[3],
+		       int cp_cnt)
+{
+  /* weights and derivatives for cao up to 7 */
+  double w_buf[6*7], *w = w_buf;
+  int q_ind;
+
 #ifdef P3M_STORE_CA_FRAC
-	  /* store current ca frac */
-	  if (cp_cnt >= 0) *(cur_ca_frac++) = cur_ca_frac_val;
+  if (cp_cnt >= 0) {
+    // make sure we have enough space
+    if (cp_cnt >= p3m.ca_num) p3m_realloc_ca_fields(cp_cnt + 1);
+    // do it here, since p3m_realloc_ca_fields may change the address of p3m.ca_frac
+    w = p3m.ca_frac + p3m.ca_block*cp_cnt;
+  }
 #endif
-	  q_ind++;
-	}
-	q_ind += p3m.local_mesh.q_2_off;
-      }
-      q_ind += p3m.local_mesh.q_21_off;
-    }
-  } else {
-    for(i0=0; i0<p3m.params.cao; i0++) {
-      tmp0 = p3m.int_caf[i0][arg[0]];
-      for(i1=0; i1<p3m.params.cao; i1++) {
-	tmp1 = tmp0 * p3m.int_caf[i1][arg[1]];
-	for(i2=0; i2<p3m.params.cao; i2++) {
-	  cur_ca_frac_val = q * tmp1 * p3m.int_caf[i2][arg[2]];
-	  p3m.rs_mesh[q_ind] += cur_ca_frac_val;
+
+  q_ind = p3m_calc_ca_weights(q, real_pos, w);
+
 #ifdef P3M_STORE_CA_FRAC
-	  /* store current ca frac */
-	  if (cp_cnt >= 0) *(cur_ca_frac++) = cur_ca_frac_val;
+  if (cp_cnt >= 0) p3m.ca_fmp[cp_cnt] = q_ind;
 #endif
-	  q_ind++;
-	}
-	q_ind += p3m.local_mesh.q_2_off;
-      }
-      q_ind += p3m.local_mesh.q_21_off;
-    }
-  }
+
+  p3m_scatter_charge(q_ind, w);
 }
 
 #ifdef P3M_STORE_CA_FRAC
@@ -889,119 +1351,126 @@ static void P3M_assign_forces(double force_prefac, int d_rs)
 {
   Cell *cell;
   Particle *p;
-  int i,c,np,i0,i1,i2;
-  double q;
+  int i,c,np;
 #ifdef ONEPART_DEBUG
   double db_fsum=0.0; /* TODO: db_fsum was missing and code couldn't compile. Now it has the arbitrary value of 0, fix it. */ 
 #endif
-  /* charged particle counter, charge fraction counter */
-  int cp_cnt=0;
+
 #ifdef P3M_STORE_CA_FRAC
-  int cf_cnt=0;
+  /* the charges of the cells have been counted in p3m_charge_assign
+     already, but ELC assigns its own way */
+  p3m_count_ca_charges();
 #endif
-  /* index, index jumps for rs_mesh array */
-  int q_ind = 0;
-  /* distance to nearest mesh point */
-  double dist[3];
-  /* index for caf interpolation grid */
-  int arg[3];
 
+#ifdef _OPENMP
+#pragma omp parallel for private(cell, p, np, i) schedule(static)
+#endif
+  for (c = 0; c < local_cells.n; c++) {
+#ifdef P3M_STORE_CA_FRAC
+    /* charged particle counter */
+    int cp_cnt = ca_cell_off[c];
+#else
+    double w[3*7];
+#endif
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i=0; i<np; i++) { 
+      if( p[i].p.q != 0.0 ) {
+#ifdef P3M_STORE_CA_FRAC
+	p[i].f.f[d_rs] -= force_prefac*p3m_gather_charge(p3m.ca_fmp[cp_cnt], p3m.ca_frac + p3m.ca_block*cp_cnt);
+	cp_cnt++;
+#else
+	p[i].f.f[d_rs] -= force_prefac*p3m_gather_charge(p3m_calc_ca_weights(p[i].p.q, p[i].r.p, w), w);
+#endif
+
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+      }
+    }
+  }
+}
+
+
+/* assign the forces obtained from k-space by analytical differentiation,
+   i.e. from the potential mesh and the gradient of the charge assignment function */
+static void P3M_assign_forces_ad(double force_prefac)
+{
+  Cell *cell;
+  Particle *p;
+  int i,c,np;
+
+#ifdef P3M_STORE_CA_FRAC
+  p3m_count_ca_charges();
+#endif
+
+#ifdef _OPENMP
+#pragma omp parallel for private(cell, p, np, i) schedule(static)
+#endif
   for (c = 0; c < local_cells.n; c++) {
+    int d, i0, i1, i2, q_ind, cao = p3m.params.cao;
+    /* charge assignment weights and their derivatives per direction */
+    double *w, *wy, *wz, *dw, *dwy, *dwz;
+    fft_float *row;
+    double sum, dsum, force[3];
+#ifdef P3M_STORE_CA_FRAC
+    int cp_cnt = ca_cell_off[c];
+#else
+    double w_buf[6*7];
+#endif
     cell = local_cells.cell[c];
     p  = cell->part;
     np = cell->n;
     for(i=0; i<np; i++) { 
-      if( (q=p[i].p.q) != 0.0 ) {
+      if( p[i].p.q != 0.0 ) {
 #ifdef P3M_STORE_CA_FRAC
 	q_ind = p3m.ca_fmp[cp_cnt];
-	for(i0=0; i0<p3m.params.cao; i0++) {
-	  for(i1=0; i1<p3m.params.cao; i1++) {
-	    for(i2=0; i2<p3m.params.cao; i2++) {
-	      p[i].f.f[d_rs] -= force_prefac*p3m.ca_frac[cf_cnt]*p3m.rs_mesh[q_ind]; 
-	      q_ind++;
-	      cf_cnt++;
-	    }
-	    q_ind += p3m.local_mesh.q_2_off;
-	  }
-	  q_ind += p3m.local_mesh.q_21_off;
-	}
+	w = p3m.ca_frac + p3m.ca_block*cp_cnt;
 	cp_cnt++;
 #else
-	double pos;
-	int nmp;
-	double tmp0,tmp1;
-	double cur_ca_frac_val;
-	for(int d=0;d<3;d++) {
-	  /* particle position in mesh coordinates */
-	  pos    = ((p[i].r.p[d]-p3m.local_mesh.ld_pos[d])*p3m.params.ai[d]) - p3m.pos_shift;
-	  /* nearest mesh point */
-	  nmp  = (int)pos;
-	  /* 3d-array index of nearest mesh point */
-	  q_ind = (d == 0) ? nmp : nmp + p3m.local_mesh.dim[d]*q_ind;
-
-	  if (p3m.params.inter == 0)
-	    /* distance to nearest mesh point */
-	    dist[d] = (pos-nmp)-0.5;
-	  else
-	    /* distance to nearest mesh point for interpolation */
-	    arg[d] = (int)((pos-nmp)*p3m.params.inter2);
-	}
-
-	if (p3m.params.inter == 0) {
-	  for(i0=0; i0<p3m.params.cao; i0++) {
-	    tmp0 = p3m_caf(i0, dist[0],p3m.params.cao);
-	    for(i1=0; i1<p3m.params.cao; i1++) {
-	      tmp1 = tmp0 * p3m_caf(i1, dist[1],p3m.params.cao);
-	      for(i2=0; i2<p3m.params.cao; i2++) {
-		cur_ca_frac_val = q * tmp1 * p3m_caf(i2, dist[2], p3m.params.cao);
-		p[i].f.f[d_rs] -= force_prefac*cur_ca_frac_val*p3m.rs_mesh[q_ind];
-		q_ind++;
-	      }
-	      q_ind += p3m.local_mesh.q_2_off;
-	    }
-	    q_ind += p3m.local_mesh.q_21_off;
-	  }
-	} else {
-	  for(i0=0; i0<p3m.params.cao; i0++) {
-	    tmp0 = p3m.int_caf[i0][arg[0]];
-	    for(i1=0; i1<p3m.params.cao; i1++) {
-	      tmp1 = tmp0 * p3m.int_caf[i1][arg[1]];
-	      for(i2=0; i2<p3m.params.cao; i2++) {
-		cur_ca_frac_val = q * tmp1 * p3m.int_caf[i2][arg[2]];
-		p[i].f.f[d_rs] -= force_prefac*cur_ca_frac_val*p3m.rs_mesh[q_ind];
-		q_ind++;
-	      }
-	      q_ind += p3m.local_mesh.q_2_off;
+	w = w_buf;
+	q_ind = p3m_calc_ca_weights(p[i].p.q, p[i].r.p, w);
+#endif
+	wy = w + cao; wz = w + 2*cao;
+	dw = w + 3*cao; dwy = w + 4*cao; dwz = w + 5*cao;
+
+	force[0] = force[1] = force[2] = 0.0;
+	for(i0=0; i0<cao; i0++) {
+	  for(i1=0; i1<cao; i1++) {
+	    row = p3m.rs_mesh + q_ind;
+	    sum = dsum = 0.0;
+	    for(i2=0; i2<cao; i2++) {
+	      sum  +=  wz[i2]*row[i2];
+	      dsum += dwz[i2]*row[i2];
 	    }
-	    q_ind += p3m.local_mesh.q_21_off;
+	    force[0] += dw[i0]* wy[i1]*sum;
+	    force[1] +=  w[i0]*dwy[i1]*sum;
+	    force[2] +=  w[i0]* wy[i1]*dsum;
+	    q_ind += p3m.local_mesh.dim[2];
 	  }
+	  q_ind += p3m.local_mesh.q_21_off;
 	}
-#endif
 
-	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+	for(d=0;d<3;d++)
+	  p[i].f.f[d] -= force_prefac*force[d];
+
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2]));
       }
     }
   }
 }
 
-
-
-double p3m_calc_kspace_forces(int force_flag, int energy_flag)
+/** k-space energy and forces of a single charge mesh, which has
+    already been assigned. Returns the energy contribution of this
+    node. If \a split is set, the back transforms are only started,
+    and the forces are assigned by \ref p3m_calc_kspace_forces_finish. */
+static double p3m_calc_kspace_mesh(int force_flag, int energy_flag, double force_prefac, int split)
 {
     int i,d,d_rs,ind,j[3];
-    /**************************************************************/
-    /* Prefactor for force */
-    double force_prefac;
     /* k space energy */
-    double k_space_energy=0.0, node_k_space_energy=0.0;
+    double node_k_space_energy=0.0;
     /* directions */
     double *d_operator = NULL;
 
-    P3M_TRACE(fprintf(stderr,"%d: p3m_perform: \n",this_node));
-//     fprintf(stderr, "calculating kspace forces\n");
-
-    force_prefac = coulomb.prefactor / ( 2 * box_l[0] * box_l[1] * box_l[2] );
-
     /* Gather information for FFT grid inside the nodes domain (inner local mesh) */
     /* and Perform forward 3D FFT (Charge Assignment Mesh). */
     if (p3m.sum_q2 > 0) {
@@ -1012,6 +1481,7 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
 
     /* === K Space Calculations === */
     P3M_TRACE(fprintf(stderr,"%d: p3m_perform: k-Space\n",this_node));
+    p3m_check_influence_functions();
 
     /* === K Space Energy Calculation  === */
 //     if(energy_flag && p3m.sum_q2 > 0) {
@@ -1021,20 +1491,17 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
         **********************/
 
 
-      for(i=0;i<fft.plan[3].new_size;i++) {
-        // Use the energy optimized influence function for energy!
-        node_k_space_energy += p3m.g_energy[i] * ( SQR(p3m.rs_mesh[2*i]) + SQR(p3m.rs_mesh[2*i+1]) );
+      i = 0;
+      for(j[0]=0; j[0]<fft.plan[3].new_mesh[0]; j[0]++) {
+        for(j[1]=0; j[1]<fft.plan[3].new_mesh[1]; j[1]++) {
+          for(j[2]=0; j[2]<fft.plan[3].new_mesh[2]; j[2]++) {
+            // Use the energy optimized influence function for energy!
+            node_k_space_energy += fft_mode_weight(&fft, j) * p3m.g_energy[i] * ( SQR(p3m.rs_mesh[2*i]) + SQR(p3m.rs_mesh[2*i+1]) );
+            i++;
+          }
+        }
       }
         node_k_space_energy *= force_prefac;
-
-        MPI_Reduce(&node_k_space_energy, &k_space_energy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-        if(this_node==0) {
-            /* self energy correction */
-            k_space_energy -= coulomb.prefactor*(p3m.sum_q2 * p3m.params.alpha * wupii);
-            /* net charge correction */
-            k_space_energy -= coulomb.prefactor* p3m.square_sum_q * PI / (2.0*box_l[0]*box_l[1]*box_l[2]*SQR(p3m.params.alpha));
-        }
-
     } /* if (energy_flag) */
 
     /* === K Space Force Calculation  === */
@@ -1042,46 +1509,87 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
        /***************************
         COULOMB FORCES (k-space)
         ****************************/
-        /* Force preparation */
-        ind = 0;
-        /* apply the influence function */
-        for(i=0; i<fft.plan[3].new_size; i++) {
-            p3m.ks_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
-            p3m.ks_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
-        } 
-
-        /* === 3 Fold backward 3D FFT (Force Component Meshs) === */
-
-        /* Force component loop */
-        for(d=0;d<3;d++) {
-            if (d == KX)
-                d_operator = p3m.d_op[RX];
-            else if (d == KY)
-                d_operator = p3m.d_op[RY];
-            else if (d == KZ)
-                d_operator = p3m.d_op[RZ];
-
-            /* direction in k space: */
-            d_rs = (d+p3m.ks_pnum)%3;
-            /* srqt(-1)*k differentiation */
-            ind=0;
-            for(j[0]=0; j[0]<fft.plan[3].new_mesh[0]; j[0]++) {
-                for(j[1]=0; j[1]<fft.plan[3].new_mesh[1]; j[1]++) {
-                    for(j[2]=0; j[2]<fft.plan[3].new_mesh[2]; j[2]++) {
-                        /* i*k*(Re+i*Im) = - Im*k + i*Re*k     (i=sqrt(-1)) */
-                        p3m.rs_mesh[ind] = -2.0*PI*(p3m.ks_mesh[ind+1] * d_operator[ j[d]+fft.plan[3].start[d] ])/box_l[d_rs]; 
-			ind++;
-                        p3m.rs_mesh[ind] =   2.0*PI*p3m.ks_mesh[ind-1] * d_operator[ j[d]+fft.plan[3].start[d] ]/box_l[d_rs];  
-			ind++;
+        if (p3m.params.ad) {
+            /* === single backward 3D FFT (Potential Mesh) === */
+            ind = 0;
+            /* apply the influence function */
+            for(i=0; i<fft.plan[3].new_size; i++) {
+                p3m.rs_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
+                p3m.rs_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
+            }
+            if (split) {
+                fft_perform_back_start(p3m.rs_mesh, 0);
+                return node_k_space_energy;
+            }
+            fft_perform_back(p3m.rs_mesh);              /* Back FFT potential mesh */
+            p3m_spread_force_grid(p3m.rs_mesh);         /* redistribute potential mesh */
+            P3M_assign_forces_ad(force_prefac);         /* forces from the gradient of the assignment function */
+        }
+        else {
+            /* Force preparation */
+            ind = 0;
+            /* apply the influence function */
+            for(i=0; i<fft.plan[3].new_size; i++) {
+                p3m.ks_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
+                p3m.ks_mesh[ind] = p3m.g_force[i] * p3m.rs_mesh[ind]; ind++;
+            } 
+
+            /* === 3 Fold backward 3D FFT (Force Component Meshs) === */
+
+            /* Force component loop */
+            for(d=0;d<3;d++) {
+                if (d == KX)
+                    d_operator = p3m.d_op[RX];
+                else if (d == KY)
+                    d_operator = p3m.d_op[RY];
+                else if (d == KZ)
+                    d_operator = p3m.d_op[RZ];
+
+                /* direction in k space: */
+                d_rs = (d+p3m.ks_pnum)%3;
+                /* srqt(-1)*k differentiation */
+                ind=0;
+                for(j[0]=0; j[0]<fft.plan[3].new_mesh[0]; j[0]++) {
+                    for(j[1]=0; j[1]<fft.plan[3].new_mesh[1]; j[1]++) {
+                        for(j[2]=0; j[2]<fft.plan[3].new_mesh[2]; j[2]++) {
+                            /* i*k*(Re+i*Im) = - Im*k + i*Re*k     (i=sqrt(-1)) */
+                            p3m.rs_mesh[ind] = -2.0*PI*(p3m.ks_mesh[ind+1] * d_operator[ j[d]+fft.plan[3].start[d] ])/box_l[d_rs]; 
+			    ind++;
+                            p3m.rs_mesh[ind] =   2.0*PI*p3m.ks_mesh[ind-1] * d_operator[ j[d]+fft.plan[3].start[d] ]/box_l[d_rs];  
+			    ind++;
+                        }
                     }
                 }
+                if (split) {
+                    fft_perform_back_start(p3m.rs_mesh, d);
+                    continue;
+                }
+                fft_perform_back(p3m.rs_mesh);              /* Back FFT force component mesh */
+                p3m_spread_force_grid(p3m.rs_mesh);             /* redistribute force component mesh */
+                P3M_assign_forces(force_prefac, d_rs);  /* Assign force component from mesh to particle */
             }
-            fft_perform_back(p3m.rs_mesh);              /* Back FFT force component mesh */
-            p3m_spread_force_grid(p3m.rs_mesh);             /* redistribute force component mesh */
-            P3M_assign_forces(force_prefac, d_rs);  /* Assign force component from mesh to particle */
         }
     } /* if(force_flag) */
 
+    return node_k_space_energy;
+}
+
+/** energy of this node from p3m_calc_kspace_mesh, which has to be
+    summed up, with the self energy, net charge and dipole term corrections */
+static double p3m_sum_kspace_energy(double node_k_space_energy, int force_flag, int energy_flag)
+{
+    double k_space_energy=0.0;
+
+    if (energy_flag) {
+        MPI_Reduce(&node_k_space_energy, &k_space_energy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        if(this_node==0) {
+            /* self energy correction */
+            k_space_energy -= coulomb.prefactor*(p3m.sum_q2 * p3m.params.alpha * wupii);
+            /* net charge correction */
+            k_space_energy -= coulomb.prefactor* p3m.square_sum_q * PI / (2.0*box_l[0]*box_l[1]*box_l[2]*SQR(p3m.params.alpha));
+        }
+    }
+
     if (p3m.params.epsilon != P3M_EPSILON_METALLIC) {
       k_space_energy += p3m_calc_dipole_term(force_flag, energy_flag);
     }
@@ -1089,6 +1597,74 @@ double p3m_calc_kspace_forces(int force_flag, int energy_flag)
     return k_space_energy;
 }
 
+double p3m_calc_kspace_forces(int force_flag, int energy_flag)
+{
+    /**************************************************************/
+    /* Prefactor for force */
+    double force_prefac;
+    /* k space energy */
+    double node_k_space_energy=0.0;
+
+    P3M_TRACE(fprintf(stderr,"%d: p3m_perform: \n",this_node));
+
+    force_prefac = coulomb.prefactor / ( 2 * box_l[0] * box_l[1] * box_l[2] );
+
+    if (p3m.params.interlace) {
+        /* average over the assigned mesh and a second one, shifted by half a mesh constant */
+        node_k_space_energy = p3m_calc_kspace_mesh(force_flag, energy_flag, 0.5*force_prefac, 0);
+        p3m_shift_mesh(1);
+        p3m_charge_assign();
+        node_k_space_energy += p3m_calc_kspace_mesh(force_flag, energy_flag, 0.5*force_prefac, 0);
+        p3m_shift_mesh(0);
+    }
+    else
+        node_k_space_energy = p3m_calc_kspace_mesh(force_flag, energy_flag, force_prefac, 0);
+
+    return p3m_sum_kspace_energy(node_k_space_energy, force_flag, energy_flag);
+}
+
+int p3m_kspace_split_applicable()
+{
+    return coulomb.method == COULOMB_P3M && fft.n_fft_nodes < n_nodes && !p3m.params.interlace;
+}
+
+/** this node's part of the energy, between \ref
+    p3m_calc_kspace_forces_start and \ref p3m_calc_kspace_forces_finish. */
+static double p3m_split_energy = 0.0;
+
+void p3m_calc_kspace_forces_start(int energy_flag)
+{
+    double force_prefac = coulomb.prefactor / ( 2 * box_l[0] * box_l[1] * box_l[2] );
+
+    P3M_TRACE(fprintf(stderr,"%d: p3m_calc_kspace_forces_start: \n",this_node));
+    p3m_split_energy = p3m_calc_kspace_mesh(1, energy_flag, force_prefac, 1);
+}
+
+double p3m_calc_kspace_forces_finish(int energy_flag)
+{
+    int d, d_rs;
+    double force_prefac = coulomb.prefactor / ( 2 * box_l[0] * box_l[1] * box_l[2] );
+
+    P3M_TRACE(fprintf(stderr,"%d: p3m_calc_kspace_forces_finish: \n",this_node));
+    if (p3m.sum_q2 > 0) {
+        if (p3m.params.ad) {
+            fft_perform_back_finish(p3m.rs_mesh, 0);
+            p3m_spread_force_grid(p3m.rs_mesh);
+            P3M_assign_forces_ad(force_prefac);
+        }
+        else {
+            for(d=0;d<3;d++) {
+                d_rs = (d+p3m.ks_pnum)%3;
+                fft_perform_back_finish(p3m.rs_mesh, d);
+                p3m_spread_force_grid(p3m.rs_mesh);
+                P3M_assign_forces(force_prefac, d_rs);
+            }
+        }
+    }
+
+    return p3m_sum_kspace_energy(p3m_split_energy, 1, energy_flag);
+}
+
 
 /************************************************************/
 
@@ -1135,11 +1711,11 @@ double p3m_calc_dipole_term(int force_flag, int energy_flag)
 
 /************************************************************/
 
-void p3m_gather_fft_grid(double* themesh)
+void p3m_gather_fft_grid(fft_float* themesh)
 {
   int s_dir,r_dir,evenodd;
   MPI_Status status;
-  double *tmp_ptr;
+  fft_float *tmp_ptr;
 
   P3M_TRACE(fprintf(stderr,"%d: p3m_gather_fft_grid:\n",this_node));
 
@@ -1156,12 +1732,12 @@ void p3m_gather_fft_grid(double* themesh)
       for(evenodd=0; evenodd<2;evenodd++) {
 	if((node_pos[s_dir/2]+evenodd)%2==0) {
 	  if(p3m.sm.s_size[s_dir]>0) 
-	    MPI_Send(p3m.send_grid, p3m.sm.s_size[s_dir], MPI_DOUBLE, 
+	    MPI_Send(p3m.send_grid, p3m.sm.s_size[s_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[s_dir], REQ_P3M_GATHER, MPI_COMM_WORLD);
 	}
 	else {
 	  if(p3m.sm.r_size[r_dir]>0) 
-	    MPI_Recv(p3m.recv_grid, p3m.sm.r_size[r_dir], MPI_DOUBLE, 
+	    MPI_Recv(p3m.recv_grid, p3m.sm.r_size[r_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[r_dir], REQ_P3M_GATHER, MPI_COMM_WORLD, &status); 	    
 	}
       }
@@ -1179,11 +1755,11 @@ void p3m_gather_fft_grid(double* themesh)
 }
 
 
-void p3m_spread_force_grid(double* themesh)
+void p3m_spread_force_grid(fft_float* themesh)
 {
   int s_dir,r_dir,evenodd;
   MPI_Status status;
-  double *tmp_ptr;
+  fft_float *tmp_ptr;
   P3M_TRACE(fprintf(stderr,"%d: p3m_spread_force_grid:\n",this_node));
 
   /* direction loop */
@@ -1198,12 +1774,12 @@ void p3m_spread_force_grid(double* themesh)
       for(evenodd=0; evenodd<2;evenodd++) {
 	if((node_pos[r_dir/2]+evenodd)%2==0) {
 	  if(p3m.sm.r_size[r_dir]>0) 
-	    MPI_Send(p3m.send_grid, p3m.sm.r_size[r_dir], MPI_DOUBLE, 
+	    MPI_Send(p3m.send_grid, p3m.sm.r_size[r_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[r_dir], REQ_P3M_SPREAD, MPI_COMM_WORLD);
    	}
 	else {
 	  if(p3m.sm.s_size[s_dir]>0) 
-	    MPI_Recv(p3m.recv_grid, p3m.sm.s_size[s_dir], MPI_DOUBLE, 
+	    MPI_Recv(p3m.recv_grid, p3m.sm.s_size[s_dir], MPI_FFT_FLOAT, 
 		     node_neighbors[s_dir], REQ_P3M_SPREAD, MPI_COMM_WORLD, &status); 	    
 	}
       }
@@ -1229,7 +1805,7 @@ void p3m_realloc_ca_fields(int newsize)
 
   P3M_TRACE(fprintf(stderr,"%d: p3m_realloc_ca_fields: old_size=%d -> new_size=%d\n",this_node,p3m.ca_num,newsize));
   p3m.ca_num = newsize;
-  p3m.ca_frac = (double *)realloc(p3m.ca_frac, p3m.params.cao3*p3m.ca_num*sizeof(double));
+  p3m.ca_frac = (double *)realloc(p3m.ca_frac, p3m.ca_block*p3m.ca_num*sizeof(double));
   p3m.ca_fmp  = (int *)realloc(p3m.ca_fmp, p3m.ca_num*sizeof(int));
     
 } 
@@ -1262,6 +1838,61 @@ void p3m_calc_meshift(void)
 }
 
 
+void p3m_calc_interlace_sums(void)
+{
+    int d, j, n;
+    double *meshift[3] = { p3m.meshift_x, p3m.meshift_y, p3m.meshift_z };
+    double mesh_i, fac;
+
+    for (d = 0; d < 3; d++) {
+        mesh_i = 1.0/p3m.params.mesh[d];
+        p3m.il_sums[d] = (double *) realloc(p3m.il_sums[d], 4*p3m.params.mesh[d]*sizeof(double));
+        for (j = 0; j < p3m.params.mesh[d]; j++) {
+            n = (int)meshift[d][j];
+            p3m.il_sums[d][4*j]   = p3m_analytic_cotangent_sum(n, mesh_i, p3m.params.cao);
+            p3m.il_sums[d][4*j+1] = p3m_alternating_cotangent_sum(n, mesh_i, p3m.params.cao);
+            /* Sum_m sinc^(2cao)(x+m) (x+m)^2 = sin^2(pi x)/pi^2 Sum_m sinc^(2cao-2)(x+m),
+               only needed for analytical differentiation, i.e. cao > 1 */
+            if (p3m.params.cao > 1) {
+                fac = SQR(sin(PI*n*mesh_i)/(PI*mesh_i*box_l[d]));
+                p3m.il_sums[d][4*j+2] = fac*p3m_analytic_cotangent_sum(n, mesh_i, p3m.params.cao - 1);
+                p3m.il_sums[d][4*j+3] = fac*p3m_alternating_cotangent_sum(n, mesh_i, p3m.params.cao - 1);
+            }
+            else
+                p3m.il_sums[d][4*j+2] = p3m.il_sums[d][4*j+3] = 0.0;
+        }
+    }
+}
+
+/** interlaced denominator of the influence functions: half the sum of
+    the aliasing products for equal and for alternating signs. For \a
+    ad, the second factor carries k^2 as for analytical differentiation. */
+static double p3m_interlaced_denominator(int n[3], int ad)
+{
+    double *sx = p3m.il_sums[RX] + 4*n[KX], *sy = p3m.il_sums[RY] + 4*n[KY], *sz = p3m.il_sums[RZ] + 4*n[KZ];
+    double den = 0.0;
+    int s;
+
+    /* s = 0: equal signs, s = 1: alternating signs */
+    for (s = 0; s < 2; s++) {
+        if (ad)
+            den += sx[s]*sy[s]*sz[s] *
+                (sx[s+2]*sy[s]*sz[s] + sx[s]*sy[s+2]*sz[s] + sx[s]*sy[s]*sz[s+2]);
+        else
+            den += SQR(sx[s]*sy[s]*sz[s]);
+    }
+    return 0.5*den;
+}
+
+void p3m_shift_mesh(int shifted)
+{
+    int i;
+
+    p3m_calc_lm_ld_pos();
+    if (shifted)
+        for (i = 0; i < 3; i++)
+            p3m.local_mesh.ld_pos[i] -= 0.5*p3m.params.a[i];
+}
 
 void p3m_calc_differential_operator()
 {
@@ -1288,12 +1919,14 @@ void p3m_calc_influence_function_force()
     double nominator[3] = {0.0, 0.0, 0.0}, denominator = 0.0;
 
     p3m_calc_meshift();
+    if (p3m.params.interlace)
+        p3m_calc_interlace_sums();
 
     for(i=0;i<3;i++) {
         size *= fft.plan[3].new_mesh[i];
         end[i] = fft.plan[3].start[i] + fft.plan[3].new_mesh[i];
     }
-    p3m.g_force = (double *) realloc(p3m.g_force, size*sizeof(double));
+    p3m.g_force = (fft_float *) realloc(p3m.g_force, size*sizeof(fft_float));
 
     for(n[0]=fft.plan[3].start[0]; n[0]<end[0]; n[0]++) {
         for(n[1]=fft.plan[3].start[1]; n[1]<end[1]; n[1]++) {
@@ -1305,6 +1938,9 @@ void p3m_calc_influence_function_force()
                 if( (n[KX]%(p3m.params.mesh[RX]/2)==0) && (n[KY]%(p3m.params.mesh[RY]/2)==0) && (n[KZ]%(p3m.params.mesh[RZ]/2)==0) ) {
                     p3m.g_force[ind] = 0.0;
                 }
+                else if (p3m.params.ad) {
+                    p3m.g_force[ind] = 2*p3m_perform_aliasing_sums_force_ad(n)/(PI);
+                }
                 else {
                     denominator = p3m_perform_aliasing_sums_force(n,nominator);
 
@@ -1351,11 +1987,49 @@ double p3m_perform_aliasing_sums_force(int n[3], double numerator[3])
                 numerator[RY] += f2*nmy/box_l[RY];
                 numerator[RZ] += f2*nmz/box_l[RZ];
 
-                denominator  += sz;
+                denominator  += sz;
+            }
+        }
+    }
+    /* the caller squares the denominator */
+    if (p3m.params.interlace)
+        return sqrt(p3m_interlaced_denominator(n, 0));
+    return denominator;
+}
+
+double p3m_perform_aliasing_sums_force_ad(int n[3])
+{
+    double numerator = 0.0, denominator1 = 0.0, denominator2 = 0.0;
+    /* lots of temporary variables... */
+    double sx, sy, sz, f1, f2, mx, my, mz, nmx, nmy, nmz, nm2, expo;
+    double limit = 30;
+
+    f1 = SQR(PI/(p3m.params.alpha));
+
+    for(mx = -P3M_BRILLOUIN; mx <= P3M_BRILLOUIN; mx++) {
+        nmx = p3m.meshift_x[n[KX]] + p3m.params.mesh[RX]*mx;
+        sx  = pow(sinc(nmx/(double)p3m.params.mesh[RX]),2.0*p3m.params.cao);
+        for(my = -P3M_BRILLOUIN; my <= P3M_BRILLOUIN; my++) {
+            nmy = p3m.meshift_y[n[KY]] + p3m.params.mesh[RY]*my;
+            sy  = sx*pow(sinc(nmy/(double)p3m.params.mesh[RY]),2.0*p3m.params.cao);
+            for(mz = -P3M_BRILLOUIN; mz <= P3M_BRILLOUIN; mz++) {
+                nmz = p3m.meshift_z[n[KZ]] + p3m.params.mesh[RZ]*mz;
+                sz  = sy*pow(sinc(nmz/(double)p3m.params.mesh[RZ]),2.0*p3m.params.cao);
+
+                nm2          =  SQR(nmx/box_l[RX]) + SQR(nmy/box_l[RY]) + SQR(nmz/box_l[RZ]);
+                expo         =  f1*nm2;
+                /* U^2 k_m.R(k_m), the ad operator is k_m itself */
+                f2           =  (expo<limit) ? sz*exp(-expo) : 0.0;
+
+                numerator    += f2;
+                denominator1 += sz;
+                denominator2 += sz*nm2;
             }
         }
     }
-    return denominator;
+    if (p3m.params.interlace)
+        return numerator/p3m_interlaced_denominator(n, 1);
+    return numerator/(denominator1*denominator2);
 }
 
 void p3m_calc_influence_function_energy()
@@ -1365,6 +2039,8 @@ void p3m_calc_influence_function_energy()
     int size=1;
 
     p3m_calc_meshift();
+    if (p3m.params.interlace)
+        p3m_calc_interlace_sums();
 
     for(i = 0; i < 3; i++) {
       size *= fft.plan[3].new_mesh[i];
@@ -1372,7 +2048,7 @@ void p3m_calc_influence_function_energy()
       start[i] = fft.plan[3].start[i];
     }
 
-    p3m.g_energy = (double *) realloc(p3m.g_energy, size*sizeof(double));
+    p3m.g_energy = (fft_float *) realloc(p3m.g_energy, size*sizeof(fft_float));
     ind = 0;
 
 
@@ -1423,9 +2099,259 @@ double p3m_perform_aliasing_sums_energy(int n[3])
         }
     }
 
+    if (p3m.params.interlace)
+        return numerator/p3m_interlaced_denominator(n, 0);
     return numerator/SQR(denominator);
 }
 
+/************************************************
+ * Influence function cache
+ ************************************************/
+
+/** Everything the influence functions of a node depend on, except for
+    the box length itself. */
+typedef struct {
+  int mesh[3];
+  int cao;
+  int ad;
+  int interlace;
+  /** local part of the k-space mesh, fft.plan[3] */
+  int start[3];
+  int size[3];
+  /** sizeof(fft_float), so that files of the other mesh precision
+      are not used */
+  int float_size;
+  /** alpha * box_l[0] */
+  double alpha_L;
+  /** box_l[1] / box_l[0] and box_l[2] / box_l[0] */
+  double aspect[2];
+} p3m_influence_key;
+
+typedef struct {
+  p3m_influence_key key;
+  /** box_l[0] for which g_force and g_energy were calculated */
+  double box_l;
+  fft_float *g_force;
+  fft_float *g_energy;
+  /** whether the entry was written to or read from its file */
+  int on_disk;
+} p3m_influence_entry;
+
+/** number of influence function pairs kept in memory per node */
+#define P3M_INFLUENCE_CACHE_SIZE 4
+/** relative tolerance for comparing the floating point keys */
+#define P3M_INFLUENCE_KEY_EPS 1e-10
+
+static p3m_influence_entry p3m_influence_cache[P3M_INFLUENCE_CACHE_SIZE];
+/** slot that is overwritten next */
+static int p3m_influence_cache_next = 0;
+
+/** key and box length of the current p3m.g_force and p3m.g_energy */
+static p3m_influence_key p3m_g_key;
+static double p3m_g_box_l = 0;
+static int p3m_g_valid = 0;
+
+static void p3m_influence_make_key(p3m_influence_key *key)
+{
+  int i;
+  memset(key, 0, sizeof(p3m_influence_key));
+  for (i = 0; i < 3; i++) {
+    key->mesh[i]  = p3m.params.mesh[i];
+    key->start[i] = fft.plan[3].start[i];
+    key->size[i]  = fft.plan[3].new_mesh[i];
+  }
+  key->cao       = p3m.params.cao;
+  key->ad        = p3m.params.ad;
+  key->interlace = p3m.params.interlace;
+  key->float_size = sizeof(fft_float);
+  key->alpha_L   = p3m.params.alpha*box_l[0];
+  key->aspect[0] = box_l[1]/box_l[0];
+  key->aspect[1] = box_l[2]/box_l[0];
+}
+
+static int p3m_influence_key_equal(double a, double b)
+{
+  return fabs(a - b) <= P3M_INFLUENCE_KEY_EPS*fabs(a);
+}
+
+/** whether the influence functions for key a can be obtained from
+    those for key b by rescaling. */
+static int p3m_influence_key_match(p3m_influence_key *a, p3m_influence_key *b)
+{
+  int i;
+  for (i = 0; i < 3; i++)
+    if (a->mesh[i] != b->mesh[i] || a->start[i] != b->start[i] || a->size[i] != b->size[i])
+      return 0;
+  return a->cao == b->cao && a->ad == b->ad && a->interlace == b->interlace &&
+    a->float_size == b->float_size &&
+    p3m_influence_key_equal(a->alpha_L, b->alpha_L) &&
+    p3m_influence_key_equal(a->aspect[0], b->aspect[0]) &&
+    p3m_influence_key_equal(a->aspect[1], b->aspect[1]);
+}
+
+static int p3m_influence_size(p3m_influence_key *key)
+{
+  return key->size[0]*key->size[1]*key->size[2];
+}
+
+/** file in the working directory in which a node keeps the influence
+    functions for the given key, if \ref p3m_parameter_struct::influence_cache is set. */
+static void p3m_influence_file_name(char *name, p3m_influence_key *key)
+{
+  sprintf(name, "p3m_influence_m%dx%dx%d_c%d_%s%s_a%.10g_n%d_%d.dat",
+	  key->mesh[0], key->mesh[1], key->mesh[2], key->cao,
+	  key->ad ? "ad" : "ik", key->interlace ? "_il" : "",
+	  key->alpha_L, this_node, n_nodes);
+}
+
+static int p3m_influence_read_file(p3m_influence_entry *e, p3m_influence_key *key)
+{
+  char name[256];
+  FILE *f;
+  int size = p3m_influence_size(key), ok;
+
+  p3m_influence_file_name(name, key);
+  if ((f = fopen(name, "r")) == NULL)
+    return 0;
+  ok = fread(&e->key, sizeof(p3m_influence_key), 1, f) == 1 &&
+    p3m_influence_key_match(&e->key, key) &&
+    fread(&e->box_l, sizeof(double), 1, f) == 1;
+  if (ok) {
+    e->g_force  = realloc(e->g_force, size*sizeof(fft_float));
+    e->g_energy = realloc(e->g_energy, size*sizeof(fft_float));
+    ok = fread(e->g_force, sizeof(fft_float), size, f) == size &&
+      fread(e->g_energy, sizeof(fft_float), size, f) == size;
+  }
+  fclose(f);
+  e->on_disk = ok;
+
+  P3M_TRACE(fprintf(stderr, "%d: influence function file %s %s\n", this_node, name, ok ? "read" : "does not match"));
+  return ok;
+}
+
+static void p3m_influence_write_file(p3m_influence_entry *e)
+{
+  char name[256];
+  FILE *f;
+  int size = p3m_influence_size(&e->key);
+
+  p3m_influence_file_name(name, &e->key);
+  if ((f = fopen(name, "w")) == NULL)
+    return;
+  fwrite(&e->key, sizeof(p3m_influence_key), 1, f);
+  fwrite(&e->box_l, sizeof(double), 1, f);
+  fwrite(e->g_force, sizeof(fft_float), size, f);
+  fwrite(e->g_energy, sizeof(fft_float), size, f);
+  fclose(f);
+  e->on_disk = 1;
+}
+
+/** copy influence functions for box length box_l_0 into p3m.g_force
+    and p3m.g_energy, rescaled to the current box. */
+static void p3m_influence_fetch(fft_float *g_force, fft_float *g_energy, double box_l_0, int size)
+{
+  int i;
+  double scale = SQR(box_l[0]/box_l_0);
+  for (i = 0; i < size; i++) {
+    p3m.g_force[i]  = scale*g_force[i];
+    p3m.g_energy[i] = scale*g_energy[i];
+  }
+}
+
+void p3m_calc_influence_functions()
+{
+  p3m_influence_key key;
+  p3m_influence_entry *e;
+  int i, size;
+
+  p3m_influence_make_key(&key);
+  size = p3m_influence_size(&key);
+
+  p3m.g_force  = (fft_float *) realloc(p3m.g_force, size*sizeof(fft_float));
+  p3m.g_energy = (fft_float *) realloc(p3m.g_energy, size*sizeof(fft_float));
+
+  p3m_g_key   = key;
+  p3m_g_box_l = box_l[0];
+  p3m_g_valid = 1;
+
+  for (i = 0; i < P3M_INFLUENCE_CACHE_SIZE; i++) {
+    e = &p3m_influence_cache[i];
+    if (e->g_force && p3m_influence_key_match(&e->key, &key)) {
+      P3M_TRACE(fprintf(stderr, "%d: influence functions from cache slot %d\n", this_node, i));
+      p3m_influence_fetch(e->g_force, e->g_energy, e->box_l, size);
+      if (p3m.params.influence_cache && !e->on_disk)
+	p3m_influence_write_file(e);
+      return;
+    }
+  }
+
+  e = &p3m_influence_cache[p3m_influence_cache_next];
+  p3m_influence_cache_next = (p3m_influence_cache_next + 1) % P3M_INFLUENCE_CACHE_SIZE;
+
+  e->on_disk = 0;
+  if (p3m.params.influence_cache && p3m_influence_read_file(e, &key)) {
+    p3m_influence_fetch(e->g_force, e->g_energy, e->box_l, size);
+    return;
+  }
+
+  p3m_calc_influence_function_force();
+  p3m_calc_influence_function_energy();
+
+  e->key   = key;
+  e->box_l = box_l[0];
+  e->g_force  = realloc(e->g_force, size*sizeof(fft_float));
+  e->g_energy = realloc(e->g_energy, size*sizeof(fft_float));
+  memcpy(e->g_force, p3m.g_force, size*sizeof(fft_float));
+  memcpy(e->g_energy, p3m.g_energy, size*sizeof(fft_float));
+
+  if (p3m.params.influence_cache)
+    p3m_influence_write_file(e);
+}
+
+void p3m_invalidate_influence_functions()
+{
+  p3m_g_valid = 0;
+}
+
+void p3m_check_influence_functions()
+{
+  if (!p3m_g_valid)
+    p3m_calc_influence_functions();
+}
+
+void p3m_scale_influence_functions()
+{
+  p3m_influence_key key;
+  int i, size;
+  double scale;
+
+  if (!p3m_g_valid)
+    return;
+
+  p3m_influence_make_key(&key);
+  /* parameters changed, p3m_init will set up new ones */
+  for (i = 0; i < 3; i++)
+    if (key.mesh[i] != p3m_g_key.mesh[i] || key.start[i] != p3m_g_key.start[i] || key.size[i] != p3m_g_key.size[i])
+      return;
+  if (key.cao != p3m_g_key.cao || key.ad != p3m_g_key.ad || key.interlace != p3m_g_key.interlace ||
+      !p3m_influence_key_equal(key.alpha_L, p3m_g_key.alpha_L))
+    return;
+
+  if (!p3m_influence_key_match(&key, &p3m_g_key)) {
+    /* the box aspect ratio changed */
+    p3m_calc_influence_functions();
+    return;
+  }
+
+  size  = p3m_influence_size(&key);
+  scale = SQR(box_l[0]/p3m_g_box_l);
+  for (i = 0; i < size; i++) {
+    p3m.g_force[i]  *= scale;
+    p3m.g_energy[i] *= scale;
+  }
+  p3m_g_box_l = box_l[0];
+}
+
 
 
 /************************************************
@@ -1463,6 +2389,9 @@ static double p3m_get_accuracy(int mesh[3], int cao, double r_cut_iL, double *_a
   /* calculate real space and k space error for this alpha_L */
   rs_err = p3m_real_space_error(coulomb.prefactor,r_cut_iL,p3m.sum_qpart,p3m.sum_q2,alpha_L);
   ks_err = p3m_k_space_error(coulomb.prefactor,mesh,cao,p3m.sum_qpart,p3m.sum_q2,alpha_L);
+#ifdef P3M_SINGLE_PRECISION
+  ks_err = sqrt(SQR(ks_err) + SQR(p3m_k_space_rounding_error(coulomb.prefactor,mesh,p3m.sum_qpart,p3m.sum_q2,alpha_L)));
+#endif
 
   *_rs_err = rs_err;
   *_ks_err = ks_err;
@@ -1493,22 +2422,37 @@ static double p3m_mcr_time(int mesh[3], int cao, double r_cut_iL, double alpha_L
   return int_time;
 }
 
-/** get the optimal alpha and the corresponding computation time for fixed mesh, cao. The r_cut is determined via
-    a simple bisection. Returns -1 if the force evaluation does not work, -2 if there is no valid r_cut, and -3 if
-    the charge assigment order is to large for this grid */
-static double p3m_mc_time(Tcl_Interp *interp, int mesh[3], int cao,
-                         double r_cut_iL_min, double r_cut_iL_max, double *_r_cut_iL,
-                         double *_alpha_L, double *_accuracy)
+/** print one line of the tuning table, closed by msg */
+static void p3m_tune_print_line(Tcl_Interp *interp, int mesh[3], int cao, double r_cut_iL,
+				double alpha_L, double accuracy, double rs_err, double ks_err, char *msg)
+{
+  char b1[TCL_DOUBLE_SPACE + 12],b2[TCL_DOUBLE_SPACE + 12],b3[TCL_DOUBLE_SPACE + 12];
+  sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
+  Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
+  sprintf(b1,"%.5e",r_cut_iL); sprintf(b2,"%.5e",alpha_L); sprintf(b3,"%.5e",accuracy);
+  Tcl_AppendResult(interp, b1,"  ", b2,"  ",b3," ", (char *) NULL);
+  sprintf(b1,"%.3e",rs_err); sprintf(b2,"%.3e",ks_err);
+  Tcl_AppendResult(interp, b1,"  ", b2,"  ", msg, "\n", (char *) NULL);
+}
+
+/** get the optimal alpha and the smallest r_cut that reaches the
+    accuracy for fixed mesh and cao. The r_cut is determined via a
+    simple bisection. Returns 0 on success, -3 if the charge assigment
+    order is too large for this grid, -2 if there is no valid r_cut,
+    and -P3M_TUNE_ELCTEST or -P3M_TUNE_CUTOFF_TOO_LARGE if the r_cut
+    conflicts with ELC or the cell system. */
+static int p3m_mc_rcut(Tcl_Interp *interp, int mesh[3], int cao,
+		       double r_cut_iL_min, double r_cut_iL_max, double *_r_cut_iL,
+		       double *_alpha_L, double *_accuracy, double *_rs_err, double *_ks_err)
 {
-  double int_time;
   double r_cut_iL;
-  double rs_err, ks_err, mesh_size, k_cut;
+  double mesh_size, k_cut;
   int i, n_cells;
-  char b1[TCL_DOUBLE_SPACE + 12],b2[TCL_DOUBLE_SPACE + 12],b3[TCL_DOUBLE_SPACE + 12];
+  char b2[TCL_DOUBLE_SPACE + 12],b3[TCL_DOUBLE_SPACE + 12];
   /* initial checks. */
   mesh_size = box_l[0]/(double)mesh[0];
   k_cut =  mesh_size*cao/2.0;
-  P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh=(%d, %d, %d), cao=%d, rmin=%f, rmax=%f\n",
+  P3M_TRACE(fprintf(stderr, "p3m_mc_rcut: mesh=(%d, %d, %d), cao=%d, rmin=%f, rmax=%f\n",
                    mesh[0],mesh[1],mesh[2], cao, r_cut_iL_min, r_cut_iL_max));
   if(cao >= imin(mesh[0],imin(mesh[1],mesh[2])) || k_cut >= (dmin(min_box_l,min_local_box_l) - skin)) {
     sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
@@ -1518,26 +2462,21 @@ static double p3m_mc_time(Tcl_Interp *interp, int mesh[3], int cao,
 
   /* Either low and high boundary are equal (for fixed cut), or the low border is initially 0 and therefore
      has infinite error estimate, as required. Therefore if the high boundary fails, there is no possible r_cut */
-  if ((*_accuracy = p3m_get_accuracy(mesh, cao, r_cut_iL_max, _alpha_L, &rs_err, &ks_err)) > p3m.params.accuracy) {
-    /* print result */
-    sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
-    Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
-    sprintf(b1,"%.5e",r_cut_iL_max); sprintf(b2,"%.5e",*_alpha_L); sprintf(b3,"%.5e",*_accuracy);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  ",b3," ", (char *) NULL);
-    sprintf(b1,"%.3e",rs_err); sprintf(b2,"%.3e",ks_err);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  accuracy not achieved\n", (char *) NULL);
+  if ((*_accuracy = p3m_get_accuracy(mesh, cao, r_cut_iL_max, _alpha_L, _rs_err, _ks_err)) > p3m.params.accuracy) {
+    p3m_tune_print_line(interp, mesh, cao, r_cut_iL_max, *_alpha_L, *_accuracy, *_rs_err, *_ks_err,
+			"accuracy not achieved");
     return -2;
   }
 
   for (;;) {
-    P3M_TRACE(fprintf(stderr, "p3m_mc_time: interval [%f,%f]\n", r_cut_iL_min, r_cut_iL_max));
+    P3M_TRACE(fprintf(stderr, "p3m_mc_rcut: interval [%f,%f]\n", r_cut_iL_min, r_cut_iL_max));
     r_cut_iL = 0.5*(r_cut_iL_min + r_cut_iL_max);
 
     if (r_cut_iL_max - r_cut_iL_min < P3M_RCUT_PREC)
       break;
 
     /* bisection */
-    if ((p3m_get_accuracy(mesh, cao, r_cut_iL, _alpha_L, &rs_err, &ks_err) > p3m.params.accuracy))
+    if ((p3m_get_accuracy(mesh, cao, r_cut_iL, _alpha_L, _rs_err, _ks_err) > p3m.params.accuracy))
       r_cut_iL_min = r_cut_iL;
     else
       r_cut_iL_max = r_cut_iL;
@@ -1546,20 +2485,14 @@ static double p3m_mc_time(Tcl_Interp *interp, int mesh[3], int cao,
   /* final result is always the upper interval boundary, since only there
      we know that the desired minimal accuracy is obtained */
   *_r_cut_iL = r_cut_iL = r_cut_iL_max;
+  *_accuracy = p3m_get_accuracy(mesh, cao, r_cut_iL, _alpha_L, _rs_err, _ks_err);
 
   /* check whether we are running P3M+ELC, and whether we leave a reasonable gap space */
   if (coulomb.method == COULOMB_ELC_P3M && elc_params.gap_size <= 1.1*r_cut_iL*box_l[0]) {
-    P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f reject r_cut %f > gap %f\n", mesh[0],mesh[1],mesh[2], cao, r_cut_iL,
+    P3M_TRACE(fprintf(stderr, "p3m_mc_rcut: mesh (%d, %d, %d) cao %d r_cut %f reject r_cut %f > gap %f\n", mesh[0],mesh[1],mesh[2], cao, r_cut_iL,
                      2*r_cut_iL*box_l[0], elc_params.gap_size));
-    P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh %d cao %d r_cut %f reject r_cut %f > gap %f\n", mesh, cao, r_cut_iL,
-		      2*r_cut_iL*box_l[0], elc_params.gap_size));
-    /* print result */
-    sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
-    Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
-    sprintf(b1,"%.5e",r_cut_iL_max); sprintf(b2,"%.5e",*_alpha_L); sprintf(b3,"%.5e",*_accuracy);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  ",b3," ", (char *) NULL);
-    sprintf(b1,"%.3e",rs_err); sprintf(b2,"%.3e",ks_err);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  conflict with ELC\n", (char *) NULL);
+    p3m_tune_print_line(interp, mesh, cao, r_cut_iL, *_alpha_L, *_accuracy, *_rs_err, *_ks_err,
+			"conflict with ELC");
     return -P3M_TUNE_ELCTEST;
   }
 
@@ -1568,34 +2501,39 @@ static double p3m_mc_time(Tcl_Interp *interp, int mesh[3], int cao,
   for (i = 0; i < 3; i++)
     n_cells *= (int)(floor(local_box_l[i]/(r_cut_iL*box_l[0] + skin)));
   if (n_cells < min_num_cells) {
-    P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f reject n_cells %d\n", mesh[0], mesh[1], mesh[2], cao, r_cut_iL, n_cells));
-    /* print result */
-    sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
-    Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
-    sprintf(b1,"%.5e",r_cut_iL_max); sprintf(b2,"%.5e",*_alpha_L); sprintf(b3,"%.5e",*_accuracy);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  ",b3," ", (char *) NULL);
-    sprintf(b1,"%.3e",rs_err); sprintf(b2,"%.3e",ks_err);
-    Tcl_AppendResult(interp, b1,"  ", b2,"  radius dangerously high\n", (char *) NULL);
+    P3M_TRACE(fprintf(stderr, "p3m_mc_rcut: mesh (%d, %d, %d) cao %d r_cut %f reject n_cells %d\n", mesh[0], mesh[1], mesh[2], cao, r_cut_iL, n_cells));
+    p3m_tune_print_line(interp, mesh, cao, r_cut_iL, *_alpha_L, *_accuracy, *_rs_err, *_ks_err,
+			"radius dangerously high");
     return -P3M_TUNE_CUTOFF_TOO_LARGE;
   }
-  int_time = p3m_mcr_time(mesh, cao, r_cut_iL, *_alpha_L);
+  return 0;
+}
+
+/** get the optimal alpha and the corresponding computation time for fixed mesh, cao. The r_cut is determined via
+    \ref p3m_mc_rcut. Returns -1 if the force evaluation does not work, -2 if there is no valid r_cut, and -3 if
+    the charge assigment order is to large for this grid */
+static double p3m_mc_time(Tcl_Interp *interp, int mesh[3], int cao,
+                         double r_cut_iL_min, double r_cut_iL_max, double *_r_cut_iL,
+                         double *_alpha_L, double *_accuracy)
+{
+  double int_time, rs_err, ks_err;
+  int ret;
+  char b3[TCL_DOUBLE_SPACE + 12];
+
+  if ((ret = p3m_mc_rcut(interp, mesh, cao, r_cut_iL_min, r_cut_iL_max, _r_cut_iL,
+			 _alpha_L, _accuracy, &rs_err, &ks_err)) != 0)
+    return ret;
+
+  int_time = p3m_mcr_time(mesh, cao, *_r_cut_iL, *_alpha_L);
   if (int_time == -1) {
     Tcl_ResetResult(interp);
     Tcl_AppendResult(interp, "tuning failed, test integration not possible", (char *)NULL);
     return -P3M_TUNE_FAIL;
   }
 
-  *_accuracy = p3m_get_accuracy(mesh, cao, r_cut_iL, _alpha_L, &rs_err, &ks_err);
-
-  P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f time %f\n", mesh[0], mesh[1], mesh[2], cao, r_cut_iL, int_time));
-  P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh %d cao %d r_cut %f time %f\n", mesh, cao, r_cut_iL, int_time));
-  /* print result */
-  sprintf(b2,"%-4d",mesh[0]); sprintf(b3,"%-3d",cao);
-  Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
-  sprintf(b1,"%.5e",r_cut_iL); sprintf(b2,"%.5e",*_alpha_L); sprintf(b3,"%.5e",*_accuracy);
-  Tcl_AppendResult(interp, b1,"  ", b2,"  ",b3," ", (char *) NULL);
-  sprintf(b1,"%.3e",rs_err); sprintf(b2,"%.3e",ks_err); sprintf(b3,"%-8d",(int)int_time);
-  Tcl_AppendResult(interp, b1,"  ", b2,"  ", b3,"\n", (char *) NULL);
+  P3M_TRACE(fprintf(stderr, "p3m_mc_time: mesh (%d, %d, %d) cao %d r_cut %f time %f\n", mesh[0], mesh[1], mesh[2], cao, *_r_cut_iL, int_time));
+  sprintf(b3,"%-8d",(int)int_time);
+  p3m_tune_print_line(interp, mesh, cao, *_r_cut_iL, *_alpha_L, *_accuracy, rs_err, ks_err, b3);
   return int_time;
 }
 
@@ -1722,6 +2660,428 @@ static double p3m_m_time(Tcl_Interp *interp, int mesh[3],
   return best_time;
 }
 
+/** the mesh for a mesh density, with an even number of points in
+    each direction */
+static void p3m_tune_mesh(double mesh_density, int mesh[3])
+{
+  int i;
+  for (i = 0; i < 3; i++) {
+    mesh[i] = (int)(box_l[i]*mesh_density);
+    if (mesh[i] % 2)
+      mesh[i]++;
+  }
+}
+
+/************************************************
+ * Model based tuning
+ ************************************************/
+
+/** a P3M parameter set considered by the tuning */
+typedef struct {
+  int mesh[3];
+  int cao;
+  int ad;
+  int interlace;
+  double r_cut_iL;
+  double alpha_L;
+  double accuracy;
+  /** predicted or measured time per force calculation in ms */
+  double time;
+} p3m_tune_set;
+
+/** terms of the cost model of a force calculation per node */
+enum { P3M_COST_CONST, P3M_COST_PAIRS, P3M_COST_CA, P3M_COST_FFT, P3M_COST_N };
+
+/** candidates with a predicted time above this factor times the best
+    prediction are not considered further */
+#define P3M_TUNE_MODEL_MARGIN 1.5
+
+/** number of values in the key of a tuning cache entry */
+#define P3M_TUNE_KEY_N 20
+
+/** the terms of the cost model for a parameter set, per node: the
+    number of real space pairs, of mesh points touched by the charge
+    assignment and the back interpolation, and the FFT operations. */
+static void p3m_cost_terms(int mesh[3], int cao, double r_cut_iL, int ad, int il, double f[P3M_COST_N])
+{
+  int fft_nodes = (p3m.params.kspace_nodes > 0 && p3m.params.kspace_nodes < n_nodes) ?
+    p3m.params.kspace_nodes : n_nodes;
+  double n_mesh = (double)mesh[0]*mesh[1]*mesh[2];
+  double r_cut = r_cut_iL*box_l[0];
+
+  f[P3M_COST_CONST] = 1.0;
+  f[P3M_COST_PAIRS] = 2.0/3.0*PI*SQR((double)p3m.sum_qpart)*r_cut*r_cut*r_cut/
+    (box_l[0]*box_l[1]*box_l[2]*n_nodes);
+  /* assignment and the gathering of the three force components */
+  f[P3M_COST_CA]    = 4.0*p3m.sum_qpart*cao*cao*cao*(il ? 2 : 1)/n_nodes;
+  /* one forward and three (ik) or one (ad) backward FFTs per mesh */
+  f[P3M_COST_FFT]   = n_mesh*log(n_mesh)/M_LN2*(ad ? 2 : 4)*(il ? 2 : 1)/fft_nodes;
+}
+
+static double p3m_cost_predict(double coeff[P3M_COST_N], double f[P3M_COST_N])
+{
+  int i;
+  double t = 0;
+  for (i = 0; i < P3M_COST_N; i++)
+    t += coeff[i]*f[i];
+  return t;
+}
+
+/** calibrate the cost model by timing four parameter sets, each of
+    which differs from the first one in only one of the terms. The
+    parameter sets need not reach the accuracy. Returns -1 if the
+    force evaluation does not work. */
+static int p3m_cost_calibrate(Tcl_Interp *interp, double mesh_density_min, double mesh_density_max,
+			      int cao_min, int cao_max, double r_cut_iL_min, double r_cut_iL_max,
+			      double coeff[P3M_COST_N])
+{
+  int mesh[2][3], cao[2], i, k;
+  double r_cut_iL[2], density, time[4], f[4][P3M_COST_N], df;
+  /* the varied parameters of the timed sets, indices into mesh, cao and r_cut_iL */
+  int set[4][3] = { {0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {1, 0, 0} };
+  int term[4] = { P3M_COST_CONST, P3M_COST_PAIRS, P3M_COST_CA, P3M_COST_FFT };
+  char b1[TCL_DOUBLE_SPACE], b2[TCL_DOUBLE_SPACE], b3[TCL_DOUBLE_SPACE], b4[TCL_DOUBLE_SPACE];
+
+  /* meshes of at least 8 points, and one twice as fine */
+  density = dmin(dmax(mesh_density_min, 8.0/dmin(box_l[0], dmin(box_l[1], box_l[2]))), mesh_density_max);
+  p3m_tune_mesh(density, mesh[0]);
+  p3m_tune_mesh(dmin(2*density, mesh_density_max), mesh[1]);
+
+  /* the largest cao that the coarser mesh can take */
+  cao[0] = cao_min;
+  for (cao[1] = cao_max; cao[1] > cao[0]; cao[1]--)
+    if (cao[1] < imin(mesh[0][0], imin(mesh[0][1], mesh[0][2])) &&
+	box_l[0]/mesh[0][0]*cao[1]/2.0 < dmin(min_box_l, min_local_box_l) - skin)
+      break;
+
+  /* cutoffs with about 50 and 170 charged neighbors */
+  r_cut_iL[0] = pow(3.0*50.0/(4.0*PI)*box_l[0]*box_l[1]*box_l[2]/p3m.sum_qpart, 1.0/3.0)*box_l_i[0];
+  r_cut_iL[0] = dmin(dmax(r_cut_iL[0], r_cut_iL_min), r_cut_iL_max);
+  r_cut_iL[1] = dmin(1.5*r_cut_iL[0], r_cut_iL_max);
+
+  p3m.params.ad = 0;
+  p3m.params.interlace = 0;
+  for (k = 0; k < 4; k++) {
+    int *m = mesh[set[k][0]], c = cao[set[k][1]];
+    double r = r_cut_iL[set[k][2]];
+    time[k] = p3m_mcr_time(m, c, r, 3.0/r);
+    if (time[k] == -1) {
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp, "tuning failed, test integration not possible", (char *)NULL);
+      return -1;
+    }
+    p3m_cost_terms(m, c, r, 0, 0, f[k]);
+  }
+
+  /* each of the timed sets gives the coefficient of the term it varies */
+  coeff[P3M_COST_CONST] = time[0];
+  for (k = 1; k < 4; k++) {
+    i = term[k];
+    df = f[k][i] - f[0][i];
+    coeff[i] = (df > 0) ? dmax((time[k] - time[0])/df, 0.0) : 0.0;
+    coeff[P3M_COST_CONST] -= coeff[i]*f[0][i];
+  }
+  coeff[P3M_COST_CONST] = dmax(coeff[P3M_COST_CONST], 0.0);
+
+  sprintf(b1, "%.3e", coeff[P3M_COST_CONST]); sprintf(b2, "%.3e", coeff[P3M_COST_PAIRS]);
+  sprintf(b3, "%.3e", coeff[P3M_COST_CA]); sprintf(b4, "%.3e", coeff[P3M_COST_FFT]);
+  Tcl_AppendResult(interp, "cost model [ms]: constant ", b1, ", per pair ", b2,
+		   ", per assignment point ", b3, ", per FFT operation ", b4, "\n", (char *) NULL);
+  return 0;
+}
+
+/** the key of the current tuning problem in the tuning cache. Has
+    to be determined before the tuning changes the parameters. */
+static void p3m_tune_cache_key(double key[P3M_TUNE_KEY_N])
+{
+  int i = 0;
+  key[i++] = n_nodes;
+  key[i++] = p3m.params.kspace_nodes;
+  key[i++] = coulomb.method;
+  key[i++] = sizeof(fft_float);
+  key[i++] = p3m.sum_qpart;
+  key[i++] = p3m.sum_q2;
+  key[i++] = box_l[0];
+  key[i++] = box_l[1];
+  key[i++] = box_l[2];
+  key[i++] = skin;
+  key[i++] = min_num_cells;
+  key[i++] = p3m.params.accuracy;
+  /* the parameters that are fixed, or 0 */
+  key[i++] = p3m.params.mesh[0];
+  key[i++] = p3m.params.mesh[1];
+  key[i++] = p3m.params.mesh[2];
+  key[i++] = p3m.params.cao;
+  key[i++] = p3m.params.r_cut_iL;
+  key[i++] = p3m_tune_differentiation;
+  key[i++] = p3m_tune_interlace;
+  key[i++] = (coulomb.method == COULOMB_ELC_P3M) ? elc_params.gap_size : 0;
+}
+
+/** maximal length of a line of the tuning cache file */
+#define P3M_TUNE_CACHE_LINE 4096
+
+/** look up the current tuning problem in the tuning cache file. The
+    result is found for the same system, number of nodes and tuning
+    constraints, the calibration of the cost model for the same number
+    of nodes. Later entries take precedence. Truncated or otherwise
+    malformed records are reported in the tuning log and skipped.
+    \return 1 if the result was found, 2 if only the calibration, 0 if neither */
+static int p3m_tune_cache_read(Tcl_Interp *interp, double key[P3M_TUNE_KEY_N], p3m_tune_set *result, double coeff[P3M_COST_N])
+{
+  FILE *f;
+  char line[P3M_TUNE_CACHE_LINE], tag[32], *pos, *end, b[TCL_INTEGER_SPACE];
+  double entry[P3M_TUNE_KEY_N + 10];
+  int i, n_entry, n_tag, n_line = 0, complete, found = 0;
+
+  if (!p3m_tune_cache_file || (f = fopen(p3m_tune_cache_file, "r")) == NULL)
+    return 0;
+
+  while (fgets(line, P3M_TUNE_CACHE_LINE, f)) {
+    n_line++;
+    /* skip the rest of overlong lines */
+    complete = strchr(line, '\n') != NULL || feof(f);
+    if (!complete) {
+      int c;
+      while ((c = fgetc(f)) != EOF && c != '\n');
+    }
+
+    if (sscanf(line, "%31s%n", tag, &n_tag) != 1)
+      continue;
+    if (!strcmp(tag, "result"))
+      n_entry = P3M_TUNE_KEY_N + 10;
+    else if (!strcmp(tag, "calibration"))
+      n_entry = 2 + P3M_COST_N;
+    else
+      /* skip unknown lines */
+      continue;
+
+    /* the record has to consist of exactly n_entry numbers */
+    pos = line + n_tag;
+    for (i = 0; i < n_entry; i++) {
+      entry[i] = strtod(pos, &end);
+      if (end == pos)
+	break;
+      pos = end;
+    }
+    while (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')
+      pos++;
+    if (!complete || i < n_entry || *pos != 0) {
+      sprintf(b, "%d", n_line);
+      Tcl_AppendResult(interp, "ignoring malformed ", tag, " record in line ", b,
+		       " of tuning cache ", p3m_tune_cache_file, "\n", (char *) NULL);
+      continue;
+    }
+
+    if (!strcmp(tag, "result")) {
+      for (i = 0; i < P3M_TUNE_KEY_N; i++)
+	if (fabs(entry[i] - key[i]) > 1e-10*fabs(key[i]))
+	  break;
+      if (i < P3M_TUNE_KEY_N)
+	continue;
+      result->mesh[0]   = (int)entry[i++];
+      result->mesh[1]   = (int)entry[i++];
+      result->mesh[2]   = (int)entry[i++];
+      result->cao       = (int)entry[i++];
+      result->ad        = (int)entry[i++];
+      result->interlace = (int)entry[i++];
+      result->r_cut_iL  = entry[i++];
+      result->alpha_L   = entry[i++];
+      result->accuracy  = entry[i++];
+      result->time      = entry[i++];
+      found = 1;
+    }
+    else if (entry[0] == key[0] && entry[1] == key[1]) {
+      for (i = 0; i < P3M_COST_N; i++)
+	coeff[i] = entry[2 + i];
+      if (!found)
+	found = 2;
+    }
+  }
+  fclose(f);
+  return found;
+}
+
+static void p3m_tune_cache_write_result(double key[P3M_TUNE_KEY_N], p3m_tune_set *result)
+{
+  FILE *f;
+  int i;
+
+  if (!p3m_tune_cache_file || (f = fopen(p3m_tune_cache_file, "a")) == NULL)
+    return;
+  fprintf(f, "result");
+  for (i = 0; i < P3M_TUNE_KEY_N; i++)
+    fprintf(f, " %.17g", key[i]);
+  fprintf(f, "  %d %d %d %d %d %d %.17g %.17g %.17g %.17g\n",
+	  result->mesh[0], result->mesh[1], result->mesh[2], result->cao,
+	  result->ad, result->interlace,
+	  result->r_cut_iL, result->alpha_L, result->accuracy, result->time);
+  fclose(f);
+}
+
+static void p3m_tune_cache_write_calibration(double coeff[P3M_COST_N])
+{
+  FILE *f;
+  int i;
+
+  if (!p3m_tune_cache_file || (f = fopen(p3m_tune_cache_file, "a")) == NULL)
+    return;
+  fprintf(f, "calibration %d %d", n_nodes, p3m.params.kspace_nodes);
+  for (i = 0; i < P3M_COST_N; i++)
+    fprintf(f, " %.17g", coeff[i]);
+  fprintf(f, "\n");
+  fclose(f);
+}
+
+static int p3m_tune_set_compare(const void *a, const void *b)
+{
+  double ta = ((const p3m_tune_set *)a)->time, tb = ((const p3m_tune_set *)b)->time;
+  return (ta < tb) ? -1 : (ta > tb);
+}
+
+/** tune with the cost model: all parameter sets that reach the
+    accuracy are determined analytically, where meshes and caos are
+    skipped if the cost model predicts them to be much slower than the
+    best set so far. Only the \ref p3m_tune_model sets with the lowest
+    predicted time are then timed. The calibration of the cost model is
+    taken from the tuning cache if available.
+    \return the measured time of the best set, or a negative value on
+    errors */
+static double p3m_model_tune(Tcl_Interp *interp, int have_coeff, double coeff[P3M_COST_N],
+			     double mesh_density_min, double mesh_density_max,
+			     int cao_min, int cao_max, double r_cut_iL_min, double r_cut_iL_max,
+			     int ad_min, int ad_max, int il_min, int il_max, p3m_tune_set *best)
+{
+  p3m_tune_set *cand = NULL, c;
+  int n_cand = 0, max_cand = 0, ad, il, cao, tmp_cao_min, mesh[3], last_mesh[3], i;
+  double mesh_density, best_pred = 1e20, f[P3M_COST_N], rs_err, ks_err, time, r_cut_iL_low;
+  /* per cao: the predicted time and r_cut for the previous mesh, and
+     whether finer meshes can still be faster */
+  double cao_time[8], cao_r_cut_iL[8];
+  int cao_done[8], n_done;
+  char b1[2*TCL_DOUBLE_SPACE + 64];
+
+  if (!have_coeff) {
+    if (p3m_cost_calibrate(interp, mesh_density_min, mesh_density_max, cao_min, cao_max,
+			   r_cut_iL_min, r_cut_iL_max, coeff) == -1)
+      return -P3M_TUNE_FAIL;
+    p3m_tune_cache_write_calibration(coeff);
+  }
+
+  for (il = il_min; il <= il_max; il++) {
+    p3m.params.interlace = il;
+    for (ad = ad_min; ad <= ad_max; ad++) {
+      p3m.params.ad = ad;
+      tmp_cao_min = (ad && cao_min < 2) ? 2 : cao_min;
+      last_mesh[0] = last_mesh[1] = last_mesh[2] = -1;
+      for (cao = 0; cao < 8; cao++) {
+	cao_time[cao] = 1e20;
+	cao_r_cut_iL[cao] = r_cut_iL_max;
+	cao_done[cao] = 0;
+      }
+
+      sprintf(b1, "%d", il);
+      Tcl_AppendResult(interp, "differentiation ", ad ? "ad" : "ik", " interlace ", b1, " (predicted)\n", (char *) NULL);
+
+      for (mesh_density = mesh_density_min; mesh_density <= mesh_density_max; mesh_density += 0.1) {
+	p3m_tune_mesh(mesh_density, mesh);
+	if (mesh[0] == last_mesh[0] && mesh[1] == last_mesh[1] && mesh[2] == last_mesh[2])
+	  continue;
+	for (i = 0; i < 3; i++)
+	  last_mesh[i] = mesh[i];
+
+	/* the FFT time only grows with the mesh */
+	p3m_cost_terms(mesh, tmp_cao_min, 0, ad, il, f);
+	if (p3m_cost_predict(coeff, f) > P3M_TUNE_MODEL_MARGIN*best_pred)
+	  break;
+
+	n_done = 0;
+	/* going down in cao, the r_cut can only grow, so that the last
+	   r_cut bounds the next bisection and the predicted time of all
+	   remaining caos from below */
+	r_cut_iL_low = r_cut_iL_min;
+	for (cao = cao_max; cao >= tmp_cao_min; cao--) {
+	  if (cao_done[cao]) {
+	    n_done++;
+	    continue;
+	  }
+	  p3m_cost_terms(mesh, tmp_cao_min, r_cut_iL_low, ad, il, f);
+	  if (p3m_cost_predict(coeff, f) > P3M_TUNE_MODEL_MARGIN*best_pred)
+	    break;
+
+	  /* the r_cut needed for the same cao can only decrease with the mesh */
+	  i = p3m_mc_rcut(interp, mesh, cao, r_cut_iL_low, cao_r_cut_iL[cao], &c.r_cut_iL,
+			  &c.alpha_L, &c.accuracy, &rs_err, &ks_err);
+	  /* a smaller cao might still fit the mesh */
+	  if (i == -3) continue;
+	  /* smaller caos do not reach the accuracy either */
+	  if (i == -2) break;
+	  if (i < 0) continue;
+	  r_cut_iL_low = c.r_cut_iL;
+
+	  for (i = 0; i < 3; i++)
+	    c.mesh[i] = mesh[i];
+	  c.cao = cao;
+	  c.ad = ad;
+	  c.interlace = il;
+	  p3m_cost_terms(mesh, cao, c.r_cut_iL, ad, il, f);
+	  c.time = p3m_cost_predict(coeff, f);
+	  if (c.time < best_pred)
+	    best_pred = c.time;
+	  /* the time for a fixed cao has a single minimum as a function of the mesh */
+	  if (c.time > cao_time[cao])
+	    cao_done[cao] = 1;
+	  cao_time[cao] = c.time;
+	  cao_r_cut_iL[cao] = c.r_cut_iL;
+
+	  if (n_cand == max_cand) {
+	    max_cand += 32;
+	    cand = realloc(cand, max_cand*sizeof(p3m_tune_set));
+	  }
+	  cand[n_cand++] = c;
+
+	  sprintf(b1, "%-8.3f", c.time);
+	  p3m_tune_print_line(interp, mesh, cao, c.r_cut_iL, c.alpha_L, c.accuracy, rs_err, ks_err, b1);
+	}
+	if (n_done == cao_max - tmp_cao_min + 1)
+	  break;
+      }
+    }
+  }
+
+  if (n_cand == 0)
+    return -P3M_TUNE_NOCUTOFF;
+
+  /* time the most promising sets */
+  qsort(cand, n_cand, sizeof(p3m_tune_set), p3m_tune_set_compare);
+  Tcl_AppendResult(interp, "timing the best predicted parameter sets\n", (char *) NULL);
+  best->time = -1;
+  for (i = 0; i < imin(n_cand, p3m_tune_model); i++) {
+    p3m.params.ad = cand[i].ad;
+    p3m.params.interlace = cand[i].interlace;
+    time = p3m_mcr_time(cand[i].mesh, cand[i].cao, cand[i].r_cut_iL, cand[i].alpha_L);
+    if (time == -1) {
+      free(cand);
+      Tcl_ResetResult(interp);
+      Tcl_AppendResult(interp, "tuning failed, test integration not possible", (char *)NULL);
+      return -P3M_TUNE_FAIL;
+    }
+
+    sprintf(b1, "%-8.3f predicted %.3f, differentiation %s interlace %d",
+	    time, cand[i].time, cand[i].ad ? "ad" : "ik", cand[i].interlace);
+    p3m_get_accuracy(cand[i].mesh, cand[i].cao, cand[i].r_cut_iL, &c.alpha_L, &rs_err, &ks_err);
+    p3m_tune_print_line(interp, cand[i].mesh, cand[i].cao, cand[i].r_cut_iL, cand[i].alpha_L,
+			cand[i].accuracy, rs_err, ks_err, b1);
+
+    if (best->time < 0 || time < best->time) {
+      *best = cand[i];
+      best->time = time;
+    }
+  }
+  free(cand);
+  return best->time;
+}
+
 int p3m_adaptive_tune(Tcl_Interp *interp) {
   int  mesh[3] = {0, 0, 0}, tmp_mesh_points; 
   int tmp_mesh[3];
@@ -1731,6 +3091,12 @@ int p3m_adaptive_tune(Tcl_Interp *interp) {
   double                             accuracy = -1, tmp_accuracy=0.0;
   double                            time_best=1e20, tmp_time;
   double mesh_density = 0.0, mesh_density_min, mesh_density_max;
+  int    ad, ad_min, ad_max, best_ad = p3m.params.ad, tmp_cao_min;
+  int    il, il_min, il_max, best_il = p3m.params.interlace;
+  double r_cut_iL_start, pass_best;
+  p3m_tune_set best;
+  double coeff[P3M_COST_N], cache_key[P3M_TUNE_KEY_N];
+  int    cache_found;
   char
     b1[3*TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12],
     b2[TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12],
@@ -1805,65 +3171,143 @@ int p3m_adaptive_tune(Tcl_Interp *interp) {
     cao_min = cao_max = cao = p3m.params.cao;
   }
 
-  Tcl_AppendResult(interp, "mesh cao r_cut_iL     alpha_L      err          rs_err     ks_err     time [ms]\n", (char *) NULL);
-
-  /* mesh loop */
-  /* we're tuning the density of mesh points, which is the same in every direction. */
-  for (mesh_density=mesh_density_min;mesh_density<=mesh_density_max;mesh_density+=0.1) {
-    tmp_cao = cao;
-
-    P3M_TRACE(fprintf(stderr, "%d: trying meshdensity %lf.\n", this_node, mesh_density));
-
-    tmp_mesh[0] = (int)(box_l[0]*mesh_density);
-    tmp_mesh[1] = (int)(box_l[1]*mesh_density);
-    tmp_mesh[2] = (int)(box_l[2]*mesh_density);
-
-    if(tmp_mesh[0] % 2)
-      tmp_mesh[0]++;
-    if(tmp_mesh[1] % 2) 
-      tmp_mesh[1]++;
-    if(tmp_mesh[2] % 2)
-      tmp_mesh[2]++;
-
-    tmp_time = p3m_m_time(interp, tmp_mesh,
-			  cao_min, cao_max, &tmp_cao,
-			  r_cut_iL_min, r_cut_iL_max, &tmp_r_cut_iL,
-			  &tmp_alpha_L, &tmp_accuracy); 
-    /* some error occured during the tuning force evaluation */
-    P3M_TRACE(fprintf(stderr,"delta_acceracy: %lf tune time: %lf\n", p3m.params.accuracy - tmp_accuracy,tmp_time));
-    //    if (tmp_time == -1) con;
-    /* this mesh does not work at all */
-    if (tmp_time < 0.0) continue;
-
-    /* the optimum r_cut for this mesh is the upper limit for higher meshes,
-       everything else is slower */
-    r_cut_iL_max = tmp_r_cut_iL;
-
-    /* new optimum */
-    if (tmp_time < time_best) {
-      P3M_TRACE(fprintf(stderr, "Found new optimum: time %lf, mesh (%d %d %d)\n", tmp_time, tmp_mesh[0], tmp_mesh[1], tmp_mesh[2]));
-      time_best = tmp_time;
-      mesh[0]   = tmp_mesh[0];
-      mesh[1]   = tmp_mesh[1];
-      mesh[2]   = tmp_mesh[2];
-      cao       = tmp_cao;
-      r_cut_iL  = tmp_r_cut_iL;
-      alpha_L   = tmp_alpha_L;
-      accuracy  = tmp_accuracy;
+  /* differentiation schemes to try */
+  if (p3m_tune_differentiation == -1) {
+    ad_min = 0;
+    ad_max = 1;
+  }
+  else {
+    ad_min = ad_max = p3m_tune_differentiation;
+    Tcl_AppendResult(interp, "fixed differentiation ", ad_min ? "ad" : "ik", "\n", (char *)NULL);
+  }
+  /* analytical differentiation needs a differentiable charge assignment function */
+  if (cao_max < 2) {
+    if (ad_min == 1) {
+      Tcl_AppendResult(interp, "analytical differentiation requires cao >= 2", (char *) NULL);
+      return (TCL_ERROR);
     }
-    /* no hope of further optimisation */
-    else if (tmp_time > time_best + P3M_TIME_GRAN) {
-      P3M_TRACE(fprintf(stderr, "%d: %lf is mush slower then best time, aborting.\n", this_node, tmp_time));
-      break;
+    ad_max = 0;
+  }
+
+  /* interlacing, which is not available with ELC */
+  if (p3m_tune_interlace == -1) {
+    il_min = 0;
+    il_max = (coulomb.method == COULOMB_ELC_P3M) ? 0 : 1;
+  }
+  else {
+    il_min = il_max = p3m_tune_interlace;
+    sprintf(b1, "%d", il_min);
+    Tcl_AppendResult(interp, "fixed interlace ", b1, "\n", (char *)NULL);
+    if (il_min && coulomb.method == COULOMB_ELC_P3M) {
+      Tcl_AppendResult(interp, "interlaced P3M cannot be used with ELC", (char *) NULL);
+      return (TCL_ERROR);
     }
   }
-  
+
+  p3m_tune_cache_key(cache_key);
+  cache_found = p3m_tune_cache_read(interp, cache_key, &best, coeff);
+  if (cache_found == 1)
+    Tcl_AppendResult(interp, "parameters from tuning cache ", p3m_tune_cache_file, "\n", (char *) NULL);
+  else
+    Tcl_AppendResult(interp, "mesh cao r_cut_iL     alpha_L      err          rs_err     ks_err     time [ms]\n", (char *) NULL);
+
+  r_cut_iL_start = r_cut_iL_max;
+  if (cache_found == 1 || p3m_tune_model > 0) {
+    if (cache_found == 1 ||
+	p3m_model_tune(interp, cache_found == 2, coeff, mesh_density_min, mesh_density_max,
+		       cao_min, cao_max, r_cut_iL_min, r_cut_iL_max,
+		       ad_min, ad_max, il_min, il_max, &best) >= 0) {
+      for (il = 0; il < 3; il++)
+	mesh[il] = best.mesh[il];
+      cao       = best.cao;
+      r_cut_iL  = best.r_cut_iL;
+      alpha_L   = best.alpha_L;
+      accuracy  = best.accuracy;
+      best_ad   = best.ad;
+      best_il   = best.interlace;
+      time_best = best.time;
+    }
+  }
+  else for (il = il_min; il <= il_max; il++) {
+    p3m.params.interlace = il;
+    for (ad = ad_min; ad <= ad_max; ad++) {
+      p3m.params.ad = ad;
+      tmp_cao_min = (ad && cao_min < 2) ? 2 : cao_min;
+      r_cut_iL_max = r_cut_iL_start;
+      pass_best = 1e20;
+
+      sprintf(b1, "%d", il);
+      Tcl_AppendResult(interp, "differentiation ", ad ? "ad" : "ik", " interlace ", b1, "\n", (char *) NULL);
+
+      /* mesh loop */
+      /* we're tuning the density of mesh points, which is the same in every direction. */
+      for (mesh_density=mesh_density_min;mesh_density<=mesh_density_max;mesh_density+=0.1) {
+	tmp_cao = imax(cao, tmp_cao_min);
+
+	P3M_TRACE(fprintf(stderr, "%d: trying meshdensity %lf.\n", this_node, mesh_density));
+
+	p3m_tune_mesh(mesh_density, tmp_mesh);
+
+	tmp_time = p3m_m_time(interp, tmp_mesh,
+			      tmp_cao_min, cao_max, &tmp_cao,
+			      r_cut_iL_min, r_cut_iL_max, &tmp_r_cut_iL,
+			      &tmp_alpha_L, &tmp_accuracy); 
+	/* some error occured during the tuning force evaluation */
+	P3M_TRACE(fprintf(stderr,"delta_acceracy: %lf tune time: %lf\n", p3m.params.accuracy - tmp_accuracy,tmp_time));
+	//    if (tmp_time == -1) con;
+	/* this mesh does not work at all */
+	if (tmp_time < 0.0) continue;
+
+	/* the optimum r_cut for this mesh is the upper limit for higher meshes,
+	   everything else is slower */
+	r_cut_iL_max = tmp_r_cut_iL;
+
+	/* new optimum */
+	if (tmp_time < time_best) {
+	  P3M_TRACE(fprintf(stderr, "Found new optimum: time %lf, mesh (%d %d %d)\n", tmp_time, tmp_mesh[0], tmp_mesh[1], tmp_mesh[2]));
+	  time_best = tmp_time;
+	  mesh[0]   = tmp_mesh[0];
+	  mesh[1]   = tmp_mesh[1];
+	  mesh[2]   = tmp_mesh[2];
+	  cao       = tmp_cao;
+	  r_cut_iL  = tmp_r_cut_iL;
+	  alpha_L   = tmp_alpha_L;
+	  accuracy  = tmp_accuracy;
+	  best_ad   = ad;
+	  best_il   = il;
+	}
+	/* the abort criterion is taken per scheme */
+	if (tmp_time < pass_best)
+	  pass_best = tmp_time;
+	/* no hope of further optimisation */
+	else if (tmp_time > pass_best + P3M_TIME_GRAN) {
+	  P3M_TRACE(fprintf(stderr, "%d: %lf is mush slower then best time, aborting.\n", this_node, tmp_time));
+	  break;
+	}
+      }
+    }
+  }
+
   P3M_TRACE(fprintf(stderr,"%d: finished tuning, best time: %lf\n", this_node,time_best));
   if(time_best == 1e20) {
     Tcl_AppendResult(interp, "** failed to tune P3M parameters to required accuracy", (char *) NULL);
     return (TCL_ERROR);
   }
 
+  if (cache_found != 1) {
+    best.mesh[0] = mesh[0];
+    best.mesh[1] = mesh[1];
+    best.mesh[2] = mesh[2];
+    best.cao = cao;
+    best.ad = best_ad;
+    best.interlace = best_il;
+    best.r_cut_iL = r_cut_iL;
+    best.alpha_L = alpha_L;
+    best.accuracy = accuracy;
+    best.time = time_best;
+    p3m_tune_cache_write_result(cache_key, &best);
+  }
+
   /* set tuned p3m parameters */
   p3m.params.r_cut_iL = r_cut_iL;
   p3m.params.mesh[0]  = mesh[0];
@@ -1872,6 +3316,8 @@ int p3m_adaptive_tune(Tcl_Interp *interp) {
   p3m.params.cao      = cao;
   p3m.params.alpha_L  = alpha_L;
   p3m.params.accuracy = accuracy;
+  p3m.params.ad       = best_ad;
+  p3m.params.interlace = best_il;
   p3m_scaleby_box_l();
   /* broadcast tuned p3m parameters */
   P3M_TRACE(fprintf(stderr,"%d: Broadcasting P3M parameters: mesh: (%d %d %d), cao: %d, alpha_L: %lf, acccuracy: %lf\n", this_node, p3m.params.mesh[0], p3m.params.mesh[1],  p3m.params.mesh[2], p3m.params.cao, p3m.params.alpha_L, p3m.params.accuracy));
@@ -1887,6 +3333,8 @@ int p3m_adaptive_tune(Tcl_Interp *interp) {
   Tcl_AppendResult(interp, b1,"  ", b2,"  ", b3,"  ", (char *) NULL);
   sprintf(b3,"                 %-8d",(int)time_best);
   Tcl_AppendResult(interp, b3, (char *) NULL);
+  sprintf(b1,"%d",best_il);
+  Tcl_AppendResult(interp, " differentiation ", best_ad ? "ad" : "ik", " interlace ", b1, (char *) NULL);
   return (TCL_OK);
 }
   
@@ -1934,6 +3382,7 @@ int tclcommand_inter_coulomb_p3m_print_adaptive_tune_parameters(Tcl_Interp *inte
   Tcl_AppendResult(interp, b2," ", b3," ", (char *) NULL);
   sprintf(b1,"%.5e",p3m.params.r_cut_iL); sprintf(b2,"%.5e",p3m.params.alpha_L); sprintf(b3,"%.5e",p3m.params.accuracy);
   Tcl_AppendResult(interp, b1,"  ", b2,"  ", b3,"  ", (char *) NULL);
+  Tcl_AppendResult(interp, "differentiation ", p3m.params.ad ? "ad" : "ik", (char *) NULL);
 
   return (TCL_OK);  
 }
@@ -1978,23 +3427,133 @@ double p3m_real_space_error(double prefac, double r_cut_iL,
   return (2.0*prefac*sum_q2*exp(-SQR(r_cut_iL*alpha_L))) / (sqrt((double)n_c_part*r_cut_iL)*box_l[1]*box_l[2]);
 }
 
+#ifdef P3M_SINGLE_PRECISION
+double p3m_k_space_rounding_error(double prefac, int mesh[3], int n_c_part, double sum_q2, double alpha_L)
+{
+  double alpha = alpha_L*box_l_i[0];
+  double field = sqrt(8.0*wupi*alpha*sum_q2/(box_l[0]*box_l[1]*box_l[2]));
+  return FLT_EPSILON*sqrt(log((double)mesh[0]*mesh[1]*mesh[2])/M_LN2)*
+    prefac*sqrt(sum_q2/(double)n_c_part)*field;
+}
+#endif
+
+/** The summands of the k-space error are even in each component of
+    the mesh index, so only the indices 0...mesh/2 are summed up, with
+    this weight for the index n. */
+#define P3M_TUNE_FOLD_WEIGHT(n, mesh) (((n) == 0 || (n) == (mesh)/2) ? 1 : 2)
+
 double p3m_k_space_error(double prefac, int mesh[3], int cao, int n_c_part, double sum_q2, double alpha_L)
 {
-  int  nx, ny, nz;
+  int  nx, ny, nz, wx, wy;
   double he_q = 0.0, mesh_i[3] = {1.0/mesh[0], 1.0/mesh[1], 1.0/mesh[2]}, alpha_L_i = 1./alpha_L;
-  double alias1, alias2, n2, cs;
+  double alias1, alias2, n2, cs, den;
   double ctan_x, ctan_y;
+  /* the cotangent sums along z, which are needed for every x and y */
+  double *ctan_z = NULL, *ctan_dz = NULL, *atan_z = NULL, *atan_dz = NULL;
+
+  if (p3m.params.ad) {
+    /* the optimal ad influence function needs the aliasing sum of
+       U^2 k^2 in the denominator, which follows analytically from the
+       cotangent sum of the next lower order:
+       Sum_m sinc^(2cao)(x+m) (x+m)^2 = sin^2(pi x)/pi^2 Sum_m sinc^(2cao-2)(x+m).
+       The same holds for the alternating sums of the interlaced scheme. */
+    double ctan[3], ctan_d[3], atan[3] = {0,0,0}, atan_d[3] = {0,0,0}, k2;
+    ctan_z  = malloc(4*(mesh[2]/2 + 1)*sizeof(double));
+    ctan_dz = ctan_z  + mesh[2]/2 + 1;
+    atan_z  = ctan_dz + mesh[2]/2 + 1;
+    atan_dz = atan_z  + mesh[2]/2 + 1;
+    for (nz=0; nz<=mesh[2]/2; nz++) {
+      ctan_z[nz]  = p3m_analytic_cotangent_sum(nz,mesh_i[2],cao);
+      ctan_dz[nz] = SQR(mesh[2]*sin(PI*nz*mesh_i[2])/PI)*p3m_analytic_cotangent_sum(nz,mesh_i[2],cao-1);
+      if (p3m.params.interlace) {
+	atan_z[nz]  = p3m_alternating_cotangent_sum(nz,mesh_i[2],cao);
+	atan_dz[nz] = SQR(mesh[2]*sin(PI*nz*mesh_i[2])/PI)*p3m_alternating_cotangent_sum(nz,mesh_i[2],cao-1);
+      }
+    }
+    for (nx=0; nx<=mesh[0]/2; nx++) {
+      wx = P3M_TUNE_FOLD_WEIGHT(nx, mesh[0]);
+      ctan[0]   = p3m_analytic_cotangent_sum(nx,mesh_i[0],cao);
+      ctan_d[0] = SQR(mesh[0]*sin(PI*nx*mesh_i[0])/PI)*p3m_analytic_cotangent_sum(nx,mesh_i[0],cao-1);
+      if (p3m.params.interlace) {
+	atan[0]   = p3m_alternating_cotangent_sum(nx,mesh_i[0],cao);
+	atan_d[0] = SQR(mesh[0]*sin(PI*nx*mesh_i[0])/PI)*p3m_alternating_cotangent_sum(nx,mesh_i[0],cao-1);
+      }
+      for (ny=0; ny<=mesh[1]/2; ny++) {
+	wy = wx*P3M_TUNE_FOLD_WEIGHT(ny, mesh[1]);
+	ctan[1]   = p3m_analytic_cotangent_sum(ny,mesh_i[1],cao);
+	ctan_d[1] = SQR(mesh[1]*sin(PI*ny*mesh_i[1])/PI)*p3m_analytic_cotangent_sum(ny,mesh_i[1],cao-1);
+	if (p3m.params.interlace) {
+	  atan[1]   = p3m_alternating_cotangent_sum(ny,mesh_i[1],cao);
+	  atan_d[1] = SQR(mesh[1]*sin(PI*ny*mesh_i[1])/PI)*p3m_alternating_cotangent_sum(ny,mesh_i[1],cao-1);
+	}
+	for (nz=0; nz<=mesh[2]/2; nz++) {
+	  if((nx!=0) || (ny!=0) || (nz!=0)) {
+	    ctan[2]   = ctan_z[nz];
+	    ctan_d[2] = ctan_dz[nz];
+	    cs = ctan[0]*ctan[1]*ctan[2];
+	    k2 = ctan_d[0]*ctan[1]*ctan[2] + ctan[0]*ctan_d[1]*ctan[2] + ctan[0]*ctan[1]*ctan_d[2];
+	    den = cs*k2;
+	    if (p3m.params.interlace) {
+	      atan[2]   = atan_z[nz];
+	      atan_d[2] = atan_dz[nz];
+	      den = 0.5*(den + atan[0]*atan[1]*atan[2]*
+			 (atan_d[0]*atan[1]*atan[2] + atan[0]*atan_d[1]*atan[2] + atan[0]*atan[1]*atan_d[2]));
+	    }
+	    p3m_tune_aliasing_sums_ad(nx,ny,nz,mesh,mesh_i,cao,alpha_L_i,&alias1,&alias2);
+	    he_q += wy*P3M_TUNE_FOLD_WEIGHT(nz, mesh[2])*(alias1  -  SQR(alias2) / den);
+	  }
+	}
+      }
+    }
+    free(ctan_z);
+    return 2.0*prefac*sum_q2*sqrt(he_q/(double)n_c_part) / (box_l[1]*box_l[2]);
+  }
+
+  if (p3m.params.interlace) {
+    /* averaging the two meshes cancels the cross terms of the odd
+       aliases, which shows up in the denominator of the optimal
+       influence function only */
+    double atan_x, atan_y;
+    ctan_z = malloc(2*(mesh[2]/2 + 1)*sizeof(double));
+    atan_z = ctan_z + mesh[2]/2 + 1;
+    for (nz=0; nz<=mesh[2]/2; nz++) {
+      ctan_z[nz] = p3m_analytic_cotangent_sum(nz,mesh_i[2],cao);
+      atan_z[nz] = p3m_alternating_cotangent_sum(nz,mesh_i[2],cao);
+    }
+    for (nx=0; nx<=mesh[0]/2; nx++) {
+      wx = P3M_TUNE_FOLD_WEIGHT(nx, mesh[0]);
+      ctan_x = p3m_analytic_cotangent_sum(nx,mesh_i[0],cao);
+      atan_x = p3m_alternating_cotangent_sum(nx,mesh_i[0],cao);
+      for (ny=0; ny<=mesh[1]/2; ny++) {
+	wy = wx*P3M_TUNE_FOLD_WEIGHT(ny, mesh[1]);
+	ctan_y = ctan_x * p3m_analytic_cotangent_sum(ny,mesh_i[1],cao);
+	atan_y = atan_x * p3m_alternating_cotangent_sum(ny,mesh_i[1],cao);
+	for (nz=0; nz<=mesh[2]/2; nz++) {
+	  if((nx!=0) || (ny!=0) || (nz!=0)) {
+	    n2 = SQR(nx) + SQR(ny) + SQR(nz);
+	    den = 0.5*(SQR(ctan_z[nz]*ctan_y) + SQR(atan_z[nz]*atan_y));
+	    p3m_tune_aliasing_sums(nx,ny,nz,mesh,mesh_i,cao,alpha_L_i,&alias1,&alias2);
+	    he_q += wy*P3M_TUNE_FOLD_WEIGHT(nz, mesh[2])*(alias1  -  SQR(alias2) / (den*n2));
+	  }
+	}
+      }
+    }
+    free(ctan_z);
+    return 2.0*prefac*sum_q2*sqrt(he_q/(double)n_c_part) / (box_l[1]*box_l[2]);
+  }
 
-  for (nx=-mesh[0]/2; nx<mesh[0]/2; nx++) {
+  for (nx=0; nx<=mesh[0]/2; nx++) {
+    wx = P3M_TUNE_FOLD_WEIGHT(nx, mesh[0]);
     ctan_x = p3m_analytic_cotangent_sum(nx,mesh_i[0],cao);
-    for (ny=-mesh[1]/2; ny<mesh[1]/2; ny++) {
+    for (ny=0; ny<=mesh[1]/2; ny++) {
+      wy = wx*P3M_TUNE_FOLD_WEIGHT(ny, mesh[1]);
       ctan_y = ctan_x * p3m_analytic_cotangent_sum(ny,mesh_i[1],cao);
-      for (nz=-mesh[2]/2; nz<mesh[2]/2; nz++) {
+      for (nz=0; nz<=mesh[2]/2; nz++) {
 	if((nx!=0) || (ny!=0) || (nz!=0)) {
 	  n2 = SQR(nx) + SQR(ny) + SQR(nz);
 	  cs = p3m_analytic_cotangent_sum(nz,mesh_i[2],cao)*ctan_y;
 	  p3m_tune_aliasing_sums(nx,ny,nz,mesh,mesh_i,cao,alpha_L_i,&alias1,&alias2);
-	  he_q += (alias1  -  SQR(alias2/cs) / n2);
+	  he_q += wy*P3M_TUNE_FOLD_WEIGHT(nz, mesh[2])*(alias1  -  SQR(alias2/cs) / n2);
 	}
       }
     }
@@ -2036,6 +3595,40 @@ void p3m_tune_aliasing_sums(int nx, int ny, int nz,
   }
 }
 
+void p3m_tune_aliasing_sums_ad(int nx, int ny, int nz, 
+			       int mesh[3], double mesh_i[3], int cao, double alpha_L_i, 
+			       double *alias1, double *alias2)
+{
+
+  int    mx,my,mz;
+  double nmx,nmy,nmz;
+  double fnmx,fnmy,fnmz;
+
+  double ex,ex2,nm2,U2,factor1;
+
+  factor1 = SQR(PI*alpha_L_i);
+
+  *alias1 = *alias2 = 0.0;
+  for (mx=-P3M_BRILLOUIN; mx<=P3M_BRILLOUIN; mx++) {
+    fnmx = mesh_i[0] * (nmx = nx + mx*mesh[0]);
+    for (my=-P3M_BRILLOUIN; my<=P3M_BRILLOUIN; my++) {
+      fnmy = mesh_i[1] * (nmy = ny + my*mesh[1]);
+      for (mz=-P3M_BRILLOUIN; mz<=P3M_BRILLOUIN; mz++) {
+	fnmz = mesh_i[2] * (nmz = nz + mz*mesh[2]);
+
+	nm2 = SQR(nmx) + SQR(nmy) + SQR(nmz);
+	ex2 = SQR( ex = exp(-factor1*nm2) );
+	
+	U2 = pow(sinc(fnmx)*sinc(fnmy)*sinc(fnmz), 2.0*cao);
+	
+	/* |R(k_m)|^2 and U^2(k_m) k_m.R(k_m) */
+	*alias1 += ex2 / nm2;
+	*alias2 += U2 * ex;
+      }
+    }
+  }
+}
+
 
 
 
@@ -2047,8 +3640,11 @@ void p3m_calc_local_ca_mesh() {
   /* total skin size */
   double full_skin[3];
   
-  for(i=0;i<3;i++)
+  for(i=0;i<3;i++) {
     full_skin[i]= p3m.params.cao_cut[i]+skin+p3m.params.additional_mesh[i];
+    /* the second mesh of interlaced P3M is shifted by half a mesh constant */
+    if (p3m.params.interlace) full_skin[i] += 0.5*p3m.params.a[i];
+  }
 
   /* inner left down grid point (global index) */
   for(i=0;i<3;i++) p3m.local_mesh.in_ld[i] = (int)ceil(my_left[i]*p3m.params.ai[i]-p3m.params.mesh_off[i]);
@@ -2174,6 +3770,16 @@ int p3m_sanity_checks()
     ERROR_SPRINTF(errtxt,"{048 P3M_init: alpha must be >0.} ");
     ret = 1;
   }
+  if (p3m.params.ad && p3m.params.cao == 1) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt,"{315 P3M_init: analytical differentiation requires cao >= 2} ");
+    ret = 1;
+  }
+  if (p3m.params.interlace && coulomb.method == COULOMB_ELC_P3M) {
+    errtxt = runtime_error(128);
+    ERROR_SPRINTF(errtxt,"{316 P3M_init: interlaced P3M cannot be used with ELC} ");
+    ret = 1;
+  }
     
   return ret;
 }
@@ -2267,6 +3873,7 @@ void p3m_scaleby_box_l() {
   p3m_init_a_ai_cao_cut();
   p3m_calc_lm_ld_pos();
   p3m_sanity_checks_boxl(); 
+  p3m_scale_influence_functions();
 }
 
 /************************************************/
@@ -2276,52 +3883,65 @@ void p3m_calc_kspace_stress (double* stress) {
         double* node_k_space_stress;
         double* k_space_stress;
         double force_prefac, node_k_space_energy, sqk, vterm, kx, ky, kz;
-        int jx, jy, jz, i, ind = 0;
+        int jx, jy, jz, i, ind, mesh_ind;
         // ordering after fourier transform
         const int x = 2, y = 0, z = 1;
         node_k_space_stress = malloc(9*sizeof(double));
         k_space_stress = malloc(9*sizeof(double));
 
+        p3m_check_influence_functions();
+
         for (i = 0; i < 9; i++) {
             node_k_space_stress[i] = 0.0;
             k_space_stress[i] = 0.0;
         }
 
-        p3m_gather_fft_grid(p3m.rs_mesh);
-        fft_perform_forw(p3m.rs_mesh);
         force_prefac = coulomb.prefactor / (2.0 * box_l[0] * box_l[1] * box_l[2]);
-
-        for(jx=0; jx < fft.plan[3].new_mesh[0]; jx++) {
-            for(jy=0; jy < fft.plan[3].new_mesh[1]; jy++) {
-                for(jz=0; jz < fft.plan[3].new_mesh[2]; jz++) {
-                       kx = p3m.d_op[2][ jx + fft.plan[3].start[0] ];
-                       ky = p3m.d_op[0][ jy + fft.plan[3].start[1] ];
-                       kz = p3m.d_op[1][ jz + fft.plan[3].start[2] ];
-                    sqk = SQR(kx/box_l[x]) + SQR(ky/box_l[y]) + SQR(kz/box_l[z]);
-                    if (sqk == 0) {
-                        node_k_space_energy = 0.0;
-                        vterm = 0.0;
+        /* interlaced P3M averages over two meshes, shifted by half a mesh constant */
+        if (p3m.params.interlace) force_prefac *= 0.5;
+
+        for (mesh_ind = 0; mesh_ind <= p3m.params.interlace; mesh_ind++) {
+            ind = 0;
+            /* the mesh was transformed by the energy calculation already */
+            p3m_shift_mesh(mesh_ind);
+            p3m_charge_assign();
+            p3m_gather_fft_grid(p3m.rs_mesh);
+            fft_perform_forw(p3m.rs_mesh);
+
+            for(jx=0; jx < fft.plan[3].new_mesh[0]; jx++) {
+                for(jy=0; jy < fft.plan[3].new_mesh[1]; jy++) {
+                    for(jz=0; jz < fft.plan[3].new_mesh[2]; jz++) {
+                           kx = p3m.d_op[2][ jx + fft.plan[3].start[0] ];
+                           ky = p3m.d_op[0][ jy + fft.plan[3].start[1] ];
+                           kz = p3m.d_op[1][ jz + fft.plan[3].start[2] ];
+                        sqk = SQR(kx/box_l[x]) + SQR(ky/box_l[y]) + SQR(kz/box_l[z]);
+                        if (sqk == 0) {
+                            node_k_space_energy = 0.0;
+                            vterm = 0.0;
+                        }
+                        else {
+                            vterm = -2.0 * (1/sqk + SQR(PI/p3m.params.alpha));
+                            int j[3] = { jx, jy, jz };
+                            node_k_space_energy = fft_mode_weight(&fft, j) * p3m.g_energy[ind] * ( SQR(p3m.rs_mesh[2*ind]) + SQR(p3m.rs_mesh[2*ind + 1]) );
+                        }
+                        ind++;
+
+                        node_k_space_stress[0] += node_k_space_energy * (1.0 + vterm*SQR(kx/box_l[x]));     /* sigma_xx */
+                        node_k_space_stress[1] += node_k_space_energy * (vterm*kx*ky/(box_l[x]*box_l[y]));  /* sigma_xy */
+                        node_k_space_stress[2] += node_k_space_energy * (vterm*kx*kz/(box_l[x]*box_l[z]));  /* sigma_xz */
+
+                        node_k_space_stress[3] += node_k_space_energy * (vterm*kx*ky/(box_l[x]*box_l[y]));  /* sigma_yx */
+                        node_k_space_stress[4] += node_k_space_energy * (1.0 + vterm*SQR(ky/box_l[y]));     /* sigma_yy */
+                        node_k_space_stress[5] += node_k_space_energy * (vterm*ky*kz/(box_l[y]*box_l[z]));  /* sigma_yz */
+
+                        node_k_space_stress[6] += node_k_space_energy * (vterm*kx*kz/(box_l[x]*box_l[z]));  /* sigma_zx */
+                        node_k_space_stress[7] += node_k_space_energy * (vterm*ky*kz/(box_l[y]*box_l[z]));  /* sigma_zy */
+                        node_k_space_stress[8] += node_k_space_energy * (1.0 + vterm*SQR(kz/box_l[z]));     /* sigma_zz */
                     }
-                    else {
-                        vterm = -2.0 * (1/sqk + SQR(PI/p3m.params.alpha));
-                        node_k_space_energy = p3m.g_energy[ind] * ( SQR(p3m.rs_mesh[2*ind]) + SQR(p3m.rs_mesh[2*ind + 1]) );
-                    }
-                    ind++;
-
-                    node_k_space_stress[0] += node_k_space_energy * (1.0 + vterm*SQR(kx/box_l[x]));     /* sigma_xx */
-                    node_k_space_stress[1] += node_k_space_energy * (vterm*kx*ky/(box_l[x]*box_l[y]));  /* sigma_xy */
-                    node_k_space_stress[2] += node_k_space_energy * (vterm*kx*kz/(box_l[x]*box_l[z]));  /* sigma_xz */
-
-                    node_k_space_stress[3] += node_k_space_energy * (vterm*kx*ky/(box_l[x]*box_l[y]));  /* sigma_yx */
-                    node_k_space_stress[4] += node_k_space_energy * (1.0 + vterm*SQR(ky/box_l[y]));     /* sigma_yy */
-                    node_k_space_stress[5] += node_k_space_energy * (vterm*ky*kz/(box_l[y]*box_l[z]));  /* sigma_yz */
-
-                    node_k_space_stress[6] += node_k_space_energy * (vterm*kx*kz/(box_l[x]*box_l[z]));  /* sigma_zx */
-                    node_k_space_stress[7] += node_k_space_energy * (vterm*ky*kz/(box_l[y]*box_l[z]));  /* sigma_zy */
-                    node_k_space_stress[8] += node_k_space_energy * (1.0 + vterm*SQR(kz/box_l[z]));     /* sigma_zz */
                 }
             }
         }
+        if (p3m.params.interlace) p3m_shift_mesh(0);
         MPI_Reduce(node_k_space_stress, k_space_stress, 9, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
         for (i = 0; i < 9; i++) {
             stress[i] += k_space_stress[i] * force_prefac;
@@ -2365,6 +3985,13 @@ int tclprint_to_result_p3m(Tcl_Interp *interp)
   }
   sprintf(buffer,"%d",p3m.params.inter);
   Tcl_AppendResult(interp, "n_interpol ", buffer, " ", (char *) NULL);
+  Tcl_AppendResult(interp, "differentiation ", p3m.params.ad ? "ad " : "ik ", (char *) NULL);
+  sprintf(buffer,"%d",p3m.params.interlace);
+  Tcl_AppendResult(interp, "interlace ", buffer, " ", (char *) NULL);
+  sprintf(buffer,"%d",p3m.params.kspace_nodes);
+  Tcl_AppendResult(interp, "kspace_nodes ", buffer, " ", (char *) NULL);
+  sprintf(buffer,"%d",p3m.params.influence_cache);
+  Tcl_AppendResult(interp, "influence_cache ", buffer, " ", (char *) NULL);
   Tcl_PrintDouble(interp, p3m.params.mesh_off[0], buffer);
   Tcl_AppendResult(interp, "mesh_off ", buffer, " ", (char *) NULL);
   Tcl_PrintDouble(interp, p3m.params.mesh_off[1], buffer);
@@ -2386,8 +4013,8 @@ void p3m_p3m_print_struct(p3m_parameter_struct ps) {
   fprintf(stderr,"   mesh=(%d,%d,%d), mesh_off=(%.4f,%.4f,%.4f)\n",
 	  ps.mesh[0],ps.mesh[1],ps.mesh[2],
 	  ps.mesh_off[0],ps.mesh_off[1],ps.mesh_off[2]);
-  fprintf(stderr,"   cao=%d, inter=%d, epsilon=%f\n",
-	  ps.cao,ps.inter,ps.epsilon);
+  fprintf(stderr,"   cao=%d, inter=%d, ad=%d, interlace=%d, epsilon=%f\n",
+	  ps.cao,ps.inter,ps.ad,ps.interlace,ps.epsilon);
   fprintf(stderr,"   cao_cut=(%f,%f,%f)\n",
 	  ps.cao_cut[0],ps.cao_cut[1],ps.cao_cut[2]);
   fprintf(stderr,"   a=(%f,%f,%f), ai=(%f,%f,%f)\n",
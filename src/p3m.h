@@ -63,9 +63,9 @@ typedef struct {
   /** local mesh. */
   p3m_local_mesh local_mesh;
   /** real space mesh (local) for CA/FFT.*/
-  double *rs_mesh;
+  fft_float *rs_mesh;
   /** k space mesh (local) for k space calculation and FFT.*/
-  double *ks_mesh;
+  fft_float *ks_mesh;
   
   /** number of charged particles (only on master node). */
   int sum_qpart;
@@ -76,6 +76,9 @@ typedef struct {
 
   /** interpolation of the charge assignment function. */
   double *int_caf[7];
+  /** interpolation of the derivative of the charge assignment
+      function, only used for analytical differentiation. */
+  double *int_dcaf[7];
 
   /** position shift for calc. of first assignment mesh point. */
   double pos_shift;
@@ -83,19 +86,30 @@ typedef struct {
   double *meshift_x;
   double *meshift_y;
   double *meshift_z;
+  /** full aliasing sums per direction for the interlaced influence
+      functions, four values per mesh index (see
+      p3m_calc_interlace_sums) */
+  double *il_sums[3];
 
   /** Spatial differential operator in k-space. We use an i*k differentiation. */
   double *d_op[3];
-  /** Force optimised influence function (k-space) */
-  double *g_force;
+  /** Force optimised influence function (k-space), for ik- or
+      analytical differentiation depending on \ref p3m_parameter_struct::ad */
+  fft_float *g_force;
   /** Energy optimised influence function (k-space) */
-  double *g_energy;
+  fft_float *g_energy;
 
 #ifdef P3M_STORE_CA_FRAC
   /** number of charged particles on the node. */
   int ca_num;
-  /** Charge fractions for mesh assignment. */
+  /** Charge assignment weights. For each charge, \ref ca_block
+      values: cao weights in x, which include the charge, followed by
+      those in y and z. For analytical differentiation, the
+      derivatives of the weights follow in the same layout. The
+      charge fractions are the products of the weights. */
   double *ca_frac;
+  /** number of values per charge in \ref ca_frac. */
+  int ca_block;
   /** index of first mesh point for charge assignment. */
   int *ca_fmp;
 #endif
@@ -107,9 +121,9 @@ typedef struct {
   p3m_send_mesh  sm;
 
   /** Field to store grid points to send. */
-  double *send_grid; 
+  fft_float *send_grid; 
   /** Field to store grid points to recv */
-  double *recv_grid;
+  fft_float *recv_grid;
   } p3m_data_struct;
 
 /** P3M parameters. */
@@ -140,6 +154,22 @@ void p3m_scaleby_box_l();
 /** compute the k-space part of forces and energies for the charge-charge interaction  **/
 double p3m_calc_kspace_forces(int force_flag, int energy_flag);
 
+/** whether the k-space forces can be split into \ref
+    p3m_calc_kspace_forces_start and \ref p3m_calc_kspace_forces_finish,
+    i. e. the FFTs are done on a part of the nodes only (see \ref
+    p3m_parameter_struct::kspace_nodes). */
+int p3m_kspace_split_applicable();
+
+/** start the k-space forces for already assigned charges: the FFT
+    nodes do the FFTs, while the other nodes just hand over their
+    mesh and can go on with the real space forces. */
+void p3m_calc_kspace_forces_start(int energy_flag);
+
+/** finish the k-space forces started by \ref
+    p3m_calc_kspace_forces_start, i. e. collect the force meshes and
+    assign the forces. Returns the energy as \ref p3m_calc_kspace_forces. */
+double p3m_calc_kspace_forces_finish(int energy_flag);
+
 /** computer the k-space part of the stress tensor **/
 void p3m_calc_kspace_stress (double* stress);
 
@@ -162,7 +192,7 @@ enum P3M_TUNE_ERROR { P3M_TUNE_FAIL = 1, P3M_TUNE_NOCUTOFF = 2, P3M_TUNE_CAOTOLA
 /** Tune P3M parameters to desired accuracy.
 
     Usage:
-    \verbatim inter coulomb <bjerrum> p3m tune accuracy <value> [r_cut <value> mesh <value> cao <value>] \endverbatim
+    \verbatim inter coulomb <bjerrum> p3m tune accuracy <value> [r_cut <value> mesh <value> cao <value> differentiation <ik|ad>] \endverbatim
 
     The parameters are tuned to obtain the desired accuracy in best
     time, by running mpi_integrate(0) for several parameter sets.
@@ -183,6 +213,9 @@ enum P3M_TUNE_ERROR { P3M_TUNE_FAIL = 1, P3M_TUNE_NOCUTOFF = 2, P3M_TUNE_CAOTOLA
 
     For each setting \ref p3m_struct::alpha_L is calculated assuming that the
     error contributions of real and reciprocal space should be equal.
+    Unless the differentiation scheme is given, all settings are tried
+    both with ik- and with analytical differentiation, using the
+    respective error estimates.
 
     After checking if the total error fulfils the accuracy goal the
     time needed for one force calculation (including verlet list
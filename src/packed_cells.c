@@ -0,0 +1,288 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file packed_cells.c
+ *
+ *  Implementation of \ref packed_cells.h "packed_cells.h".
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+#include "packed_cells.h"
+#include "packed_kernels.h"
+#include "cells.h"
+#include "domain_decomposition.h"
+#include "interaction_data.h"
+#include "thermostat.h"
+#include "communication.h"
+
+/** Granularity of the packed arrays */
+#define PACKED_INCREMENT 32
+
+/************************************************
+ * variables
+ ************************************************/
+
+PackedCell *packed_cells = NULL;
+int n_packed_cells = 0;
+int packed_n_threads = 1;
+int packed_n_part = 0;
+double *packed_thread_forces = NULL;
+int *packed_part_loc = NULL;
+
+/** number of particle identities \ref packed_part_loc can hold, 0 if
+    the locations are not recorded. */
+static int packed_n_part_loc = 0;
+
+/************************************************
+ * privat functions
+ ************************************************/
+
+/** make sure that a packed cell can hold size particles. */
+static void realloc_packed_cell(PackedCell *pc, int size)
+{
+  if (size <= pc->max && size > pc->max - 4*PACKED_INCREMENT)
+    return;
+
+  pc->max  = PACKED_INCREMENT*((size + PACKED_INCREMENT - 1)/PACKED_INCREMENT);
+  pc->pos  = (double *)realloc(pc->pos,  3*pc->max*sizeof(double));
+  pc->f    = (double *)realloc(pc->f,    3*pc->max*sizeof(double));
+  pc->type = (int *)   realloc(pc->type,   pc->max*sizeof(int));
+#ifdef ELECTROSTATICS
+  pc->q    = (double *)realloc(pc->q,      pc->max*sizeof(double));
+#endif
+}
+
+/************************************************
+ * public functions
+ ************************************************/
+
+void packed_cells_update_layout()
+{
+  int c;
+
+  if (n_packed_cells != n_cells) {
+    for (c = n_cells; c < n_packed_cells; c++) {
+      free(packed_cells[c].pos);
+      free(packed_cells[c].f);
+      free(packed_cells[c].type);
+#ifdef ELECTROSTATICS
+      free(packed_cells[c].q);
+#endif
+    }
+    packed_cells = (PackedCell *)realloc(packed_cells, n_cells*sizeof(PackedCell));
+    for (c = n_packed_cells; c < n_cells; c++)
+      memset(&packed_cells[c], 0, sizeof(PackedCell));
+    n_packed_cells = n_cells;
+  }
+
+  for (c = 0; c < n_cells; c++) {
+    realloc_packed_cell(&packed_cells[c], cells[c].n);
+    packed_cells[c].n = cells[c].n;
+  }
+
+  CELL_TRACE(fprintf(stderr, "%d: packed_cells_update_layout: %d packed cells\n", this_node, n_packed_cells));
+}
+
+void packed_cells_free()
+{
+  int c;
+  for (c = 0; c < n_packed_cells; c++) {
+    free(packed_cells[c].pos);
+    free(packed_cells[c].f);
+    free(packed_cells[c].type);
+#ifdef ELECTROSTATICS
+    free(packed_cells[c].q);
+#endif
+  }
+  free(packed_cells);
+  packed_cells = NULL;
+  n_packed_cells = 0;
+  free(packed_thread_forces);
+  packed_thread_forces = NULL;
+  packed_n_part = 0;
+  free(packed_part_loc);
+  packed_part_loc = NULL;
+  packed_n_part_loc = 0;
+}
+
+/** copy the data of cell c into its packed cell and clear the packed forces. */
+static void gather_cell(int c)
+{
+  int i, np;
+  Particle *part;
+  PackedCell *pc;
+
+  part = cells[c].part;
+  np   = cells[c].n;
+  pc   = &packed_cells[c];
+  for (i = 0; i < np; i++) {
+    pc->pos[3*i    ] = part[i].r.p[0];
+    pc->pos[3*i + 1] = part[i].r.p[1];
+    pc->pos[3*i + 2] = part[i].r.p[2];
+    pc->type[i] = part[i].p.type;
+#ifdef ELECTROSTATICS
+    pc->q[i] = part[i].p.q;
+#endif
+  }
+  /* where the bond partners are packed */
+  if (packed_n_part_loc > 0) {
+    for (i = 0; i < np; i++)
+      if (local_particles[part[i].p.identity] == &part[i]) {
+	packed_part_loc[2*part[i].p.identity    ] = c;
+	packed_part_loc[2*part[i].p.identity + 1] = i;
+      }
+  }
+  memset(pc->f, 0, 3*np*sizeof(double));
+}
+
+void packed_cells_prepare()
+{
+  int c;
+  PackedCell *pc;
+
+  /* the layout is normally current, but the cell system might have
+     been changed without resorting */
+  if (n_packed_cells != n_cells)
+    packed_cells_update_layout();
+
+  packed_n_part = 0;
+  for (c = 0; c < n_cells; c++) {
+    pc = &packed_cells[c];
+    if (cells[c].n > pc->max)
+      realloc_packed_cell(pc, cells[c].n);
+    pc->n      = cells[c].n;
+    pc->offset = packed_n_part;
+    packed_n_part += pc->n;
+  }
+
+  if (n_bonded_ia > 0) {
+    if (packed_n_part_loc != max_seen_particle + 1) {
+      packed_n_part_loc = max_seen_particle + 1;
+      packed_part_loc = (int *)realloc(packed_part_loc, 2*packed_n_part_loc*sizeof(int));
+    }
+  }
+  else
+    packed_n_part_loc = 0;
+
+#ifdef _OPENMP
+  packed_n_threads = omp_get_max_threads();
+#endif
+  if (packed_n_threads > 1) {
+    packed_thread_forces = (double *)realloc(packed_thread_forces,
+					     3*(packed_n_threads - 1)*packed_n_part*sizeof(double));
+    memset(packed_thread_forces, 0, 3*(packed_n_threads - 1)*packed_n_part*sizeof(double));
+  }
+}
+
+void packed_cells_gather_cells(CellPList *cl)
+{
+  int c;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (c = 0; c < cl->n; c++)
+    gather_cell(cl->cell[c] - cells);
+}
+
+void packed_cells_gather()
+{
+  int c;
+
+  packed_cells_prepare();
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (c = 0; c < n_cells; c++)
+    gather_cell(c);
+}
+
+void packed_cells_scatter_forces()
+{
+  int c, i, t, np;
+  Particle *part;
+  PackedCell *pc;
+  double *tf;
+
+#ifdef _OPENMP
+#pragma omp parallel for private(part, np, pc, i, t, tf) schedule(static)
+#endif
+  for (c = 0; c < n_cells; c++) {
+    part = cells[c].part;
+    np   = cells[c].n;
+    pc   = &packed_cells[c];
+    /* sum up the thread buffers */
+    for (t = 1; t < packed_n_threads; t++) {
+      tf = packed_cells_force(pc, t);
+      for (i = 0; i < 3*np; i++)
+	pc->f[i] += tf[i];
+    }
+    for (i = 0; i < np; i++) {
+      part[i].f.f[0] += pc->f[3*i    ];
+      part[i].f.f[1] += pc->f[3*i + 1];
+      part[i].f.f[2] += pc->f[3*i + 2];
+    }
+  }
+}
+
+void packed_cells_pair_indices(IA_Neighbor *neighbor)
+{
+  int i, np = neighbor->vList.n;
+  Particle **pairs = neighbor->vList.pair;
+  Particle *p1 = neighbor->pList1->part, *p2 = neighbor->pList->part;
+
+  if (np > neighbor->max_pInd || np < neighbor->max_pInd - 4*PACKED_INCREMENT) {
+    neighbor->max_pInd = PACKED_INCREMENT*((np + PACKED_INCREMENT - 1)/PACKED_INCREMENT);
+    neighbor->pInd = (int *)realloc(neighbor->pInd, 2*neighbor->max_pInd*sizeof(int));
+  }
+
+  for (i = 0; i < np; i++) {
+    neighbor->pInd[2*i    ] = pairs[2*i    ] - p1;
+    neighbor->pInd[2*i + 1] = pairs[2*i + 1] - p2;
+  }
+}
+
+int packed_cells_applicable()
+{
+  if (cell_structure.type != CELL_STRUCTURE_DOMDEC || !dd.use_vList || !dd.use_packed)
+    return 0;
+
+#if defined(ADRESS) || defined(NO_INTRA_NB) || defined(TUNABLE_SLIP)
+  return 0;
+#endif
+
+#ifdef DPD
+  if (thermo_switch & THERMO_DPD) return 0;
+#endif
+#ifdef INTER_DPD
+  if (thermo_switch == THERMO_INTER_DPD) return 0;
+#endif
+
+#ifdef ELECTROSTATICS
+  if (coulomb.method != COULOMB_NONE && coulomb.method != COULOMB_P3M)
+    return 0;
+#endif
+#ifdef DIPOLES
+  if (coulomb.Dmethod != DIPOLAR_NONE)
+    return 0;
+#endif
+
+  return packed_kernels_init();
+}
@@ -0,0 +1,197 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PACKED_CELLS_H
+#define PACKED_CELLS_H
+/** \file packed_cells.h
+    Structure-of-arrays mirror of the cell particle data for the
+    non bonded force loop.
+
+    Every \ref Cell holds full \ref Particle structs, so that the
+    verlet pair loop has to touch several hundred bytes per particle
+    just to read the position and to write the force. For the
+    domain decomposition with verlet lists, the pair loop can instead
+    work on a compact copy of the data it really needs: for each entry
+    of \ref cells::cells there is one \ref PackedCell, holding the
+    positions, types, charges and force accumulators of its
+    particles in separate arrays, in the same order as in the cell.
+
+    The layout (number and sizes of the packed cells) is adapted in
+    \ref cells_resort_particles. Once per force calculation, \ref
+    packed_cells_gather copies positions, types and charges of all
+    local and ghost particles into the packed arrays and clears the
+    packed forces, the pair loop accumulates there, and \ref
+    packed_cells_scatter_forces adds the result to the particle forces
+    before the ghost forces are collected.
+
+    The verlet pair loop does not use the particle pointers of the
+    verlet lists, but the particle indices of \ref IA_Neighbor::pInd,
+    which \ref packed_cells_pair_indices sets up whenever a verlet list
+    is rebuilt. Therefore, between gather and scatter, the loop only
+    touches the packed cells.
+
+    The pairs are evaluated in batches by the kernels of \ref
+    packed_kernels.h, which only know about some of the
+    interactions. \ref packed_cells_applicable checks
+    whether the current interactions can be treated; otherwise the
+    force calculation silently falls back to \ref calculate_verlet_ia.
+    The packed loop can be switched off with
+    <tt>cellsystem domain_decomposition -no_packed</tt>.
+
+    If compiled with OpenMP, the packed pair loop is distributed over
+    the threads of each node cell by cell. Since a pair updates the
+    forces of both particles, each thread except the first accumulates
+    into its own force buffer, see \ref packed_cells_force. The buffers
+    are summed up in \ref packed_cells_scatter_forces.
+
+    The bonded interactions are threaded in the same way. Since the
+    bond partners are found via \ref local_particles, the gather also
+    records where the particle \ref local_particles points to is
+    packed, see \ref packed_particle_force.
+*/
+#include "utils.h"
+#include "cells.h"
+#include "domain_decomposition.h"
+
+/************************************************
+ * data types
+ ************************************************/
+
+/** Packed copy of the particle data of one cell needed in the
+    non bonded force loop. Particle i of the cell has its position at
+    pos[3*i], its force at f[3*i] and so on. */
+typedef struct {
+  /** particle positions, 3 doubles per particle. */
+  double *pos;
+  /** forces accumulated by the packed pair loop, 3 doubles per particle. */
+  double *f;
+  /** particle types. */
+  int *type;
+#ifdef ELECTROSTATICS
+  /** particle charges. */
+  double *q;
+#endif
+  /** number of particles in the cell. */
+  int n;
+  /** number of particles the arrays can hold. */
+  int max;
+  /** index of the first particle of the cell in the thread force
+      buffers. */
+  int offset;
+} PackedCell;
+
+/************************************************************/
+/** \name Exported Variables */
+/************************************************************/
+/*@{*/
+
+/** one packed cell per entry of \ref cells::cells . */
+extern PackedCell *packed_cells;
+/** number of packed cells. */
+extern int n_packed_cells;
+/** number of threads the packed forces are accumulated for. */
+extern int packed_n_threads;
+/** total number of particles in the packed cells. */
+extern int packed_n_part;
+/** force buffers of the threads 1 to \ref packed_n_threads - 1, each
+    holding 3 doubles for \ref packed_n_part particles. */
+extern double *packed_thread_forces;
+/** packed cell and index in that cell of the particle \ref
+    local_particles points to, for each particle identity. Only set up
+    if there are bonded interactions. */
+extern int *packed_part_loc;
+
+/*@}*/
+
+/************************************************************/
+/** \name Exported Functions */
+/************************************************************/
+/*@{*/
+
+/** Adapt the packed layout to the current number of cells and
+    particles per cell. Called from \ref cells_resort_particles. */
+void packed_cells_update_layout();
+
+/** Release the packed cells. */
+void packed_cells_free();
+
+/** Copy positions, types and charges of all local and ghost
+    particles into the packed cells and clear the packed forces. */
+void packed_cells_gather();
+
+/** Set up the packed cells and clear the thread force buffers, the
+    first part of \ref packed_cells_gather. The cells then have to be
+    filled by \ref packed_cells_gather_cells. */
+void packed_cells_prepare();
+
+/** Copy positions, types and charges of the particles of some cells
+    into their packed cells and clear the packed forces. Needs \ref
+    packed_cells_prepare first.
+    @param cl the cells to gather, e. g. \ref local_cells . */
+void packed_cells_gather_cells(CellPList *cl);
+
+/** Add the packed forces to the forces of the local and ghost
+    particles. */
+void packed_cells_scatter_forces();
+
+/** Set up the packed particle indices \ref IA_Neighbor::pInd of the
+    pairs of a verlet list. Has to be called whenever the verlet list
+    was rebuilt.
+    @param neighbor the cell pair whose verlet list was rebuilt. */
+void packed_cells_pair_indices(IA_Neighbor *neighbor);
+
+/** Check whether the packed force loop can be used with the current
+    cell system, thermostat and interactions.
+    \return 1 if the packed loop is applicable, 0 otherwise. */
+int packed_cells_applicable();
+
+/** Number of the calling thread, 0 without OpenMP. */
+MDINLINE int packed_thread_num()
+{
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/** The force accumulators of a packed cell for a thread. Thread 0
+    uses the forces of the packed cell itself.
+    @param pc     the packed cell
+    @param thread the thread number, see \ref packed_thread_num
+    @return pointer to the force of the first particle of the cell. */
+MDINLINE double *packed_cells_force(PackedCell *pc, int thread)
+{
+  if (thread == 0)
+    return pc->f;
+  return packed_thread_forces + 3*((thread - 1)*packed_n_part + pc->offset);
+}
+
+/** The force accumulator of a particle for a thread.
+    @param p      a particle \ref local_particles points to
+    @param thread the thread number, see \ref packed_thread_num
+    @return pointer to the packed force of the particle. */
+MDINLINE double *packed_particle_force(Particle *p, int thread)
+{
+  int *loc = &packed_part_loc[2*p->p.identity];
+  return packed_cells_force(&packed_cells[loc[0]], thread) + 3*loc[1];
+}
+
+/*@}*/
+
+#endif
@@ -0,0 +1,259 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** \file packed_kernels.c
+ *
+ *  Implementation of \ref packed_kernels.h "packed_kernels.h".
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "utils.h"
+/* the SIMD switches come from acconfig.h via utils.h */
+#if defined(SIMD_AVX2) || defined(SIMD_AVX512)
+#include <immintrin.h>
+#endif
+#include "packed_kernels.h"
+#include "forces.h"
+
+/************************************************
+ * variables
+ ************************************************/
+
+int *packed_ia_masks = NULL;
+
+/************************************************
+ * privat functions
+ ************************************************/
+
+/** potential flags of a type pair, or -1 if the pair has a potential
+    that the packed kernels do not support. */
+static int packed_ia_mask(IA_parameters *data)
+{
+  int mask = 0;
+
+#ifdef LENNARD_JONES
+  if (data->LJ_cut > 0) mask |= PACKED_IA_LJ;
+#endif
+#ifdef LJCOS
+  if (data->LJCOS_cut > 0) mask |= PACKED_IA_LJCOS;
+#endif
+#ifdef SOFT_SPHERE
+  if (data->soft_cut > 0) mask |= PACKED_IA_SOFT;
+#endif
+#ifdef MORSE
+  if (data->MORSE_cut > 0) mask |= PACKED_IA_MORSE;
+#endif
+#ifdef BUCKINGHAM
+  if (data->BUCK_cut > 0) mask |= PACKED_IA_BUCK;
+#endif
+#ifdef TABULATED
+  if (data->TAB_maxval > 0) mask |= PACKED_IA_TAB;
+#endif
+
+  /* not supported */
+#ifdef LENNARD_JONES_GENERIC
+  if (data->LJGEN_cut > 0) return -1;
+#endif
+#ifdef LJ_ANGLE
+  if (data->LJANGLE_cut > 0) return -1;
+#endif
+#ifdef SMOOTH_STEP
+  if (data->SmSt_cut > 0) return -1;
+#endif
+#ifdef HERTZIAN
+  if (data->Hertzian_sig > 0) return -1;
+#endif
+#ifdef BMHTF_NACL
+  if (data->BMHTF_cut > 0) return -1;
+#endif
+#ifdef LJCOS2
+  if (data->LJCOS2_cut > 0) return -1;
+#endif
+#ifdef GAY_BERNE
+  if (data->GB_cut > 0) return -1;
+#endif
+#ifdef INTER_RF
+  if (data->rf_on) return -1;
+#endif
+#ifdef MOL_CUT
+  if (data->mol_cut_type != 0) return -1;
+#endif
+
+  return mask;
+}
+
+#ifdef LENNARD_JONES
+/** Lennard-Jones force factors of a batch. The capped and the normal
+    branch of \ref lj_pair_force_factor only differ in the effective
+    distance, max(dist - offset, capradius), which makes the kernel
+    branch free. */
+static void lj_batch_force_factors(PairBatch *b)
+{
+  int k = 0, n = b->n;
+#if defined(SIMD_AVX2) || defined(SIMD_AVX512)
+  double cut[PACKED_BATCH], min[PACKED_BATCH], off[PACKED_BATCH];
+  double cap[PACKED_BATCH], sig2[PACKED_BATCH], eps48[PACKED_BATCH];
+  IA_parameters *ia;
+
+  for (k = 0; k < n; k++) {
+    ia       = b->ia[k];
+    cut[k]   = ia->LJ_cut + ia->LJ_offset;
+    min[k]   = ia->LJ_min + ia->LJ_offset;
+    off[k]   = ia->LJ_offset;
+    cap[k]   = ia->LJ_capradius;
+    sig2[k]  = SQR(ia->LJ_sig);
+    eps48[k] = 48.0*ia->LJ_eps;
+  }
+  k = 0;
+#endif
+
+#if defined(SIMD_AVX512)
+  {
+    const __m512d zero = _mm512_setzero_pd(), half = _mm512_set1_pd(0.5);
+    __m512d r, rc, frac2, frac6, num;
+    __mmask8 m;
+    for (; k + 8 <= n; k += 8) {
+      r  = _mm512_loadu_pd(&b->dist[k]);
+      m  = _mm512_cmp_pd_mask(r, _mm512_loadu_pd(&cut[k]), _CMP_LT_OQ) &
+	   _mm512_cmp_pd_mask(r, _mm512_loadu_pd(&min[k]), _CMP_GT_OQ) &
+	   _mm512_cmp_pd_mask(r, zero, _CMP_GT_OQ);
+      rc = _mm512_max_pd(_mm512_sub_pd(r, _mm512_loadu_pd(&off[k])), _mm512_loadu_pd(&cap[k]));
+      frac2 = _mm512_maskz_div_pd(m, _mm512_loadu_pd(&sig2[k]), _mm512_mul_pd(rc, rc));
+      frac6 = _mm512_mul_pd(frac2, _mm512_mul_pd(frac2, frac2));
+      num   = _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(&eps48[k]), frac6), _mm512_sub_pd(frac6, half));
+      _mm512_storeu_pd(&b->fac[k], _mm512_add_pd(_mm512_loadu_pd(&b->fac[k]),
+						 _mm512_maskz_div_pd(m, num, _mm512_mul_pd(rc, r))));
+    }
+  }
+#elif defined(SIMD_AVX2)
+  {
+    const __m256d zero = _mm256_setzero_pd(), half = _mm256_set1_pd(0.5);
+    __m256d r, m, rc, frac2, frac6, fac;
+    for (; k + 4 <= n; k += 4) {
+      r  = _mm256_loadu_pd(&b->dist[k]);
+      m  = _mm256_and_pd(_mm256_cmp_pd(r, _mm256_loadu_pd(&cut[k]), _CMP_LT_OQ),
+			 _mm256_and_pd(_mm256_cmp_pd(r, _mm256_loadu_pd(&min[k]), _CMP_GT_OQ),
+				       _mm256_cmp_pd(r, zero, _CMP_GT_OQ)));
+      rc = _mm256_max_pd(_mm256_sub_pd(r, _mm256_loadu_pd(&off[k])), _mm256_loadu_pd(&cap[k]));
+      frac2 = _mm256_div_pd(_mm256_loadu_pd(&sig2[k]), _mm256_mul_pd(rc, rc));
+      frac6 = _mm256_mul_pd(frac2, _mm256_mul_pd(frac2, frac2));
+      fac   = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(&eps48[k]), frac6),
+					  _mm256_sub_pd(frac6, half)),
+			    _mm256_mul_pd(rc, r));
+      /* out of range lanes may contain garbage, mask them out */
+      _mm256_storeu_pd(&b->fac[k], _mm256_add_pd(_mm256_loadu_pd(&b->fac[k]),
+						 _mm256_and_pd(m, fac)));
+    }
+  }
+#endif
+
+  /* scalar kernel and remainder */
+  for (; k < n; k++)
+    b->fac[k] += lj_pair_force_factor(b->ia[k], b->dist[k]);
+}
+#endif
+
+/************************************************
+ * public functions
+ ************************************************/
+
+int packed_kernels_init()
+{
+  int i, j, mask;
+
+  packed_ia_masks = (int *)realloc(packed_ia_masks, SQR(n_particle_types)*sizeof(int));
+  for (i = 0; i < n_particle_types; i++)
+    for (j = i; j < n_particle_types; j++) {
+      mask = packed_ia_mask(get_ia_param(i, j));
+      if (mask < 0)
+	return 0;
+      packed_ia_masks[i*n_particle_types + j] =
+	packed_ia_masks[j*n_particle_types + i] = mask;
+    }
+  return 1;
+}
+
+void packed_batch_flush(PairBatch *b, double p_vir[3])
+{
+  int k, j, n = b->n;
+  double force[3];
+
+  for (k = 0; k < n; k++) {
+    b->dist[k] = sqrt(b->dist2[k]);
+    b->fac[k]  = 0.0;
+  }
+
+  /* short range potentials, one after the other over the whole batch */
+#ifdef LENNARD_JONES
+  if (b->mask & PACKED_IA_LJ)
+    lj_batch_force_factors(b);
+#endif
+#ifdef LJCOS
+  if (b->mask & PACKED_IA_LJCOS)
+    for (k = 0; k < n; k++)
+      b->fac[k] += ljcos_pair_force_factor(b->ia[k], b->dist[k]);
+#endif
+#ifdef SOFT_SPHERE
+  if (b->mask & PACKED_IA_SOFT)
+    for (k = 0; k < n; k++)
+      b->fac[k] += soft_pair_force_factor(b->ia[k], b->dist[k]);
+#endif
+#ifdef MORSE
+  if (b->mask & PACKED_IA_MORSE)
+    for (k = 0; k < n; k++)
+      b->fac[k] += morse_pair_force_factor(b->ia[k], b->dist[k]);
+#endif
+#ifdef BUCKINGHAM
+  if (b->mask & PACKED_IA_BUCK)
+    for (k = 0; k < n; k++)
+      b->fac[k] += buck_pair_force_factor(b->ia[k], b->dist[k]);
+#endif
+#ifdef TABULATED
+  if (b->mask & PACKED_IA_TAB)
+    for (k = 0; k < n; k++)
+      b->fac[k] += tabulated_pair_force_factor(b->ia[k], b->dist[k]);
+#endif
+
+  /* forces, virial and real space electrostatics */
+  for (k = 0; k < n; k++) {
+    for (j = 0; j < 3; j++) {
+      force[j] = b->fac[k]*b->d[k][j];
+#ifdef NPT
+      p_vir[j] += force[j]*b->d[k][j];
+#endif
+    }
+
+#if defined(ELECTROSTATICS) && defined(P3M)
+    if (coulomb.method == COULOMB_P3M && b->q1q2[k] != 0.0) {
+#ifdef NPT
+      p_vir[0] += p3m_add_pair_force(b->q1q2[k], b->d[k], b->dist2[k], b->dist[k], force);
+#else
+      p3m_add_pair_force(b->q1q2[k], b->d[k], b->dist2[k], b->dist[k], force);
+#endif
+    }
+#endif
+
+    for (j = 0; j < 3; j++) {
+      b->f1[k][j] += force[j];
+      b->f2[k][j] -= force[j];
+    }
+  }
+
+  b->n    = 0;
+  b->mask = 0;
+}
@@ -0,0 +1,140 @@
+/*
+  Copyright (C) 2010,2011 The ESPResSo project
+
+  This file is part of ESPResSo.
+
+  ESPResSo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  ESPResSo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PACKED_KERNELS_H
+#define PACKED_KERNELS_H
+/** \file packed_kernels.h
+    Batched non bonded pair kernels for the packed force loop.
+
+    Instead of evaluating \ref add_non_bonded_pair_force pair by pair,
+    the packed loop (see \ref packed_cells.h) collects up to \ref
+    PACKED_BATCH pairs in a \ref PairBatch and evaluates the scalar
+    force factors of all pairs of the batch potential by potential,
+    over contiguous arrays. Only central potentials, where the force
+    is given by a factor times the distance vector, are supported:
+    Lennard-Jones (and therefore WCA), Lennard-Jones+cos,
+    soft-sphere, Morse, Buckingham and tabulated potentials, plus the
+    real space part of P3M.
+
+    The Lennard-Jones kernel, which dominates most simulations, has
+    explicit SIMD versions that evaluate 4 (AVX2) or 8 (AVX-512) pairs
+    at once. The instruction set is chosen at configure time with
+    <tt>--with-simd=avx2|avx512</tt>, which defines SIMD_AVX2 or
+    SIMD_AVX512, respectively; otherwise, a scalar kernel is used. The
+    remaining potentials need transcendental functions and are
+    evaluated by scalar loops over the batch.
+*/
+#include "utils.h"
+#include "interaction_data.h"
+
+/** Number of pairs evaluated in one batch. Multiple of the SIMD width. */
+#define PACKED_BATCH 64
+
+/** \name Potential flags
+    Bit flags of the potentials active for a type pair, see \ref
+    packed_ia_masks. */
+/*@{*/
+#define PACKED_IA_LJ     1
+#define PACKED_IA_LJCOS  2
+#define PACKED_IA_SOFT   4
+#define PACKED_IA_MORSE  8
+#define PACKED_IA_BUCK  16
+#define PACKED_IA_TAB   32
+/*@}*/
+
+/** A batch of pairs for the packed pair kernels. */
+typedef struct {
+  /** number of pairs in the batch. */
+  int n;
+  /** or'ed \ref packed_ia_masks of the pairs in the batch. */
+  int mask;
+  /** distance vectors. */
+  double d[PACKED_BATCH][3];
+  /** squared distances. */
+  double dist2[PACKED_BATCH];
+  /** distances. */
+  double dist[PACKED_BATCH];
+  /** interaction parameters of the pairs. */
+  IA_parameters *ia[PACKED_BATCH];
+  /** products of the charges. */
+  double q1q2[PACKED_BATCH];
+  /** force accumulators of the first and second particles. */
+  double *f1[PACKED_BATCH], *f2[PACKED_BATCH];
+  /** short range force factors, the force on particle 1 is fac*d. */
+  double fac[PACKED_BATCH];
+} PairBatch;
+
+/************************************************************/
+/** \name Exported Variables */
+/************************************************************/
+/*@{*/
+
+/** potential flags for all type pairs, indexed like \ref get_ia_param. */
+extern int *packed_ia_masks;
+
+/*@}*/
+
+/************************************************************/
+/** \name Exported Functions */
+/************************************************************/
+/*@{*/
+
+/** Determine the potentials active for each type pair.
+    \return 1 if the packed kernels support all active
+    potentials, 0 otherwise. */
+int packed_kernels_init();
+
+/** Evaluate all pairs of a batch, add the forces to the packed force
+    accumulators and empty the batch.
+    @param b     the batch.
+    @param p_vir NpT virial, the contributions are added.
+*/
+void packed_batch_flush(PairBatch *b, double p_vir[3]);
+
+/** Append a pair to a batch, and evaluate the batch if it is full.
+    @param b     the batch.
+    @param t1    type of particle 1.
+    @param t2    type of particle 2.
+    @param q1q2  product of the charges.
+    @param d     distance vector from particle 2 to 1.
+    @param dist2 distance squared.
+    @param f1    force accumulator of particle 1.
+    @param f2    force accumulator of particle 2.
+    @param p_vir NpT virial.
+*/
+MDINLINE void packed_batch_add(PairBatch *b, int t1, int t2, double q1q2,
+			       double d[3], double dist2,
+			       double *f1, double *f2, double p_vir[3])
+{
+  int k = b->n++;
+  b->d[k][0]  = d[0];
+  b->d[k][1]  = d[1];
+  b->d[k][2]  = d[2];
+  b->dist2[k] = dist2;
+  b->ia[k]    = get_ia_param(t1, t2);
+  b->q1q2[k]  = q1q2;
+  b->f1[k]    = f1;
+  b->f2[k]    = f2;
+  b->mask    |= packed_ia_masks[t1*n_particle_types + t2];
+  if (b->n == PACKED_BATCH)
+    packed_batch_flush(b, p_vir);
+}
+
+/*@}*/
+
+#endif
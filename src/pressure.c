@@ -27,6 +27,7 @@
 #include "integrate.h"
 #include "initialize.h"
 #include "domain_decomposition.h"
+#include "cluster_lists.h"
 #include "nsquare.h"
 #include "layered.h"
 
@@ -124,8 +125,14 @@ void pressure_calc(double *result, double *result_t, double *result_nb, double *
     layered_calculate_virials();
     break;
   case CELL_STRUCTURE_DOMDEC:
-    if (rebuild_verletlist) build_verlet_lists();
-    calculate_verlet_virials(v_comp);
+    if (dd.use_clusters) {
+      if (rebuild_verletlist) build_cluster_lists();
+      calculate_cluster_virials(v_comp);
+    }
+    else {
+      if (rebuild_verletlist) build_verlet_lists();
+      calculate_verlet_virials(v_comp);
+    }
     break;
   case CELL_STRUCTURE_NSQUARE:
     nsq_calculate_virials();
@@ -154,6 +154,20 @@ MDINLINE void add_soft_pair_force(Particle *p1, Particle *p2, IA_parameters *ia_
   }
 }
 
+/** Calculate the soft-sphere force factor for a pair at distance dist,
+    i. e. the force on particle 1 is fac*d. Particle free version of
+    \ref add_soft_pair_force for the packed force loop. */
+MDINLINE double soft_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  double r_off;
+  if(dist < ia_params->soft_cut+ia_params->soft_offset) {
+    r_off = dist - ia_params->soft_offset;
+    if(r_off > 0.0)
+      return soft_force_r(ia_params->soft_a, ia_params->soft_n, r_off)/dist;
+  }
+  return 0.0;
+}
+
 /** calculate soft-sphere energy between particle p1 and p2. */
 MDINLINE double soft_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
 				double d[3], double dist)
@@ -183,6 +183,9 @@ int aggregation(double dist_criteria2, int min_contact, int s_mol_id, int f_mol_
 
   on_observable_calc();
   build_verlet_lists();
+  /* the cluster lists are not up to date anymore */
+  if (dd.use_clusters)
+    rebuild_verletlist = 1;
 
   for (i = s_mol_id; i <= f_mol_id; i++) {
     head_list[i]=i;
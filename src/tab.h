@@ -432,6 +432,39 @@ MDINLINE void add_tabulated_pair_force(Particle *p1, Particle *p2, IA_parameters
   }
 }
 
+/** Calculate the tabulated force factor for a pair at distance dist,
+    i. e. the force on particle 1 is fac*d. Particle free version of
+    \ref add_tabulated_pair_force for the packed force loop. */
+MDINLINE double tabulated_pair_force_factor(IA_parameters *ia_params, double dist)
+{
+  double phi, dindex, fac = 0.0;
+  int tablepos, table_start;
+  double maxval = ia_params->TAB_maxval;
+  double minval = ia_params->TAB_minval;
+
+  if ( maxval > 0 && dist < maxval ) {
+    table_start = ia_params->TAB_startindex;
+    dindex = (dist-minval)/ia_params->TAB_stepsize;
+    tablepos = (int)(floor(dindex));
+
+    if ( dist > minval ) {
+      phi = dindex - tablepos;
+      fac = tabulated_forces.e[table_start + tablepos]*(1-phi) + tabulated_forces.e[table_start + tablepos+1]*phi;
+    }
+    /* Use an extrapolation beyond the table */
+    else if ( dist > 0 ) {
+      phi = dindex;
+      fac = (tabulated_forces.e[table_start]*minval)*(1-phi) +
+	(tabulated_forces.e[table_start+1]*(minval+ia_params->TAB_stepsize))*phi;
+      fac = fac/dist;
+    }
+
+    if ( tab_force_cap > 0.0 && tab_force_cap/dist < fac )
+      fac = tab_force_cap/dist;
+  }
+  return fac;
+}
+
 /** Add a non-bonded pair energy by linear interpolation from a table.
     Needs feature TABULATED compiled in (see \ref config.h). */
 MDINLINE double tabulated_pair_energy(Particle *p1, Particle *p2, IA_parameters *ia_params,
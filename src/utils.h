@@ -31,6 +31,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "config.h"
 #include "debug.h"
 
@@ -766,6 +769,23 @@ MDINLINE void get_grid_pos(int i, int *a, int *b, int *c, int adim[3])
   *c = i;
 }
 
+/** get the index of a point on the Morton (Z-order) space filling
+ *  curve through a 3D grid, by interleaving the bits of the
+ *  coordinates. Points with close indices are close in space.
+ *
+ * @return        the Morton index
+ * @param a       x position, only the lowest 10 bits are used
+ * @param b       y position, only the lowest 10 bits are used
+ * @param c       z position, only the lowest 10 bits are used
+ */
+MDINLINE unsigned int get_morton_index(unsigned int a, unsigned int b, unsigned int c)
+{
+  unsigned int i, index = 0;
+  for (i = 0; i < 10; i++)
+    index |= (((a >> i) & 1) << (3*i)) | (((b >> i) & 1) << (3*i + 1)) | (((c >> i) & 1) << (3*i + 2));
+  return index;
+}
+
 /** Malloc a 3d grid for doubles with dimension dim[3] . 
  * @param grid    pointer to grid.
  * @param dim  dimension of the grid.
@@ -36,6 +36,9 @@
 #include "pressure.h"
 #include "domain_decomposition.h"
 #include "constraint.h"
+#include "packed_cells.h"
+#include "packed_kernels.h"
+#include "ghosts.h"
 
 /** Granularity of the verlet list */
 #define LIST_INCREMENT 20
@@ -46,7 +49,30 @@
 
 int rebuild_verletlist = 1;
 
-
+/** State of a cell at the last call of \ref build_verlet_lists_incremental. */
+typedef struct {
+  /** particle storage of the cell */
+  Particle *part;
+  /** number of particles */
+  int n;
+  /** allocated size of \ref VerletCellRecord::identity and \ref VerletCellRecord::pos */
+  int max;
+  /** identities of the particles */
+  int *identity;
+  /** positions of the particles */
+  double *pos;
+  /** 1 if the pair lists of the cell are rebuilt */
+  int changed;
+} VerletCellRecord;
+
+/** one record per cell of \ref cells::cells */
+static VerletCellRecord *cell_record = NULL;
+/** allocated number of cell records */
+static int n_cell_records = 0;
+/** 0 if the records do not describe the current verlet lists */
+static int cell_records_valid = 0;
+/** the margin the verlet lists were built with, see \ref incremental_margin */
+static double cell_record_margin = 0.0;
 
 /** \name Privat Functions */
 /************************************************************/
@@ -76,6 +102,57 @@ MDINLINE void add_pair(PairList *pl, Particle *p1, Particle *p2)
     \param pl Pointer to the verlet pair list. */
 void resize_verlet_list(PairList *pl);
 
+/** The distance a particle may move before the pair lists of its cell
+    are rebuilt by \ref build_verlet_lists_incremental. This is a
+    quarter of the skin, but the lists, which contain all pairs within
+    \ref max_range_non_bonded plus twice the margin, must not reach
+    beyond the neighbor cells. */
+static double incremental_margin()
+{
+  int i;
+  double margin = 0.25*skin;
+
+  for (i = 0; i < 3; i++)
+    if (0.5*(dd.cell_size[i] - max_range_non_bonded) < margin)
+      margin = 0.5*(dd.cell_size[i] - max_range_non_bonded);
+  return (margin > 0.0) ? margin : 0.0;
+}
+
+/** Whether the particles of a cell were exchanged or moved further
+    than sqrt(margin2) since the record was taken. */
+static int cell_changed(Cell *cell, VerletCellRecord *rec, double margin2)
+{
+  int i;
+  Particle *part = cell->part;
+
+  if (part != rec->part || cell->n != rec->n)
+    return 1;
+  for (i = 0; i < cell->n; i++)
+    if (part[i].p.identity != rec->identity[i] ||
+	distance2(part[i].r.p, &rec->pos[3*i]) > margin2)
+      return 1;
+  return 0;
+}
+
+/** Store the current state of a cell in its record. */
+static void store_cell_record(Cell *cell, VerletCellRecord *rec)
+{
+  int i;
+  Particle *part = cell->part;
+
+  if (cell->n > rec->max) {
+    rec->max      = cell->n;
+    rec->identity = (int *)realloc(rec->identity, rec->max*sizeof(int));
+    rec->pos      = (double *)realloc(rec->pos, 3*rec->max*sizeof(double));
+  }
+  rec->part = part;
+  rec->n    = cell->n;
+  for (i = 0; i < cell->n; i++) {
+    rec->identity[i] = part[i].p.identity;
+    memcpy(&rec->pos[3*i], part[i].r.p, 3*sizeof(double));
+  }
+}
+
 /*@}*/
 
 /*******************  exported functions  *******************/
@@ -97,7 +174,6 @@ void free_pairList(PairList *list)
 void build_verlet_lists()
 {
   int c, np1, n, np2, i ,j, j_start;
-  Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   PairList *pl;
@@ -111,17 +187,22 @@ void build_verlet_lists()
 
   if (!dd.use_vList) { fprintf(stderr, "%d: build_verlet_lists, but use_vList == 0\n", this_node); errexit(); }
 #endif
+
+  if (dd.use_incremental) {
+    build_verlet_lists_incremental();
+    return;
+  }
+  cell_records_valid = 0;
    
   /* Loop local cells */
   for (c = 0; c < local_cells.n; c++) {
     VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       /* init pair list */
@@ -147,6 +228,8 @@ void build_verlet_lists()
 	}
       }
       resize_verlet_list(pl);
+      if (dd.use_packed)
+	packed_cells_pair_indices(neighbor);
       VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d particles\n",this_node,n,pl->n));
       VERLET_TRACE(sum += pl->n);
     }
@@ -157,45 +240,372 @@ void build_verlet_lists()
   rebuild_verletlist = 0;
 }
 
-void calculate_verlet_ia()
+void build_verlet_lists_incremental()
 {
-  int c, np, n, i;
+  int c, np1, n, np2, i ,j, j_start;
+  IA_Neighbor *neighbor;
+  Particle *p1, *p2;
+  PairList *pl;
+  double dist2, range2, margin = incremental_margin();
+#ifdef VERLET_DEBUG
+  int rebuilt = 0;
+#endif
+
+  if (n_cells > n_cell_records) {
+    cell_record = (VerletCellRecord *)realloc(cell_record, n_cells*sizeof(VerletCellRecord));
+    for (c = n_cell_records; c < n_cells; c++) {
+      cell_record[c].part     = NULL;
+      cell_record[c].n        = cell_record[c].max = 0;
+      cell_record[c].identity = NULL;
+      cell_record[c].pos      = NULL;
+    }
+    n_cell_records = n_cells;
+    cell_records_valid = 0;
+  }
+  if (margin != cell_record_margin)
+    cell_records_valid = 0;
+
+  /* find the cells, local or ghost, whose particles changed */
+  for (c = 0; c < n_cells; c++) {
+    cell_record[c].changed = !cell_records_valid ||
+      cell_changed(&cells[c], &cell_record[c], SQR(margin));
+    if (cell_record[c].changed)
+      store_cell_record(&cells[c], &cell_record[c]);
+  }
+
+  /* The unchanged lists contain all pairs within max_range_non_bonded
+     plus the margin of both particles, therefore they stay valid as
+     long as none of the particles moves further than skin/2 from its
+     last old position plus the margin from its recorded position. */
+  range2 = SQR(max_range_non_bonded + 2*margin);
+
+  /* Loop local cells */
+  for (c = 0; c < local_cells.n; c++) {
+    /* Loop cell neighbors */
+    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
+      neighbor = &dd.cell_inter[c].nList[n];
+      if (!cell_record[neighbor->pList1 - cells].changed &&
+	  !cell_record[neighbor->pList - cells].changed)
+	continue;
+      VERLET_TRACE(rebuilt++);
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
+      p2  = neighbor->pList->part;
+      np2 = neighbor->pList->n;
+      /* init pair list */
+      pl  = &neighbor->vList;
+      pl->n = 0;
+      /* Loop cell particles */
+      for(i=0; i < np1; i++) {
+	/* Tasks within cell: avoid double counting */
+	j_start = (n == 0) ? i+1 : 0;
+	/* Loop neighbor cell particles */
+	for(j = j_start; j < np2; j++) {
+#ifdef EXCLUSIONS
+          if(do_nonbonded(&p1[i], &p2[j]))
+#endif
+	  {
+	    dist2 = distance2(p1[i].r.p, p2[j].r.p);
+	    if(dist2 <= range2) add_pair(pl, &p1[i], &p2[j]);
+	  }
+	}
+      }
+      resize_verlet_list(pl);
+      if (dd.use_packed)
+	packed_cells_pair_indices(neighbor);
+    }
+  }
+
+  /* store old positions */
+  for (c = 0; c < local_cells.n; c++) {
+    p1  = local_cells.cell[c]->part;
+    np1 = local_cells.cell[c]->n;
+    for(i=0; i < np1; i++)
+      memcpy(p1[i].l.p_old, p1[i].r.p, 3*sizeof(double));
+  }
+
+  VERLET_TRACE(fprintf(stderr,"%d: build_verlet_lists_incremental: rebuilt %d pair lists, margin %f\n",this_node,rebuilt,margin));
+
+  cell_record_margin = margin;
+  cell_records_valid = 1;
+  rebuild_verletlist = 0;
+}
+
+void invalidate_verlet_cell_records()
+{
+  cell_records_valid = 0;
+}
+
+/** Bonded and nonbonded force loop of local cell c, see \ref calculate_verlet_ia. */
+static void calculate_verlet_ia_cell(int c)
+{
+  int np, n, i;
   Cell *cell;
   Particle *p1, *p2, **pairs;
   double dist2, vec21[3];
 
+  cell = local_cells.cell[c];
+  p1   = cell->part;
+  np  = cell->n;
+  /* calculate bonded interactions (loop local particles) */
+  for(i = 0; i < np; i++)  {
+    add_bonded_force(&p1[i]);
+#ifdef CONSTRAINTS
+    add_constraints_forces(&p1[i]);
+#endif
+  }
+
+  /* Loop cell neighbors */
+  for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
+    pairs = dd.cell_inter[c].nList[n].vList.pair;
+    np    = dd.cell_inter[c].nList[n].vList.n;
+    /* verlet list loop */
+    for(i=0; i<2*np; i+=2) {
+      p1 = pairs[i];                    /* pointer to particle 1 */
+      p2 = pairs[i+1];                  /* pointer to particle 2 */
+      dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
+      add_non_bonded_pair_force(p1, p2, vec21, sqrt(dist2), dist2);
+    }
+  }
+}
+
+void calculate_verlet_ia()
+{
+  int c;
+
   /* Loop local cells */
-  for (c = 0; c < local_cells.n; c++) {
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np  = cell->n;
-    /* calculate bonded interactions (loop local particles) */
-    for(i = 0; i < np; i++)  {
-      add_bonded_force(&p1[i]);
+  for (c = 0; c < local_cells.n; c++)
+    calculate_verlet_ia_cell(c);
+}
+
+/** Whether local cell c is treated in a loop over the cells of type
+    select, which is 1 for the inner cells (see \ref
+    IA_Neighbor_List::inner), 0 for the others or -1 for all cells. */
+MDINLINE int cell_selected(int c, int select)
+{
+  return select < 0 || dd.cell_inter[c].inner == select;
+}
+
+/** calculate the bonded interactions and constraints of the particles
+    of the local cells first to last-1 of type select (see \ref
+    cell_selected). The bonds write to the forces of arbitrary
+    partners, therefore the threads accumulate into the packed force
+    buffers, which have to be gathered. The virial is added to
+    p_vir. The constraints also write to the constraint itself and are
+    not threaded. */
+static void add_bonded_forces_cells(int first, int last, int select, double *p_vir)
+{
+  int c, i, np, thread;
+  Particle *p1;
+  double t_vir[3];
+
+  if (n_bonded_ia > 0) {
+#ifdef _OPENMP
+#pragma omp parallel private(c, i, np, thread, p1, t_vir)
+#endif
+    {
+      thread = packed_thread_num();
+      t_vir[0] = t_vir[1] = t_vir[2] = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (c = first; c < last; c++) {
+	if (!cell_selected(c, select))
+	  continue;
+	p1 = local_cells.cell[c]->part;
+	np = local_cells.cell[c]->n;
+	for(i = 0; i < np; i++)
+	  add_bonded_force_to(&p1[i], thread, t_vir);
+      }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      for (i = 0; i < 3; i++)
+	p_vir[i] += t_vir[i];
+    }
+  }
+
 #ifdef CONSTRAINTS
+  for (c = first; c < last; c++) {
+    if (!cell_selected(c, select))
+      continue;
+    p1 = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)
       add_constraints_forces(&p1[i]);
+  }
 #endif
-    }
+}
 
-    /* Loop cell neighbors */
-    for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
-      pairs = dd.cell_inter[c].nList[n].vList.pair;
-      np    = dd.cell_inter[c].nList[n].vList.n;
-      /* verlet list loop */
-      for(i=0; i<2*np; i+=2) {
-	p1 = pairs[i];                    /* pointer to particle 1 */
-	p2 = pairs[i+1];                  /* pointer to particle 2 */
-	dist2 = distance2vec(p1->r.p, p2->r.p, vec21);
-	add_non_bonded_pair_force(p1, p2, vec21, sqrt(dist2), dist2);
+/** packed pair loop over the local cells first to last-1 of type
+    select (see \ref cell_selected). The packed cells have to be
+    gathered, the virial is added to p_vir. */
+static void packed_pair_loop(int first, int last, int select, double *p_vir)
+{
+  int c, np, n, i, i1, i2, thread;
+  IA_Neighbor *neighbor;
+  PackedCell *pc1, *pc2;
+  int *pairs;
+  double *x1, *x2, *f1, *f2;
+  double dist2, vec21[3], t_vir[3];
+  PairBatch batch;
+
+#ifdef _OPENMP
+#pragma omp parallel private(c, np, n, i, i1, i2, thread, neighbor, pc1, pc2, pairs, \
+			     x1, x2, f1, f2, dist2, vec21, t_vir, batch)
+#endif
+  {
+    thread = packed_thread_num();
+    batch.n = batch.mask = 0;
+    t_vir[0] = t_vir[1] = t_vir[2] = 0.0;
+
+    /* Loop local cells */
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (c = first; c < last; c++) {
+      if (!cell_selected(c, select))
+	continue;
+      /* Loop cell neighbors */
+      for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
+	neighbor = &dd.cell_inter[c].nList[n];
+	pc1   = &packed_cells[neighbor->pList1 - cells];
+	f1    = packed_cells_force(pc1, thread);
+	pc2   = &packed_cells[neighbor->pList - cells];
+	f2    = packed_cells_force(pc2, thread);
+	pairs = neighbor->pInd;
+	np    = neighbor->vList.n;
+	/* verlet list loop on the packed indices */
+	for(i=0; i<2*np; i+=2) {
+	  i1 = pairs[i];
+	  i2 = pairs[i+1];
+	  x1 = &pc1->pos[3*i1];
+	  x2 = &pc2->pos[3*i2];
+	  vec21[0] = x1[0] - x2[0];
+	  vec21[1] = x1[1] - x2[1];
+	  vec21[2] = x1[2] - x2[2];
+	  dist2 = SQR(vec21[0]) + SQR(vec21[1]) + SQR(vec21[2]);
+	  packed_batch_add(&batch, pc1->type[i1], pc2->type[i2],
+#ifdef ELECTROSTATICS
+			   pc1->q[i1]*pc2->q[i2],
+#else
+			   0.0,
+#endif
+			   vec21, dist2, &f1[3*i1], &f2[3*i2], t_vir);
+	}
       }
     }
+    /* remaining pairs */
+    packed_batch_flush(&batch, t_vir);
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    for (i = 0; i < 3; i++)
+      p_vir[i] += t_vir[i];
+  }
+}
+
+void calculate_verlet_ia_packed()
+{
+  double p_vir[3] = { 0., 0., 0. };
+
+  packed_cells_gather();
+
+  add_bonded_forces_cells(0, local_cells.n, -1, p_vir);
+
+  packed_pair_loop(0, local_cells.n, -1, p_vir);
+
+  packed_cells_scatter_forces();
+
+#ifdef NPT
+  if(integ_switch == INTEG_METHOD_NPT_ISO) {
+    int i;
+    for (i = 0; i < 3; i++)
+      nptiso.p_vir[i] += p_vir[i];
+  }
+#endif
+}
+
+/** state of the inner cell loop of \ref calculate_verlet_ia_overlapped */
+static struct {
+  /** use the packed pair loop */
+  int packed;
+  /** next local cell to treat */
+  int next;
+  /** number of cells treated per call of \ref verlet_inner_cells_work */
+  int chunk;
+  /** virial of the packed pair loop */
+  double p_vir[3];
+} overlap;
+
+/** Calculate the forces of the next few inner cells.
+    \return 0 if all inner cells are done. */
+static int verlet_inner_cells_work()
+{
+  int c, last = overlap.next + overlap.chunk;
+
+  if (last > local_cells.n)
+    last = local_cells.n;
+
+  if (overlap.packed) {
+    add_bonded_forces_cells(overlap.next, last, 1, overlap.p_vir);
+    packed_pair_loop(overlap.next, last, 1, overlap.p_vir);
+  }
+  else {
+    for (c = overlap.next; c < last; c++)
+      if (dd.cell_inter[c].inner)
+	calculate_verlet_ia_cell(c);
+  }
+
+  overlap.next = last;
+  return (last < local_cells.n);
+}
+
+void calculate_verlet_ia_overlapped()
+{
+  int c;
+
+  overlap.packed = packed_cells_applicable();
+  overlap.next   = 0;
+  overlap.p_vir[0] = overlap.p_vir[1] = overlap.p_vir[2] = 0.0;
+
+  /* the inner cells only need the local particles */
+  if (overlap.packed) {
+    packed_cells_prepare();
+    packed_cells_gather_cells(&local_cells);
+    overlap.chunk = packed_n_threads;
+  }
+  else
+    overlap.chunk = 1;
+
+  if (ghost_communicator_overlap(&cell_structure.update_ghost_pos_comm, verlet_inner_cells_work))
+    while (verlet_inner_cells_work());
+
+  /* the remaining cells, which need the ghosts */
+  if (overlap.packed) {
+    packed_cells_gather_cells(&ghost_cells);
+    add_bonded_forces_cells(0, local_cells.n, 0, overlap.p_vir);
+    packed_pair_loop(0, local_cells.n, 0, overlap.p_vir);
+    packed_cells_scatter_forces();
+#ifdef NPT
+    if(integ_switch == INTEG_METHOD_NPT_ISO)
+      for (c = 0; c < 3; c++)
+	nptiso.p_vir[c] += overlap.p_vir[c];
+#endif
+  }
+  else {
+    for (c = 0; c < local_cells.n; c++)
+      if (!dd.cell_inter[c].inner)
+	calculate_verlet_ia_cell(c);
   }
 }
 
 void build_verlet_lists_and_calc_verlet_ia()
 {
   int c, np1, n, np2, i ,j, j_start;
-  Cell *cell;
   IA_Neighbor *neighbor;
   Particle *p1, *p2;
   PairList *pl;
@@ -209,18 +619,18 @@ void build_verlet_lists_and_calc_verlet_ia()
 
   if (!dd.use_vList) { fprintf(stderr, "%d: build_verlet_lists, but use_vList == 0\n", this_node); errexit(); }
 #endif
+
+  cell_records_valid = 0;
  
   /* Loop local cells */
   for (c = 0; c < local_cells.n; c++) {
     VERLET_TRACE(fprintf(stderr,"%d: cell %d with %d neighbors\n",this_node,c, dd.cell_inter[c].n_neighbors));
 
-    cell = local_cells.cell[c];
-    p1   = cell->part;
-    np1  = cell->n;
-    
     /* Loop cell neighbors */
     for (n = 0; n < dd.cell_inter[c].n_neighbors; n++) {
       neighbor = &dd.cell_inter[c].nList[n];
+      p1  = neighbor->pList1->part;
+      np1 = neighbor->pList1->n;
       p2  = neighbor->pList->part;
       np2 = neighbor->pList->n;
       VERLET_TRACE(fprintf(stderr,"%d: neighbor %d contains %d parts\n",this_node,n,np2));
@@ -260,6 +670,8 @@ void build_verlet_lists_and_calc_verlet_ia()
 	}
       }
       resize_verlet_list(pl);
+      if (dd.use_packed)
+	packed_cells_pair_indices(neighbor);
       VERLET_TRACE(fprintf(stderr,"%d: neighbor %d has %d pairs\n",this_node,n,pl->n));
       VERLET_TRACE(sum += pl->n);
     }
@@ -91,12 +91,39 @@ void init_pairList(PairList *list);
 /** Free a Pair List . */
 void free_pairList(PairList *list);
 
-/** Fill verlet tables. */
+/** Fill verlet tables. If \ref DomainDecomposition::use_incremental
+    is set, this calls \ref build_verlet_lists_incremental. */
 void build_verlet_lists();
 
+/** Rebuild only the verlet tables of the cell pairs where at least one
+    of the cells has changed since the last call, i. e. particles were
+    exchanged or moved further than a quarter of the skin. To keep the
+    other tables valid, all tables contain the pairs within \ref
+    max_range_non_bonded plus twice that margin, as far as the cell
+    size allows. */
+void build_verlet_lists_incremental();
+
+/** Force a full rebuild at the next call of \ref
+    build_verlet_lists_incremental, e. g. because the cells or the
+    particle properties changed. */
+void invalidate_verlet_cell_records();
+
 /** Nonbonded and bonded force calculation using the verlet list */
 void calculate_verlet_ia();
 
+/** Nonbonded and bonded force calculation using the verlet list,
+    with the pair loop running on the packed particle data of \ref
+    packed_cells.h. Only valid if \ref packed_cells_applicable. */
+void calculate_verlet_ia_packed();
+
+/** Update the ghost positions and calculate the nonbonded and
+    bonded forces with the verlet lists. While the ghost positions
+    are transferred, the forces of the inner cells (see \ref
+    IA_Neighbor_List::inner) are calculated, and the remaining cells
+    afterwards. Uses the packed pair loop if \ref
+    packed_cells_applicable. The verlet lists have to be valid. */
+void calculate_verlet_ia_overlapped();
+
 /** Fill verlet tables and Calculate nonbonded and bonded forces. This
     is a combination of \ref build_verlet_lists and
     \ref calculate_verlet_ia.
@@ -0,0 +1,191 @@
+# Copyright (C) 2010,2011 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Runs a short MD of a Lennard-Jones fluid (optionally charged, and
+# at constant pressure) with the different options of the domain
+# decomposition and compares the trajectories to the ones of the
+# default options. A droplet in a corner of a larger box checks the
+# load balancing.
+#
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+require_feature "ADRESS" off
+
+puts "----------------------------------------"
+puts "- Testcase cellsystem.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "----------------------------------------"
+
+set epsilon 1e-6
+set box 9.0
+set droplet_box 16.0
+set steps 100
+
+# the options to compare to the default
+set flagsets {
+    {-no_verlet_list}
+    {-no_packed}
+    {-cluster_list}
+    {-cluster_list -no_packed}
+    {-eighth_shell}
+    {-overlap_comm}
+    {-overlap_comm -no_packed}
+    {-sort_particles}
+    {-sort_cells}
+    {-sort_particles -sort_cells}
+    {-incremental_verlet_list}
+    {-incremental_verlet_list -no_packed}
+    {-eighth_shell -overlap_comm -sort_particles -sort_cells}
+}
+
+# a jittered cubic lattice, so that no warmup is needed. The droplet
+# is the same lattice with spacing 1.1 in the corner of the box.
+proc setup_particles {charged droplet} {
+    global box initial
+    set n 7
+    if {$droplet} { set a 1.1 } { set a [expr $box/$n] }
+    if {![info exists initial]} {
+	expr srand(42)
+	set id 0
+	for {set i 0} {$i < $n} {incr i} {
+	    for {set j 0} {$j < $n} {incr j} {
+		for {set k 0} {$k < $n} {incr k} {
+		    set pos [list \
+				 [expr $i + 0.1*rand()] \
+				 [expr $j + 0.1*rand()] \
+				 [expr $k + 0.1*rand()]]
+		    set v [list [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5]]
+		    lappend initial [list $id [expr $id % 2] $pos $v]
+		    incr id
+		}
+	    }
+	}
+    }
+    part deleteall
+    foreach p $initial {
+	foreach {id type pos v} $p break
+	eval part $id pos [vecscale $a $pos] v $v type $type
+	if {$charged} { part $id q [expr 1 - 2*$type] }
+    }
+}
+
+# run the MD and return energy and final positions and forces
+proc run_md {flags charged npt {droplet 0}} {
+    global steps box droplet_box
+    eval cellsystem domain_decomposition $flags
+    if {$droplet} {
+	setmd box_l $droplet_box $droplet_box $droplet_box
+    } {
+	setmd box_l $box $box $box
+    }
+    setup_particles $charged $droplet
+    if {$npt} {
+	integrate set npt_isotropic 1.0 1e-3
+	setmd npt_p_diff 0.0
+    } {
+	integrate set nvt
+    }
+    if {$charged} {
+	inter coulomb 1.0 p3m 2.5 16 5 1.1
+    }
+    integrate $steps
+
+    set res [list [analyze energy total] [setmd n_part] [setmd box_l]]
+    for {set i 0} {$i <= [setmd max_part]} {incr i} {
+	lappend res [concat [part $i print pos f]]
+    }
+    if {$charged} { inter coulomb 0.0 }
+    return $res
+}
+
+proc compare {ref res flags} {
+    global epsilon
+
+    foreach {eref nref bref} $ref break
+    foreach {eres nres bres} $res break
+    if {$nres != $nref} {
+	error "$flags: lost particles, $nres instead of $nref"
+    }
+    if {abs($eres - $eref) > $epsilon*abs($eref)} {
+	error "$flags: energy $eres differs from $eref"
+    }
+    if {abs([lindex $bres 0] - [lindex $bref 0]) > $epsilon} {
+	error "$flags: box length $bres differs from $bref"
+    }
+    set maxdev 0
+    foreach pref [lrange $ref 3 end] pres [lrange $res 3 end] {
+	foreach x $pref y $pres {
+	    set dev [expr abs($x - $y)]
+	    if {$dev > $maxdev} { set maxdev $dev }
+	}
+    }
+    puts "$flags: maximal position/force deviation $maxdev"
+    if {$maxdev > $epsilon} {
+	error "$flags: trajectory differs from the default one"
+    }
+}
+
+if { [catch {
+    setmd box_l $box $box $box
+    thermostat off
+    setmd time_step 0.005
+    setmd skin 0.3
+
+    inter 0 0 lennard-jones 1.0 1.0 2.5 auto 0.0
+    inter 1 1 lennard-jones 1.2 0.9 2.5 auto 0.0
+    inter 0 1 lennard-jones 0.8 0.95 2.5 auto 0.0
+
+    set modes {{0 0}}
+    if {[has_feature "ELECTROSTATICS"] && [has_feature "FFTW"]} { lappend modes {1 0} }
+    if {[has_feature "NPT"]} { lappend modes {0 1} }
+
+    foreach mode $modes {
+	foreach {charged npt} $mode break
+	puts "charged $charged, npt $npt"
+	set ref [run_md {} $charged $npt]
+	foreach flags $flagsets {
+	    compare $ref [run_md $flags $charged $npt] $flags
+	}
+    }
+
+    # the droplet is all on the first node with equal domains, which
+    # therefore has to shrink with load balancing
+    puts "droplet"
+    set ref [run_md {} 0 0 1]
+    set equal_box [setmd local_box_l]
+    compare $ref [run_md {-load_balance 10} 0 0 1] {-load_balance 10}
+    set balanced_box [setmd local_box_l]
+    puts "local box of node 0: $equal_box equal, $balanced_box balanced"
+    foreach n [setmd node_grid] l $equal_box lb $balanced_box {
+	if {$n > 1 && $lb >= $l} {
+	    error "domains were not balanced"
+	}
+    }
+
+    # switching off restores the equal domains
+    cellsystem domain_decomposition
+    integrate 0
+    foreach l $equal_box lb [setmd local_box_l] {
+	if {abs($lb - $l) > $epsilon} {
+	    error "domains were not reset"
+	}
+    }
+} res ] } {
+    error_exit $res
+}
+
+exit 0
@@ -30,6 +30,9 @@ puts "- Testcase el2d.tcl running on [format %02d [setmd n_nodes]] nodes: -"
 puts "-------------------------------------------"
 
 set epsilon 1e-3
+# the tabulated near formula has to agree with the direct one
+# within the pairwise error
+set epsilon_table 1e-4
 thermostat off
 setmd time_step 0.01
 setmd skin 0.05
@@ -137,6 +140,72 @@ if { [catch {
 	error "MMM2D layered relative energy error too large"
     }
 
+    #########################################
+    ####      check the tabulated near formula
+    #########################################
+
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set Fnear($i) [part $i pr f]
+    }
+    set near_energy $toteng
+
+    inter coulomb 1.0 mmm2d 1e-4 near_table
+    puts -nonewline "MMM2D near_table  "
+    flush stdout
+
+    invalidate_system
+    integrate 0
+    if { [string first "near_table" [inter coulomb]] < 0 } {
+	error "MMM2D near formula was not tabulated"
+    }
+
+    ############## deviation from the direct near formula
+
+    set maxdf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach x [part $i pr f] y $Fnear($i) {
+	    set df [expr abs($x - $y)]
+	    if { $df > $maxdf } { set maxdf $df }
+	}
+    }
+    set toteng [analyze energy total]
+    set rel_eng_error [expr abs(($toteng - $near_energy)/$near_energy)]
+    puts "maximal force deviation $maxdf, relative energy deviation $rel_eng_error from the direct near formula"
+    if { $maxdf > $epsilon_table || $rel_eng_error > $epsilon } {
+	error "MMM2D near_table deviates from the direct near formula"
+    }
+
+    ############## RMS force error for MMM2D, near_table
+
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach x [part $i pr f] y $F($i) {
+	    set rmsf [expr $rmsf + ($x - $y)*($x - $y)]
+	}
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    puts "rms force deviation $rmsf"
+    if { $rmsf > $epsilon } {
+	error "MMM2D near_table force error too large"
+    }
+
+    set rel_eng_error [expr abs(($toteng - $energy)/$energy)]
+    puts "relative energy deviations: $rel_eng_error"
+    if { $rel_eng_error > $epsilon } {
+	error "MMM2D near_table relative energy error too large"
+    }
+
+    # a table for this error would be too large
+    if { ![catch {inter coulomb 1.0 mmm2d 1e-12 near_table} err] ||
+	 [string first "319" $err] < 0 } {
+	error "too large near formula table was not reported"
+    }
+    if { [string first "near_table" [inter coulomb]] >= 0 } {
+	error "too large near formula table was not switched off"
+    }
+
+    inter coulomb 1.0 mmm2d 1e-4
+
     #########################################
     ####      check with nsquare
     #########################################
@@ -0,0 +1,169 @@
+# Copyright (C) 2010,2011 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Ions between two dielectric walls, which are discretized into
+# surface elements. The induced charges of the different ICCP3M
+# solvers have to agree with the ones of the relaxed iteration, also
+# during a short MD. The response solver has to be recalculated when
+# the electrostatics change, and its size limit is checked.
+#
+source "tests_common.tcl"
+
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+require_feature "EXTERNAL_FORCES"
+require_feature "ADRESS" off
+
+puts "----------------------------------------"
+puts "- Testcase iccp3m.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "----------------------------------------"
+
+set epsilon 1e-5
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+proc write_data {file} {
+    set f [open $file "w"]
+    blockfile $f write variable box_l
+    blockfile $f write tclvariable {last_ind_id areas normals eps}
+    blockfile $f write particles {id pos q fix}
+    close $f
+}
+
+# the current induced charges
+proc induced_charges {} {
+    global last_ind_id
+    set res {}
+    for {set i 0} {$i <= $last_ind_id} {incr i} {
+	lappend res [part $i print q]
+    }
+    return $res
+}
+
+# calculate the induced charges for the initial configuration and
+# after a few MD steps, and return the charges and ion positions
+proc run_icc {solver} {
+    global last_ind_id areas normals eps
+    part deleteall
+    read_data "iccp3m_system.data"
+    integrate 0
+    eval iccp3m $last_ind_id 80.0 500 1e-8 0.7 [list $areas] [list $normals] [list $eps] $solver
+
+    set res [induced_charges]
+    set seeds {}
+    for {set n 0} {$n < [setmd n_nodes]} {incr n} { lappend seeds [expr 7 + $n] }
+    eval t_random seed $seeds
+    for {set step 0} {$step < 5} {incr step} {
+	integrate 5
+	iccp3m iterate
+    }
+    for {set i 0} {$i <= [setmd max_part]} {incr i} {
+	if {$i <= $last_ind_id} {
+	    lappend res [part $i print q]
+	} {
+	    eval lappend res [part $i print pos]
+	}
+    }
+    return $res
+}
+
+proc compare {ref res name refname} {
+    global epsilon
+    set maxq 0
+    set maxdev 0
+    foreach x $ref y $res {
+	if {abs($x) > $maxq} { set maxq [expr abs($x)] }
+	set dev [expr abs($x - $y)]
+	if {$dev > $maxdev} { set maxdev $dev }
+    }
+    puts "$name: maximal deviation $maxdev from $refname"
+    if {$maxdev > $epsilon*$maxq} {
+	error "$name: induced charges differ from $refname"
+    }
+}
+
+if { [catch {
+    read_data "iccp3m_system.data"
+    setmd time_step 0.01
+    setmd skin 0.3
+    thermostat langevin 1.0 1.0
+    inter coulomb 1.0 p3m 3.0 32 5 1.2
+
+    # here you can create the necessary snapshot: the walls at z=3 and
+    # z=7 of 10x10 surface elements, with the ions outside
+    if { 0 } {
+	set box 10.0
+	setmd box_l $box $box $box
+	part deleteall
+	set areas {}
+	set normals {}
+	set eps {}
+	set id 0
+	foreach z {3.0 7.0} nz {-1 1} {
+	    for {set x 0} {$x < $box} {incr x} {
+		for {set y 0} {$y < $box} {incr y} {
+		    part $id pos [expr $x + 0.5] [expr $y + 0.5] $z q 0.001 fix
+		    lappend areas 1.0
+		    lappend normals 0 0 $nz
+		    lappend eps 2.0
+		    incr id
+		}
+	    }
+	}
+	set last_ind_id [expr $id - 1]
+	expr srand(3)
+	for {set i 0} {$i < 20} {incr i} {
+	    set z [expr rand()*2.0 + 0.2]
+	    if {$i % 2} { set z [expr $box - $z] }
+	    part $id pos [expr rand()*$box] [expr rand()*$box] $z \
+		q [expr ($i % 4 < 2) ? 1 : -1]
+	    incr id
+	}
+	write_data "iccp3m_system.data"
+    }
+
+    set ref [run_icc {solver sor}]
+    set gmres [run_icc {solver gmres}]
+    compare $ref $gmres "gmres" "sor"
+    compare $ref [run_icc {solver gmres 4}] "gmres 4" "sor"
+    set response [run_icc {solver response}]
+    compare $ref $response "response" "sor"
+    compare $gmres $response "response" "gmres"
+
+    # the response has to be recalculated when the electrostatics
+    # parameters change, here the dielectric constant of the surrounding
+    inter coulomb epsilon 1.0
+    iccp3m iterate
+    set response [induced_charges]
+    eval iccp3m $last_ind_id 80.0 500 1e-8 0.7 [list $areas] [list $normals] [list $eps] solver sor
+    compare [induced_charges] $response "response, epsilon 1" "sor"
+    inter coulomb epsilon metallic
+
+    # the dense response matrix is limited in size
+    if {![catch {iccp3m 2000 80.0 500 1e-8 0.7 {} {} {} solver response} err] || \
+	    ![string match "*limited to 2000 surface elements*" $err]} {
+	error "response for 2001 surface elements was not rejected"
+    }
+} res ] } {
+    error_exit $res
+}
+
+exit 0
@@ -47,29 +47,14 @@ proc write_data {file} {
     close $f
 }
 
-if { [catch {
-    read_data "mmm1d_system.data"
-
-    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
-	set F($i) [part $i pr f]
-    }
-    ############## mmm1d-specific part
-
-    setmd periodic 0 0 1
-    inter coulomb 1.0 mmm1d 6.0 3 0.0001
+# maximal deviation of the forces from the reference forces
+proc check_forces {name} {
+    global epsilon F
 
     # to ensure force recalculation
     invalidate_system
     integrate 0
 
-    # here you can create the necessary snapshot
-    if { 0 } {
-	inter coulomb 1.0 mmm1d tune 1e-20
-	write_data "mmm1d_system.data22"
-    }
-
-    ############## end
-
     set maxdx 0
     set maxpx 0
     set maxdy 0
@@ -96,13 +81,58 @@ if { [catch {
 	    set maxpz $i
 	}
     }
-    puts "maximal force deviation in x $maxdx for particle $maxpx, in y $maxdy for particle $maxpy, in z $maxdz for particle $maxpz"
+    puts "$name: maximal force deviation in x $maxdx for particle $maxpx, in y $maxdy for particle $maxpy, in z $maxdz for particle $maxpz"
     if { $maxdx > $epsilon || $maxdy > $epsilon || $maxdz > $epsilon } {
 	if { $maxdx > $epsilon} {puts "force of particle $maxpx: [part $maxpx pr f] != $F($maxpx)"}
 	if { $maxdy > $epsilon} {puts "force of particle $maxpy: [part $maxpy pr f] != $F($maxpy)"}
 	if { $maxdz > $epsilon} {puts "force of particle $maxpz: [part $maxpz pr f] != $F($maxpz)"}
-	error "force error too large"
+	error "$name: force error too large"
+    }
+    return [expr max($maxdx, $maxdy, $maxdz)]
+}
+
+if { [catch {
+    read_data "mmm1d_system.data"
+
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+    }
+    ############## mmm1d-specific part
+
+    setmd periodic 0 0 1
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001
+
+    # here you can create the necessary snapshot
+    if { 0 } {
+	inter coulomb 1.0 mmm1d tune 1e-20
+	write_data "mmm1d_system.data22"
+    }
+
+    ############## end
+
+    set direct [check_forces "direct"]
+
+    ############## tabulated interaction
+
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001 table
+    set tabulated [check_forces "table"]
+    if { [string first "table" [inter coulomb]] < 0 } {
+	error "interaction was not tabulated"
+    }
+    # the interpolation error is well below the pairwise error
+    if { $tabulated > 1.5*$direct } {
+	error "table is less accurate than the direct calculation"
+    }
+
+    # a table for this error would be too large
+    if { ![catch {inter coulomb 1.0 mmm1d 6.0 3 1e-12 table} err] ||
+	 [string first "320" $err] < 0 } {
+	error "too large table was not reported"
+    }
+    if { [string first "table" [inter coulomb]] >= 0 } {
+	error "too large table was not switched off"
     }
+    check_forces "switched off table"
 } res ] } {
     error_exit $res
 }
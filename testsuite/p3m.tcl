@@ -41,6 +41,27 @@ proc read_data {file} {
     close $f
 }
 
+# relative energy and rms force deviation from the reference
+proc check_p3m {name epsilon} {
+    global energy F
+    set cureng [lindex [analyze energy coulomb] 0]
+    set rel_eng_error [expr abs(($cureng - $energy)/$energy)]
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach x [part $i pr f] y $F($i) {
+	    set rmsf [expr $rmsf + ($x - $y)*($x - $y)]
+	}
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    puts "p3m-charges $name: relative energy deviation $rel_eng_error, rms force deviation $rmsf"
+    if { $rel_eng_error > $epsilon } {
+	error "p3m-charges $name: relative energy error too large"
+    }
+    if { $rmsf > $epsilon } {
+	error "p3m-charges $name: force error too large"
+    }
+}
+
 proc write_data {file} {
     set f [open $file "w"]
     blockfile $f write variable box_l
@@ -122,6 +143,92 @@ if { [catch {
    }
    
    
+    ############## the other P3M schemes with the same parameters
+
+    foreach {name opts} {
+	"ad"                {differentiation ad}
+	"interlaced ik"     {differentiation ik interlace 1}
+	"interlaced ad"     {differentiation ad interlace 1}
+	"kspace_nodes 1"    {differentiation ik interlace 0 kspace_nodes 1}
+	"kspace_nodes 1 ad" {differentiation ad kspace_nodes 1}
+    } {
+	eval inter coulomb $opts
+	invalidate_system
+	integrate 0
+	check_p3m $name $epsilon
+    }
+    inter coulomb differentiation ik interlace 0 kspace_nodes 0
+
+    ############## influence function files
+
+    set p3m [lrange [lindex [inter coulomb] 0] 3 end]
+    foreach f [glob -nocomplain p3m_influence_*.dat] { file delete $f }
+    inter coulomb influence_cache 1
+    invalidate_system
+    integrate 0
+    check_p3m "influence_cache" $epsilon
+    set files [glob -nocomplain p3m_influence_*.dat]
+    if { [llength $files] != [setmd n_nodes] } {
+	error "p3m-charges: [llength $files] influence function files instead of [setmd n_nodes]"
+    }
+    # mark the files, and push the influence functions out of the memory by other meshes
+    foreach f $files { file mtime $f 1000000000 }
+    foreach mesh {16 20 24 28} {
+	inter coulomb 1.0 p3m [lindex $p3m 0] $mesh [lindex $p3m 2] [lindex $p3m 3]
+	integrate 0
+    }
+    # this now has to read the files instead of calculating new ones
+    eval inter coulomb 1.0 p3m $p3m
+    inter coulomb influence_cache 1
+    invalidate_system
+    integrate 0
+    check_p3m "influence_cache read" $epsilon
+    foreach f $files {
+	if { [file mtime $f] != 1000000000 } {
+	    error "p3m-charges: the influence function file $f was not reused"
+	}
+    }
+    inter coulomb influence_cache 0
+    foreach f [glob -nocomplain p3m_influence_*.dat] { file delete $f }
+
+    ############## rescaling of the influence functions
+
+    # with all lengths scaled by s, r_cut and alpha scale along, so
+    # that the energy scales with 1/s and the forces with 1/s^2. This
+    # holds up to the rounding error of the meshes.
+    set s 1.1
+    if { [has_feature "P3M_SINGLE_PRECISION"] } {
+	set epsilon_scale 1e-6
+    } {
+	set epsilon_scale 1e-8
+    }
+    inter 0 0 lennard-jones 0.0 1.0 0.0
+    integrate 0
+    set e0 [lindex [analyze energy coulomb] 0]
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F0($i) [part $i pr f]
+	set P0($i) [part $i pr pos]
+    }
+    set box [setmd box_l]
+    setmd box_l [expr $s*[lindex $box 0]] [expr $s*[lindex $box 1]] [expr $s*[lindex $box 2]]
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	eval part $i pos [vecscale $s $P0($i)]
+    }
+    integrate 0
+    set rel_eng_error [expr abs(($s*[lindex [analyze energy coulomb] 0] - $e0)/$e0)]
+    set maxf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach x [part $i pr f] y $F0($i) {
+	    set d [expr abs($s*$s*$x - $y)]
+	    if { $d > $maxf } { set maxf $d }
+	}
+    }
+    puts "p3m-charges box scaled by $s: relative energy deviation $rel_eng_error, maximal force deviation $maxf"
+    if { $rel_eng_error > $epsilon_scale || $maxf > $epsilon_scale } {
+	error "p3m-charges: rescaled influence functions are wrong"
+    }
+    setmd box_l [lindex $box 0] [lindex $box 1] [lindex $box 2]
+
      #end this part of the p3m-checks by cleaning the system .... 
    part deleteall
    inter coulomb 0.0
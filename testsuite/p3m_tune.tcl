@@ -0,0 +1,118 @@
+# Copyright (C) 2010,2011 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# check the model based P3M tuning and the tuning cache file
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase p3m_tune.tcl running on [format %02d [setmd n_nodes]] nodes"
+puts "---------------------------------------------------------------"
+
+# the accuracy only bounds the force error, the energy is less accurate
+set epsilon 1e-3
+set epsilon_energy 1e-2
+set cache "p3m_tune_cache.dat"
+thermostat off
+setmd time_step 0.01
+setmd skin 0.05
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+# tune from scratch and check the forces against the reference
+proc tune {} {
+    global cache energy F epsilon epsilon_energy
+    set log [inter coulomb 1.0 p3m tune accuracy 1e-4 r_cut 0 mesh 0 cao 0 model 4 cache $cache]
+    invalidate_system
+    integrate 0
+
+    set cureng [lindex [analyze energy coulomb] 0]
+    set rel_eng_error [expr abs(($cureng - $energy)/$energy)]
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach x [part $i pr f] y $F($i) {
+	    set rmsf [expr $rmsf + ($x - $y)*($x - $y)]
+	}
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    puts "[lindex [inter coulomb] 0]: relative energy deviation $rel_eng_error, rms force deviation $rmsf"
+    if { $rel_eng_error > $epsilon_energy || $rmsf > $epsilon } {
+	error "tuned P3M parameters are not accurate enough"
+    }
+    return $log
+}
+
+if { [catch {
+    read_data "p3m_system.data"
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+    }
+    file delete $cache
+
+    # first run: calibrates the cost model and tunes
+    set log [tune]
+    if { [string first "tuning cache" $log] >= 0 } {
+	error "empty tuning cache was used"
+    }
+    set params [lindex [inter coulomb] 0]
+    set f [open $cache "r"]
+    set content [read $f]
+    close $f
+    if { [regexp -all -line {^calibration } $content] != 1 || [regexp -all -line {^result } $content] != 1 } {
+	error "tuning cache does not contain the calibration and the result"
+    }
+
+    # second run: takes the parameters from the cache
+    set log [tune]
+    if { [string first "parameters from tuning cache" $log] < 0 } {
+	error "tuning cache was not used"
+    }
+    if { [lindex [inter coulomb] 0] != $params } {
+	error "parameters from the tuning cache [lindex [inter coulomb] 0] differ from $params"
+    }
+
+    # truncated and malformed records are reported and skipped
+    set f [open $cache "w"]
+    puts $f "result 1 2 3"
+    puts -nonewline $f $content
+    puts $f "calibration 1 0 abc"
+    puts -nonewline $f "result [lrange [lindex [split $content "\n"] 1] 1 10]"
+    close $f
+    set log [tune]
+    if { [regexp -all {ignoring malformed} $log] != 3 } {
+	error "malformed tuning cache records were not reported:\n$log"
+    }
+    if { [string first "parameters from tuning cache" $log] < 0 } {
+	error "tuning cache was not used after the malformed records"
+    }
+    if { [lindex [inter coulomb] 0] != $params } {
+	error "parameters from the tuning cache [lindex [inter coulomb] 0] differ from $params"
+    }
+
+    file delete $cache
+} res ] } {
+    error_exit $res
+}
+
+exit 0
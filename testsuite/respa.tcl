@@ -0,0 +1,160 @@
+# Copyright (C) 2010,2011 The ESPResSo project
+#
+# This file is part of ESPResSo.
+#
+# ESPResSo is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# ESPResSo is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks the RESPA integrator on a charged Lennard-Jones fluid: with
+# n=1 it has to reproduce the velocity Verlet trajectory, with larger
+# n the energy has to be conserved about as well as with velocity
+# Verlet. MAGGS and magnetostatics have to be rejected.
+#
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+require_feature "ADRESS" off
+
+puts "----------------------------------------"
+puts "- Testcase respa.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "----------------------------------------"
+
+set epsilon 1e-8
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+proc write_data {file} {
+    set f [open $file "w"]
+    blockfile $f write variable box_l
+    blockfile $f write particles {id pos v q}
+    close $f
+}
+
+# run the MD in chunks of steps, and return the maximal deviation
+# of the total energy from the initial one and the final positions
+# and velocities
+proc run_md {method chunks steps} {
+    eval integrate set $method
+    part deleteall
+    read_data "respa_system.data"
+    set e0 [analyze energy total]
+    set maxdev 0
+    for {set c 0} {$c < $chunks} {incr c} {
+	integrate $steps
+	set dev [expr abs([analyze energy total] - $e0)]
+	if {$dev > $maxdev} { set maxdev $dev }
+    }
+    set res [list $maxdev]
+    for {set i 0} {$i <= [setmd max_part]} {incr i} {
+	lappend res [concat [part $i print pos v]]
+    }
+    return $res
+}
+
+if { [catch {
+    read_data "respa_system.data"
+    thermostat off
+    setmd time_step 0.005
+    setmd skin 0.3
+
+    inter 0 0 lennard-jones 1.0 1.0 1.12246 auto 0.0
+    inter coulomb 2.0 p3m 2.5 16 5 1.1
+
+    # here you can create the necessary snapshot: a jittered, charged
+    # cubic lattice, so that no warmup is needed
+    if { 0 } {
+	set box 9.0
+	set n 7
+	set a [expr $box/$n]
+	setmd box_l $box $box $box
+	part deleteall
+	expr srand(42)
+	set id 0
+	for {set i 0} {$i < $n} {incr i} {
+	    for {set j 0} {$j < $n} {incr j} {
+		for {set k 0} {$k < $n} {incr k} {
+		    part $id \
+			pos [expr ($i + 0.1*rand())*$a] [expr ($j + 0.1*rand())*$a] [expr ($k + 0.1*rand())*$a] \
+			v [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5] \
+			q [expr 1 - 2*(($i + $j + $k) % 2)]
+		    incr id
+		}
+	    }
+	}
+	write_data "respa_system.data"
+    }
+
+    # n=1 is velocity Verlet
+    set ref [run_md nvt 5 20]
+    set res [run_md {respa 1} 5 20]
+    set maxdev 0
+    foreach pref [lrange $ref 1 end] pres [lrange $res 1 end] {
+	foreach x $pref y $pres {
+	    set dev [expr abs($x - $y)]
+	    if {$dev > $maxdev} { set maxdev $dev }
+	}
+    }
+    puts "respa 1: maximal position/velocity deviation from velocity Verlet $maxdev"
+    if {$maxdev > $epsilon} {
+	error "respa 1 differs from velocity Verlet"
+    }
+
+    # energy conservation, also with integrate calls that end within a cycle
+    set verlet [lindex [run_md nvt 10 30] 0]
+    puts "velocity Verlet: maximal energy deviation $verlet"
+    foreach {n steps} {2 30 3 30 4 30 3 25} {
+	set respa [lindex [run_md "respa $n" 10 $steps] 0]
+	puts "respa $n, $steps steps per call: maximal energy deviation $respa"
+	if {$respa > 2*$verlet} {
+	    error "respa $n does not conserve the energy"
+	}
+    }
+    integrate set nvt
+
+    # methods with field propagation or torques are not supported
+    inter coulomb 0.0
+    part deleteall
+    part 0 pos 1 1 1 q 1
+    part 1 pos 3 1 1 q -1
+    cellsystem domain_decomposition -no_verlet_list
+    inter coulomb 1.0 memd 0.01 8
+    integrate set respa 2
+    if {![catch {integrate 1} err] || ![string match "*317*" $err]} {
+	error "respa was not rejected for maggs"
+    }
+    integrate set nvt
+    inter coulomb 0.0
+    cellsystem domain_decomposition
+    if {[has_feature "DIPOLES"] && [setmd n_nodes] == 1} {
+	part deleteall
+	part 0 pos 1 1 1 dip 1 0 0
+	part 1 pos 3 1 1 dip 0 1 0
+	inter magnetic 1.0 dawaanr
+	integrate set respa 2
+	if {![catch {integrate 1} err] || ![string match "*317*" $err]} {
+	    error "respa was not rejected for magnetostatics"
+	}
+	integrate set nvt
+	inter magnetic 0.0
+    }
+} res ] } {
+    error_exit $res
+}
+
+exit 0